@@ -40,6 +40,10 @@ along with this program.  If not, see <https://www.gnu.org/licenses/>.
 #include <QDebug>
 #include <QSettings>
 #include <QByteArray>
+#include <QDir>
+#include <QTextStream>
+
+#include <memory>
 
 #include "model/editableitemmanager.h"
 #include "model/editableItems/personnage.h"
@@ -50,6 +54,9 @@ along with this program.  If not, see <https://www.gnu.org/licenses/>.
 
 #include "model/editableItemsManagers/jsoneditableitemmanager.h"
 
+#include "text/comicscript.h"
+#include "text/documentexporters.h"
+
 #include "gui/editors/personnageeditor.h"
 #include "gui/editors/placeeditor.h"
 #include "gui/editors/cartographyeditor.h"
@@ -165,6 +172,71 @@ void App::openProject(QString const& projectFile) {
 
 }
 
+int App::exportProjectScripts(QString const& projectFile, QString const& format, QString const& outDir) {
+
+	QTextStream err(stderr);
+
+	ComicScriptTextStyleManager styles;
+	std::unique_ptr<TextDocumentExporter> exporter(TextDocumentExporter::createExporter(format, &styles));
+
+	if (exporter == nullptr) {
+		err << tr("Unknown export format %1, available formats are: %2").arg(format).arg(TextDocumentExporter::availableFormats().join(", ")) << Qt::endl;
+		return 1;
+	}
+
+	QDir dir(outDir);
+
+	if (!dir.exists() and !dir.mkpath(".")) {
+		err << tr("Impossible to create the output directory %1").arg(outDir) << Qt::endl;
+		return 1;
+	}
+
+	loadEditableFactories();
+
+	JsonEditableItemManager* project = configureJsonProject();
+
+	project->connectProject(projectFile);
+
+	if (!project->hasDataSource()) {
+		err << tr("Impossible to open the project %1").arg(projectFile) << Qt::endl;
+		delete project;
+		return 1;
+	}
+
+	int nFailed = 0;
+
+	for (QString const& ref : project->itemsRefsOfType(Comicscript::COMICSTRIP_TYPE_ID)) {
+
+		Comicscript* script = nullptr;
+
+		try {
+			script = qobject_cast<Comicscript*>(project->loadItem(ref));
+		} catch (ItemIOException const& e) {
+			err << e.what() << Qt::endl;
+		}
+
+		if (script == nullptr) {
+			nFailed++;
+			continue;
+		}
+
+		exporter->setTitle(script->objectName());
+
+		QString fileName = dir.filePath(ref + exporter->fileExtension());
+
+		if (!exporter->exportDocument(script->document(), fileName)) {
+			err << tr("Impossible to export the script %1 to %2").arg(ref).arg(fileName) << Qt::endl;
+			nFailed++;
+		}
+
+		project->closeAll(); //keep a single script in memory at a time.
+	}
+
+	delete project;
+
+	return (nFailed > 0) ? 1 : 0;
+}
+
 void App::buildMainWindow() {
 
 	if (_mainWindow != nullptr) {
@@ -285,6 +357,7 @@ void App::loadEditableFactories() {
 
 	getAppEditableItemFactoryManager()->installSubItemFactory(new CartographyItem::CartographyItemFactory());
 	getAppEditableItemFactoryManager()->installSubItemFactory(new CartographyCategory::CartographyCategoryFactory());
+	getAppEditableItemFactoryManager()->installSubItemFactory(new CartographyVectorItem::CartographyVectorItemFactory());
 
 }
 
@@ -53,6 +53,18 @@ public:
 
 	void openProject(QString const& projectFile);
 
+	/*!
+	 * \brief exportProjectScripts export all the comic scripts of a project, one file per script, without opening any window.
+	 *
+	 * The scripts are loaded and written one at a time, so the memory used does not grow with the size of the project.
+	 *
+	 * \param projectFile the project to export.
+	 * \param format the export format id (see TextDocumentExporter::availableFormats).
+	 * \param outDir the directory in which the files are written, created if needed.
+	 * \return the exit code of the program, 0 if all the scripts have been exported.
+	 */
+	int exportProjectScripts(QString const& projectFile, QString const& format, QString const& outDir);
+
 protected:
 
 	void openFileProject();
@@ -19,8 +19,12 @@ along with this program.  If not, see <https://www.gnu.org/licenses/>.
 #include "cartographyeditor.h"
 #include "ui_cartographyeditor.h"
 
+#include "cartographypointsitem.h"
+#include "cartographyvectorsitem.h"
+
 #include "utils/settings_global_keys.h"
 #include "model/editableItems/cartography.h"
+#include "model/editableItems/cartographygeojson.h"
 
 #include <QQmlEngine>
 #include <QQmlContext>
@@ -30,9 +34,11 @@ along with this program.  If not, see <https://www.gnu.org/licenses/>.
 #include <QSettings>
 #include <QFileDialog>
 #include <QColorDialog>
+#include <QMessageBox>
 #include <QImage>
 #include <QSortFilterProxyModel>
 #include <QFont>
+#include <QScrollBar>
 
 #include <cmath>
 
@@ -40,6 +46,7 @@ namespace Sabrina {
 
 bool CartographyEditor::qmlTypeRegistrationDone = false;
 const QString CartographyEditor::CARTOGRAPHY_EDITOR_TYPE_ID = "sabrina_jdr_cartography_editor";
+const int CartographyEditor::VisibilityMargin = 200;
 
 CartographyEditor::CartographyEditor(QWidget *parent) :
 	Aline::EditableItemEditor(parent),
@@ -69,6 +76,13 @@ CartographyEditor::CartographyEditor(QWidget *parent) :
 
 	_mapProxy = new CartographyMapProxy(this, nullptr);
 
+	ui->backgroundLayersListView->setModel(_mapProxy->getBackgroundLayers());
+	ui->backgroundLayersListView->setVisible(false);
+
+	connect(_mapProxy->getBackgroundLayers(), &QAbstractItemModel::modelReset, this, [this] () {
+		ui->backgroundLayersListView->setVisible(_mapProxy->getBackgroundLayers()->rowCount() > 0);
+	});
+
 	_editor = new QQuickWidget(this);
 
 	_loader = new CartographyBackgroundLoader(_mapProxy);
@@ -77,6 +91,8 @@ CartographyEditor::CartographyEditor(QWidget *parent) :
 
 	if (!qmlTypeRegistrationDone) {
 		qmlRegisterUncreatableType<Sabrina::CartographyItem>("SabrinaCartography", 0, 1, "SabrinaCartographyItem", "Cartography items cannot be instanciated from qml.");
+		qmlRegisterType<Sabrina::CartographyPointsItem>("SabrinaCartography", 0, 1, "SabrinaCartographyPoints");
+		qmlRegisterType<Sabrina::CartographyVectorsItem>("SabrinaCartography", 0, 1, "SabrinaCartographyVectors");
 		qmlTypeRegistrationDone = true;
 	}
 
@@ -89,6 +105,11 @@ CartographyEditor::CartographyEditor(QWidget *parent) :
 	QQuickItem* rootObj = _editor->rootObject();
 
 	_mapAreaItem = rootObj->findChild<QQuickItem *>("mapArea");
+	_pointsItem = rootObj->findChild<CartographyPointsItem *>("mapPoints");
+	_vectorsItem = rootObj->findChild<CartographyVectorsItem *>("mapVectors");
+
+	connect(_pointsItem, &CartographyPointsItem::itemPressed,
+			this, &CartographyEditor::setSelectedItem);
 
 	connect(ui->removeItemButton, &QPushButton::clicked,
 			this, &CartographyEditor::onMapItemDeletionRequested);
@@ -96,6 +117,12 @@ CartographyEditor::CartographyEditor(QWidget *parent) :
 	connect(ui->backgroundOpenButton, &QPushButton::clicked,
 			this, &CartographyEditor::onBackgroundImageLoadingRequest);
 
+	connect(ui->importGeoJsonButton, &QPushButton::clicked,
+			this, &CartographyEditor::onGeoJsonImportRequest);
+
+	connect(ui->exportGeoJsonButton, &QPushButton::clicked,
+			this, &CartographyEditor::onGeoJsonExportRequest);
+
 	connect(ui->zoomPlusButton, &QPushButton::clicked,
 			_mapProxy, &CartographyMapProxy::increaseScale);
 
@@ -122,6 +149,16 @@ CartographyEditor::CartographyEditor(QWidget *parent) :
 	connect(_mapProxy, &CartographyMapProxy::clearItemSelection,
 			this, &CartographyEditor::clearSelectedItem);
 
+	connect(_mapProxy, &CartographyMapProxy::scaleChanged,
+			this, &CartographyEditor::onViewportChanged);
+
+	for (QScrollBar* bar : {ui->scrollArea->horizontalScrollBar(), ui->scrollArea->verticalScrollBar()}) {
+		connect(bar, &QScrollBar::valueChanged,
+				this, &CartographyEditor::onViewportChanged);
+		connect(bar, &QScrollBar::rangeChanged,
+				this, &CartographyEditor::onViewportChanged);
+	}
+
 	connect(ui->heightSpinBox, static_cast<void (QDoubleSpinBox::*)(qreal) >(&QDoubleSpinBox::valueChanged),
 			this, &CartographyEditor::heightSpinBoxesChange);
 
@@ -194,11 +231,16 @@ bool CartographyEditor::effectivelySetEditedItem(Aline::EditableItem* item) {
 
 	if (_currentCartography != nullptr) {
 
-		disconnect(_currentCartography, &Cartography::cartographyItemInserted,
-				this, &CartographyEditor::connectItem);
+		disconnect(_currentCartography, &Cartography::cartographyItemsInserted,
+				this, &CartographyEditor::connectItems);
 		disconnect(_currentCartography, &Cartography::cartographyItemRemoved,
 				this, &CartographyEditor::onCartographyItemRemoved);
 
+		for (CartographyItem* it : _currentCartography->getItems()) {
+			disconnect(it, &CartographyItem::refSwap,
+					   this, &CartographyEditor::mapItemRefChanged);
+		}
+
 		disconnect(ui->addItemButton, &QPushButton::clicked,
 				_currentCartography, static_cast<void (Cartography::*)()>(&Cartography::addCartoPoint));
 
@@ -211,20 +253,23 @@ bool CartographyEditor::effectivelySetEditedItem(Aline::EditableItem* item) {
 		disconnect(_nameWatchConnection);
 	}
 
+	clearSelectedItem();
+	_currentItems.clear();
+
 	_currentCartography = carto;
+	_pointsItem->setCartography(carto);
+	_vectorsItem->setCartography(carto);
 
 	_resizeMapOnNewBackground = false;
 	_mapProxy->setConnectedCartography(carto);
 	_resizeMapOnNewBackground = true;
 
-	for (CartographyItem* it : carto->getItems()) {
-		connectItem(it);
-	}
+	connectItems(carto->getItems());
 
 	if (carto != nullptr) {
 
-		connect(carto, &Cartography::cartographyItemInserted,
-				this, &CartographyEditor::connectItem);
+		connect(carto, &Cartography::cartographyItemsInserted,
+				this, &CartographyEditor::connectItems);
 		connect(carto, &Cartography::cartographyItemRemoved,
 				this, &CartographyEditor::onCartographyItemRemoved);
 
@@ -247,6 +292,8 @@ bool CartographyEditor::effectivelySetEditedItem(Aline::EditableItem* item) {
 
 	_categoryListProxy->setSourceModel(carto->getCategoryListModel());
 
+	onViewportChanged();
+
 	return true;
 }
 
@@ -260,7 +307,42 @@ void CartographyEditor::connectItem(CartographyItem* item) {
 		return;
 	}
 
-	CartographyItemProxy* proxy = new CartographyItemProxy(this, item);
+	connect(item, &CartographyItem::refSwap,
+			this, &CartographyEditor::mapItemRefChanged);
+
+	CartographyItemContext cont = {item, nullptr, nullptr};
+
+	_currentItems.insert(item->getRef(), cont);
+
+}
+
+void CartographyEditor::connectItems(QVector<CartographyItem*> const& items) {
+
+	for (CartographyItem* item : items) {
+		connectItem(item);
+	}
+
+}
+
+void CartographyEditor::onCartographyItemRemoved(QString oldRef) {
+
+	if (_selectedItem != nullptr and _selectedItem->_item->getRef() == oldRef) {
+		clearSelectedItem();
+	}
+
+	if (_currentItems.contains(oldRef)) {
+		_currentItems.remove(oldRef);
+	}
+
+}
+
+void CartographyEditor::createItemDelegate(CartographyItemContext & context) {
+
+	if (context._proxy != nullptr) {
+		return;
+	}
+
+	CartographyItemProxy* proxy = new CartographyItemProxy(this, context._item);
 
 	QQmlContext* rootContext = _editor->rootContext();
 
@@ -278,24 +360,25 @@ void CartographyEditor::connectItem(CartographyItem* item) {
 	connect(proxy, &QObject::destroyed,
 			itemPointItem, &QObject::deleteLater); //delete item if proxy is deleted
 
-	CartographyItemContext cont = {item, proxy, itemPointItem};
-
-	connect(proxy, &CartographyItemProxy::refSwap,
-			this, &CartographyEditor::mapItemRefChanged);
-
 	connect(proxy, &CartographyItemProxy::receivedSelectionTrigger,
 			this, &CartographyEditor::setSelectedItem);
 
-	_currentItems.insert(item->getRef(), cont);
+	context._proxy = proxy;
+	context._associatedItem = itemPointItem;
 
 }
 
-void CartographyEditor::onCartographyItemRemoved(QString oldRef) {
+void CartographyEditor::releaseItemDelegate(CartographyItemContext & context) {
 
-	if (_currentItems.contains(oldRef)) {
-		_currentItems.remove(oldRef);
+	if (context._proxy == nullptr) {
+		return;
 	}
 
+	context._proxy->deleteLater(); //the delegate is deleted with the proxy.
+
+	context._proxy = nullptr;
+	context._associatedItem = nullptr;
+
 }
 
 void CartographyEditor::mapItemRefChanged(QString oldRef, QString newRef) {
@@ -344,7 +427,7 @@ void CartographyEditor::onBackgroundImageLoadingRequest() {
 	QString file = QFileDialog::getOpenFileName((this->parentWidget() != nullptr) ? this->parentWidget() : this,
 												tr("Choisir une image de fond."),
 												dir,
-												tr("Images (*.jpg *.jpeg *.png *.tif);;jpeg (*.jpg *.jpeg);;png (*.png);;tiff (*.tif)" ));
+												tr("Images (*.jpg *.jpeg *.png *.tif *.ora *.kra);;jpeg (*.jpg *.jpeg);;png (*.png);;tiff (*.tif);;Images à calques (*.ora *.kra)" ));
 
 	if (file == "") {
 		return;
@@ -364,19 +447,75 @@ void CartographyEditor::onBackgroundImageLoadingRequest() {
 
 }
 
-void CartographyEditor::onNewBackgroundImageLoaded() {
+void CartographyEditor::onGeoJsonImportRequest() {
 
-	if (_currentCartography != nullptr) {
+	if (_currentCartography == nullptr) {
+		return;
+	}
+
+	QSettings settings;
+	QString dir = settings.value(GEOJSON_DIR_KEY, QDir::homePath()).toString();
+
+	QString file = QFileDialog::getOpenFileName((this->parentWidget() != nullptr) ? this->parentWidget() : this,
+												tr("Importer un fichier GeoJSON"),
+												dir,
+												tr("GeoJSON (*.geojson *.json)"));
+
+	if (file.isEmpty()) {
+		return;
+	}
+
+	settings.setValue(GEOJSON_DIR_KEY, QFileInfo(file).dir().absolutePath());
+
+	CartographyGeoJson geoJson;
+
+	if (geoJson.importCartography(_currentCartography, file) < 0) {
+		QMessageBox::warning(this,
+							 tr("Erreur d'importation"),
+							 tr("Le fichier %1 n'a pas pu être importé entièrement: %2").arg(file).arg(geoJson.errorString()));
+	}
+}
+void CartographyEditor::onGeoJsonExportRequest() {
+
+	if (_currentCartography == nullptr) {
+		return;
+	}
+
+	QSettings settings;
+	QString dir = settings.value(GEOJSON_DIR_KEY, QDir::homePath()).toString();
 
-		if (_resizeMapOnNewBackground) {
+	QString file = QFileDialog::getSaveFileName((this->parentWidget() != nullptr) ? this->parentWidget() : this,
+												tr("Exporter en GeoJSON"),
+												QDir(dir).filePath(_currentCartography->objectName() + ".geojson"),
+												tr("GeoJSON (*.geojson *.json)"));
 
-			QSize imSize;
-			_loader->requestImage(_mapProxy->getImageBackground(), &imSize, imSize);
+	if (file.isEmpty()) {
+		return;
+	}
 
-			_currentCartography->setSize(imSize);
+	settings.setValue(GEOJSON_DIR_KEY, QFileInfo(file).dir().absolutePath());
 
+	CartographyGeoJson geoJson;
+
+	if (!geoJson.exportCartography(_currentCartography, file)) {
+		QMessageBox::warning(this,
+							 tr("Erreur d'exportation"),
+							 tr("Impossible d'écrire le fichier %1").arg(file));
+	}
+}
+
+void CartographyEditor::onNewBackgroundImageLoaded() {
+
+	if (_currentCartography != nullptr) {
+
+		QSize imageSize = _mapProxy->getBackgroundImageSize();
+
+		if (_resizeMapOnNewBackground and imageSize.isValid()) {
+			_currentCartography->setSize(imageSize);
 		}
 
+		onViewportChanged();
+
 	}
 
 }
@@ -747,6 +886,10 @@ void CartographyEditor::clearSelectedItem() {
 
 void CartographyEditor::setSelectedItem(QString ref) {
 
+	if (_selectedItem != nullptr and ref == _selectedItem->_item->getRef()) {
+		return; //keep the delegate, it might be handling the press which selected it.
+	}
+
 	if (_selectedItem != nullptr) {
 		_selectedItem->setFocus(false);
 
@@ -759,12 +902,20 @@ void CartographyEditor::setSelectedItem(QString ref) {
 		disconnect(_selectedItem, &CartographyItemProxy::legendPositionChanged,
 				   this, &CartographyEditor::onSelectedItemLegendPosChange);
 
+		QString oldRef = _selectedItem->_item->getRef();
+
+		if (_currentItems.contains(oldRef)) {
+			releaseItemDelegate(_currentItems[oldRef]);
+		}
+
 	}
 
 	_selectedItem = nullptr;
 
 	if (ref != QString() && _currentItems.contains(ref)) {
-		CartographyItemContext cont = _currentItems.value(ref);
+		CartographyItemContext & cont = _currentItems[ref];
+
+		createItemDelegate(cont);
 
 		_selectedItem = cont._proxy;
 		_selectedItem->setFocus(true);
@@ -798,8 +949,13 @@ void CartographyEditor::setSelectedItem(QString ref) {
 		ui->spinBoxItemScale->setValue(_selectedItem->getScale()*100);
 		ui->spinBoxItemScale->blockSignals(false);
 
+		_pointsItem->setSelectedItem(_selectedItem->_item);
+
 	} else {
 
+		_pointsItem->setSelectedItem(nullptr);
+
+
 		ui->comboBoxSelectCategory->setEnabled(false);
 		ui->spinBoxItemScale->setEnabled(false);
 		ui->legendPosComboBox->setEnabled(false);
@@ -879,6 +1035,34 @@ void CartographyEditor::onSelectedItemLegendPosChange(int pos) {
 
 }
 
+QRectF CartographyEditor::visibleMapArea() const {
+
+	QWidget* viewport = ui->scrollArea->viewport();
+
+	qreal scale = _mapProxy->getScale();
+
+	if (scale <= 0) {
+		scale = 1;
+	}
+
+	QPoint topLeft = _editor->mapFrom(viewport, QPoint(0, 0));
+	qreal margin = VisibilityMargin/scale;
+
+	QRectF area(topLeft.x()/scale, topLeft.y()/scale, viewport->width()/scale, viewport->height()/scale);
+
+	return area.adjusted(-margin, -margin, margin, margin);
+}
+
+void CartographyEditor::onViewportChanged() {
+
+	QRectF area = visibleMapArea();
+
+	_mapProxy->setVisibleArea(area);
+	_pointsItem->setVisibleArea(area, _mapProxy->getScale());
+	_vectorsItem->setVisibleArea(area, _mapProxy->getScale());
+
+}
+
 CartographyEditor::CartographyEditorFactory::CartographyEditorFactory(QObject* parent) :
 	Aline::EditorFactory(parent)
 {
@@ -906,35 +1090,15 @@ CartographyItemProxy::CartographyItemProxy(CartographyEditor* parent, Cartograph
 	connect(_item, &CartographyItem::scaleChanged,
 			this, &CartographyItemProxy::scaleChanged);
 
-	connect(_item, &CartographyItem::colorChanged,
-			this, &CartographyItemProxy::colorChanged);
-
-	connect(_item, &CartographyItem::radiusChanged,
-			this, &CartographyItemProxy::radiusChanged);
-
-	connect(_item, &CartographyItem::borderColorChanged,
-			this, &CartographyItemProxy::borderColorChanged);
-
-	connect(_item, &CartographyItem::borderChanged,
-			this, &CartographyItemProxy::borderChanged);
+	Cartography* carto = _item->getCartographyParent();
 
-	connect(_item, &CartographyItem::legendFontChanged,
-			this, &CartographyItemProxy::legendFontChanged);
-
-	connect(_item, &CartographyItem::legendSizeChanged,
-			this, &CartographyItemProxy::legendSizeChanged);
-
-	connect(_item, &CartographyItem::legendBoldChanged,
-			this, &CartographyItemProxy::legendBoldChanged);
-
-	connect(_item, &CartographyItem::legendItalicChanged,
-			this, &CartographyItemProxy::legendItalicChanged);
-
-	connect(_item, &CartographyItem::legendUnderlinedChanged,
-			this, &CartographyItemProxy::legendUnderlinedChanged);
-
-	connect(_item, &CartographyItem::legendColorChanged,
-			this, &CartographyItemProxy::legendColorChanged);
+	if (carto != nullptr) {
+		connect(carto, &Cartography::categoryStyleChanged, this, [this] (int index) {
+			if (index == _item->getCategoryIndex()) {
+				onCategoryChanged();
+			}
+		});
+	}
 
 	connect(_item, &CartographyItem::linkedStatusChanged,
 			this, &CartographyItemProxy::linkedStatusChanged);
@@ -1054,6 +1218,21 @@ CartographyMapProxy::CartographyMapProxy(CartographyEditor* parent, Cartography*
 	_connectedCartography(nullptr),
 	_scale(1.0)
 {
+	_backgroundTiles = new CartographyBackgroundTilesModel(this);
+	_backgroundLayers = new CartographyBackgroundLayersModel(this);
+	_pyramidLoader = new CartographyTilePyramidLoader(this);
+
+	connect(this, &CartographyMapProxy::sizeChanged,
+			_backgroundTiles, &CartographyBackgroundTilesModel::setMapSize);
+
+	connect(_pyramidLoader, &CartographyTilePyramidLoader::previewLoaded,
+			this, &CartographyMapProxy::onBackgroundPreviewLoaded);
+	connect(_pyramidLoader, &CartographyTilePyramidLoader::pyramidLoaded,
+			this, &CartographyMapProxy::onBackgroundPyramidLoaded);
+
+	connect(_backgroundLayers, &CartographyBackgroundLayersModel::layerVisibilityRequested,
+			this, &CartographyMapProxy::onBackgroundLayerVisibilityRequested);
+
 	setConnectedCartography(carto);
 }
 
@@ -1121,6 +1300,31 @@ QString CartographyMapProxy::getImageBackgroundFile() const {
 	return "";
 }
 
+std::shared_ptr<CartographyTilePyramid const> CartographyMapProxy::getBackgroundPyramid() const {
+	QMutexLocker lock(&_backgroundMutex);
+	return _backgroundPyramid;
+}
+QImage CartographyMapProxy::getBackgroundPreview() const {
+	QMutexLocker lock(&_backgroundMutex);
+	return _backgroundPreview;
+}
+QSize CartographyMapProxy::getBackgroundImageSize() const {
+	return _backgroundImageSize;
+}
+bool CartographyMapProxy::isLoadingBackground() const {
+	return _pyramidLoader->isLoading();
+}
+QAbstractItemModel* CartographyMapProxy::getBackgroundTiles() const {
+	return _backgroundTiles;
+}
+QAbstractItemModel* CartographyMapProxy::getBackgroundLayers() const {
+	return _backgroundLayers;
+}
+void CartographyMapProxy::setVisibleArea(QRectF const& area) {
+	_visibleArea = area;
+	_backgroundTiles->setVisibleArea(area, _scale);
+}
+
 Cartography *CartographyMapProxy::getConnectedCartography() const
 {
 	return _connectedCartography;
@@ -1136,6 +1340,9 @@ void CartographyMapProxy::setConnectedCartography(Cartography *cartography)
 
 			disconnect(_connectedCartography, &Cartography::backgroundChanged,
 					   this, &CartographyMapProxy::onBackgroundChanged);
+
+			disconnect(_connectedCartography, &Cartography::toggledBackgroundLayersChanged,
+					   this, &CartographyMapProxy::applyBackgroundLayersVisibility);
 		}
 
 		_connectedCartography = cartography;
@@ -1146,8 +1353,13 @@ void CartographyMapProxy::setConnectedCartography(Cartography *cartography)
 
 			connect(cartography, &Cartography::backgroundChanged,
 					this, &CartographyMapProxy::onBackgroundChanged);
+
+			connect(cartography, &Cartography::toggledBackgroundLayersChanged,
+					this, &CartographyMapProxy::applyBackgroundLayersVisibility);
 		}
 
+		reloadBackgroundPyramid();
+
 		emit sizeChanged(getSize());
 		emit imageBackgroundChanged(getImageBackground());
 
@@ -1160,72 +1372,183 @@ void CartographyMapProxy::insertEditableItem(QByteArray refDatas) {
 
 		QDataStream stream(&refDatas, QIODevice::ReadOnly);
 		QStringList newItems;
-		int rows = 0;
 
 		while (!stream.atEnd()) {
 			QString text;
 			stream >> text;
 			newItems << text;
-			++rows;
 		}
 
+		_connectedCartography->addCartoItems(newItems); //a single insertion signal for the whole drop.
+	}
 
-		for (QString ref : newItems) {
+}
+
+void CartographyMapProxy::onBackgroundChanged() {
+	reloadBackgroundPyramid();
+	emit imageBackgroundChanged(getImageBackground());
+}
 
-			_connectedCartography->addCartoItem(ref);
+void CartographyMapProxy::reloadBackgroundPyramid() {
 
-		}
+	QString file = getImageBackgroundFile();
+
+	{
+		QMutexLocker lock(&_backgroundMutex);
+		_backgroundPyramid.reset();
+		_backgroundPreview = QImage();
+	}
+
+	_backgroundTiles->setHasPreview(false);
+	_backgroundTiles->setPyramid(nullptr);
+	_backgroundTiles->setMapSize(getSize());
+	_backgroundLayers->setPyramid(nullptr);
+
+	if (file.isEmpty()) {
+		_backgroundImageSize = QSize();
+		_pyramidLoader->cancel();
+		return;
 	}
 
+	_backgroundImageSize = CartographyTilePyramid::imageFileSize(file); //only the header is read, the image is decoded by the loader.
+	_pyramidLoader->load(file); //the layered documents are recognized by the pyramid.
 }
 
-void CartographyMapProxy::onBackgroundChanged() {
-	emit imageBackgroundChanged(getImageBackground());
+void CartographyMapProxy::onBackgroundPreviewLoaded(QImage preview) {
+
+	{
+		QMutexLocker lock(&_backgroundMutex);
+		_backgroundPreview = preview;
+	}
+
+	_backgroundTiles->setHasPreview(!preview.isNull());
+	_backgroundTiles->setVisibleArea(_visibleArea, _scale);
 }
 
-CartographyBackgroundLoader::CartographyBackgroundLoader(CartographyMapProxy* proxy) :
-	QQuickImageProvider(QQmlImageProviderBase::Image),
-	_proxy(proxy)
-{
+void CartographyMapProxy::onBackgroundPyramidLoaded(CartographyTilePyramidPtr pyramid) {
 
+	{
+		QMutexLocker lock(&_backgroundMutex);
+		_backgroundPyramid = pyramid;
+	}
+
+	applyBackgroundLayersVisibility();
+
+	_backgroundTiles->setPyramid(pyramid);
+	_backgroundTiles->setVisibleArea(_visibleArea, _scale);
+	_backgroundLayers->setPyramid(pyramid);
 }
 
-QImage CartographyBackgroundLoader::requestImage(const QString &id, QSize *size, const QSize &requestedSize) {
+void CartographyMapProxy::onBackgroundLayerVisibilityRequested(QString layerId, bool visible) {
 
-	Q_UNUSED(requestedSize);
+	if (_connectedCartography == nullptr or _backgroundPyramid == nullptr) {
+		return;
+	}
 
-	if (id == "") {
+	for (int i = 0; i < _backgroundPyramid->layersCount(); i++) {
+		if (_backgroundPyramid->layerId(i) == layerId) {
+			_connectedCartography->setBackgroundLayerToggled(layerId, visible != _backgroundPyramid->isLayerVisibleInFile(i));
+			return;
+		}
+	}
+}
+
+void CartographyMapProxy::applyBackgroundLayersVisibility() {
+
+	if (_connectedCartography == nullptr or _backgroundPyramid == nullptr) {
+		return;
+	}
+
+	bool changed = false;
 
-		QImage img;
+	for (int i = 0; i < _backgroundPyramid->layersCount(); i++) {
 
-		*size = img.size();
-		return img;
+		bool toggled = _connectedCartography->isBackgroundLayerToggled(_backgroundPyramid->layerId(i));
+		bool visible = _backgroundPyramid->isLayerVisibleInFile(i) != toggled;
 
+		if (visible != _backgroundPyramid->isLayerVisible(i)) {
+			_backgroundPyramid->setLayerVisible(i, visible);
+			changed = true;
+		}
 	}
 
-	if (id == _loadedFileName) {
-		*size = _loadedImage.size();
-		return _loadedImage;
+	if (changed) {
+		_backgroundTiles->refresh();
+		_backgroundLayers->refreshVisibility();
 	}
+}
 
-	if (id == _proxy->getImageBackground()) {
-		_loadedImage.load(_proxy->getImageBackgroundFile()); //TODO: try to be more clever to also load .ora and .kra files.
+CartographyBackgroundResponse::CartographyBackgroundResponse(std::shared_ptr<CartographyTilePyramid const> pyramid, int level, int column, int row) :
+	_pyramid(pyramid),
+	_level(level),
+	_column(column),
+	_row(row),
+	_cancelled(0)
+{
+	setAutoDelete(false); //the response is deleted by the qml engine.
+}
 
-		*size = _loadedImage.size();
-		_loadedFileName = id;
+CartographyBackgroundResponse::CartographyBackgroundResponse(QImage const& image) :
+	_pyramid(nullptr),
+	_level(-1),
+	_column(-1),
+	_row(-1),
+	_image(image),
+	_cancelled(0)
+{
+	setAutoDelete(false);
+}
+
+QQuickTextureFactory* CartographyBackgroundResponse::textureFactory() const {
+	return QQuickTextureFactory::textureFactoryForImage(_image);
+}
+
+void CartographyBackgroundResponse::run() {
 
-		return _loadedImage;
+	if (!_cancelled.loadAcquire() and _pyramid != nullptr) {
+		_image = _pyramid->tile(_level, _column, _row);
 	}
 
-	QImage img;
+	Q_EMIT finished(); //even when cancelled, so that the engine release the response.
+}
+
+void CartographyBackgroundResponse::cancel() {
+	_cancelled.storeRelease(1);
+}
 
-	*size = img.size();
-	return img;
+CartographyBackgroundLoader::CartographyBackgroundLoader(CartographyMapProxy* proxy) :
+	QQuickAsyncImageProvider(),
+	_proxy(proxy)
+{
 
 }
 
-QQmlImageProviderBase::ImageType CartographyBackgroundLoader::imageType() const {
-	return QQmlImageProviderBase::Image;
+QQuickImageResponse* CartographyBackgroundLoader::requestImageResponse(const QString &id, const QSize &requestedSize) {
+
+	Q_UNUSED(requestedSize);
+
+	CartographyBackgroundResponse* response = nullptr;
+
+	if (id.startsWith(CartographyBackgroundTilesModel::SourcePrefix)) {
+
+		//tile/<generation>/<level>/<column>/<row>, the generation is only there to invalidate the qml cache.
+		QStringList parts = id.mid(CartographyBackgroundTilesModel::SourcePrefix.size()).split('/');
+
+		if (parts.size() == 4) {
+			response = new CartographyBackgroundResponse(_proxy->getBackgroundPyramid(), parts[1].toInt(), parts[2].toInt(), parts[3].toInt());
+		}
+
+	} else if (id.startsWith(CartographyBackgroundTilesModel::PreviewPrefix)) {
+		response = new CartographyBackgroundResponse(_proxy->getBackgroundPreview());
+	}
+
+	if (response == nullptr) {
+		response = new CartographyBackgroundResponse(QImage());
+	}
+
+	_pool.start(response);
+
+	return response;
 }
 
 } // namespace Sabrina
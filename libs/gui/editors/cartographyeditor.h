@@ -28,8 +28,12 @@ along with this program.  If not, see <https://www.gnu.org/licenses/>.
 #include <QColor>
 
 #include <QQuickImageProvider>
+#include <QMutex>
+#include <QRunnable>
+#include <QThreadPool>
 
 #include "model/editableItems/cartography.h"
+#include "./cartographytilepyramid.h"
 
 class QQuickItem;
 class QQuickWidget;
@@ -41,6 +45,8 @@ class Cartography;
 class CartographyItem;
 class CartographyCategory;
 class CartographyEditor;
+class CartographyPointsItem;
+class CartographyVectorsItem;
 
 namespace Ui {
 class CartographyEditor;
@@ -160,6 +166,7 @@ public:
 	Q_PROPERTY(QSizeF size READ getSize WRITE setSize NOTIFY sizeChanged)
 	Q_PROPERTY(qreal scale READ getScale WRITE setScale NOTIFY scaleChanged)
 	Q_PROPERTY(QString imageBackground READ getImageBackground NOTIFY imageBackgroundChanged)
+	Q_PROPERTY(QAbstractItemModel* backgroundTiles READ getBackgroundTiles CONSTANT)
 
 	QSizeF getSize() const;
 	void setSize(QSizeF size);
@@ -177,6 +184,20 @@ public:
 	QString getImageBackground() const;
 	QString getImageBackgroundFile() const;
 
+	//! \brief the tiles of the background, nullptr while they are loading. Can be called from any thread.
+	std::shared_ptr<CartographyTilePyramid const> getBackgroundPyramid() const;
+	//! \brief a low resolution version of the background, available while the tiles are generated. Can be called from any thread.
+	QImage getBackgroundPreview() const;
+	//! \brief the size of the background image, known before the image is decoded.
+	QSize getBackgroundImageSize() const;
+	bool isLoadingBackground() const;
+
+	QAbstractItemModel* getBackgroundTiles() const;
+	//! \brief the layers of a layered background, empty for the other images.
+	QAbstractItemModel* getBackgroundLayers() const;
+	//! \brief select the background tiles to display for the visible part of the map, in map coordinates.
+	void setVisibleArea(QRectF const& area);
+
 	Cartography *getConnectedCartography() const;
 	void setConnectedCartography(Cartography *cartography);
 
@@ -197,29 +218,69 @@ public slots:
 protected:
 
 	void onBackgroundChanged();
+	void reloadBackgroundPyramid();
+	void onBackgroundPreviewLoaded(QImage preview);
+	void onBackgroundPyramidLoaded(CartographyTilePyramidPtr pyramid);
+
+	void onBackgroundLayerVisibilityRequested(QString layerId, bool visible);
+	//! \brief show the layers of the background as stored in the cartography, the unaffected tiles are not redrawn.
+	void applyBackgroundLayersVisibility();
 
 	Cartography* _connectedCartography;
 
 	qreal _scale;
 
+	mutable QMutex _backgroundMutex; //protect the pyramid and the preview, read by the image provider threads.
+	CartographyTilePyramidPtr _backgroundPyramid;
+	QImage _backgroundPreview;
+	QSize _backgroundImageSize;
+
+	CartographyTilePyramidLoader* _pyramidLoader;
+	CartographyBackgroundTilesModel* _backgroundTiles;
+	CartographyBackgroundLayersModel* _backgroundLayers;
+	QRectF _visibleArea;
+
 };
 
-class CartographyBackgroundLoader: public QQuickImageProvider {
+//! \brief The CartographyBackgroundResponse class read a background tile in the thread pool of the CartographyBackgroundLoader.
+class CartographyBackgroundResponse : public QQuickImageResponse, public QRunnable {
 
 public:
 
-	explicit CartographyBackgroundLoader(CartographyMapProxy* proxy);
+	CartographyBackgroundResponse(std::shared_ptr<CartographyTilePyramid const> pyramid, int level, int column, int row);
+	explicit CartographyBackgroundResponse(QImage const& image);
 
-	virtual QImage requestImage(const QString &id, QSize *size, const QSize &requestedSize);
+	QQuickTextureFactory* textureFactory() const override;
 
-	virtual QQmlImageProviderBase::ImageType imageType() const;
+	void run() override;
+	//! \brief skip the reading if it did not start yet, when the tile left the view before being loaded.
+	void cancel() override;
 
 protected:
 
-	QString _loadedFileName;
-	QImage _loadedImage;
+	std::shared_ptr<CartographyTilePyramid const> _pyramid;
+	int _level;
+	int _column;
+	int _row;
+
+	QImage _image;
+	QAtomicInt _cancelled;
+
+};
+
+//! \brief The CartographyBackgroundLoader class serve the tiles and the preview of the background of the map proxy without blocking the gui.
+class CartographyBackgroundLoader: public QQuickAsyncImageProvider {
+
+public:
+
+	explicit CartographyBackgroundLoader(CartographyMapProxy* proxy);
+
+	QQuickImageResponse* requestImageResponse(const QString &id, const QSize &requestedSize) override;
+
+protected:
 
 	CartographyMapProxy* _proxy;
+	QThreadPool _pool;
 
 };
 
@@ -250,6 +311,7 @@ protected:
 	virtual bool effectivelySetEditedItem(Aline::EditableItem* item);
 
 	void connectItem(CartographyItem* item);
+	void connectItems(QVector<CartographyItem*> const& items);
 	void onCartographyItemRemoved(QString oldRef);
 
 	void mapItemRefChanged(QString oldRef, QString newRef);
@@ -259,6 +321,9 @@ protected:
 	void onBackgroundImageLoadingRequest();
 	void onNewBackgroundImageLoaded();
 
+	void onGeoJsonImportRequest();
+	void onGeoJsonExportRequest();
+
 	void widthSpinBoxesChange();
 	void heightSpinBoxesChange();
 	void onMapSizeChanged(QSizeF size);
@@ -297,16 +362,29 @@ protected:
 	void onSelectedItemScaleChange(qreal scale);
 	void onSelectedItemLegendPosChange(int pos);
 
+	//visibility
+
+	//! \brief the part of the map shown in the scroll area, in map coordinates, enlarged by VisibilityMargin.
+	QRectF visibleMapArea() const;
+	//! \brief update the points and the background tiles after the view was scrolled, zoomed or resized.
+	void onViewportChanged();
+
+	static const int VisibilityMargin; //in pixels, to keep the legends of the points just outside of the view.
+
 private:
 
 	static bool qmlTypeRegistrationDone;
 
+	//! \brief the proxy and the qml delegate exist only for the selected item, the other items are drawn by the points item.
 	struct CartographyItemContext {
 		CartographyItem* _item;
 		CartographyItemProxy* _proxy;
 		QQuickItem* _associatedItem;
 	};
 
+	void createItemDelegate(CartographyItemContext & context);
+	void releaseItemDelegate(CartographyItemContext & context);
+
 	Ui::CartographyEditor *ui;
 
 	Cartography* _currentCartography;
@@ -319,6 +397,8 @@ private:
 	QMap<QString, CartographyItemContext> _currentItems;
 
 	QQuickItem *_mapAreaItem;
+	CartographyPointsItem* _pointsItem;
+	CartographyVectorsItem* _vectorsItem;
 
 	QSortFilterProxyModel* _categoryListProxy;
 
@@ -0,0 +1,671 @@
+/*
+This file is part of the project Sabrina
+Copyright (C) 2023  Paragon <french.paragon@gmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "cartographylayeredimage.h"
+
+#include <QBuffer>
+#include <QFileInfo>
+#include <QHash>
+#include <QImageReader>
+#include <QXmlStreamReader>
+
+#include <algorithm>
+#include <iterator>
+
+namespace Sabrina {
+
+namespace {
+
+const char* OpenRasterStack = "stack.xml";
+const char* OpenRasterThumbnail = "Thumbnails/thumbnail.png";
+const char* MergedImage = "mergedimage.png";
+const char* KritaDocument = "maindoc.xml";
+const char* KritaPreview = "preview.png";
+
+const int KritaMaxTileSize = 1024; //krita writes tiles of 64 pixels, larger ones come from a corrupted file.
+
+QPainter::CompositionMode compositionMode(QStringRef const& op) {
+
+	if (op == "svg:multiply") {
+		return QPainter::CompositionMode_Multiply;
+	}
+	if (op == "svg:screen") {
+		return QPainter::CompositionMode_Screen;
+	}
+	if (op == "svg:overlay") {
+		return QPainter::CompositionMode_Overlay;
+	}
+	if (op == "svg:darken") {
+		return QPainter::CompositionMode_Darken;
+	}
+	if (op == "svg:lighten") {
+		return QPainter::CompositionMode_Lighten;
+	}
+	if (op == "svg:color-dodge") {
+		return QPainter::CompositionMode_ColorDodge;
+	}
+	if (op == "svg:color-burn") {
+		return QPainter::CompositionMode_ColorBurn;
+	}
+	if (op == "svg:hard-light") {
+		return QPainter::CompositionMode_HardLight;
+	}
+	if (op == "svg:soft-light") {
+		return QPainter::CompositionMode_SoftLight;
+	}
+	if (op == "svg:difference") {
+		return QPainter::CompositionMode_Difference;
+	}
+	if (op == "svg:plus") {
+		return QPainter::CompositionMode_Plus;
+	}
+
+	return QPainter::CompositionMode_SourceOver; //svg:src-over, and the modes qt does not support.
+}
+
+QPainter::CompositionMode kritaCompositionMode(QStringRef const& op) {
+
+	if (op == "multiply") {
+		return QPainter::CompositionMode_Multiply;
+	}
+	if (op == "screen") {
+		return QPainter::CompositionMode_Screen;
+	}
+	if (op == "overlay") {
+		return QPainter::CompositionMode_Overlay;
+	}
+	if (op == "darken") {
+		return QPainter::CompositionMode_Darken;
+	}
+	if (op == "lighten") {
+		return QPainter::CompositionMode_Lighten;
+	}
+	if (op == "dodge") {
+		return QPainter::CompositionMode_ColorDodge;
+	}
+	if (op == "burn") {
+		return QPainter::CompositionMode_ColorBurn;
+	}
+	if (op == "hard_light") {
+		return QPainter::CompositionMode_HardLight;
+	}
+	if (op == "soft_light") {
+		return QPainter::CompositionMode_SoftLight;
+	}
+	if (op == "diff") {
+		return QPainter::CompositionMode_Difference;
+	}
+	if (op == "add") {
+		return QPainter::CompositionMode_Plus;
+	}
+
+	return QPainter::CompositionMode_SourceOver; //normal, and the modes qt does not support.
+}
+
+//! \brief decompress LZF data, as written by krita, return the number of bytes written or -1 if the data is corrupted.
+int lzfDecompress(const char* in, int inSize, char* out, int outSize) {
+
+	const quint8* ip = reinterpret_cast<const quint8*>(in);
+	const quint8* inEnd = ip + inSize;
+	quint8* op = reinterpret_cast<quint8*>(out);
+	quint8* outStart = op;
+	quint8* outEnd = op + outSize;
+
+	while (ip < inEnd) {
+
+		int ctrl = *ip++;
+
+		if (ctrl < 32) { //a run of ctrl+1 literal bytes.
+
+			ctrl++;
+
+			if (op + ctrl > outEnd or ip + ctrl > inEnd) {
+				return -1;
+			}
+
+			std::copy(ip, ip + ctrl, op);
+			ip += ctrl;
+			op += ctrl;
+
+			continue;
+		}
+
+		//a back reference.
+		int len = ctrl >> 5;
+		quint8* ref = op - ((ctrl & 0x1f) << 8) - 1;
+
+		if (len == 7) {
+			if (ip >= inEnd) {
+				return -1;
+			}
+			len += *ip++;
+		}
+
+		if (ip >= inEnd) {
+			return -1;
+		}
+
+		ref -= *ip++;
+		len += 2;
+
+		if (op + len > outEnd or ref < outStart) {
+			return -1;
+		}
+
+		for (int i = 0; i < len; i++) { //the reference may overlap the output.
+			*op++ = *ref++;
+		}
+	}
+
+	return static_cast<int>(op - outStart);
+}
+
+QSize readOpenRasterSize(QByteArray const& stack) {
+
+	QXmlStreamReader xml(stack);
+
+	while (xml.readNextStartElement()) {
+		if (xml.name() == "image") {
+			return QSize(xml.attributes().value("w").toInt(), xml.attributes().value("h").toInt());
+		}
+		xml.skipCurrentElement();
+	}
+
+	return QSize();
+}
+
+QSize readKritaSize(QByteArray const& document) {
+
+	QXmlStreamReader xml(document);
+
+	while (!xml.atEnd()) {
+		if (xml.readNext() == QXmlStreamReader::StartElement and xml.name() == "IMAGE") {
+			return QSize(xml.attributes().value("width").toInt(), xml.attributes().value("height").toInt());
+		}
+	}
+
+	return QSize();
+}
+
+} // namespace
+
+bool CartographyLayeredImage::isLayeredFile(QString const& file) {
+	QString suffix = QFileInfo(file).suffix().toLower();
+	return suffix == "ora" or suffix == "kra";
+}
+
+QSize CartographyLayeredImage::imageFileSize(QString const& file) {
+
+	ZipArchive archive(file);
+
+	if (!archive.isValid()) {
+		return QSize();
+	}
+
+	if (archive.contains(OpenRasterStack)) {
+		return readOpenRasterSize(archive.read(OpenRasterStack));
+	}
+
+	if (archive.contains(KritaDocument)) {
+		return readKritaSize(archive.read(KritaDocument));
+	}
+
+	return QSize();
+}
+
+CartographyLayeredImage::CartographyLayeredImage() :
+	_krita(false)
+{
+
+}
+
+bool CartographyLayeredImage::open(QString const& file) {
+
+	_layers.clear();
+	_size = QSize();
+	_krita = false;
+
+	if (!_archive.open(file)) {
+		return false;
+	}
+
+	bool ok = false;
+
+	if (_archive.contains(OpenRasterStack)) {
+		ok = readOpenRasterStack();
+	} else if (_archive.contains(KritaDocument)) {
+		_krita = true;
+		ok = readKritaDocument();
+	}
+
+	if (!ok or _size.isEmpty() or _layers.isEmpty()) {
+		_archive.close();
+		_layers.clear();
+		_size = QSize();
+		return false;
+	}
+
+	return true;
+}
+
+bool CartographyLayeredImage::isValid() const {
+	return _archive.isValid() and !_layers.isEmpty();
+}
+
+QSize CartographyLayeredImage::size() const {
+	return _size;
+}
+
+QVector<CartographyLayeredImage::Layer> const& CartographyLayeredImage::layers() const {
+	return _layers;
+}
+
+QImage CartographyLayeredImage::layerImage(int index) const {
+
+	if (index < 0 or index >= _layers.size()) {
+		return QImage();
+	}
+
+	if (_layers[index].tiled) {
+		return readKritaTiles(_layers[index]);
+	}
+
+	return readImage(_layers[index].source);
+}
+
+QImage CartographyLayeredImage::preview() const {
+
+	if (!_archive.isValid()) {
+		return QImage();
+	}
+
+	if (_krita) {
+		return readImage(KritaPreview);
+	}
+
+	QImage thumbnail = readImage(OpenRasterThumbnail);
+
+	if (thumbnail.isNull()) {
+		thumbnail = readImage(MergedImage); //optional in both, but saved by most of the painting softwares.
+	}
+
+	return thumbnail;
+}
+
+bool CartographyLayeredImage::readOpenRasterStack() {
+
+	QXmlStreamReader xml(_archive.read(OpenRasterStack));
+
+	struct Group {
+		QString path;
+		qreal opacity;
+		bool visible;
+	};
+
+	QVector<Group> groups; //the stacks containing the current element.
+	QVector<Layer> topFirst;
+	QHash<QString, int> pathsCount;
+
+	while (!xml.atEnd()) {
+
+		QXmlStreamReader::TokenType token = xml.readNext();
+
+		if (token == QXmlStreamReader::EndElement) {
+			if (xml.name() == "stack" and !groups.isEmpty()) {
+				groups.pop_back();
+			}
+			continue;
+		}
+
+		if (token != QXmlStreamReader::StartElement) {
+			continue;
+		}
+
+		QXmlStreamAttributes attributes = xml.attributes();
+
+		qreal opacity = attributes.hasAttribute("opacity") ? attributes.value("opacity").toDouble() : 1.0;
+		bool visible = attributes.value("visibility") != "hidden";
+
+		QString parentPath = groups.isEmpty() ? QString() : groups.last().path;
+		qreal parentOpacity = groups.isEmpty() ? 1.0 : groups.last().opacity;
+		bool parentVisible = groups.isEmpty() ? true : groups.last().visible;
+
+		if (xml.name() == "image") {
+			_size = QSize(attributes.value("w").toInt(), attributes.value("h").toInt());
+		} else if (xml.name() == "stack") {
+			//the root stack is not a group of the layers.
+			QString path = groups.isEmpty() ? QString() : parentPath + attributes.value("name").toString() + "/";
+			groups.push_back({path, parentOpacity*opacity, parentVisible and visible});
+		} else if (xml.name() == "layer") {
+
+			Layer layer;
+			layer.name = attributes.value("name").toString();
+			layer.source = attributes.value("src").toString();
+			layer.tiled = false;
+			layer.offset = QPoint(attributes.value("x").toInt(), attributes.value("y").toInt());
+			layer.opacity = std::min(std::max(parentOpacity*opacity, 0.0), 1.0);
+			layer.visible = parentVisible and visible;
+			layer.mode = compositionMode(attributes.value("composite-op"));
+
+			if (layer.name.isEmpty()) {
+				layer.name = layer.source;
+			}
+
+			layer.id = parentPath + layer.name;
+
+			int rank = pathsCount.value(layer.id, 0) + 1;
+			pathsCount.insert(layer.id, rank);
+
+			if (rank > 1) {
+				layer.id += QString("#%1").arg(rank);
+			}
+
+			if (_archive.contains(layer.source)) {
+				topFirst.push_back(layer);
+			}
+		}
+	}
+
+	if (xml.hasError()) {
+		return false;
+	}
+
+	_layers.reserve(topFirst.size());
+	std::copy(topFirst.crbegin(), topFirst.crend(), std::back_inserter(_layers));
+
+	return true;
+}
+
+bool CartographyLayeredImage::readKritaDocument() {
+
+	QXmlStreamReader xml(_archive.read(KritaDocument));
+
+	struct Group {
+		QString path;
+		qreal opacity;
+		bool visible;
+	};
+
+	QVector<Group> groups;
+	QVector<bool> openedLayers; //for each layer element being read, if it is a group.
+	QVector<Layer> topFirst;
+	QHash<QString, int> pathsCount;
+
+	QString imageName;
+	bool readable = true;
+
+	while (!xml.atEnd()) {
+
+		QXmlStreamReader::TokenType token = xml.readNext();
+
+		if (token == QXmlStreamReader::EndElement) {
+			if (xml.name() == "layer" and !openedLayers.isEmpty() and openedLayers.takeLast() and !groups.isEmpty()) {
+				groups.pop_back();
+			}
+			continue;
+		}
+
+		if (token != QXmlStreamReader::StartElement) {
+			continue;
+		}
+
+		QXmlStreamAttributes attributes = xml.attributes();
+
+		if (xml.name() == "IMAGE" and imageName.isEmpty()) {
+			_size = QSize(attributes.value("width").toInt(), attributes.value("height").toInt());
+			imageName = attributes.value("name").toString();
+			continue;
+		}
+
+		if (xml.name() != "layer") {
+			continue;
+		}
+
+		QStringRef type = attributes.value("nodetype");
+		QString name = attributes.value("name").toString();
+
+		qreal opacity = attributes.hasAttribute("opacity") ? attributes.value("opacity").toInt()/255.0 : 1.0;
+		bool visible = attributes.value("visible") != "0";
+
+		QString parentPath = groups.isEmpty() ? QString() : groups.last().path;
+		qreal parentOpacity = groups.isEmpty() ? 1.0 : groups.last().opacity;
+		bool parentVisible = groups.isEmpty() ? true : groups.last().visible;
+
+		openedLayers.push_back(type == "grouplayer");
+
+		if (type == "grouplayer") {
+			groups.push_back({parentPath + name + "/", parentOpacity*opacity, parentVisible and visible});
+			continue;
+		}
+
+		//the other layers are not stored as pixels, or in a color space which is not supported.
+		if (type != "paintlayer" or attributes.value("colorspacename") != "RGBA") {
+			if (parentVisible and visible) {
+				readable = false;
+			}
+			continue;
+		}
+
+		Layer layer;
+		layer.name = name.isEmpty() ? attributes.value("filename").toString() : name;
+		layer.source = imageName + "/layers/" + attributes.value("filename").toString();
+		layer.tiled = true;
+		layer.tilesOrigin = QPoint(attributes.value("x").toInt(), attributes.value("y").toInt());
+		layer.offset = QPoint(0, 0);
+		layer.opacity = std::min(std::max(parentOpacity*opacity, 0.0), 1.0);
+		layer.visible = parentVisible and visible;
+		layer.mode = kritaCompositionMode(attributes.value("compositeop"));
+
+		layer.id = parentPath + layer.name;
+
+		int rank = pathsCount.value(layer.id, 0) + 1;
+		pathsCount.insert(layer.id, rank);
+
+		if (rank > 1) {
+			layer.id += QString("#%1").arg(rank);
+		}
+
+		if (_archive.contains(layer.source)) {
+			topFirst.push_back(layer);
+		} else if (layer.visible) {
+			readable = false;
+		}
+	}
+
+	if (xml.hasError()) {
+		return false;
+	}
+
+	if (!readable or topFirst.isEmpty()) {
+		return readKritaMergedImage();
+	}
+
+	_layers.reserve(topFirst.size());
+	std::copy(topFirst.crbegin(), topFirst.crend(), std::back_inserter(_layers));
+
+	return true;
+}
+
+bool CartographyLayeredImage::readKritaMergedImage() {
+
+	if (!_archive.contains(MergedImage)) {
+		return false;
+	}
+
+	if (_size.isEmpty()) {
+		_size = readKritaSize(_archive.read(KritaDocument));
+	}
+
+	Layer layer;
+	layer.name = QFileInfo(_archive.fileName()).completeBaseName();
+	layer.id = layer.name;
+	layer.source = MergedImage;
+	layer.tiled = false;
+	layer.offset = QPoint(0, 0);
+	layer.opacity = 1.0;
+	layer.visible = true;
+	layer.mode = QPainter::CompositionMode_SourceOver;
+
+	_layers.clear();
+	_layers.push_back(layer);
+
+	return true;
+}
+
+QImage CartographyLayeredImage::readImage(QString const& entry) const {
+
+	QByteArray data = _archive.read(entry);
+
+	if (data.isEmpty()) {
+		return QImage();
+	}
+
+	QBuffer buffer(&data);
+	buffer.open(QIODevice::ReadOnly);
+
+	QImageReader reader(&buffer, "png");
+	return reader.read();
+}
+
+QImage CartographyLayeredImage::readKritaTiles(Layer const& layer) const {
+
+	QByteArray data = _archive.read(layer.source);
+
+	int pos = 0;
+
+	auto readLine = [&data, &pos] () -> QByteArray {
+
+		int end = data.indexOf('\n', pos);
+
+		if (end < 0) {
+			pos = data.size();
+			return QByteArray();
+		}
+
+		QByteArray line = data.mid(pos, end - pos);
+		pos = end+1;
+		return line;
+	};
+
+	int version = -1;
+	int tileWidth = 0;
+	int tileHeight = 0;
+	int pixelSize = 0;
+	int nTiles = -1;
+
+	while (pos < data.size() and nTiles < 0) {
+
+		QList<QByteArray> header = readLine().split(' ');
+
+		if (header.size() != 2) {
+			return QImage();
+		}
+
+		if (header[0] == "VERSION") {
+			version = header[1].toInt();
+		} else if (header[0] == "TILEWIDTH") {
+			tileWidth = header[1].toInt();
+		} else if (header[0] == "TILEHEIGHT") {
+			tileHeight = header[1].toInt();
+		} else if (header[0] == "PIXELSIZE") {
+			pixelSize = header[1].toInt();
+		} else if (header[0] == "DATA") {
+			nTiles = header[1].toInt();
+		}
+	}
+
+	//only the 8 bits RGBA color space of krita is read, its pixels are stored as blue, green, red and alpha.
+	if (version != 2 or tileWidth <= 0 or tileHeight <= 0 or pixelSize != 4 or nTiles < 0) {
+		return QImage();
+	}
+
+	//bound the tile before computing its size in bytes, it cannot overflow afterward.
+	if (tileWidth > KritaMaxTileSize or tileHeight > KritaMaxTileSize) {
+		return QImage();
+	}
+
+	int tileBytes = tileWidth*tileHeight*pixelSize;
+
+	QImage image(_size, QImage::Format_ARGB32);
+	image.fill(Qt::transparent);
+
+	QByteArray planar(tileBytes, 0);
+	QImage tile(tileWidth, tileHeight, QImage::Format_ARGB32);
+
+	int nPixels = tileWidth*tileHeight;
+
+	QPainter painter(&image);
+	painter.setCompositionMode(QPainter::CompositionMode_Source);
+
+	for (int t = 0; t < nTiles; t++) {
+
+		//each tile start with a line "x,y,LZF,size", followed by the size bytes of the tile.
+		QList<QByteArray> header = readLine().split(',');
+
+		if (header.size() != 4) {
+			return QImage();
+		}
+
+		int x = header[0].toInt();
+		int y = header[1].toInt();
+		int size = header[3].toInt();
+
+		if (size < 1 or pos + size > data.size()) {
+			return QImage();
+		}
+
+		const uchar* tileData = reinterpret_cast<const uchar*>(data.constData()) + pos;
+		pos += size;
+
+		const uchar* pixels = tileData+1;
+		int pixelStride = pixelSize; //raw data, the channels of each pixel are stored together.
+		int channelStride = 1;
+
+		if (tileData[0] != 0) { //LZF compressed data, the channels are stored one after the other.
+
+			if (lzfDecompress(reinterpret_cast<const char*>(tileData+1), size - 1, planar.data(), tileBytes) != tileBytes) {
+				return QImage();
+			}
+
+			pixels = reinterpret_cast<const uchar*>(planar.constData());
+			pixelStride = 1;
+			channelStride = nPixels;
+
+		} else if (size - 1 < tileBytes) {
+			return QImage();
+		}
+
+		for (int r = 0; r < tileHeight; r++) {
+
+			QRgb* line = reinterpret_cast<QRgb*>(tile.scanLine(r));
+
+			for (int c = 0; c < tileWidth; c++) {
+				const uchar* p = pixels + (r*tileWidth + c)*pixelStride;
+				line[c] = qRgba(p[2*channelStride], p[channelStride], p[0], p[3*channelStride]);
+			}
+		}
+
+		painter.drawImage(layer.tilesOrigin + QPoint(x, y), tile);
+	}
+
+	painter.end();
+
+	return image;
+}
+
+} // namespace Sabrina
@@ -0,0 +1,98 @@
+#ifndef SABRINA_CARTOGRAPHYLAYEREDIMAGE_H
+#define SABRINA_CARTOGRAPHYLAYEREDIMAGE_H
+
+/*
+This file is part of the project Sabrina
+Copyright (C) 2023  Paragon <french.paragon@gmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "utils/ziparchive.h"
+
+#include <QImage>
+#include <QPainter>
+#include <QPoint>
+#include <QSize>
+#include <QVector>
+
+namespace Sabrina {
+
+/*!
+ * \brief The CartographyLayeredImage class read the layers of an OpenRaster (.ora) or Krita (.kra) document.
+ *
+ * OpenRaster documents are zip archives listing their png layers in stack.xml, the groups are flattened:
+ * their opacity and visibility are applied to the layers they contain.
+ * As the names of the layers are not unique, each layer is identified by the names of its groups and its own name,
+ * followed by its rank among the layers with the same path when there are several of them.
+ * The paint layers of Krita documents are read from their tiles, in the format 2 of Krita (LZF compressed, channels stored one after the other),
+ * the groups are flattened as for OpenRaster. The masks are ignored. When a visible layer cannot be read (other color spaces,
+ * vector or filter layers), the merged image saved by Krita is read instead, as a single layer.
+ *
+ * The layers are decoded one at a time, when they are requested.
+ */
+class CartographyLayeredImage
+{
+public:
+
+	struct Layer {
+		QString name;
+		QString id; //the path of the layer in the groups, unique in the document.
+		QString source; //the entry of the archive.
+		bool tiled; //the source is a paint layer of krita, not a png image.
+		QPoint tilesOrigin; //for the paint layers of krita, the position of the origin of the tiles in the document.
+		QPoint offset;
+		qreal opacity;
+		bool visible;
+		QPainter::CompositionMode mode;
+	};
+
+	//! \brief if the file is a layered document, judging by its suffix.
+	static bool isLayeredFile(QString const& file);
+	//! \brief the size of a layered document, read from its description without decoding the layers.
+	static QSize imageFileSize(QString const& file);
+
+	CartographyLayeredImage();
+
+	bool open(QString const& file);
+	bool isValid() const;
+
+	QSize size() const;
+
+	//! \brief the layers, from the bottom to the top.
+	QVector<Layer> const& layers() const;
+	QImage layerImage(int index) const;
+
+	//! \brief the thumbnail saved in the document, or a null image.
+	QImage preview() const;
+
+protected:
+
+	bool readOpenRasterStack();
+	bool readKritaDocument();
+	bool readKritaMergedImage();
+
+	QImage readImage(QString const& entry) const;
+	//! \brief decode the tiles of a krita paint layer in an image of the size of the document.
+	QImage readKritaTiles(Layer const& layer) const;
+
+	ZipArchive _archive;
+	bool _krita;
+	QSize _size;
+	QVector<Layer> _layers;
+};
+
+} // namespace Sabrina
+
+#endif // SABRINA_CARTOGRAPHYLAYEREDIMAGE_H
@@ -0,0 +1,672 @@
+/*
+This file is part of the project Sabrina
+Copyright (C) 2023  Paragon <french.paragon@gmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "cartographypointsitem.h"
+#include "cartographypointslayout.h"
+
+#include "model/editableItems/cartography.h"
+
+#include <QFontMetricsF>
+#include <QMouseEvent>
+#include <QPainter>
+#include <QQuickWindow>
+#include <QSGFlatColorMaterial>
+#include <QSGGeometryNode>
+#include <QSGTextureMaterial>
+
+#include <algorithm>
+#include <cmath>
+
+namespace Sabrina {
+
+const int CartographyPointsItem::CircleSegments = 20;
+const int CartographyPointsItem::LabelOversampling = 2;
+const int CartographyPointsItem::AtlasWidth = 2048;
+const int CartographyPointsItem::MaxAtlasHeight = 4096;
+const int CartographyPointsItem::MaxCachedLayouts = 8;
+const int CartographyPointsItem::MaxCachedLabelSizes = 65536;
+
+namespace {
+
+//! \brief the root node keeps the texture of the legends atlas, which has to be deleted in the render thread.
+class PointsRootNode : public QSGNode
+{
+public:
+	PointsRootNode() :
+		atlas(nullptr),
+		atlasKey(0)
+	{
+
+	}
+	~PointsRootNode() {
+		delete atlas;
+	}
+
+	QSGTexture* atlas;
+	qint64 atlasKey;
+};
+
+QVector<QPointF> const& unitCircle() {
+
+	static QVector<QPointF> circle;
+
+	if (circle.isEmpty()) {
+		for (int i = 0; i < CartographyPointsItem::CircleSegments; i++) {
+			qreal angle = 2*std::acos(-1.0)*i/CartographyPointsItem::CircleSegments;
+			circle.push_back(QPointF(std::cos(angle), std::sin(angle)));
+		}
+	}
+
+	return circle;
+}
+
+QSGGeometryNode* colorNode(QSGGeometry* geometry, QRgb color) {
+
+	QSGFlatColorMaterial* material = new QSGFlatColorMaterial();
+	material->setColor(QColor::fromRgba(color));
+
+	QSGGeometryNode* node = new QSGGeometryNode();
+	node->setGeometry(geometry);
+	node->setMaterial(material);
+	node->setFlags(QSGNode::OwnsGeometry | QSGNode::OwnsMaterial);
+
+	return node;
+}
+
+} // namespace
+
+CartographyPointsItem::CartographyPointsItem(QQuickItem* parent) :
+	QQuickItem(parent),
+	_cartography(nullptr),
+	_scale(1.0),
+	_nodesDirty(true),
+	_shelfHeight(0)
+{
+	setFlag(ItemHasContents, true);
+	setAcceptedMouseButtons(Qt::LeftButton);
+}
+
+Cartography* CartographyPointsItem::cartography() const {
+	return _cartography;
+}
+void CartographyPointsItem::setCartography(Cartography* cartography) {
+
+	if (cartography == _cartography) {
+		return;
+	}
+
+	if (_cartography != nullptr) {
+
+		for (CartographyItem* item : _cartography->getItems()) {
+			disconnect(item, nullptr, this, nullptr);
+		}
+
+		disconnect(_cartography, nullptr, this, nullptr);
+	}
+
+	_cartography = cartography;
+	_dragged = nullptr;
+
+	if (_cartography != nullptr) {
+
+		for (CartographyItem* item : _cartography->getItems()) {
+			connectItem(item);
+		}
+
+		connect(_cartography, &Cartography::cartographyItemsInserted, this, [this] (QVector<CartographyItem*> const& items) {
+
+			for (CartographyItem* item : items) {
+				connectItem(item);
+			}
+
+			invalidateLayouts(); //once for the whole batch.
+		});
+		connect(_cartography, &Cartography::cartographyItemRemoved,
+				this, &CartographyPointsItem::onItemRemoved);
+
+		connect(_cartography, &Cartography::categoryStyleChanged, this, [this] () {
+			_labelSizes.clear();
+			invalidateLayouts();
+		});
+	}
+
+	clearAtlas();
+	_labelSizes.clear();
+	invalidateLayouts();
+}
+
+CartographyItem* CartographyPointsItem::selectedItem() const {
+	return _selectedItem;
+}
+void CartographyPointsItem::setSelectedItem(CartographyItem* item) {
+
+	if (item == _selectedItem) {
+		return;
+	}
+
+	_selectedItem = item;
+	invalidateLayouts(); //the selected item is left out of the layouts, its legend is drawn by its delegate.
+}
+
+void CartographyPointsItem::setVisibleArea(QRectF const& area, qreal scale) {
+
+	if (area == _visibleArea and scale == _scale) {
+		return;
+	}
+
+	_visibleArea = area;
+	_scale = scale;
+	polish();
+}
+
+CartographyItem* CartographyPointsItem::itemAt(QPointF const& pos) const {
+
+	if (_cartography == nullptr or _layout == nullptr) {
+		return nullptr;
+	}
+
+	CartographyItem* item = _layout->itemAt(pos);
+
+	if (item == _selectedItem) {
+		return nullptr;
+	}
+
+	return item;
+}
+
+void CartographyPointsItem::updatePolish() {
+
+	refreshVisibleItems();
+
+	_nodesDirty = true;
+	update();
+}
+
+QSGNode* CartographyPointsItem::updatePaintNode(QSGNode* oldNode, UpdatePaintNodeData* data) {
+
+	Q_UNUSED(data);
+
+	PointsRootNode* root = static_cast<PointsRootNode*>(oldNode);
+
+	if (root == nullptr) {
+		root = new PointsRootNode();
+	}
+
+	if (!_nodesDirty) {
+		return root;
+	}
+
+	_nodesDirty = false;
+
+	while (QSGNode* child = root->firstChild()) {
+		root->removeChildNode(child);
+		delete child;
+	}
+
+	if (_atlas.isNull()) {
+		delete root->atlas;
+		root->atlas = nullptr;
+		root->atlasKey = 0;
+	} else if (root->atlasKey != _atlas.cacheKey()) {
+		delete root->atlas;
+		root->atlas = window()->createTextureFromImage(_atlas);
+		root->atlasKey = _atlas.cacheKey();
+	}
+
+	//one node per color, for the fills and the borders.
+	QHash<QRgb, QVector<int>> fills;
+	QHash<QRgb, QVector<int>> borders;
+	int labelsCount = 0;
+
+	for (int i = 0; i < _points.size(); i++) {
+
+		Point const& point = _points[i];
+
+		fills[point.color].push_back(i);
+
+		if (point.border > 0) {
+			borders[point.borderColor].push_back(i);
+		}
+
+		if (point.hasLabel) {
+			labelsCount++;
+		}
+	}
+
+	QVector<QPointF> const& circle = unitCircle();
+	int const k = CircleSegments;
+
+	for (auto it = fills.constBegin(); it != fills.constEnd(); ++it) {
+
+		QVector<int> const& points = it.value();
+
+		QSGGeometry* geometry = new QSGGeometry(QSGGeometry::defaultAttributes_Point2D(), points.size()*(k+1), points.size()*3*k, QSGGeometry::UnsignedIntType);
+		geometry->setDrawingMode(QSGGeometry::DrawTriangles);
+
+		QSGGeometry::Point2D* vertices = geometry->vertexDataAsPoint2D();
+		quint32* indices = geometry->indexDataAsUInt();
+
+		for (int p = 0; p < points.size(); p++) {
+
+			Point const& point = _points[points[p]];
+			qreal radius = std::max(point.radius - point.border, 0.0); //the border is drawn inside the point, as the qml rectangles do.
+
+			quint32 base = p*(k+1);
+			vertices[base].set(point.position.x(), point.position.y());
+
+			for (int s = 0; s < k; s++) {
+				QPointF v = point.position + radius*circle[s];
+				vertices[base+1+s].set(v.x(), v.y());
+
+				*indices++ = base;
+				*indices++ = base+1+s;
+				*indices++ = base+1+(s+1)%k;
+			}
+		}
+
+		root->appendChildNode(colorNode(geometry, it.key()));
+	}
+
+	for (auto it = borders.constBegin(); it != borders.constEnd(); ++it) {
+
+		QVector<int> const& points = it.value();
+
+		QSGGeometry* geometry = new QSGGeometry(QSGGeometry::defaultAttributes_Point2D(), points.size()*2*k, points.size()*6*k, QSGGeometry::UnsignedIntType);
+		geometry->setDrawingMode(QSGGeometry::DrawTriangles);
+
+		QSGGeometry::Point2D* vertices = geometry->vertexDataAsPoint2D();
+		quint32* indices = geometry->indexDataAsUInt();
+
+		for (int p = 0; p < points.size(); p++) {
+
+			Point const& point = _points[points[p]];
+			qreal inner = std::max(point.radius - point.border, 0.0);
+
+			quint32 base = p*2*k;
+
+			for (int s = 0; s < k; s++) {
+				QPointF in = point.position + inner*circle[s];
+				QPointF out = point.position + point.radius*circle[s];
+				vertices[base+2*s].set(in.x(), in.y());
+				vertices[base+2*s+1].set(out.x(), out.y());
+
+				quint32 a = base+2*s;
+				quint32 b = base+2*((s+1)%k);
+
+				*indices++ = a;
+				*indices++ = a+1;
+				*indices++ = b;
+				*indices++ = a+1;
+				*indices++ = b+1;
+				*indices++ = b;
+			}
+		}
+
+		root->appendChildNode(colorNode(geometry, it.key()));
+	}
+
+	if (labelsCount > 0 and root->atlas != nullptr) {
+
+		QSGGeometry* geometry = new QSGGeometry(QSGGeometry::defaultAttributes_TexturedPoint2D(), labelsCount*4, labelsCount*6, QSGGeometry::UnsignedIntType);
+		geometry->setDrawingMode(QSGGeometry::DrawTriangles);
+
+		QSGGeometry::TexturedPoint2D* vertices = geometry->vertexDataAsTexturedPoint2D();
+		quint32* indices = geometry->indexDataAsUInt();
+
+		qreal atlasWidth = _atlas.width();
+		qreal atlasHeight = _atlas.height();
+
+		quint32 base = 0;
+
+		for (Point const& point : qAsConst(_points)) {
+
+			if (!point.hasLabel) {
+				continue;
+			}
+
+			QRectF const& area = point.labelArea;
+			QRect const& tex = point.label.atlasRect;
+
+			float tl = tex.left()/atlasWidth;
+			float tr = (tex.left() + tex.width())/atlasWidth;
+			float tt = tex.top()/atlasHeight;
+			float tb = (tex.top() + tex.height())/atlasHeight;
+
+			vertices[base].set(area.left(), area.top(), tl, tt);
+			vertices[base+1].set(area.right(), area.top(), tr, tt);
+			vertices[base+2].set(area.left(), area.bottom(), tl, tb);
+			vertices[base+3].set(area.right(), area.bottom(), tr, tb);
+
+			*indices++ = base;
+			*indices++ = base+1;
+			*indices++ = base+2;
+			*indices++ = base+1;
+			*indices++ = base+3;
+			*indices++ = base+2;
+
+			base += 4;
+		}
+
+		QSGTextureMaterial* material = new QSGTextureMaterial();
+		material->setTexture(root->atlas);
+		material->setFiltering(QSGTexture::Linear);
+
+		QSGGeometryNode* node = new QSGGeometryNode();
+		node->setGeometry(geometry);
+		node->setMaterial(material);
+		node->setFlags(QSGNode::OwnsGeometry | QSGNode::OwnsMaterial);
+
+		root->appendChildNode(node);
+	}
+
+	return root;
+}
+
+void CartographyPointsItem::mousePressEvent(QMouseEvent* event) {
+
+	CartographyItem* item = itemAt(event->localPos());
+
+	if (item == nullptr) {
+		event->ignore(); //let the map below handle the click.
+		return;
+	}
+
+	_dragged = item;
+	_dragOffset = item->getPosition() - event->localPos();
+
+	Q_EMIT itemPressed(item->getRef());
+
+	event->accept();
+}
+void CartographyPointsItem::mouseMoveEvent(QMouseEvent* event) {
+
+	if (_dragged == nullptr) {
+		event->ignore();
+		return;
+	}
+
+	_dragged->setPosition(event->localPos() + _dragOffset);
+}
+void CartographyPointsItem::mouseReleaseEvent(QMouseEvent* event) {
+
+	Q_UNUSED(event);
+	_dragged = nullptr;
+}
+
+void CartographyPointsItem::connectItem(CartographyItem* item) {
+
+	auto onChange = [this, item] () {
+		if (item != _selectedItem) {
+			invalidateLayouts();
+		}
+	};
+
+	connect(item, &CartographyItem::positionChanged, this, onChange);
+	connect(item, &CartographyItem::scaleChanged, this, onChange);
+	connect(item, &CartographyItem::categoryChanged, this, onChange);
+	connect(item, &CartographyItem::legendPositionChanged, this, onChange);
+	connect(item, &QObject::objectNameChanged, this, onChange);
+}
+
+void CartographyPointsItem::onItemRemoved() {
+
+	//the removed item is deleted later, it has to leave the layouts and the visible points before.
+	_layouts.clear();
+	refreshVisibleItems();
+
+	_nodesDirty = true;
+	update();
+}
+
+void CartographyPointsItem::invalidateLayouts() {
+	_layouts.clear();
+	polish();
+}
+
+std::shared_ptr<CartographyPointsLayout> CartographyPointsItem::layoutFor(int band) {
+
+	std::shared_ptr<CartographyPointsLayout> layout = _layouts.value(band);
+
+	if (layout != nullptr) {
+		return layout;
+	}
+
+	if (_layouts.size() >= MaxCachedLayouts) {
+		_layouts.clear();
+	}
+
+	QVector<CartographyStyle> const styles = _cartography->categoryStyles();
+
+	//the fonts are built once per category, not once per legend.
+	QVector<QFont> fonts;
+	QVector<QString> fontKeys;
+
+	fonts.reserve(styles.size() + 1);
+	fontKeys.reserve(styles.size() + 1);
+
+	for (CartographyStyle const& style : styles) {
+		fonts.push_back(legendFont(style));
+		fontKeys.push_back(fonts.last().key());
+	}
+
+	fonts.push_back(legendFont(CartographyStyle()));
+	fontKeys.push_back(fonts.last().key());
+
+	auto measure = [this, &fonts, &fontKeys] (QString const& text, int styleIndex) {
+		int i = (styleIndex >= 0 and styleIndex < fonts.size() - 1) ? styleIndex : fonts.size() - 1;
+		return labelSize(text, fonts[i], fontKeys[i]);
+	};
+
+	layout = std::make_shared<CartographyPointsLayout>(band);
+	layout->build(_cartography->getItems(), styles, measure, _selectedItem);
+
+	_layouts.insert(band, layout);
+
+	return layout;
+}
+
+void CartographyPointsItem::refreshVisibleItems() {
+
+	_points.clear();
+	_layout.reset();
+
+	if (_cartography == nullptr or _visibleArea.isEmpty()) {
+		return;
+	}
+
+	_layout = layoutFor(CartographyPointsLayout::zoomBand(_scale));
+
+	QVector<CartographyPointsLayout::Mark> const& marks = _layout->marks();
+	QVector<int> visible = _layout->marksIn(_visibleArea);
+
+	//the styles are read once for all the points, most of the points share a few categories.
+	QVector<CartographyStyle> const styles = _cartography->categoryStyles();
+	CartographyStyle const defaultStyle;
+
+	auto styleOf = [&styles, &defaultStyle] (CartographyItem* item) -> CartographyStyle const& {
+		int index = item->getCategoryIndex();
+		return (index >= 0 and index < styles.size()) ? styles.at(index) : defaultStyle;
+	};
+
+	_points.reserve(visible.size());
+
+	for (int m : qAsConst(visible)) {
+
+		CartographyPointsLayout::Mark const& mark = marks[m];
+		CartographyStyle const& style = styleOf(mark.item);
+
+		Point point;
+		point.position = mark.position;
+		point.radius = mark.radius;
+		point.border = style.border*mark.item->getScale();
+		point.color = style.color.rgba();
+		point.borderColor = style.borderColor.rgba();
+		point.hasLabel = false;
+		point.labelArea = mark.labelArea;
+
+		_points.push_back(point);
+	}
+
+	//the legends placed by the layout are rendered in the atlas, which is rebuilt with the visible legends only when it is full.
+	for (int attempt = 0; attempt < 2; attempt++) {
+
+		bool full = false;
+
+		for (int i = 0; i < visible.size(); i++) {
+
+			CartographyPointsLayout::Mark const& mark = marks[visible[i]];
+
+			if (!mark.showLabel) {
+				continue;
+			}
+
+			Point & point = _points[i];
+			point.hasLabel = itemLabel(mark.text, styleOf(mark.item), point.label);
+			full = full or !point.hasLabel;
+		}
+
+		if (!full or attempt > 0) {
+			break;
+		}
+
+		clearAtlas();
+	}
+}
+
+QFont CartographyPointsItem::legendFont(CartographyStyle const& style) {
+
+	QFont font(style.legendFont);
+	font.setPointSize(std::max(style.legendSize, 1));
+	font.setBold(style.legendBold);
+	font.setItalic(style.legendItalic);
+	font.setUnderline(style.legendUnderlined);
+
+	return font;
+}
+
+QSizeF CartographyPointsItem::labelSize(QString const& text, QFont const& font, QString const& fontKey) {
+
+	QString key = fontKey + QChar('\n') + text;
+
+	auto it = _labelSizes.constFind(key);
+
+	if (it != _labelSizes.constEnd()) {
+		return it.value();
+	}
+
+	if (_labelSizes.size() >= MaxCachedLabelSizes) {
+		_labelSizes.clear();
+	}
+
+	QFontMetricsF metrics(font);
+	QSizeF size(metrics.horizontalAdvance(text) + 4, metrics.height() + 2);
+
+	_labelSizes.insert(key, size);
+
+	return size;
+}
+
+bool CartographyPointsItem::itemLabel(QString const& text, CartographyStyle const& style, Label & label) {
+
+	if (text.isEmpty()) {
+		return false;
+	}
+
+	QColor color = style.legendColor;
+	QFont font = legendFont(style);
+	QString fontKey = font.key();
+
+	QString key = QString("%1\n%2\n%3").arg(text, fontKey, color.name(QColor::HexArgb));
+
+	auto it = _labels.constFind(key);
+
+	if (it != _labels.constEnd()) {
+		label = it.value();
+		return true;
+	}
+
+	QSizeF size = labelSize(text, font, fontKey);
+
+	QSize pixels = (size*LabelOversampling).toSize() + QSize(1, 1);
+	pixels.setWidth(std::min(pixels.width(), AtlasWidth));
+
+	if (_atlasCursor.x() + pixels.width() > AtlasWidth) { //next shelf.
+		_atlasCursor = QPoint(0, _atlasCursor.y() + _shelfHeight);
+		_shelfHeight = 0;
+	}
+
+	int needed = _atlasCursor.y() + pixels.height();
+
+	if (needed > MaxAtlasHeight) {
+		return false;
+	}
+
+	if (needed > _atlas.height()) {
+
+		int height = std::max(_atlas.height(), 256);
+
+		while (height < needed) {
+			height *= 2;
+		}
+
+		QImage grown(AtlasWidth, std::min(height, MaxAtlasHeight), QImage::Format_ARGB32_Premultiplied);
+		grown.fill(Qt::transparent);
+
+		if (!_atlas.isNull()) {
+			QPainter painter(&grown);
+			painter.setCompositionMode(QPainter::CompositionMode_Source);
+			painter.drawImage(0, 0, _atlas);
+		}
+
+		_atlas = grown;
+	}
+
+	QRect rect(_atlasCursor, pixels);
+
+	QPainter painter(&_atlas);
+	painter.setRenderHint(QPainter::TextAntialiasing);
+
+	painter.translate(rect.topLeft());
+	painter.scale(LabelOversampling, LabelOversampling);
+
+	painter.setFont(font);
+	painter.setPen(color);
+	painter.drawText(QRectF(QPointF(0, 0), size), Qt::AlignCenter, text);
+
+	painter.end();
+
+	_atlasCursor.rx() += pixels.width() + 1;
+	_shelfHeight = std::max(_shelfHeight, pixels.height() + 1);
+
+	label.atlasRect = rect;
+	label.size = size;
+
+	_labels.insert(key, label);
+
+	return true;
+}
+
+void CartographyPointsItem::clearAtlas() {
+
+	_atlas = QImage();
+	_labels.clear();
+	_atlasCursor = QPoint(0, 0);
+	_shelfHeight = 0;
+}
+
+} // namespace Sabrina
@@ -0,0 +1,148 @@
+#ifndef SABRINA_CARTOGRAPHYPOINTSITEM_H
+#define SABRINA_CARTOGRAPHYPOINTSITEM_H
+
+/*
+This file is part of the project Sabrina
+Copyright (C) 2023  Paragon <french.paragon@gmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include <QQuickItem>
+#include <QFont>
+#include <QHash>
+#include <QImage>
+#include <QPointer>
+#include <QVector>
+
+#include <memory>
+
+namespace Sabrina {
+
+class Cartography;
+class CartographyItem;
+struct CartographyStyle;
+class CartographyPointsLayout;
+
+/*!
+ * \brief The CartographyPointsItem class draw all the points of a cartography in a few scene graph nodes.
+ *
+ * The points sharing a color are drawn by the same geometry node, so the number of nodes depends on the number of categories, not on the number of points.
+ * The legends are rendered once in a texture atlas, and drawn as textured quads by a single node.
+ * Only the points in the visible area are drawn. The selected item is skipped, it is drawn and edited by its own qml delegate.
+ *
+ * The points are clustered and their legends are culled by a CartographyPointsLayout, computed once per zoom band
+ * and kept until an item changes, so that panning the map only queries the layout.
+ *
+ * Pressing a point emits itemPressed and drags the point until the mouse is released.
+ */
+class CartographyPointsItem : public QQuickItem
+{
+	Q_OBJECT
+public:
+
+	static const int CircleSegments;
+	static const int LabelOversampling; //the legends are rendered at a higher resolution, so that they stay sharp when zooming in.
+	static const int AtlasWidth;
+	static const int MaxAtlasHeight;
+	static const int MaxCachedLayouts;
+	static const int MaxCachedLabelSizes;
+
+	explicit CartographyPointsItem(QQuickItem* parent = nullptr);
+
+	Cartography* cartography() const;
+	void setCartography(Cartography* cartography);
+
+	CartographyItem* selectedItem() const;
+	//! \brief set the item drawn by its own delegate, which is not drawn by the batch.
+	void setSelectedItem(CartographyItem* item);
+
+	//! \brief set the part of the map to draw, in map coordinates, and the scale at which the map is displayed.
+	void setVisibleArea(QRectF const& area, qreal scale);
+
+	//! \brief the item whose point is under pos, in map coordinates, or nullptr.
+	CartographyItem* itemAt(QPointF const& pos) const;
+
+Q_SIGNALS:
+
+	void itemPressed(QString ref);
+
+protected:
+
+	struct Label {
+		QRect atlasRect; //in atlas pixels.
+		QSizeF size; //in map units, before the scale of the item.
+	};
+
+	//! \brief the style of a visible point or cluster, read from the style table of the cartography when the visible points are refreshed.
+	struct Point {
+		QPointF position;
+		qreal radius; //scaled.
+		qreal border; //scaled.
+		QRgb color;
+		QRgb borderColor;
+		bool hasLabel;
+		Label label;
+		QRectF labelArea; //in map coordinates.
+	};
+
+	void updatePolish() override;
+	QSGNode* updatePaintNode(QSGNode* oldNode, UpdatePaintNodeData* data) override;
+
+	void mousePressEvent(QMouseEvent* event) override;
+	void mouseMoveEvent(QMouseEvent* event) override;
+	void mouseReleaseEvent(QMouseEvent* event) override;
+
+	void connectItem(CartographyItem* item);
+	void onItemRemoved();
+
+	//! \brief drop the cached layouts, after a change of the items or of their styles.
+	void invalidateLayouts();
+	std::shared_ptr<CartographyPointsLayout> layoutFor(int band);
+
+	//! \brief query the visible marks of the layout and render their missing legends, in the gui thread before the scene graph is synchronized.
+	void refreshVisibleItems();
+
+	static QFont legendFont(CartographyStyle const& style);
+	//! \brief the size of a legend in map units, the sizes are cached so that the text is laid out once.
+	QSizeF labelSize(QString const& text, QFont const& font, QString const& fontKey);
+
+	//! \brief find a legend in the atlas, or render it. Return false if the legend is empty or the atlas is full.
+	bool itemLabel(QString const& text, CartographyStyle const& style, Label & label);
+	void clearAtlas();
+
+	Cartography* _cartography;
+	QPointer<CartographyItem> _selectedItem;
+	QRectF _visibleArea;
+	qreal _scale;
+
+	QHash<int, std::shared_ptr<CartographyPointsLayout>> _layouts; //by zoom band.
+	std::shared_ptr<CartographyPointsLayout> _layout; //the layout of the visible points.
+	QHash<QString, QSizeF> _labelSizes;
+
+	QVector<Point> _points;
+	bool _nodesDirty;
+
+	QImage _atlas;
+	QHash<QString, Label> _labels;
+	QPoint _atlasCursor;
+	int _shelfHeight;
+
+	QPointer<CartographyItem> _dragged;
+	QPointF _dragOffset;
+};
+
+} // namespace Sabrina
+
+#endif // SABRINA_CARTOGRAPHYPOINTSITEM_H
@@ -0,0 +1,336 @@
+/*
+This file is part of the project Sabrina
+Copyright (C) 2023  Paragon <french.paragon@gmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "cartographypointslayout.h"
+
+#include <QHash>
+#include <QPair>
+
+#include <algorithm>
+#include <cmath>
+
+namespace Sabrina {
+
+const int CartographyPointsLayout::BandsPerOctave = 4;
+const qreal CartographyPointsLayout::ClusteringScale = 0.75;
+const int CartographyPointsLayout::ClusterCellSize = 40;
+const int CartographyPointsLayout::LabelGridCellSize = 64;
+const qreal CartographyPointsLayout::MinLabelScreenHeight = 6;
+
+namespace {
+
+typedef QPair<qint64, qint64> GridCell;
+
+inline GridCell gridCell(QPointF const& pos, qreal cellSize) {
+	return GridCell(qint64(std::floor(pos.x()/cellSize)), qint64(std::floor(pos.y()/cellSize)));
+}
+
+} // namespace
+
+int CartographyPointsLayout::zoomBand(qreal scale) {
+
+	if (scale <= 0 or !std::isfinite(scale)) {
+		return 0;
+	}
+
+	return int(std::floor(std::log2(scale)*BandsPerOctave));
+}
+
+qreal CartographyPointsLayout::bandScale(int band) {
+	return std::pow(2.0, qreal(band)/BandsPerOctave);
+}
+
+QPointF CartographyPointsLayout::labelOffset(CartographyItem::LegendPos pos, qreal margin, QSizeF const& labelSize) {
+
+	qreal w = labelSize.width();
+	qreal h = labelSize.height();
+
+	switch (pos) {
+	case CartographyItem::TOP_LEFT:
+		return QPointF(-w - margin, -h - margin);
+	case CartographyItem::TOP_MIDDLE:
+		return QPointF(-w/2, -h - margin);
+	case CartographyItem::TOP_RIGHT:
+		return QPointF(margin, -h - margin);
+	case CartographyItem::MIDDLE_LEFT:
+		return QPointF(-w - margin, -h/2);
+	case CartographyItem::MIDDLE_RIGHT:
+		return QPointF(margin, -h/2);
+	case CartographyItem::BOTTOM_LEFT:
+		return QPointF(-w - margin, margin);
+	case CartographyItem::BOTTOM_MIDDLE:
+		return QPointF(-w/2, margin);
+	case CartographyItem::BOTTOM_RIGHT:
+		return QPointF(margin, margin);
+	}
+
+	return QPointF(margin, margin);
+}
+
+CartographyPointsLayout::CartographyPointsLayout(int band) :
+	_band(band),
+	_maxRadius(0)
+{
+
+}
+
+void CartographyPointsLayout::build(QVector<CartographyItem*> const& items,
+									QVector<CartographyStyle> const& styles,
+									LabelMeasure const& measure,
+									CartographyItem* excluded) {
+
+	_marks.clear();
+	_members.clear();
+	_index.clear();
+	_maxRadius = 0;
+
+	CartographyStyle const defaultStyle;
+
+	auto styleOf = [&styles, &defaultStyle] (CartographyItem* item) -> CartographyStyle const& {
+		int index = item->getCategoryIndex();
+		return (index >= 0 and index < styles.size()) ? styles.at(index) : defaultStyle;
+	};
+
+	qreal s = scale();
+	qreal clusterCell = ClusterCellSize/s;
+
+	//group the items by screen cell, or one group per item when zoomed in enough.
+	QVector<QVector<CartographyItem*>> groups;
+
+	if (s < ClusteringScale) {
+
+		QHash<GridCell, int> cells;
+
+		for (CartographyItem* item : items) {
+
+			if (item == excluded) {
+				continue;
+			}
+
+			GridCell cell = gridCell(item->getPosition(), clusterCell);
+			auto it = cells.constFind(cell);
+
+			if (it == cells.constEnd()) {
+				cells.insert(cell, groups.size());
+				groups.push_back({item});
+			} else {
+				groups[it.value()].push_back(item);
+			}
+		}
+
+	} else {
+
+		groups.reserve(items.size());
+
+		for (CartographyItem* item : items) {
+			if (item != excluded) {
+				groups.push_back({item});
+			}
+		}
+	}
+
+	_marks.reserve(groups.size());
+	_members.reserve(items.size());
+
+	QVector<int> candidates;
+
+	for (QVector<CartographyItem*> const& group : qAsConst(groups)) {
+
+		Mark mark;
+		mark.item = group.first();
+		mark.firstMember = _members.size();
+		mark.membersCount = group.size();
+		mark.showLabel = false;
+
+		_members += group;
+
+		qreal itemScale = mark.item->getScale();
+
+		if (group.size() == 1) {
+
+			mark.position = mark.item->getPosition();
+			mark.radius = styleOf(mark.item).radius*itemScale;
+			mark.text = mark.item->objectName();
+
+		} else {
+
+			QPointF sum;
+			qreal radius = 0;
+
+			for (CartographyItem* member : group) {
+				sum += member->getPosition();
+				radius = std::max(radius, styleOf(member).radius*member->getScale());
+			}
+
+			//the clusters grow with the number of points, without covering the neighbouring cells.
+			qreal grown = radius*(1 + std::log2(qreal(group.size()))/2);
+
+			mark.position = sum/group.size();
+			mark.radius = std::max(radius, std::min(grown, clusterCell/2));
+			mark.text = QString::number(group.size());
+		}
+
+		if (!mark.text.isEmpty()) {
+
+			QSizeF size = measure(mark.text, mark.item->getCategoryIndex())*itemScale;
+
+			if (size.height()*s >= MinLabelScreenHeight) {
+				qreal margin = mark.radius + 2*itemScale;
+				mark.labelArea = QRectF(mark.position + labelOffset(mark.item->getLegendPosition(), margin, size), size);
+				candidates.push_back(_marks.size());
+			}
+		}
+
+		_maxRadius = std::max(_maxRadius, mark.radius);
+		_index.insert(_marks.size(), mark.position);
+		_marks.push_back(mark);
+	}
+
+	placeLabels(candidates);
+}
+
+void CartographyPointsLayout::placeLabels(QVector<int> candidates) {
+
+	//the biggest clusters get their legend first, the points keep the order of the items.
+	std::stable_sort(candidates.begin(), candidates.end(), [this] (int a, int b) {
+		return _marks[a].membersCount > _marks[b].membersCount;
+	});
+
+	qreal cellSize = LabelGridCellSize/scale();
+	QHash<GridCell, QVector<int>> grid;
+
+	for (int candidate : qAsConst(candidates)) {
+
+		Mark & mark = _marks[candidate];
+		QRectF const& area = mark.labelArea;
+
+		GridCell first = gridCell(area.topLeft(), cellSize);
+		GridCell last = gridCell(area.bottomRight(), cellSize);
+
+		bool free = true;
+
+		for (qint64 x = first.first; x <= last.first and free; x++) {
+			for (qint64 y = first.second; y <= last.second and free; y++) {
+
+				auto it = grid.constFind(GridCell(x, y));
+
+				if (it == grid.constEnd()) {
+					continue;
+				}
+
+				for (int placed : it.value()) {
+					if (_marks[placed].labelArea.intersects(area)) {
+						free = false;
+						break;
+					}
+				}
+			}
+		}
+
+		if (!free) {
+			continue;
+		}
+
+		mark.showLabel = true;
+
+		for (qint64 x = first.first; x <= last.first; x++) {
+			for (qint64 y = first.second; y <= last.second; y++) {
+				grid[GridCell(x, y)].push_back(candidate);
+			}
+		}
+	}
+}
+
+int CartographyPointsLayout::band() const {
+	return _band;
+}
+qreal CartographyPointsLayout::scale() const {
+	return bandScale(_band);
+}
+
+QVector<CartographyPointsLayout::Mark> const& CartographyPointsLayout::marks() const {
+	return _marks;
+}
+QVector<CartographyItem*> CartographyPointsLayout::members(int mark) const {
+
+	if (mark < 0 or mark >= _marks.size()) {
+		return {};
+	}
+
+	return _members.mid(_marks[mark].firstMember, _marks[mark].membersCount);
+}
+
+QVector<int> CartographyPointsLayout::marksIn(QRectF const& area) const {
+	return _index.query(area);
+}
+
+CartographyItem* CartographyPointsLayout::itemAt(QPointF const& pos) const {
+
+	QVector<int> candidates = _index.query(QRectF(pos.x() - _maxRadius, pos.y() - _maxRadius, 2*_maxRadius, 2*_maxRadius));
+
+	int found = -1;
+	qreal foundDistance = 0;
+
+	for (int candidate : qAsConst(candidates)) {
+
+		Mark const& mark = _marks[candidate];
+		QPointF delta = mark.position - pos;
+		qreal distance = QPointF::dotProduct(delta, delta);
+
+		if (distance > mark.radius*mark.radius) {
+			continue;
+		}
+
+		if (found < 0 or distance < foundDistance) {
+			found = candidate;
+			foundDistance = distance;
+		}
+	}
+
+	if (found < 0) {
+		return nullptr;
+	}
+
+	Mark const& mark = _marks[found];
+
+	if (mark.membersCount == 1) {
+		return mark.item;
+	}
+
+	CartographyItem* closest = nullptr;
+	qreal closestDistance = 0;
+
+	for (int i = mark.firstMember; i < mark.firstMember + mark.membersCount; i++) {
+
+		QPointF delta = _members[i]->getPosition() - pos;
+		qreal distance = QPointF::dotProduct(delta, delta);
+
+		if (closest == nullptr or distance < closestDistance) {
+			closest = _members[i];
+			closestDistance = distance;
+		}
+	}
+
+	return closest;
+}
+
+qreal CartographyPointsLayout::maxRadius() const {
+	return _maxRadius;
+}
+
+} // namespace Sabrina
@@ -0,0 +1,108 @@
+#ifndef SABRINA_CARTOGRAPHYPOINTSLAYOUT_H
+#define SABRINA_CARTOGRAPHYPOINTSLAYOUT_H
+
+/*
+This file is part of the project Sabrina
+Copyright (C) 2023  Paragon <french.paragon@gmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "model/editableItems/cartography.h"
+#include "utils/pointquadtree.h"
+
+#include <QRectF>
+#include <QString>
+#include <QVector>
+
+#include <functional>
+
+namespace Sabrina {
+
+/*!
+ * \brief The CartographyPointsLayout class decide how the points of a cartography are drawn at a zoom band.
+ *
+ * Below ClusteringScale, the points falling in the same screen cell are merged in a single mark, labelled with the number of points.
+ * Then the legends are placed, the biggest clusters first, and a legend overlapping an already placed one is hidden.
+ * Legends too small to be read at the zoom band are not placed at all.
+ *
+ * The layout only depends on the items and the zoom band, not on the visible area, so it can be kept while the view is panned.
+ */
+class CartographyPointsLayout
+{
+public:
+
+	static const int BandsPerOctave;
+	static const qreal ClusteringScale;
+	static const int ClusterCellSize; //in screen pixels.
+	static const int LabelGridCellSize; //in screen pixels.
+	static const qreal MinLabelScreenHeight; //in screen pixels.
+
+	//! \brief a single point, or a cluster of points.
+	struct Mark {
+		QPointF position;
+		qreal radius; //in map units.
+		CartographyItem* item; //the item of the point, or the first item of the cluster, giving the style.
+		int firstMember;
+		int membersCount;
+		QString text;
+		bool showLabel;
+		QRectF labelArea; //in map coordinates.
+	};
+
+	//! \brief measure a legend in map units, before the scale of the item, for a category style index.
+	typedef std::function<QSizeF(QString const& text, int styleIndex)> LabelMeasure;
+
+	static int zoomBand(qreal scale);
+	//! \brief the smallest scale of a zoom band, the layout is computed for this scale.
+	static qreal bandScale(int band);
+
+	static QPointF labelOffset(CartographyItem::LegendPos pos, qreal margin, QSizeF const& labelSize);
+
+	explicit CartographyPointsLayout(int band);
+
+	//! \brief compute the marks of the items, the excluded item is left out.
+	void build(QVector<CartographyItem*> const& items,
+			   QVector<CartographyStyle> const& styles,
+			   LabelMeasure const& measure,
+			   CartographyItem* excluded = nullptr);
+
+	int band() const;
+	qreal scale() const;
+
+	QVector<Mark> const& marks() const;
+	QVector<CartographyItem*> members(int mark) const;
+
+	//! \brief the indices of the marks placed in the area.
+	QVector<int> marksIn(QRectF const& area) const;
+	//! \brief the item under pos, the closest member when pos is on a cluster, or nullptr.
+	CartographyItem* itemAt(QPointF const& pos) const;
+
+	qreal maxRadius() const;
+
+protected:
+
+	void placeLabels(QVector<int> candidates);
+
+	int _band;
+
+	QVector<Mark> _marks;
+	QVector<CartographyItem*> _members;
+	PointQuadTree<int> _index;
+	qreal _maxRadius;
+};
+
+} // namespace Sabrina
+
+#endif // SABRINA_CARTOGRAPHYPOINTSLAYOUT_H
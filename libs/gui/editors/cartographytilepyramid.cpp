@@ -0,0 +1,1158 @@
+/*
+This file is part of the project Sabrina
+Copyright (C) 2023  Paragon <french.paragon@gmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "cartographytilepyramid.h"
+
+#include "./cartographylayeredimage.h"
+
+#include <QCryptographicHash>
+#include <QDir>
+#include <QImageReader>
+#include <QPainter>
+#include <QSet>
+#include <QSettings>
+#include <QStandardPaths>
+#include <QThread>
+
+#include <algorithm>
+#include <cmath>
+
+namespace Sabrina {
+
+const int CartographyTilePyramid::TileSize = 256;
+const int CartographyTilePyramid::MemoryCacheSize = 64*1024;
+
+static const int PyramidIndexVersion = 3;
+static const char* PyramidIndexFile = "index.ini";
+static const QString CompositePrefix = "composite/";
+
+static bool isTransparent(QImage const& image) {
+
+	QImage argb = image.convertToFormat(QImage::Format_ARGB32_Premultiplied);
+
+	for (int y = 0; y < argb.height(); y++) {
+
+		QRgb const* line = reinterpret_cast<QRgb const*>(argb.constScanLine(y));
+
+		for (int x = 0; x < argb.width(); x++) {
+			if (qAlpha(line[x]) != 0) {
+				return false;
+			}
+		}
+	}
+
+	return true;
+}
+
+CartographyTilePyramid::CartographyTilePyramid() :
+	_levels(0),
+	_layered(false),
+	_visibilityGeneration(0),
+	_tiles(MemoryCacheSize)
+{
+
+}
+
+bool CartographyTilePyramid::open(QString const& imageFile,
+								  std::function<bool()> const& cancelled,
+								  std::function<void(QImage const&)> const& preview) {
+
+	QMutexLocker lock(&_mutex);
+
+	QFileInfo infos(imageFile);
+
+	_imageFile.clear();
+	_cacheDir.clear();
+	_imageSize = QSize();
+	_levels = 0;
+	_layered = CartographyLayeredImage::isLayeredFile(imageFile);
+	_layers.clear();
+	_visibilityGeneration++;
+	_tiles.clear();
+
+	if (!infos.exists()) {
+		return false;
+	}
+
+	QString dir = cacheDirectory(imageFile);
+
+	if (!readIndex(dir, infos)) {
+
+		_layers.clear();
+
+		bool ok = (_layered) ? generateLayers(dir, infos, cancelled, preview) : generate(dir, infos, cancelled, preview);
+
+		if (!ok or !writeIndex(dir, infos)) {
+			_imageSize = QSize();
+			_levels = 0;
+			_layers.clear();
+			return false;
+		}
+	}
+
+	_imageFile = imageFile;
+	_cacheDir = dir;
+
+	return true;
+}
+
+void CartographyTilePyramid::close() {
+
+	QMutexLocker lock(&_mutex);
+
+	_imageFile.clear();
+	_cacheDir.clear();
+	_imageSize = QSize();
+	_levels = 0;
+	_layered = false;
+	_layers.clear();
+	_visibilityGeneration++;
+	_tiles.clear();
+}
+
+bool CartographyTilePyramid::isValid() const {
+	return _levels > 0;
+}
+
+QString CartographyTilePyramid::imageFile() const {
+	return _imageFile;
+}
+QSize CartographyTilePyramid::imageSize() const {
+	return _imageSize;
+}
+
+int CartographyTilePyramid::levelsCount() const {
+	return _levels;
+}
+QSize CartographyTilePyramid::levelSize(int level) const {
+	int factor = 1 << level;
+	return QSize((_imageSize.width() + factor - 1)/factor, (_imageSize.height() + factor - 1)/factor);
+}
+int CartographyTilePyramid::columns(int level) const {
+	return (levelSize(level).width() + TileSize - 1)/TileSize;
+}
+int CartographyTilePyramid::rows(int level) const {
+	return (levelSize(level).height() + TileSize - 1)/TileSize;
+}
+
+QRect CartographyTilePyramid::tileArea(int level, int column, int row) const {
+	int span = TileSize << level;
+	return QRect(column*span, row*span, span, span).intersected(QRect(QPoint(0, 0), _imageSize));
+}
+
+int CartographyTilePyramid::levelForScale(qreal imageScale) const {
+
+	if (_levels <= 0) {
+		return 0;
+	}
+
+	if (imageScale <= 0) {
+		return _levels-1;
+	}
+
+	int level = static_cast<int>(std::floor(std::log2(1/imageScale)));
+
+	return std::min(std::max(level, 0), _levels-1);
+}
+
+QImage CartographyTilePyramid::tile(int level, int column, int row) const {
+
+	{
+		QMutexLocker lock(&_mutex);
+
+		if (level < 0 or level >= _levels or column < 0 or column >= columns(level) or row < 0 or row >= rows(level)) {
+			return QImage();
+		}
+
+		if (!_layered) {
+			lock.unlock();
+			return cachedTile(tilePath(level, column, row));
+		}
+	}
+
+	return compositeTile(level, column, row);
+}
+
+bool CartographyTilePyramid::isLayered() const {
+	return _layered;
+}
+int CartographyTilePyramid::layersCount() const {
+	QMutexLocker lock(&_mutex);
+	return _layers.size();
+}
+QString CartographyTilePyramid::layerName(int layer) const {
+
+	QMutexLocker lock(&_mutex);
+
+	if (layer < 0 or layer >= _layers.size()) {
+		return QString();
+	}
+
+	return _layers[layer].name;
+}
+QString CartographyTilePyramid::layerId(int layer) const {
+
+	QMutexLocker lock(&_mutex);
+
+	if (layer < 0 or layer >= _layers.size()) {
+		return QString();
+	}
+
+	return _layers[layer].id;
+}
+bool CartographyTilePyramid::isLayerVisible(int layer) const {
+
+	QMutexLocker lock(&_mutex);
+
+	if (layer < 0 or layer >= _layers.size()) {
+		return false;
+	}
+
+	return _layers[layer].visible;
+}
+bool CartographyTilePyramid::isLayerVisibleInFile(int layer) const {
+
+	QMutexLocker lock(&_mutex);
+
+	if (layer < 0 or layer >= _layers.size()) {
+		return false;
+	}
+
+	return _layers[layer].visibleInFile;
+}
+void CartographyTilePyramid::setLayerVisible(int layer, bool visible) {
+
+	QMutexLocker lock(&_mutex);
+
+	if (layer < 0 or layer >= _layers.size() or _layers[layer].visible == visible) {
+		return;
+	}
+
+	_layers[layer].visible = visible;
+	_visibilityGeneration++;
+
+	for (QString const& key : _tiles.keys()) {
+		if (key.startsWith(CompositePrefix)) {
+			_tiles.remove(key);
+		}
+	}
+}
+
+QString CartographyTilePyramid::cacheDirectory(QString const& imageFile) {
+
+	QFileInfo infos(imageFile);
+	QFileInfo dirInfos(infos.absolutePath());
+
+	if (dirInfos.isWritable()) {
+		return infos.absolutePath() + "/." + infos.fileName() + ".tiles";
+	}
+
+	QByteArray hash = QCryptographicHash::hash(infos.absoluteFilePath().toUtf8(), QCryptographicHash::Md5).toHex();
+	return QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + "/map_tiles/" + QString::fromLatin1(hash);
+}
+
+QSize CartographyTilePyramid::imageFileSize(QString const& imageFile) {
+
+	if (CartographyLayeredImage::isLayeredFile(imageFile)) {
+		return CartographyLayeredImage::imageFileSize(imageFile);
+	}
+
+	QImageReader reader(imageFile);
+	reader.setAutoTransform(true);
+
+	QSize size = reader.size();
+
+	if (reader.transformation() & QImageIOHandler::TransformationRotate90) {
+		size.transpose();
+	}
+
+	return size;
+}
+
+bool CartographyTilePyramid::readIndex(QString const& dir, QFileInfo const& imageInfos) {
+
+	QFileInfo indexInfos(dir + "/" + PyramidIndexFile);
+
+	if (!indexInfos.exists()) {
+		return false;
+	}
+
+	QSettings index(indexInfos.absoluteFilePath(), QSettings::IniFormat);
+
+	if (index.value("pyramid/version").toInt() != PyramidIndexVersion or
+			index.value("pyramid/tileSize").toInt() != TileSize or
+			index.value("pyramid/layered").toBool() != _layered or
+			index.value("source/bytes").toLongLong() != imageInfos.size() or
+			index.value("source/modified").toDateTime() != imageInfos.lastModified()) {
+		return false;
+	}
+
+	_imageSize = index.value("pyramid/size").toSize();
+	_levels = index.value("pyramid/levels").toInt();
+
+	if (_imageSize.isEmpty() or _levels <= 0) {
+		return false;
+	}
+
+	_cacheDir = dir;
+
+	if (!_layered) {
+		return QFileInfo(tilePath(_levels-1, 0, 0)).exists();
+	}
+
+	int count = index.beginReadArray("layers");
+
+	for (int i = 0; i < count; i++) {
+
+		index.setArrayIndex(i);
+
+		Layer layer;
+		layer.name = index.value("name").toString();
+		layer.id = index.value("id").toString();
+		layer.opacity = index.value("opacity", 1.0).toDouble();
+		layer.mode = static_cast<QPainter::CompositionMode>(index.value("mode", QPainter::CompositionMode_SourceOver).toInt());
+		layer.visibleInFile = index.value("visible", true).toBool();
+		layer.visible = layer.visibleInFile;
+
+		_layers.push_back(layer);
+	}
+
+	index.endArray();
+
+	//the tiles of a transparent layer are not saved, but its directory is always created.
+	return !_layers.isEmpty() and QFileInfo(layerDirectory(_layers.size()-1)).isDir();
+}
+
+bool CartographyTilePyramid::generate(QString const& dir,
+									  QFileInfo const& imageInfos,
+									  std::function<bool()> const& cancelled,
+									  std::function<void(QImage const&)> const& preview) {
+
+	auto isCancelled = [&cancelled] () {
+		return cancelled and cancelled();
+	};
+
+	QDir cacheDir(dir);
+
+	if (cacheDir.exists()) {
+		cacheDir.removeRecursively();
+	}
+
+	_cacheDir = dir;
+
+	{
+		QImageReader reader(imageInfos.absoluteFilePath());
+		reader.setAutoTransform(true);
+
+		bool previewSent = false;
+
+		if (preview and reader.supportsOption(QImageIOHandler::ScaledSize)) {
+			//formats like jpeg can be decoded at a lower resolution for a fraction of the cost of the full image.
+			QImageReader previewReader(imageInfos.absoluteFilePath());
+			previewReader.setScaledSize(reader.size().scaled(TileSize, TileSize, Qt::KeepAspectRatio));
+			previewReader.setAutoTransform(true);
+
+			QImage previewImage = previewReader.read();
+
+			if (!previewImage.isNull()) {
+				preview(previewImage);
+				previewSent = true;
+			}
+		}
+
+		if (isCancelled()) {
+			return false;
+		}
+
+		QImage image = reader.read();
+
+		if (image.isNull()) {
+			return false;
+		}
+
+		if (preview and !previewSent) {
+			preview(image.scaled(TileSize, TileSize, Qt::KeepAspectRatio, Qt::SmoothTransformation));
+		}
+
+		setupLevels(image.size());
+
+		if (!QDir().mkpath(dir + "/0")) {
+			return false;
+		}
+
+		for (int r = 0; r < rows(0); r++) {
+
+			if (isCancelled()) {
+				return false;
+			}
+
+			for (int c = 0; c < columns(0); c++) {
+				if (!image.copy(tileArea(0, c, r)).save(tilePath(0, c, r), "PNG")) {
+					return false;
+				}
+			}
+		}
+	} //the full image is released here, the coarser levels are built from the tiles of the previous level.
+
+	return buildLevels(dir, isCancelled);
+}
+
+bool CartographyTilePyramid::generateLayers(QString const& dir,
+											QFileInfo const& imageInfos,
+											std::function<bool()> const& cancelled,
+											std::function<void(QImage const&)> const& preview) {
+
+	auto isCancelled = [&cancelled] () {
+		return cancelled and cancelled();
+	};
+
+	QDir cacheDir(dir);
+
+	if (cacheDir.exists()) {
+		cacheDir.removeRecursively();
+	}
+
+	_cacheDir = dir;
+
+	CartographyLayeredImage document;
+
+	if (!document.open(imageInfos.absoluteFilePath())) {
+		return false;
+	}
+
+	if (preview) {
+
+		QImage previewImage = document.preview();
+
+		if (!previewImage.isNull()) {
+			preview(previewImage.scaled(TileSize, TileSize, Qt::KeepAspectRatio, Qt::SmoothTransformation));
+		}
+	}
+
+	setupLevels(document.size());
+
+	QVector<CartographyLayeredImage::Layer> const& layers = document.layers();
+
+	for (int i = 0; i < layers.size(); i++) {
+
+		if (isCancelled()) {
+			return false;
+		}
+
+		Layer layer;
+		layer.name = layers[i].name;
+		layer.id = layers[i].id;
+		layer.opacity = layers[i].opacity;
+		layer.mode = layers[i].mode;
+		layer.visibleInFile = layers[i].visible;
+		layer.visible = layer.visibleInFile;
+
+		_layers.push_back(layer);
+
+		QString root = layerDirectory(i);
+
+		if (!QDir().mkpath(root + "/0")) {
+			return false;
+		}
+
+		//the layers are decoded one at a time, and only their non transparent tiles are saved.
+		QImage image = document.layerImage(i);
+
+		if (image.isNull()) {
+			continue;
+		}
+
+		QRect layerArea = QRect(layers[i].offset, image.size()).intersected(QRect(QPoint(0, 0), _imageSize));
+
+		if (layerArea.isEmpty()) {
+			continue;
+		}
+
+		int c0 = layerArea.left()/TileSize;
+		int c1 = layerArea.right()/TileSize;
+		int r0 = layerArea.top()/TileSize;
+		int r1 = layerArea.bottom()/TileSize;
+
+		for (int r = r0; r <= r1; r++) {
+
+			if (isCancelled()) {
+				return false;
+			}
+
+			for (int c = c0; c <= c1; c++) {
+
+				QRect area = tileArea(0, c, r);
+
+				QImage layerTile(area.size(), QImage::Format_ARGB32_Premultiplied);
+				layerTile.fill(Qt::transparent);
+
+				QPainter painter(&layerTile);
+				painter.setCompositionMode(QPainter::CompositionMode_Source);
+				painter.drawImage(layers[i].offset - area.topLeft(), image);
+				painter.end();
+
+				if (isTransparent(layerTile)) {
+					continue;
+				}
+
+				if (!layerTile.save(tilePath(root, 0, c, r), "PNG")) {
+					return false;
+				}
+			}
+		}
+
+		image = QImage();
+
+		if (!buildLevels(root, isCancelled)) {
+			return false;
+		}
+	}
+
+	return !_layers.isEmpty();
+}
+
+void CartographyTilePyramid::setupLevels(QSize const& imageSize) {
+
+	_imageSize = imageSize;
+	_levels = 1;
+
+	while (std::max(levelSize(_levels-1).width(), levelSize(_levels-1).height()) > TileSize) {
+		_levels++;
+	}
+}
+
+bool CartographyTilePyramid::buildLevels(QString const& root, std::function<bool()> const& isCancelled) const {
+
+	for (int level = 1; level < _levels; level++) {
+
+		if (!QDir().mkpath(root + "/" + QString::number(level))) {
+			return false;
+		}
+
+		QRect previousLevel(QPoint(0, 0), levelSize(level-1));
+
+		for (int r = 0; r < rows(level); r++) {
+
+			if (isCancelled()) {
+				return false;
+			}
+
+			for (int c = 0; c < columns(level); c++) {
+
+				QRect area = QRect(2*c*TileSize, 2*r*TileSize, 2*TileSize, 2*TileSize).intersected(previousLevel);
+
+				QImage canvas(area.size(), QImage::Format_ARGB32_Premultiplied);
+				canvas.fill(Qt::transparent);
+
+				QPainter painter(&canvas);
+				bool empty = true;
+
+				for (int dy = 0; dy < 2; dy++) {
+					for (int dx = 0; dx < 2; dx++) {
+
+						if (2*c + dx >= columns(level-1) or 2*r + dy >= rows(level-1)) {
+							continue;
+						}
+
+						QImage previous(tilePath(root, level-1, 2*c + dx, 2*r + dy));
+
+						if (!previous.isNull()) {
+							painter.drawImage(QPoint(dx*TileSize, dy*TileSize), previous);
+							empty = false;
+						}
+					}
+				}
+
+				painter.end();
+
+				if (empty) { //the transparent parts of the layers have no tiles.
+					continue;
+				}
+
+				QSize size((area.width() + 1)/2, (area.height() + 1)/2);
+
+				if (!canvas.scaled(size, Qt::IgnoreAspectRatio, Qt::SmoothTransformation).save(tilePath(root, level, c, r), "PNG")) {
+					return false;
+				}
+			}
+		}
+	}
+
+	return true;
+}
+
+bool CartographyTilePyramid::writeIndex(QString const& dir, QFileInfo const& imageInfos) const {
+
+	//the index is written last, so that an interrupted generation is done again.
+	QSettings index(dir + "/" + PyramidIndexFile, QSettings::IniFormat);
+
+	index.setValue("pyramid/version", PyramidIndexVersion);
+	index.setValue("pyramid/tileSize", TileSize);
+	index.setValue("pyramid/size", _imageSize);
+	index.setValue("pyramid/levels", _levels);
+	index.setValue("pyramid/layered", _layered);
+	index.setValue("source/bytes", imageInfos.size());
+	index.setValue("source/modified", imageInfos.lastModified());
+
+	index.beginWriteArray("layers", _layers.size());
+
+	for (int i = 0; i < _layers.size(); i++) {
+		index.setArrayIndex(i);
+		index.setValue("name", _layers[i].name);
+		index.setValue("id", _layers[i].id);
+		index.setValue("opacity", _layers[i].opacity);
+		index.setValue("mode", static_cast<int>(_layers[i].mode));
+		index.setValue("visible", _layers[i].visibleInFile);
+	}
+
+	index.endArray();
+
+	index.sync();
+
+	return index.status() == QSettings::NoError;
+}
+
+QString CartographyTilePyramid::tilePath(int level, int column, int row) const {
+	return tilePath(_cacheDir, level, column, row);
+}
+QString CartographyTilePyramid::tilePath(QString const& root, int level, int column, int row) const {
+	return QString("%1/%2/%3_%4.png").arg(root).arg(level).arg(column).arg(row);
+}
+QString CartographyTilePyramid::layerDirectory(int layer) const {
+	return QString("%1/layers/%2").arg(_cacheDir).arg(layer);
+}
+
+QImage CartographyTilePyramid::cachedTile(QString const& path) const {
+
+	{
+		QMutexLocker lock(&_mutex);
+
+		QImage* cached = _tiles.object(path);
+
+		if (cached != nullptr) {
+			return *cached;
+		}
+	}
+
+	QImage img;
+
+	if (QFileInfo::exists(path)) {
+		img.load(path); //decoded without the lock, so that several tiles can be read at the same time.
+	}
+
+	QMutexLocker lock(&_mutex);
+
+	if (!_cacheDir.isEmpty() and path.startsWith(_cacheDir + "/")) { //the pyramid might have been changed in the meantime.
+		_tiles.insert(path, new QImage(img), std::max<int>(img.sizeInBytes()/1024, 1));
+	}
+
+	return img;
+}
+
+QImage CartographyTilePyramid::compositeTile(int level, int column, int row) const {
+
+	QString key;
+	int generation;
+	QVector<Layer> layers;
+	QVector<QString> paths;
+
+	{
+		QMutexLocker lock(&_mutex);
+
+		generation = _visibilityGeneration;
+		key = QString("%1%2/%3/%4/%5").arg(CompositePrefix).arg(generation).arg(level).arg(column).arg(row);
+
+		QImage* cached = _tiles.object(key);
+
+		if (cached != nullptr) {
+			return *cached;
+		}
+
+		for (int i = 0; i < _layers.size(); i++) {
+			if (_layers[i].visible) {
+				layers.push_back(_layers[i]);
+				paths.push_back(tilePath(layerDirectory(i), level, column, row));
+			}
+		}
+	}
+
+	QRect levelArea = QRect(column*TileSize, row*TileSize, TileSize, TileSize).intersected(QRect(QPoint(0, 0), levelSize(level)));
+
+	QImage composite(levelArea.size(), QImage::Format_ARGB32_Premultiplied);
+	composite.fill(Qt::transparent);
+
+	QPainter painter(&composite);
+
+	for (int i = 0; i < layers.size(); i++) {
+
+		QImage layerTile = cachedTile(paths[i]); //the tiles of the layers stay cached when the visibility changes.
+
+		if (layerTile.isNull()) {
+			continue;
+		}
+
+		painter.setOpacity(layers[i].opacity);
+		painter.setCompositionMode(layers[i].mode);
+		painter.drawImage(QPoint(0, 0), layerTile);
+	}
+
+	painter.end();
+
+	QMutexLocker lock(&_mutex);
+
+	if (generation == _visibilityGeneration) { //no layer was toggled in the meantime.
+		_tiles.insert(key, new QImage(composite), std::max<int>(composite.sizeInBytes()/1024, 1));
+	}
+
+	return composite;
+}
+
+CartographyTilePyramidWorker::CartographyTilePyramidWorker(QAtomicInt const* latestRequest, QObject* parent) :
+	QObject(parent),
+	_latestRequest(latestRequest)
+{
+
+}
+
+void CartographyTilePyramidWorker::load(QString const& imageFile, int request) {
+
+	auto cancelled = [this, request] () {
+		return _latestRequest->loadAcquire() != request;
+	};
+
+	if (cancelled()) {
+		return;
+	}
+
+	CartographyTilePyramidPtr pyramid = std::make_shared<CartographyTilePyramid>();
+
+	bool ok = pyramid->open(imageFile, cancelled, [this, request] (QImage const& preview) {
+		Q_EMIT previewLoaded(request, preview);
+	});
+
+	if (cancelled()) {
+		return;
+	}
+
+	Q_EMIT pyramidLoaded(request, ok ? pyramid : nullptr);
+}
+
+CartographyTilePyramidLoader::CartographyTilePyramidLoader(QObject* parent) :
+	QObject(parent),
+	_thread(new QThread(this)),
+	_request(0),
+	_loading(false)
+{
+	qRegisterMetaType<Sabrina::CartographyTilePyramidPtr>();
+
+	_worker = new CartographyTilePyramidWorker(&_request);
+
+	_worker->moveToThread(_thread);
+	connect(_thread, &QThread::finished, _worker, &QObject::deleteLater);
+
+	connect(_worker, &CartographyTilePyramidWorker::previewLoaded, this, &CartographyTilePyramidLoader::onPreviewLoaded);
+	connect(_worker, &CartographyTilePyramidWorker::pyramidLoaded, this, &CartographyTilePyramidLoader::onPyramidLoaded);
+
+	_thread->start(QThread::LowPriority);
+}
+CartographyTilePyramidLoader::~CartographyTilePyramidLoader() {
+	cancel();
+	_thread->quit();
+	_thread->wait();
+}
+
+void CartographyTilePyramidLoader::load(QString const& imageFile) {
+
+	int request = _request.fetchAndAddOrdered(1) + 1; //cancel the loading in progress.
+	_loading = true;
+
+	CartographyTilePyramidWorker* worker = _worker;
+
+	QMetaObject::invokeMethod(_worker, [worker, imageFile, request] () {
+		worker->load(imageFile, request);
+	}, Qt::QueuedConnection);
+}
+void CartographyTilePyramidLoader::cancel() {
+	_request.fetchAndAddOrdered(1);
+	_loading = false;
+}
+
+bool CartographyTilePyramidLoader::isLoading() const {
+	return _loading;
+}
+
+void CartographyTilePyramidLoader::onPreviewLoaded(int request, QImage preview) {
+
+	if (request != _request.loadAcquire()) {
+		return;
+	}
+
+	Q_EMIT previewLoaded(preview);
+}
+void CartographyTilePyramidLoader::onPyramidLoaded(int request, CartographyTilePyramidPtr pyramid) {
+
+	if (request != _request.loadAcquire()) {
+		return;
+	}
+
+	_loading = false;
+	Q_EMIT pyramidLoaded(pyramid);
+}
+
+const QString CartographyBackgroundTilesModel::SourcePrefix = "tile/";
+const QString CartographyBackgroundTilesModel::PreviewPrefix = "preview/";
+
+CartographyBackgroundTilesModel::CartographyBackgroundTilesModel(QObject* parent) :
+	QAbstractListModel(parent),
+	_pyramid(nullptr),
+	_hasPreview(false),
+	_generation(0),
+	_scale(1.0)
+{
+
+}
+
+int CartographyBackgroundTilesModel::rowCount(const QModelIndex &parent) const {
+
+	if (parent.isValid()) {
+		return 0;
+	}
+
+	return _tiles.size();
+}
+
+QVariant CartographyBackgroundTilesModel::data(const QModelIndex &index, int role) const {
+
+	if (!index.isValid() or index.row() >= _tiles.size()) {
+		return QVariant();
+	}
+
+	Tile const& tile = _tiles[index.row()];
+
+	if (tile.level < 0) { //the preview covers the whole map.
+
+		switch (role) {
+		case TileXRole:
+		case TileYRole:
+			return 0.0;
+		case TileWidthRole:
+			return _mapSize.width();
+		case TileHeightRole:
+			return _mapSize.height();
+		case TileZRole:
+			return -64; //below the tiles of any level.
+		case TileSourceRole:
+			return QString("%1%2").arg(PreviewPrefix).arg(_generation);
+		default:
+			break;
+		}
+
+		return QVariant();
+	}
+
+	if (_pyramid == nullptr) {
+		return QVariant();
+	}
+
+	QSize imageSize = _pyramid->imageSize();
+	qreal sx = _mapSize.width()/imageSize.width();
+	qreal sy = _mapSize.height()/imageSize.height();
+
+	QRect area = _pyramid->tileArea(tile.level, tile.column, tile.row);
+
+	switch (role) {
+	case TileXRole:
+		return area.x()*sx;
+	case TileYRole:
+		return area.y()*sy;
+	case TileWidthRole:
+		return area.width()*sx;
+	case TileHeightRole:
+		return area.height()*sy;
+	case TileZRole:
+		return -(tile.level+1); //finer levels above the coarser ones, and all below the points.
+	case TileSourceRole:
+		return QString("%1%2/%3/%4/%5").arg(SourcePrefix).arg(_generation).arg(tile.level).arg(tile.column).arg(tile.row);
+	default:
+		break;
+	}
+
+	return QVariant();
+}
+
+QHash<int, QByteArray> CartographyBackgroundTilesModel::roleNames() const {
+	return {
+		{TileXRole, "tileX"},
+		{TileYRole, "tileY"},
+		{TileWidthRole, "tileWidth"},
+		{TileHeightRole, "tileHeight"},
+		{TileZRole, "tileZ"},
+		{TileSourceRole, "tileSource"}
+	};
+}
+
+void CartographyBackgroundTilesModel::setPyramid(std::shared_ptr<CartographyTilePyramid const> pyramid) {
+
+	if (pyramid == _pyramid) {
+		return;
+	}
+
+	_pyramid = pyramid;
+
+	if (!_hasPreview) {
+		_generation++;
+		resetTiles();
+	} //else the preview stays displayed while the first tiles are loading.
+
+	updateTiles();
+}
+
+void CartographyBackgroundTilesModel::refresh() {
+
+	_generation++; //the new sources are not in the cache of the images.
+
+	resetTiles();
+	updateTiles();
+}
+
+void CartographyBackgroundTilesModel::setHasPreview(bool hasPreview) {
+
+	if (hasPreview == _hasPreview and !hasPreview) {
+		return;
+	}
+
+	_hasPreview = hasPreview;
+	_generation++; //a new preview has a new source.
+
+	resetTiles();
+	updateTiles();
+}
+
+void CartographyBackgroundTilesModel::setMapSize(QSizeF const& size) {
+
+	if (size == _mapSize) {
+		return;
+	}
+
+	_mapSize = size;
+
+	resetTiles(); //all the tiles are moved.
+	updateTiles();
+}
+
+void CartographyBackgroundTilesModel::setVisibleArea(QRectF const& area, qreal scale) {
+
+	_visibleArea = area;
+	_scale = scale;
+
+	updateTiles();
+}
+
+void CartographyBackgroundTilesModel::resetTiles() {
+
+	if (_tiles.isEmpty()) {
+		return;
+	}
+
+	beginResetModel();
+	_tiles.clear();
+	endResetModel();
+}
+
+void CartographyBackgroundTilesModel::updateTiles() {
+
+	if (_mapSize.isEmpty() or ((_pyramid == nullptr or !_pyramid->isValid()) and !_hasPreview)) {
+		resetTiles();
+		return;
+	}
+
+	QVector<Tile> wanted;
+
+	if (_hasPreview) {
+		wanted.push_back({-1, 0, 0});
+	}
+
+	if (_pyramid == nullptr or !_pyramid->isValid()) {
+		updateRows(wanted);
+		return;
+	}
+
+	QSize imageSize = _pyramid->imageSize();
+	qreal sx = _mapSize.width()/imageSize.width();
+	qreal sy = _mapSize.height()/imageSize.height();
+
+	int top = _pyramid->levelsCount()-1;
+	int level = _pyramid->levelForScale(_scale*std::max(sx, sy));
+
+	wanted.push_back({top, 0, 0});
+
+	QRectF imageArea(_visibleArea.x()/sx, _visibleArea.y()/sy, _visibleArea.width()/sx, _visibleArea.height()/sy);
+	imageArea = imageArea.intersected(QRectF(QPointF(0, 0), imageSize));
+
+	if (level < top and !imageArea.isEmpty()) {
+
+		int span = CartographyTilePyramid::TileSize << level;
+
+		int c0 = static_cast<int>(std::floor(imageArea.left()/span));
+		int c1 = std::min(static_cast<int>(std::floor(imageArea.right()/span)), _pyramid->columns(level)-1);
+		int r0 = static_cast<int>(std::floor(imageArea.top()/span));
+		int r1 = std::min(static_cast<int>(std::floor(imageArea.bottom()/span)), _pyramid->rows(level)-1);
+
+		for (int r = r0; r <= r1; r++) {
+			for (int c = c0; c <= c1; c++) {
+				wanted.push_back({level, c, r});
+			}
+		}
+	}
+
+	updateRows(wanted);
+}
+
+void CartographyBackgroundTilesModel::updateRows(QVector<Tile> const& wanted) {
+
+	QSet<quint64> needed;
+	needed.reserve(wanted.size());
+
+	for (Tile const& t : wanted) {
+		needed.insert(tileKey(t.level, t.column, t.row));
+	}
+
+	//remove the tiles which are not needed anymore, by contiguous ranges.
+	QSet<quint64> present;
+
+	for (int i = _tiles.size()-1; i >= 0; ) {
+
+		quint64 key = tileKey(_tiles[i].level, _tiles[i].column, _tiles[i].row);
+
+		if (needed.contains(key)) {
+			present.insert(key);
+			i--;
+			continue;
+		}
+
+		int last = i;
+
+		while (i >= 0 and !needed.contains(tileKey(_tiles[i].level, _tiles[i].column, _tiles[i].row))) {
+			i--;
+		}
+
+		beginRemoveRows(QModelIndex(), i+1, last);
+		_tiles.remove(i+1, last-i);
+		endRemoveRows();
+	}
+
+	QVector<Tile> added;
+
+	for (Tile const& t : wanted) {
+		if (!present.contains(tileKey(t.level, t.column, t.row))) {
+			added.push_back(t);
+		}
+	}
+
+	if (added.isEmpty()) {
+		return;
+	}
+
+	beginInsertRows(QModelIndex(), _tiles.size(), _tiles.size() + added.size() - 1);
+	_tiles += added;
+	endInsertRows();
+}
+
+CartographyBackgroundLayersModel::CartographyBackgroundLayersModel(QObject* parent) :
+	QAbstractListModel(parent),
+	_pyramid(nullptr)
+{
+
+}
+
+int CartographyBackgroundLayersModel::rowCount(const QModelIndex &parent) const {
+
+	if (parent.isValid() or _pyramid == nullptr) {
+		return 0;
+	}
+
+	return _pyramid->layersCount();
+}
+
+QVariant CartographyBackgroundLayersModel::data(const QModelIndex &index, int role) const {
+
+	if (!index.isValid() or index.row() >= rowCount()) {
+		return QVariant();
+	}
+
+	int layer = layerIndex(index.row());
+
+	switch (role) {
+	case Qt::DisplayRole:
+		return _pyramid->layerName(layer);
+	case Qt::ToolTipRole:
+		return _pyramid->layerId(layer); //tell apart the layers with the same name.
+	case Qt::CheckStateRole:
+		return _pyramid->isLayerVisible(layer) ? Qt::Checked : Qt::Unchecked;
+	default:
+		break;
+	}
+
+	return QVariant();
+}
+
+bool CartographyBackgroundLayersModel::setData(const QModelIndex &index, const QVariant &value, int role) {
+
+	if (!index.isValid() or index.row() >= rowCount() or role != Qt::CheckStateRole) {
+		return false;
+	}
+
+	Q_EMIT layerVisibilityRequested(_pyramid->layerId(layerIndex(index.row())), value.toInt() == Qt::Checked);
+
+	return true;
+}
+
+Qt::ItemFlags CartographyBackgroundLayersModel::flags(const QModelIndex &index) const {
+
+	if (!index.isValid()) {
+		return Qt::NoItemFlags;
+	}
+
+	return Qt::ItemIsEnabled | Qt::ItemIsSelectable | Qt::ItemIsUserCheckable;
+}
+
+void CartographyBackgroundLayersModel::setPyramid(std::shared_ptr<CartographyTilePyramid const> pyramid) {
+
+	if (pyramid == _pyramid) {
+		return;
+	}
+
+	beginResetModel();
+	_pyramid = pyramid;
+	endResetModel();
+}
+
+void CartographyBackgroundLayersModel::refreshVisibility() {
+
+	int count = rowCount();
+
+	if (count > 0) {
+		Q_EMIT dataChanged(index(0), index(count-1), {Qt::CheckStateRole});
+	}
+}
+
+int CartographyBackgroundLayersModel::layerIndex(int row) const {
+	return _pyramid->layersCount() - 1 - row; //the top layer first, as in the painting softwares.
+}
+
+} // namespace Sabrina
@@ -0,0 +1,318 @@
+#ifndef SABRINA_CARTOGRAPHYTILEPYRAMID_H
+#define SABRINA_CARTOGRAPHYTILEPYRAMID_H
+
+/*
+This file is part of the project Sabrina
+Copyright (C) 2023  Paragon <french.paragon@gmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include <QAbstractListModel>
+#include <QAtomicInt>
+#include <QCache>
+#include <QFileInfo>
+#include <QImage>
+#include <QMutex>
+#include <QPainter>
+#include <QRect>
+#include <QVector>
+
+#include <functional>
+#include <memory>
+
+class QThread;
+
+namespace Sabrina {
+
+/*!
+ * \brief The CartographyTilePyramid class cut a map background in tiles, at several resolutions.
+ *
+ * Level 0 is the image at full resolution, and each level is half the size of the previous one, up to a level fitting in a single tile.
+ * The tiles are generated once and stored as png files in a cache directory next to the image, and regenerated only when the image changes.
+ * The pyramid can be read from several threads, the last used tiles are kept in memory.
+ *
+ * The layered documents (see CartographyLayeredImage) get a pyramid per layer, the layers are composited when a tile is read,
+ * so that hiding or showing a layer only composites the tiles again, without decoding the layers.
+ */
+class CartographyTilePyramid
+{
+public:
+
+	static const int TileSize;
+	static const int MemoryCacheSize; //in kB.
+
+	CartographyTilePyramid();
+
+	/*!
+	 * \brief open the pyramid of an image, the tiles are generated if they are missing or older than the image.
+	 * \param cancelled polled while the tiles are generated, the generation stops and open fails once it returns true.
+	 * \param preview called with a low resolution version of the image, before the tiles are generated.
+	 */
+	bool open(QString const& imageFile,
+			  std::function<bool()> const& cancelled = nullptr,
+			  std::function<void(QImage const&)> const& preview = nullptr);
+	void close();
+
+	bool isValid() const;
+
+	QString imageFile() const;
+	//! \brief the size of the image, read from the cache or from the image header, without decoding the image.
+	QSize imageSize() const;
+
+	int levelsCount() const;
+	QSize levelSize(int level) const;
+	int columns(int level) const;
+	int rows(int level) const;
+
+	//! \brief the part of the full resolution image covered by a tile.
+	QRect tileArea(int level, int column, int row) const;
+
+	//! \brief the coarsest level whose pixels are not displayed larger than screen pixels, when the full image is drawn at imageScale.
+	int levelForScale(qreal imageScale) const;
+
+	QImage tile(int level, int column, int row) const;
+
+	bool isLayered() const;
+	//! \brief the number of layers, 0 for the images which are not layered documents.
+	int layersCount() const;
+	//! \brief the name of a layer, the layers are indexed from the bottom to the top.
+	QString layerName(int layer) const;
+	//! \brief the identifier of a layer in the document, unlike its name it is unique.
+	QString layerId(int layer) const;
+	bool isLayerVisible(int layer) const;
+	//! \brief if the layer is visible in the document, before being toggled in Sabrina.
+	bool isLayerVisibleInFile(int layer) const;
+	//! \brief show or hide a layer, the composited tiles are dropped, the tiles of the layers stay in memory.
+	void setLayerVisible(int layer, bool visible);
+
+	//! \brief the directory where the tiles of an image are stored.
+	static QString cacheDirectory(QString const& imageFile);
+	//! \brief the size of an image file, read from its header.
+	static QSize imageFileSize(QString const& imageFile);
+
+protected:
+
+	struct Layer {
+		QString name;
+		QString id;
+		qreal opacity;
+		QPainter::CompositionMode mode;
+		bool visibleInFile;
+		bool visible;
+	};
+
+	bool readIndex(QString const& dir, QFileInfo const& imageInfos);
+	bool generate(QString const& dir,
+				  QFileInfo const& imageInfos,
+				  std::function<bool()> const& cancelled,
+				  std::function<void(QImage const&)> const& preview);
+	bool generateLayers(QString const& dir,
+						QFileInfo const& imageInfos,
+						std::function<bool()> const& cancelled,
+						std::function<void(QImage const&)> const& preview);
+	//! \brief compute the number of levels from the size of the image.
+	void setupLevels(QSize const& imageSize);
+	//! \brief build the coarser levels of the pyramid stored in root from its level 0, the missing tiles are transparent.
+	bool buildLevels(QString const& root, std::function<bool()> const& isCancelled) const;
+	bool writeIndex(QString const& dir, QFileInfo const& imageInfos) const;
+
+	QString tilePath(int level, int column, int row) const;
+	QString tilePath(QString const& root, int level, int column, int row) const;
+	QString layerDirectory(int layer) const;
+
+	//! \brief read a tile file through the memory cache, a null image for the transparent tiles which were not saved.
+	QImage cachedTile(QString const& path) const;
+	QImage compositeTile(int level, int column, int row) const;
+
+	mutable QMutex _mutex;
+
+	QString _imageFile;
+	QString _cacheDir;
+	QSize _imageSize;
+	int _levels;
+
+	bool _layered;
+	QVector<Layer> _layers;
+	int _visibilityGeneration; //part of the keys of the composited tiles, changes when a layer is shown or hidden.
+
+	mutable QCache<QString, QImage> _tiles;
+};
+
+typedef std::shared_ptr<CartographyTilePyramid> CartographyTilePyramidPtr;
+
+//! \brief The CartographyTilePyramidWorker class open the pyramids in the thread of a CartographyTilePyramidLoader.
+class CartographyTilePyramidWorker : public QObject
+{
+	Q_OBJECT
+public:
+	explicit CartographyTilePyramidWorker(QAtomicInt const* latestRequest, QObject* parent = nullptr);
+
+	void load(QString const& imageFile, int request);
+
+Q_SIGNALS:
+
+	void previewLoaded(int request, QImage preview);
+	void pyramidLoaded(int request, Sabrina::CartographyTilePyramidPtr pyramid);
+
+protected:
+
+	QAtomicInt const* _latestRequest;
+};
+
+/*!
+ * \brief The CartographyTilePyramidLoader class open or generate pyramids on a worker thread, so that the gui is not blocked while a large image is decoded.
+ *
+ * Starting a new loading cancels the previous one, the results of a cancelled loading are never emitted.
+ */
+class CartographyTilePyramidLoader : public QObject
+{
+	Q_OBJECT
+public:
+	explicit CartographyTilePyramidLoader(QObject* parent = nullptr);
+	~CartographyTilePyramidLoader();
+
+	void load(QString const& imageFile);
+	void cancel();
+
+	bool isLoading() const;
+
+Q_SIGNALS:
+
+	//! \brief emitted before the tiles are generated, when the pyramid of the image was not in the cache.
+	void previewLoaded(QImage preview);
+	//! \brief emitted at the end of the loading, the pyramid is nullptr if the image could not be read.
+	void pyramidLoaded(Sabrina::CartographyTilePyramidPtr pyramid);
+
+protected:
+
+	void onPreviewLoaded(int request, QImage preview);
+	void onPyramidLoaded(int request, CartographyTilePyramidPtr pyramid);
+
+	QThread* _thread;
+	CartographyTilePyramidWorker* _worker;
+
+	QAtomicInt _request;
+	bool _loading;
+};
+
+/*!
+ * \brief The CartographyBackgroundTilesModel class list the tiles of a pyramid needed to draw the visible part of a map.
+ *
+ * The tiles are placed in map coordinates, the coarsest level is always listed below the others,
+ * so that the map is never blank while the finer tiles are loading. When the view moves, only the tiles
+ * entering or leaving the view are inserted or removed.
+ */
+class CartographyBackgroundTilesModel : public QAbstractListModel
+{
+	Q_OBJECT
+public:
+
+	enum TileRoles {
+		TileXRole = Qt::UserRole + 1,
+		TileYRole,
+		TileWidthRole,
+		TileHeightRole,
+		TileZRole,
+		TileSourceRole
+	};
+
+	explicit CartographyBackgroundTilesModel(QObject* parent = nullptr);
+
+	int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+	QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+	QHash<int, QByteArray> roleNames() const override;
+
+	//! \brief set the pyramid to draw, or nullptr.
+	void setPyramid(std::shared_ptr<CartographyTilePyramid const> pyramid);
+	//! \brief reload all the tiles, after the content of the pyramid changed (e.g. a layer was hidden).
+	void refresh();
+	//! \brief list a preview of the whole background, under the tiles.
+	void setHasPreview(bool hasPreview);
+	void setMapSize(QSizeF const& size);
+
+	//! \brief select the tiles for the visible part of the map, in map coordinates, drawn at scale.
+	void setVisibleArea(QRectF const& area, qreal scale);
+
+	//! \brief the prefix of the tiles sources, the provider receive "tile/<generation>/<level>/<column>/<row>".
+	static const QString SourcePrefix;
+	//! \brief the prefix of the preview source, the provider receive "preview/<generation>".
+	static const QString PreviewPrefix;
+
+protected:
+
+	struct Tile {
+		int level; //-1 for the preview.
+		int column;
+		int row;
+	};
+
+	static inline quint64 tileKey(int level, int column, int row) {
+		return (quint64(level) << 48) | (quint64(column) << 24) | quint64(row);
+	}
+
+	void resetTiles();
+	void updateTiles();
+	//! \brief remove the rows which are not wanted anymore and append the missing ones.
+	void updateRows(QVector<Tile> const& wanted);
+
+	std::shared_ptr<CartographyTilePyramid const> _pyramid;
+	bool _hasPreview;
+	int _generation; //changes with the pyramid, so that the sources of the new tiles differ from the cached ones.
+
+	QSizeF _mapSize;
+	QRectF _visibleArea;
+	qreal _scale;
+
+	QVector<Tile> _tiles;
+};
+
+/*!
+ * \brief The CartographyBackgroundLayersModel class list the layers of a layered background, from the top to the bottom.
+ *
+ * The layers are checkable, checking or unchecking a layer only emits layerVisibilityRequested,
+ * so that the visibility is stored in the cartography before being applied to the pyramid.
+ */
+class CartographyBackgroundLayersModel : public QAbstractListModel
+{
+	Q_OBJECT
+public:
+
+	explicit CartographyBackgroundLayersModel(QObject* parent = nullptr);
+
+	int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+	QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+	bool setData(const QModelIndex &index, const QVariant &value, int role = Qt::EditRole) override;
+	Qt::ItemFlags flags(const QModelIndex &index) const override;
+
+	void setPyramid(std::shared_ptr<CartographyTilePyramid const> pyramid);
+	//! \brief update the check states, after the visibility of the layers changed.
+	void refreshVisibility();
+
+Q_SIGNALS:
+
+	void layerVisibilityRequested(QString layerId, bool visible);
+
+protected:
+
+	int layerIndex(int row) const;
+
+	std::shared_ptr<CartographyTilePyramid const> _pyramid;
+};
+
+} // namespace Sabrina
+
+Q_DECLARE_METATYPE(Sabrina::CartographyTilePyramidPtr)
+
+#endif // SABRINA_CARTOGRAPHYTILEPYRAMID_H
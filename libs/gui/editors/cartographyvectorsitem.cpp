@@ -0,0 +1,452 @@
+/*
+This file is part of the project Sabrina
+Copyright (C) 2023  Paragon <french.paragon@gmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "cartographyvectorsitem.h"
+
+#include "model/editableItems/cartography.h"
+
+#include <QSGGeometryNode>
+#include <QSGVertexColorMaterial>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace Sabrina {
+
+namespace {
+
+inline qreal cross(QPointF const& a, QPointF const& b, QPointF const& c) {
+	return (b.x() - a.x())*(c.y() - a.y()) - (b.y() - a.y())*(c.x() - a.x());
+}
+
+//! \brief if p is inside the triangle abc, or on its border, whatever the orientation of the triangle.
+bool inTriangle(QPointF const& p, QPointF const& a, QPointF const& b, QPointF const& c) {
+
+	qreal d1 = cross(a, b, p);
+	qreal d2 = cross(b, c, p);
+	qreal d3 = cross(c, a, p);
+
+	bool hasNeg = d1 < 0 or d2 < 0 or d3 < 0;
+	bool hasPos = d1 > 0 or d2 > 0 or d3 > 0;
+
+	return !(hasNeg and hasPos);
+}
+
+//! \brief a vertex of a QSGVertexColorMaterial, which expects premultiplied colors.
+inline QSGGeometry::ColoredPoint2D coloredPoint(QPointF const& p, QRgb premultiplied) {
+
+	QSGGeometry::ColoredPoint2D v;
+	v.set(p.x(), p.y(), qRed(premultiplied), qGreen(premultiplied), qBlue(premultiplied), qAlpha(premultiplied));
+	return v;
+}
+
+QSGGeometryNode* vertexColorNode(QVector<QSGGeometry::ColoredPoint2D> const& vertices) {
+
+	QSGGeometry* geometry = new QSGGeometry(QSGGeometry::defaultAttributes_ColoredPoint2D(), vertices.size());
+	geometry->setDrawingMode(QSGGeometry::DrawTriangles);
+
+	std::memcpy(geometry->vertexDataAsColoredPoint2D(), vertices.constData(), vertices.size()*sizeof(QSGGeometry::ColoredPoint2D));
+
+	QSGGeometryNode* node = new QSGGeometryNode();
+	node->setGeometry(geometry);
+	node->setMaterial(new QSGVertexColorMaterial());
+	node->setFlags(QSGNode::OwnsGeometry | QSGNode::OwnsMaterial);
+
+	return node;
+}
+
+} // namespace
+
+CartographyVectorsItem::CartographyVectorsItem(QQuickItem* parent) :
+	QQuickItem(parent),
+	_cartography(nullptr),
+	_scale(1.0),
+	_nodesDirty(true)
+{
+	setFlag(ItemHasContents, true);
+}
+
+Cartography* CartographyVectorsItem::cartography() const {
+	return _cartography;
+}
+void CartographyVectorsItem::setCartography(Cartography* cartography) {
+
+	if (cartography == _cartography) {
+		return;
+	}
+
+	if (_cartography != nullptr) {
+
+		for (CartographyVectorItem* item : _cartography->getVectorItems()) {
+			disconnect(item, nullptr, this, nullptr);
+		}
+
+		disconnect(_cartography, nullptr, this, nullptr);
+	}
+
+	_cartography = cartography;
+	_triangulations.clear();
+
+	if (_cartography != nullptr) {
+
+		for (CartographyVectorItem* item : _cartography->getVectorItems()) {
+			connectItem(item);
+		}
+
+		connect(_cartography, &Cartography::cartographyVectorItemsInserted, this, [this] (QVector<CartographyVectorItem*> const& items) {
+
+			for (CartographyVectorItem* item : items) {
+				connectItem(item);
+			}
+
+			invalidateVisibleItems(); //once for the whole batch.
+		});
+		connect(_cartography, &Cartography::cartographyVectorItemRemoved,
+				this, &CartographyVectorsItem::onItemRemoved);
+
+		connect(_cartography, &Cartography::categoryStyleChanged,
+				this, &CartographyVectorsItem::invalidateVisibleItems);
+	}
+
+	invalidateVisibleItems();
+}
+
+void CartographyVectorsItem::setVisibleArea(QRectF const& area, qreal scale) {
+
+	if (area == _visibleArea and scale == _scale) {
+		return;
+	}
+
+	_visibleArea = area;
+	_scale = scale;
+	polish();
+}
+
+void CartographyVectorsItem::triangulate(QVector<QPointF> const& polygon, QVector<QPointF> & out) {
+
+	int n = polygon.size();
+
+	if (n > 1 and polygon.first() == polygon.last()) {
+		n--;
+	}
+
+	if (n < 3) {
+		return;
+	}
+
+	qreal area = 0;
+
+	for (int i = 0, j = n-1; i < n; j = i++) {
+		area += polygon[j].x()*polygon[i].y() - polygon[i].x()*polygon[j].y();
+	}
+
+	qreal orientation = (area < 0) ? -1 : 1;
+
+	QVector<int> remaining(n);
+
+	for (int i = 0; i < n; i++) {
+		remaining[i] = i;
+	}
+
+	auto isEar = [&polygon, &remaining, orientation] (int prev, int current, int next) {
+
+		QPointF const& a = polygon[remaining[prev]];
+		QPointF const& b = polygon[remaining[current]];
+		QPointF const& c = polygon[remaining[next]];
+
+		if (orientation*cross(a, b, c) <= 0) {
+			return false; //reflex or flat vertex.
+		}
+
+		for (int k = 0; k < remaining.size(); k++) {
+
+			if (k == prev or k == current or k == next) {
+				continue;
+			}
+
+			QPointF const& p = polygon[remaining[k]];
+
+			if (p != a and p != b and p != c and inTriangle(p, a, b, c)) {
+				return false;
+			}
+		}
+
+		return true;
+	};
+
+	int i = 0;
+	int misses = 0;
+
+	while (remaining.size() > 3) {
+
+		int m = remaining.size();
+		int prev = (i + m - 1)%m;
+		int next = (i + 1)%m;
+
+		if (isEar(prev, i, next)) {
+
+			out.push_back(polygon[remaining[prev]]);
+			out.push_back(polygon[remaining[i]]);
+			out.push_back(polygon[remaining[next]]);
+
+			remaining.remove(i);
+			i %= remaining.size();
+			misses = 0;
+			continue;
+		}
+
+		i = next;
+
+		if (++misses >= m) { //no ear left, the polygon intersects itself.
+			for (int k = 1; k < m-1; k++) {
+				out.push_back(polygon[remaining[0]]);
+				out.push_back(polygon[remaining[k]]);
+				out.push_back(polygon[remaining[k+1]]);
+			}
+			return;
+		}
+	}
+
+	out.push_back(polygon[remaining[0]]);
+	out.push_back(polygon[remaining[1]]);
+	out.push_back(polygon[remaining[2]]);
+}
+
+void CartographyVectorsItem::updatePolish() {
+
+	refreshVisibleItems();
+
+	_nodesDirty = true;
+	update();
+}
+
+QSGNode* CartographyVectorsItem::updatePaintNode(QSGNode* oldNode, UpdatePaintNodeData* data) {
+
+	Q_UNUSED(data);
+
+	QSGNode* root = oldNode;
+
+	if (root == nullptr) {
+		root = new QSGNode();
+	}
+
+	if (!_nodesDirty) {
+		return root;
+	}
+
+	_nodesDirty = false;
+
+	while (QSGNode* child = root->firstChild()) {
+		root->removeChildNode(child);
+		delete child;
+	}
+
+	//all the fills below all the strokes, so that the borders of the regions are not hidden by their neighbours.
+	if (!_fillVertices.isEmpty()) {
+		root->appendChildNode(vertexColorNode(_fillVertices));
+	}
+
+	if (!_strokeVertices.isEmpty()) {
+		root->appendChildNode(vertexColorNode(_strokeVertices));
+	}
+
+	return root;
+}
+
+void CartographyVectorsItem::connectItem(CartographyVectorItem* item) {
+
+	connect(item, &CartographyVectorItem::geometryChanged, this, [this, item] () {
+		_triangulations.remove(item);
+		invalidateVisibleItems();
+	});
+	connect(item, &CartographyVectorItem::kindChanged, this, [this, item] () {
+		_triangulations.remove(item);
+		invalidateVisibleItems();
+	});
+	connect(item, &CartographyVectorItem::categoriesChanged,
+			this, &CartographyVectorsItem::invalidateVisibleItems);
+
+	connect(item, &QObject::destroyed, this, [this, item] () {
+		_triangulations.remove(item);
+	});
+}
+
+void CartographyVectorsItem::onItemRemoved() {
+
+	//the removed item is deleted later, it has to leave the vertices before.
+	refreshVisibleItems();
+
+	_nodesDirty = true;
+	update();
+}
+
+void CartographyVectorsItem::invalidateVisibleItems() {
+	polish();
+}
+
+void CartographyVectorsItem::refreshVisibleItems() {
+
+	_fillVertices.clear();
+	_strokeVertices.clear();
+
+	if (_cartography == nullptr or _visibleArea.isEmpty()) {
+		return;
+	}
+
+	QVector<CartographyVectorItem*> visible = _cartography->vectorItemsInRect(_visibleArea);
+
+	if (visible.isEmpty()) {
+		return;
+	}
+
+	//the styles are read once for all the items, most of the items share a few categories.
+	QVector<CartographyStyle> const styles = _cartography->categoryStyles();
+	CartographyStyle const defaultStyle;
+
+	auto styleOf = [&styles, &defaultStyle] (int index) -> CartographyStyle const& {
+		return (index >= 0 and index < styles.size()) ? styles.at(index) : defaultStyle;
+	};
+
+	qreal pixel = 1.0/std::max(_scale, 1e-6);
+
+	for (CartographyVectorItem* item : qAsConst(visible)) {
+
+		if (item->getFillIndex() >= 0) {
+			appendFill(item, qPremultiply(styleOf(item->getFillIndex()).color.rgba()));
+		}
+	}
+
+	for (CartographyVectorItem* item : qAsConst(visible)) {
+
+		if (item->getStrokeIndex() >= 0) {
+			CartographyStyle const& style = styleOf(item->getStrokeIndex());
+			appendStroke(item, qPremultiply(style.borderColor.rgba()), std::max(style.border, pixel));
+		}
+	}
+}
+
+void CartographyVectorsItem::appendFill(CartographyVectorItem* item, QRgb color) {
+
+	auto it = _triangulations.find(item);
+
+	if (it == _triangulations.end()) {
+		QVector<QPointF> triangles;
+		triangulate(item->getPoints(), triangles);
+		it = _triangulations.insert(item, triangles);
+	}
+
+	QVector<QPointF> const& triangles = it.value();
+
+	_fillVertices.reserve(_fillVertices.size() + triangles.size());
+
+	for (QPointF const& p : triangles) {
+		_fillVertices.push_back(coloredPoint(p, color));
+	}
+}
+
+void CartographyVectorsItem::appendStroke(CartographyVectorItem* item, QRgb color, qreal width) {
+
+	int n = item->pointsCount();
+
+	if (n < 2) {
+		return;
+	}
+
+	qreal minLength = 0.5/std::max(_scale, 1e-6); //the points closer than half a pixel are not visible.
+	qreal halfWidth = width/2;
+
+	QVector<QPointF> points;
+	points.reserve(n + 1);
+	points.push_back(item->point(0));
+
+	for (int i = 1; i < n; i++) {
+
+		QPointF p = item->point(i);
+		QPointF d = p - points.last();
+
+		if (i == n-1 or std::hypot(d.x(), d.y()) >= minLength) {
+			points.push_back(p);
+		}
+	}
+
+	bool closed = item->isClosed() and points.size() >= 3;
+
+	if (closed) {
+		points.push_back(points.first());
+	}
+
+	auto push = [this, color] (QPointF const& p) {
+		_strokeVertices.push_back(coloredPoint(p, color));
+	};
+
+	_strokeVertices.reserve(_strokeVertices.size() + points.size()*12);
+
+	QPointF firstNormal;
+	QPointF previousNormal;
+	bool hasPrevious = false;
+
+	for (int i = 0; i + 1 < points.size(); i++) {
+
+		QPointF const& a = points[i];
+		QPointF const& b = points[i+1];
+		QPointF d = b - a;
+		qreal length = std::hypot(d.x(), d.y());
+
+		if (length <= 0) {
+			continue;
+		}
+
+		QPointF normal(-d.y()*halfWidth/length, d.x()*halfWidth/length);
+
+		push(a + normal);
+		push(a - normal);
+		push(b + normal);
+		push(a - normal);
+		push(b - normal);
+		push(b + normal);
+
+		if (hasPrevious) { //bevel join, on both sides as the turn direction is not known.
+			push(a);
+			push(a + previousNormal);
+			push(a + normal);
+			push(a);
+			push(a - previousNormal);
+			push(a - normal);
+		} else {
+			firstNormal = normal;
+		}
+
+		previousNormal = normal;
+		hasPrevious = true;
+	}
+
+	if (closed and hasPrevious) {
+
+		QPointF const& a = points.first();
+
+		push(a);
+		push(a + previousNormal);
+		push(a + firstNormal);
+		push(a);
+		push(a - previousNormal);
+		push(a - firstNormal);
+	}
+}
+
+} // namespace Sabrina
@@ -0,0 +1,91 @@
+#ifndef SABRINA_CARTOGRAPHYVECTORSITEM_H
+#define SABRINA_CARTOGRAPHYVECTORSITEM_H
+
+/*
+This file is part of the project Sabrina
+Copyright (C) 2023  Paragon <french.paragon@gmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include <QQuickItem>
+#include <QHash>
+#include <QRgb>
+#include <QSGGeometry>
+#include <QVector>
+
+namespace Sabrina {
+
+class Cartography;
+class CartographyVectorItem;
+
+/*!
+ * \brief The CartographyVectorsItem class draw the paths and regions of a cartography in two scene graph nodes.
+ *
+ * The colors are stored in the vertices, so all the fills are drawn by one node and all the strokes by another one,
+ * in the drawing order of the items, whatever the number of items and categories.
+ * Only the items whose bounds intersect the visible area are drawn, they are found with the spatial index of the cartography.
+ *
+ * The fills are triangulated once per outline, the strokes are rebuilt when the visible area changes,
+ * so that they keep a width of at least one pixel and skip the points closer than half a pixel.
+ */
+class CartographyVectorsItem : public QQuickItem
+{
+	Q_OBJECT
+public:
+
+	explicit CartographyVectorsItem(QQuickItem* parent = nullptr);
+
+	Cartography* cartography() const;
+	void setCartography(Cartography* cartography);
+
+	//! \brief set the part of the map to draw, in map coordinates, and the scale at which the map is displayed.
+	void setVisibleArea(QRectF const& area, qreal scale);
+
+	/*!
+	 * \brief triangulate a simple polygon by ear clipping, the triangles are appended to out, three points per triangle.
+	 *
+	 * The polygon may be closed or not. The remaining part of a self-intersecting polygon is drawn as a fan.
+	 */
+	static void triangulate(QVector<QPointF> const& polygon, QVector<QPointF> & out);
+
+protected:
+
+	void updatePolish() override;
+	QSGNode* updatePaintNode(QSGNode* oldNode, UpdatePaintNodeData* data) override;
+
+	void connectItem(CartographyVectorItem* item);
+	void onItemRemoved();
+
+	void invalidateVisibleItems();
+	//! \brief build the vertices of the visible items, in the gui thread before the scene graph is synchronized.
+	void refreshVisibleItems();
+
+	void appendFill(CartographyVectorItem* item, QRgb color);
+	void appendStroke(CartographyVectorItem* item, QRgb color, qreal width);
+
+	Cartography* _cartography;
+	QRectF _visibleArea;
+	qreal _scale;
+
+	QHash<CartographyVectorItem*, QVector<QPointF>> _triangulations; //the triangles of the fills, in map coordinates.
+
+	QVector<QSGGeometry::ColoredPoint2D> _fillVertices;
+	QVector<QSGGeometry::ColoredPoint2D> _strokeVertices;
+	bool _nodesDirty;
+};
+
+} // namespace Sabrina
+
+#endif // SABRINA_CARTOGRAPHYVECTORSITEM_H
@@ -22,15 +22,24 @@ along with this program.  If not, see <https://www.gnu.org/licenses/>.
 #include "model/editableItems/comicscript.h"
 #include "text/comicscript.h"
 #include "text/exportfunctions.h"
+#include "text/spellchecker.h"
+#include "text/textsearchengine.h"
 
+#include <QAction>
 #include <QFileDialog>
 #include <QMessageBox>
+#include <QProgressDialog>
+#include <QCoreApplication>
 #include <QStandardPaths>
+#include <QLocale>
+
+#include <algorithm>
 
 #include <QSettings>
 #define COMIC_EDITOR_HIGHLIGHT_SETTING "comic_editor_highlight_activetext"
 #define COMIC_EDITOR_SELECTBYBLOCK_SETTING "comic_editor_select_restricted_to_blocks"
 #define COMIC_EDITOR_EXPORT_SETTING "comic_editor_export_path"
+#define COMIC_EDITOR_SPELLCHECK_SETTING "comic_editor_spellcheck_dictionary"
 
 namespace Sabrina {
 
@@ -39,10 +48,20 @@ const QString ComicscriptEditor::COMICSCRIPT_EDITOR_TYPE_ID = "sabrina_comic_scr
 ComicscriptEditor::ComicscriptEditor(QWidget *parent) :
 	Aline::EditableItemEditor(parent),
 	ui(new Ui::ComicscriptEditor),
-	_currentScript(nullptr)
+	_currentScript(nullptr),
+	_spellChecker(new SpellChecker(this))
 {
 	ui->setupUi(this);
 
+	ui->minimapWidget->setEditor(ui->editWidget);
+	ui->minimapWidget->setStyleColor(ComicScriptStyle::PAGE, QColor(90, 90, 90));
+	ui->minimapWidget->setStyleColor(ComicScriptStyle::PANEL, QColor(140, 160, 200));
+	ui->minimapWidget->setStyleColor(ComicScriptStyle::CAPTION, QColor(200, 180, 120));
+	ui->minimapWidget->setStyleColor(ComicScriptStyle::DIALOG, QColor(190, 190, 190));
+
+	ui->editWidget->setLineDecorator(_spellChecker);
+	connect(_spellChecker, &SpellChecker::linesChecked, ui->editWidget, QOverload<>::of(&QWidget::update));
+
 	connect(ui->editWidget, &ComicscriptEditWidget::currentLineChanged, this, &ComicscriptEditor::checkAddButtonsActivation);
 
 	connect(ui->addPageButton, &QPushButton::pressed, ui->editWidget, &ComicscriptEditWidget::addPage);
@@ -52,6 +71,11 @@ ComicscriptEditor::ComicscriptEditor(QWidget *parent) :
 
 	connect(ui->exportPdfButton, &QPushButton::pressed, this, &ComicscriptEditor::exportPdf);
 
+	connect(ui->editWidget, &ComicscriptEditWidget::currentLineChanged, this, &ComicscriptEditor::updatePageIndicator);
+	connect(ui->editWidget, &ComicscriptEditWidget::pagesChanged, this, &ComicscriptEditor::updatePageIndicator);
+	connect(ui->editWidget, &ComicscriptEditWidget::paginationProgressed, this, &ComicscriptEditor::updatePageIndicator);
+	connect(ui->pageSpinBox, QOverload<int>::of(&QSpinBox::valueChanged), this, &ComicscriptEditor::onPageSpinBoxChanged);
+
 	connect(ui->nameEdit, &QLineEdit::textChanged, this, &ComicscriptEditor::onNameChanged);
 	connect(ui->synopsisEdit, &QTextEdit::textChanged, this, &ComicscriptEditor::onSynopsisChanged);
 
@@ -79,6 +103,35 @@ ComicscriptEditor::ComicscriptEditor(QWidget *parent) :
 	}
 
 	connect(ui->selectionMode, &QButtonGroup::idToggled, this, &ComicscriptEditor::onSelectionModeToggled);
+
+	ui->findBar->hide();
+
+	QAction* find = new QAction(tr("Find"), this);
+	find->setShortcut(QKeySequence::Find);
+	find->setShortcutContext(Qt::WidgetWithChildrenShortcut);
+	connect(find, &QAction::triggered, this, &ComicscriptEditor::showFindBar);
+	addAction(find);
+
+	QAction* closeFind = new QAction(tr("Close the find bar"), ui->findBar);
+	closeFind->setShortcut(Qt::Key_Escape);
+	closeFind->setShortcutContext(Qt::WidgetWithChildrenShortcut);
+	connect(closeFind, &QAction::triggered, this, &ComicscriptEditor::hideFindBar);
+	ui->findBar->addAction(closeFind);
+
+	connect(ui->findEdit, &QLineEdit::textChanged, this, &ComicscriptEditor::updateSearchQuery);
+	connect(ui->findModeComboBox, QOverload<int>::of(&QComboBox::currentIndexChanged), this, &ComicscriptEditor::updateSearchQuery);
+	connect(ui->caseSensitiveCheckBox, &QCheckBox::toggled, this, &ComicscriptEditor::updateSearchQuery);
+
+	connect(ui->findEdit, &QLineEdit::returnPressed, this, &ComicscriptEditor::findNext);
+	connect(ui->findNextButton, &QPushButton::clicked, this, &ComicscriptEditor::findNext);
+	connect(ui->findPreviousButton, &QPushButton::clicked, this, &ComicscriptEditor::findPrevious);
+	connect(ui->replaceEdit, &QLineEdit::returnPressed, this, &ComicscriptEditor::replaceAll);
+	connect(ui->replaceAllButton, &QPushButton::clicked, this, &ComicscriptEditor::replaceAll);
+	connect(ui->closeFindBarButton, &QPushButton::clicked, this, &ComicscriptEditor::hideFindBar);
+
+	connect(ui->editWidget->searchEngine(), &TextSearchEngine::matchesChanged, this, &ComicscriptEditor::updateMatchCount);
+
+	loadSpellCheckDictionary();
 }
 
 ComicscriptEditor::~ComicscriptEditor()
@@ -124,6 +177,8 @@ bool ComicscriptEditor::effectivelySetEditedItem(Aline::EditableItem* item) {
 	connect(_currentScript, &Comicscript::synopsisChanged, this, &ComicscriptEditor::onScriptSynopsisChanged);
 
 	ui->editWidget->setCurrentScript(script);
+	_spellChecker->setDocument(ui->editWidget->getDocument());
+	updatePageIndicator();
 
 	return true;
 }
@@ -249,16 +304,23 @@ void ComicscriptEditor::exportPdf() {
 
 	} while (!ok);
 
-	ComicScriptTextStyleManager comicstyle;
-
-	QPageLayout layout;
-	layout.setUnits(QPageLayout::Unit::Point);
-	layout.setOrientation(QPageLayout::Orientation::Portrait);
-	layout.setPageSize(QPageSize(QPageSize::A4), QMargins(40.0, 40.0, 40.0, 40.0));
-
-	ok = savePdf(ui->editWidget->getCurrentNode(), &comicstyle, layout, file);
+	//application modal, the document must not be edited while the pages are rendered.
+	QProgressDialog progressDialog(tr("Exporting script to pdf..."), tr("Cancel"), 0, 0, this);
+	progressDialog.setWindowModality(Qt::ApplicationModal);
+	progressDialog.setMinimumDuration(500);
+
+	ok = savePdf(ui->editWidget->paginator(), file, [&progressDialog] (int done, int total) { //the page breaks are kept up to date by the editor.
+		progressDialog.setMaximum(total);
+		progressDialog.setValue(done);
+		QCoreApplication::processEvents();
+		return !progressDialog.wasCanceled();
+	});
 	settings.setValue(COMIC_EDITOR_EXPORT_SETTING, outDir.path());
 
+	if (progressDialog.wasCanceled()) {
+		return;
+	}
+
 	if (!ok) {
 		QMessageBox::warning(this, tr("Imposible to save file"), tr("Unknown error !"));
 		return;
@@ -266,6 +328,141 @@ void ComicscriptEditor::exportPdf() {
 
 }
 
+void ComicscriptEditor::updatePageIndicator() {
+
+	//only the pages up to the cursor are computed here, the others are computed when the application is idle.
+	int page = std::max(ui->editWidget->currentPage(), 0);
+	int nPages = std::max(ui->editWidget->pageCount(), page+1);
+	bool complete = ui->editWidget->isPaginationComplete();
+
+	ui->pageSpinBox->blockSignals(true);
+	ui->pageSpinBox->setMaximum(nPages);
+	ui->pageSpinBox->setValue(page+1);
+	ui->pageSpinBox->blockSignals(false);
+
+	ui->pageCountLabel->setText(complete ? QString("/ %1").arg(nPages) : QString("/ ~%1").arg(nPages));
+}
+void ComicscriptEditor::onPageSpinBoxChanged(int page) {
+	ui->editWidget->goToPage(page-1);
+}
+
+void ComicscriptEditor::loadSpellCheckDictionary() {
+
+	QSettings settings;
+
+	QString dicFile;
+
+	if (settings.contains(COMIC_EDITOR_SPELLCHECK_SETTING)) {
+		dicFile = settings.value(COMIC_EDITOR_SPELLCHECK_SETTING).toString();
+	} else {
+		//the dictionary of the system language is looked for in the data directories of the application, then in those shared by hunspell.
+		QString dicName = QString("%1.dic").arg(QLocale::system().name());
+
+		dicFile = QStandardPaths::locate(QStandardPaths::AppDataLocation, "dictionaries/" + dicName);
+
+		if (dicFile.isEmpty()) {
+			dicFile = QStandardPaths::locate(QStandardPaths::GenericDataLocation, "hunspell/" + dicName);
+		}
+	}
+
+	if (dicFile.isEmpty()) {
+		return;
+	}
+
+	QFileInfo dicInfo(dicFile);
+
+	if (!dicInfo.exists()) {
+		return;
+	}
+
+	QFileInfo affInfo(dicInfo.dir(), dicInfo.completeBaseName() + ".aff");
+
+	_spellChecker->setDictionaryFiles(dicFile, (affInfo.exists()) ? affInfo.filePath() : QString());
+}
+
+void ComicscriptEditor::showFindBar() {
+
+	QString selected = ui->editWidget->getTextInSelection();
+
+	if (!selected.isEmpty() and !selected.contains('\n')) {
+		ui->findEdit->setText(selected);
+	}
+
+	ui->findBar->show();
+	ui->findEdit->setFocus();
+	ui->findEdit->selectAll();
+
+	updateSearchQuery();
+}
+void ComicscriptEditor::hideFindBar() {
+
+	ui->findBar->hide();
+
+	//an empty query does not search anything while the document is edited.
+	ui->editWidget->searchEngine()->setQuery(TextSearchEngine::Query());
+	ui->editWidget->setFocus();
+}
+void ComicscriptEditor::updateSearchQuery() {
+
+	if (!ui->findBar->isVisible()) {
+		return;
+	}
+
+	TextSearchEngine::Query query;
+	query.pattern = ui->findEdit->text();
+	query.caseSensitivity = ui->caseSensitiveCheckBox->isChecked() ? Qt::CaseSensitive : Qt::CaseInsensitive;
+
+	switch (ui->findModeComboBox->currentIndex()) {
+	case 1:
+		query.mode = TextSearchEngine::Mode::WholeWord;
+		break;
+	case 2:
+		query.mode = TextSearchEngine::Mode::RegularExpression;
+		break;
+	default:
+		query.mode = TextSearchEngine::Mode::Plain;
+		break;
+	}
+
+	ui->editWidget->searchEngine()->setQuery(query);
+}
+void ComicscriptEditor::updateMatchCount() {
+
+	if (!ui->findBar->isVisible()) {
+		return;
+	}
+
+	TextSearchEngine* engine = ui->editWidget->searchEngine();
+
+	if (ui->findEdit->text().isEmpty()) {
+		ui->matchCountLabel->clear();
+	} else if (!engine->isQueryValid()) {
+		ui->matchCountLabel->setText(tr("Invalid expression"));
+	} else {
+		ui->matchCountLabel->setText(tr("%n match(es)", "", engine->matchCount()));
+	}
+
+	bool found = engine->isQueryValid() and engine->matchCount() > 0;
+
+	ui->findNextButton->setEnabled(found);
+	ui->findPreviousButton->setEnabled(found);
+	ui->replaceAllButton->setEnabled(found);
+}
+void ComicscriptEditor::findNext() {
+	ui->editWidget->findNext();
+}
+void ComicscriptEditor::findPrevious() {
+	ui->editWidget->findPrevious();
+}
+void ComicscriptEditor::replaceAll() {
+
+	int nLines = ui->editWidget->replaceAll(ui->replaceEdit->text());
+
+	if (nLines > 0) {
+		ui->matchCountLabel->setText(tr("%n line(s) changed", "", nLines));
+	}
+}
+
 ComicscriptEditor::ComicscriptEditorFactory::ComicscriptEditorFactory(QObject* parent) :
 	Aline::EditorFactory(parent)
 {
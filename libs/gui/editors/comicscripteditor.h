@@ -27,6 +27,7 @@ along with this program.  If not, see <https://www.gnu.org/licenses/>.
 namespace Sabrina {
 
 class Comicscript;
+class SpellChecker;
 
 namespace Ui {
 class ComicscriptEditor;
@@ -74,10 +75,25 @@ protected:
 
 	void exportPdf();
 
+	void updatePageIndicator();
+	void onPageSpinBoxChanged(int page);
+
+	void loadSpellCheckDictionary();
+
+	void showFindBar();
+	void hideFindBar();
+	//! \brief set the query of the search engine of the edit widget from the find bar.
+	void updateSearchQuery();
+	void updateMatchCount();
+	void findNext();
+	void findPrevious();
+	void replaceAll();
+
 private:
 	Ui::ComicscriptEditor *ui;
 
 	Comicscript* _currentScript;
+	SpellChecker* _spellChecker;
 };
 
 } // namespace Sabrina
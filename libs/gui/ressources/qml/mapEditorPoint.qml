@@ -45,6 +45,18 @@ Item {
         y = parseInt(mapItem.position.y)
     }
 
+    Connections {
+        target: mapItem
+
+        // follow the moves which are not done by dragging the delegate, like the drags started on the points item.
+        onPositionChanged: {
+            if (!mouseArea.drag.active) {
+                container.x = mapItem.position.x
+                container.y = mapItem.position.y
+            }
+        }
+    }
+
     Rectangle {
 
          width: mapItem.radius*2
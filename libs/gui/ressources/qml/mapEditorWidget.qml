@@ -18,6 +18,7 @@ along with this program.  If not, see <https://www.gnu.org/licenses/>.
 
 import QtQuick 2.9
 import QtQuick.Controls 2.2
+import SabrinaCartography 0.1
 
 Item {
 
@@ -56,16 +57,26 @@ Item {
 
             scale: mapProxy.scale
 
-            Image {
+            Repeater {
 
-                anchors.fill: parent
+                id: mapTiles
+                model: mapProxy.backgroundTiles
+
+                Image {
 
-                z: 0
+                    x: tileX
+                    y: tileY
+                    z: tileZ
 
-                id: mapImage
-                source: "image://provider/" + mapProxy.imageBackground // "image://provider/name"
+                    width: tileWidth
+                    height: tileHeight
 
-                fillMode: Image.Stretch
+                    source: "image://provider/" + tileSource // "image://provider/tile/generation/level/column/row"
+
+                    asynchronous: true
+                    smooth: true
+                    fillMode: Image.Stretch
+                }
             }
 
             DropArea {
@@ -89,6 +100,28 @@ Item {
                 }
             }
 
+            SabrinaCartographyVectors {
+
+                // the paths and regions, over the background and under the points.
+                id: mapVectors
+                objectName: "mapVectors"
+
+                anchors.fill: parent
+
+                z: 1
+            }
+
+            SabrinaCartographyPoints {
+
+                // all the points but the selected one, which is drawn by its own delegate.
+                id: mapPoints
+                objectName: "mapPoints"
+
+                anchors.fill: parent
+
+                z: 2
+            }
+
         }
 
     }
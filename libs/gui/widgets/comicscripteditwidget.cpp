@@ -19,18 +19,33 @@ along with this program.  If not, see <https://www.gnu.org/licenses/>.
 #include "comicscripteditwidget.h"
 
 #include "model/editableItems/comicscript.h"
+#include "text/textpaginator.h"
 
 #include <QPainter>
 #include <QPaintEvent>
 #include <QTextLayout>
+#include <QTimer>
 
 namespace Sabrina {
 
 ComicscriptEditWidget::ComicscriptEditWidget(QWidget *parent) :
-	TextEditWidget(parent)
+	TextEditWidget(parent),
+	_paginator(new TextPaginator(this)),
+	_paginationTimer(new QTimer(this))
 {
 	ComicScriptTextStyleManager* st = new ComicScriptTextStyleManager(this);
 	setStyleManager(st);
+
+	//the paginator lay the nodes out at the width of the page, so it cannot share the styles of the editor.
+	_paginator->setStyleManager(new ComicScriptTextStyleManager(_paginator));
+	_paginator->setPageLayout(_paginator->pageLayout(), logicalDpiY());
+
+	_paginationTimer->setSingleShot(true);
+	_paginationTimer->setInterval(0); //run when the event loop is idle.
+
+	connect(_paginator, &TextPaginator::pagesChanged, this, &ComicscriptEditWidget::pagesChanged);
+	connect(_paginator, &TextPaginator::pagesChanged, _paginationTimer, static_cast<void(QTimer::*)()>(&QTimer::start));
+	connect(_paginationTimer, &QTimer::timeout, this, &ComicscriptEditWidget::paginateStep);
 }
 
 ComicscriptEditWidget::~ComicscriptEditWidget() {
@@ -45,6 +60,8 @@ void ComicscriptEditWidget::setCurrentScript(TextNode *root) {
 
 	if (root->styleId() == ComicScriptStyle::MAIN) {
 		TextEditWidget::setCurrentScript(root);
+		_paginator->setDocument(root);
+		_paginationTimer->start();
 	}
 
 }
@@ -54,11 +71,11 @@ void ComicscriptEditWidget::addPage() {
 	TextNode* n = getCurrentNode();
 
 	if (n->isRootNode()) {
-		n->insertNodeBelow(ComicScriptStyle::PAGE);
+		insertNode(n, ComicScriptStyle::PAGE, TextStyleManager::LevelJump::Below);
 	} else if (n->styleId() == ComicScriptStyle::PAGE) {
-		n->insertNodeAfter(ComicScriptStyle::PAGE);
+		insertNode(n, ComicScriptStyle::PAGE, TextStyleManager::LevelJump::After);
 	} else {
-		n->insertNodeSubRoot(ComicScriptStyle::PAGE);
+		insertNode(n, ComicScriptStyle::PAGE, TextStyleManager::LevelJump::UnderRoot);
 	}
 }
 
@@ -67,11 +84,11 @@ void ComicscriptEditWidget::addPanel() {
 	TextNode* n = getCurrentNode();
 
 	if (n->styleId() == ComicScriptStyle::PAGE) {
-		n->insertNodeBelow(ComicScriptStyle::PANEL);
+		insertNode(n, ComicScriptStyle::PANEL, TextStyleManager::LevelJump::Below);
 	} else if (n->styleId() == ComicScriptStyle::PANEL) {
-		n->insertNodeAfter(ComicScriptStyle::PANEL);
+		insertNode(n, ComicScriptStyle::PANEL, TextStyleManager::LevelJump::After);
 	} else if (n->styleId() > ComicScriptStyle::PANEL) {
-		n->insertNodeAbove(ComicScriptStyle::PANEL);
+		insertNode(n, ComicScriptStyle::PANEL, TextStyleManager::LevelJump::Above);
 	}
 }
 
@@ -80,9 +97,9 @@ void ComicscriptEditWidget::addCaption() {
 	TextNode* n = getCurrentNode();
 
 	if (n->styleId() == ComicScriptStyle::PANEL) {
-		n->insertNodeBelow(ComicScriptStyle::CAPTION);
+		insertNode(n, ComicScriptStyle::CAPTION, TextStyleManager::LevelJump::Below);
 	} else if (n->styleId() > ComicScriptStyle::PANEL) {
-		n->insertNodeAfter(ComicScriptStyle::CAPTION);
+		insertNode(n, ComicScriptStyle::CAPTION, TextStyleManager::LevelJump::After);
 	}
 
 }
@@ -92,9 +109,9 @@ void ComicscriptEditWidget::addDialog() {
 	TextNode* n = getCurrentNode();
 
 	if (n->styleId() == ComicScriptStyle::PANEL) {
-		n->insertNodeBelow(ComicScriptStyle::DIALOG);
+		insertNode(n, ComicScriptStyle::DIALOG, TextStyleManager::LevelJump::Below);
 	} else if (n->styleId() > ComicScriptStyle::PANEL) {
-		n->insertNodeAfter(ComicScriptStyle::DIALOG);
+		insertNode(n, ComicScriptStyle::DIALOG, TextStyleManager::LevelJump::After);
 	}
 }
 
@@ -110,4 +127,61 @@ void ComicscriptEditWidget::selectFullBlocks(bool selectFullBlocks) {
 	TextEditWidget::setSelectionMode(selMode);
 }
 
+TextPaginator* ComicscriptEditWidget::paginator() const {
+	return _paginator;
+}
+
+int ComicscriptEditWidget::pageCount() {
+
+	if (!hasScript()) {
+		return 0;
+	}
+
+	return _paginator->estimatedPageCount();
+}
+bool ComicscriptEditWidget::isPaginationComplete() const {
+	return _paginator->isComplete();
+}
+int ComicscriptEditWidget::currentPage() {
+
+	if (!hasScript()) {
+		return -1;
+	}
+
+	return _paginator->pageOfNode(getCurrentNode());
+}
+void ComicscriptEditWidget::goToPage(int page) {
+
+	if (!hasScript()) {
+		return;
+	}
+
+	TextNode* n = _paginator->firstNodeOfPage(page);
+
+	if (n == nullptr) {
+		return;
+	}
+
+	int line = _layoutIndex->nodeFirstLine(n);
+
+	_cursor->setState(Cursor::CursorPos(line, 0));
+	scrollToLine(line);
+	update();
+}
+
+void ComicscriptEditWidget::paginateStep() {
+
+	if (!hasScript()) {
+		return;
+	}
+
+	bool complete = _paginator->computePages(4);
+
+	Q_EMIT paginationProgressed();
+
+	if (!complete) {
+		_paginationTimer->start();
+	}
+}
+
 } // namespace Sabrina
@@ -22,9 +22,12 @@ along with this program.  If not, see <https://www.gnu.org/licenses/>.
 #include "./texteditwidget.h"
 #include <QModelIndex>
 
+class QTimer;
+
 namespace Sabrina {
 
 class Comicscript;
+class TextPaginator;
 
 class ComicscriptEditWidget : public TextEditWidget
 {
@@ -45,6 +48,28 @@ public:
 	void highlightCurrentNode(bool highlight);
 	void selectFullBlocks(bool selectFullBlocks);
 
+	//! \brief the paginator keeping the page breaks of the script up to date, it can be used to export the script.
+	TextPaginator* paginator() const;
+
+	//! \brief the number of pages, estimated until all the pages have been computed when the application is idle.
+	int pageCount();
+	bool isPaginationComplete() const;
+	int currentPage();
+	void goToPage(int page);
+
+Q_SIGNALS:
+
+	void pagesChanged();
+	void paginationProgressed();
+
+protected:
+
+	//! \brief compute a few pages, without blocking the interface for a long script.
+	void paginateStep();
+
+	TextPaginator* _paginator;
+	QTimer* _paginationTimer;
+
 };
 
 } // namespace Sabrina
@@ -0,0 +1,114 @@
+/*
+This file is part of the project Sabrina
+Copyright (C) 2023  Paragon <french.paragon@gmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "kineticscroller.h"
+
+#include <cmath>
+#include <algorithm>
+
+namespace Sabrina {
+
+namespace {
+
+const qreal EasingFactor = 0.3; //part of the animated distance covered at each frame.
+
+} // namespace
+
+const int KineticScroller::FrameInterval = 16;
+
+KineticScroller::KineticScroller(QObject *parent) :
+	QObject(parent),
+	_animated(0),
+	_immediate(0),
+	_remainder(0),
+	_maxStep(0)
+{
+	_frameTimer.setInterval(FrameInterval);
+	_frameTimer.setTimerType(Qt::PreciseTimer);
+	connect(&_frameTimer, &QTimer::timeout, this, &KineticScroller::onFrame);
+}
+
+void KineticScroller::addDelta(qreal pixels, bool animated) {
+
+	if (animated) {
+		_animated += pixels;
+	} else {
+		_immediate += pixels;
+	}
+
+	if (!_frameTimer.isActive()) {
+		_frameTimer.start();
+	}
+}
+void KineticScroller::stop() {
+
+	_animated = 0;
+	_immediate = 0;
+	_remainder = 0;
+
+	if (_frameTimer.isActive()) {
+		_frameTimer.stop();
+		Q_EMIT finished();
+	}
+}
+
+bool KineticScroller::isScrolling() const {
+	return _frameTimer.isActive();
+}
+
+int KineticScroller::maxStep() const {
+	return _maxStep;
+}
+void KineticScroller::setMaxStep(int maxStep) {
+	_maxStep = maxStep;
+}
+
+void KineticScroller::onFrame() {
+
+	qreal animatedStep = _animated*EasingFactor;
+
+	if (std::abs(_animated - animatedStep) < 1) { //end of the easing.
+		animatedStep = _animated;
+	}
+
+	_animated -= animatedStep;
+
+	qreal distance = _immediate + animatedStep + _remainder;
+	_immediate = 0;
+
+	if (_maxStep > 0 and std::abs(distance) > _maxStep) {
+		qreal capped = (distance > 0) ? _maxStep : -_maxStep;
+		_immediate = distance - capped; //the rest is covered at the next frames.
+		distance = capped;
+	}
+
+	int pixels = static_cast<int>(distance);
+	_remainder = distance - pixels;
+
+	if (pixels != 0) {
+		Q_EMIT step(pixels);
+	}
+
+	Q_EMIT frameDone();
+
+	if (std::abs(_animated) < 1 and std::abs(_immediate) < 1) {
+		stop();
+	}
+}
+
+} // namespace Sabrina
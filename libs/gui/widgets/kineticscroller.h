@@ -0,0 +1,76 @@
+#ifndef SABRINA_KINETICSCROLLER_H
+#define SABRINA_KINETICSCROLLER_H
+
+/*
+This file is part of the project Sabrina
+Copyright (C) 2023  Paragon <french.paragon@gmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include <QObject>
+#include <QTimer>
+
+namespace Sabrina {
+
+/*!
+ * \brief The KineticScroller class turn scroll deltas into at most one scroll step per frame.
+ *
+ * All the deltas received between two frames are summed, so a burst of wheel or trackpad events costs a single scroll and a single paint.
+ * Wheel deltas are eased over the next frames, while pixel deltas (trackpads), which are already smooth, are applied at the next frame.
+ * A step never exceeds the maximal step, so that the layout work needed to scroll is spread over several frames.
+ */
+class KineticScroller : public QObject
+{
+	Q_OBJECT
+public:
+
+	static const int FrameInterval; //ms
+
+	explicit KineticScroller(QObject *parent = nullptr);
+
+	//! \brief add a scroll distance in pixels, animated or applied at the next frame.
+	void addDelta(qreal pixels, bool animated = true);
+	//! \brief drop the remaining distance, for example when the view reached an end of the document.
+	void stop();
+
+	bool isScrolling() const;
+
+	int maxStep() const;
+	void setMaxStep(int maxStep);
+
+Q_SIGNALS:
+
+	//! \brief emitted once per frame while there is a distance left to scroll.
+	void step(int pixels);
+	//! \brief emitted at the end of the frames, after the last step.
+	void frameDone();
+	//! \brief emitted when the remaining distance is covered.
+	void finished();
+
+protected:
+
+	void onFrame();
+
+	QTimer _frameTimer;
+
+	qreal _animated;
+	qreal _immediate;
+	qreal _remainder;
+	int _maxStep;
+};
+
+} // namespace Sabrina
+
+#endif // SABRINA_KINETICSCROLLER_H
@@ -0,0 +1,211 @@
+/*
+This file is part of the project Sabrina
+Copyright (C) 2023  Paragon <french.paragon@gmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "textdocumentminimap.h"
+
+#include "texteditwidget.h"
+
+#include "text/textnode.h"
+#include "text/textlayoutindex.h"
+
+#include <QPainter>
+#include <QPaintEvent>
+#include <QMouseEvent>
+
+#include <algorithm>
+
+namespace Sabrina {
+
+namespace {
+
+const int LevelIndent = 8;
+
+//! \brief the child of the root node containing the node, a page in a comic script.
+TextNode* sectionOf(TextNode* node) {
+
+	while (node->parentNode() != nullptr and !node->parentNode()->isRootNode()) {
+		node = node->parentNode();
+	}
+
+	return node;
+}
+
+} // namespace
+
+const qreal TextDocumentMinimap::MaxScale = 0.2;
+
+TextDocumentMinimap::TextDocumentMinimap(QWidget *parent) :
+	QWidget(parent)
+{
+	setSizePolicy(QSizePolicy::Fixed, QSizePolicy::Expanding);
+	setCursor(Qt::PointingHandCursor);
+}
+
+TextEditWidget* TextDocumentMinimap::editor() const {
+	return _editor;
+}
+void TextDocumentMinimap::setEditor(TextEditWidget* editor) {
+
+	if (editor == _editor) {
+		return;
+	}
+
+	if (_editor != nullptr) {
+		disconnect(_editor, nullptr, this, nullptr);
+		disconnect(_editor->layoutIndex(), nullptr, this, nullptr);
+	}
+
+	_editor = editor;
+
+	if (_editor != nullptr) {
+		connect(_editor, &TextEditWidget::viewportChanged, this, static_cast<void(TextDocumentMinimap::*)()>(&TextDocumentMinimap::update));
+		connect(_editor->layoutIndex(), &TextLayoutIndex::layoutInvalidated, this, static_cast<void(TextDocumentMinimap::*)()>(&TextDocumentMinimap::update));
+		connect(_editor->layoutIndex(), &TextLayoutIndex::nodeRelaidOut, this, static_cast<void(TextDocumentMinimap::*)()>(&TextDocumentMinimap::update));
+	}
+
+	update();
+}
+
+QColor TextDocumentMinimap::styleColor(int styleId) const {
+	return _styleColors.value(styleId);
+}
+void TextDocumentMinimap::setStyleColor(int styleId, QColor const& color) {
+	_styleColors.insert(styleId, color);
+	update();
+}
+
+QSize TextDocumentMinimap::sizeHint() const {
+	return QSize(80, 200);
+}
+
+void TextDocumentMinimap::paintEvent(QPaintEvent *event) {
+
+	QPainter painter(this);
+
+	painter.fillRect(event->rect(), QColor(245, 245, 245));
+
+	if (_editor == nullptr or _editor->getDocument() == nullptr) {
+		return;
+	}
+
+	TextLayoutIndex* index = _editor->layoutIndex();
+	qreal s = scale();
+
+	if (s <= 0) {
+		return;
+	}
+
+	TextNode* previous = nullptr;
+	TextNode* previousSection = nullptr;
+	int runStart = event->rect().top();
+
+	//consecutive rows showing the same node are drawn as a single bar.
+	auto drawRun = [&] (int end) {
+
+		if (previous == nullptr or end <= runStart) {
+			return;
+		}
+
+		int level = std::max(previous->nodeLevel() - 1, 0);
+		int x = 2 + level*LevelIndent;
+		painter.fillRect(x, runStart, std::max(width() - x - 2, 1), std::max(end - runStart - 1, 1), nodeColor(previous, level));
+	};
+
+	for (int y = event->rect().top(); y <= event->rect().bottom() + 1; y++) {
+
+		TextNode* n = (y <= event->rect().bottom()) ? index->nodeAtHeight(static_cast<int>((y + 0.5)/s)) : nullptr;
+
+		if (n == previous) {
+			continue;
+		}
+
+		drawRun(y);
+
+		if (n == nullptr) {
+			break;
+		}
+
+		TextNode* section = sectionOf(n);
+
+		if (previousSection != nullptr and section != previousSection) {
+			painter.fillRect(0, y, width(), 1, QColor(120, 120, 120)); //start of a new section.
+		}
+
+		previous = n;
+		previousSection = section;
+		runStart = y;
+	}
+
+	//visible part of the document.
+	QRectF viewport(0, _editor->viewportTop()*s, width(), std::max(_editor->height()*s, 4.0));
+	painter.fillRect(viewport, QColor(100, 140, 220, 60));
+	painter.setPen(QColor(100, 140, 220));
+	painter.drawRect(viewport.adjusted(0, 0, -1, -1));
+}
+void TextDocumentMinimap::mousePressEvent(QMouseEvent *event) {
+
+	if (event->buttons() == Qt::LeftButton) {
+		jumpTo(event->pos().y());
+		event->accept();
+	}
+}
+void TextDocumentMinimap::mouseMoveEvent(QMouseEvent *event) {
+
+	if (event->buttons() == Qt::LeftButton) {
+		jumpTo(event->pos().y());
+		event->accept();
+	}
+}
+
+qreal TextDocumentMinimap::scale() const {
+
+	if (_editor == nullptr) {
+		return 0;
+	}
+
+	int total = _editor->layoutIndex()->totalHeight();
+
+	if (total <= 0) {
+		return 0;
+	}
+
+	return std::min(static_cast<qreal>(height())/total, MaxScale);
+}
+void TextDocumentMinimap::jumpTo(int y) {
+
+	qreal s = scale();
+
+	if (s <= 0) {
+		return;
+	}
+
+	_editor->setViewportTop(static_cast<int>(y/s) - _editor->height()/2);
+}
+
+QColor TextDocumentMinimap::nodeColor(TextNode* node, int level) const {
+
+	auto it = _styleColors.constFind(node->styleId());
+
+	if (it != _styleColors.constEnd()) {
+		return *it;
+	}
+
+	return QColor(160, 160, 160).lighter(100 + 15*level);
+}
+
+} // namespace Sabrina
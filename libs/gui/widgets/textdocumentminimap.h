@@ -0,0 +1,74 @@
+#ifndef SABRINA_TEXTDOCUMENTMINIMAP_H
+#define SABRINA_TEXTDOCUMENTMINIMAP_H
+
+/*
+This file is part of the project Sabrina
+Copyright (C) 2023  Paragon <french.paragon@gmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include <QWidget>
+#include <QPointer>
+#include <QHash>
+
+namespace Sabrina {
+
+class TextEditWidget;
+class TextNode;
+
+/*!
+ * \brief The TextDocumentMinimap class show an overview of the structure of the document of a TextEditWidget, with the visible part, and scroll the editor to the clicked part.
+ *
+ * The document is never rendered: each row of the minimap is the node found at the matching height in the layout index of the editor,
+ * drawn as a bar colored after its style and indented after its level. Painting is thus O(h log n) for a minimap h pixels high,
+ * and the index, updated incrementally from the document signals, is the only structure it relies on.
+ */
+class TextDocumentMinimap : public QWidget
+{
+	Q_OBJECT
+public:
+
+	static const qreal MaxScale; //short documents are not stretched over the whole minimap.
+
+	explicit TextDocumentMinimap(QWidget *parent = nullptr);
+
+	TextEditWidget* editor() const;
+	void setEditor(TextEditWidget* editor);
+
+	//! \brief the color of the bars of the nodes with the given style, nodes without a color are shaded after their level.
+	QColor styleColor(int styleId) const;
+	void setStyleColor(int styleId, QColor const& color);
+
+	QSize sizeHint() const override;
+
+protected:
+
+	void paintEvent(QPaintEvent *event) override;
+	void mousePressEvent(QMouseEvent *event) override;
+	void mouseMoveEvent(QMouseEvent *event) override;
+
+	qreal scale() const;
+	//! \brief scroll the editor to center the document part at the vertical position y of the minimap.
+	void jumpTo(int y);
+
+	QColor nodeColor(TextNode* node, int level) const;
+
+	QPointer<TextEditWidget> _editor;
+	QHash<int, QColor> _styleColors;
+};
+
+} // namespace Sabrina
+
+#endif // SABRINA_TEXTDOCUMENTMINIMAP_H
@@ -0,0 +1,505 @@
+/*
+This file is part of the project Sabrina
+Copyright (C) 2023  Paragon <french.paragon@gmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "texteditcommands.h"
+
+#include <algorithm>
+
+namespace Sabrina {
+
+TextEditCommand::TextEditCommand(TextNode* document) :
+	QUndoCommand(),
+	_document(document),
+	_byteSize(sizeof(TextEditCommand))
+{
+
+}
+
+void TextEditCommand::undo() {
+	undoEdit();
+}
+void TextEditCommand::redo() {
+	redoEdit();
+}
+
+TextEditCommand::CursorState TextEditCommand::cursorBefore() const {
+	return _cursorBefore;
+}
+TextEditCommand::CursorState TextEditCommand::cursorAfter() const {
+	return _cursorAfter;
+}
+void TextEditCommand::setCursorStates(CursorState const& before, CursorState const& after) {
+	_cursorBefore = before;
+	_cursorAfter = after;
+}
+
+qint64 TextEditCommand::byteSize() const {
+	return _byteSize;
+}
+
+qint64 TextEditCommand::pathByteSize(QVector<int> const& path) {
+	return path.size()*sizeof(int);
+}
+qint64 TextEditCommand::linesByteSize(QStringList const& lines) {
+
+	qint64 size = 0;
+
+	for (QString const& line : lines) {
+		size += sizeof(QString) + line.size()*sizeof(QChar);
+	}
+
+	return size;
+}
+
+
+TextEditGroupCommand::TextEditGroupCommand(TextNode* document, QString const& text) :
+	TextEditCommand(document)
+{
+	_byteSize = sizeof(TextEditGroupCommand);
+	setText(text);
+}
+TextEditGroupCommand::~TextEditGroupCommand() {
+	qDeleteAll(_commands);
+}
+
+void TextEditGroupCommand::addCommand(TextEditCommand* command) {
+	_commands.push_back(command);
+	_byteSize += command->byteSize();
+}
+int TextEditGroupCommand::commandsCount() const {
+	return _commands.size();
+}
+TextEditCommand* TextEditGroupCommand::takeSingleCommand() {
+
+	if (_commands.size() != 1) {
+		return nullptr;
+	}
+
+	TextEditCommand* command = _commands.takeFirst();
+	_byteSize -= command->byteSize();
+	return command;
+}
+
+void TextEditGroupCommand::undoEdit() {
+	for (int i = _commands.size()-1; i >= 0; i--) {
+		_commands[i]->undoEdit();
+	}
+}
+void TextEditGroupCommand::redoEdit() {
+	for (TextEditCommand* command : qAsConst(_commands)) {
+		command->redoEdit();
+	}
+}
+
+
+const int LineTextCommand::Id = 1;
+
+LineTextCommand::LineTextCommand(TextNode* document, TextLine* line, QString const& oldText, QString const& newText) :
+	TextEditCommand(document),
+	_nodePath(line->nodeParent()->nodePath()),
+	_lineIndex(line->lineNodeIndexNumber())
+{
+	int maxCommon = std::min(oldText.length(), newText.length());
+
+	int prefix = 0;
+	while (prefix < maxCommon and oldText[prefix] == newText[prefix]) {
+		prefix++;
+	}
+
+	int suffix = 0;
+	while (suffix < maxCommon - prefix and
+		   oldText[oldText.length()-1-suffix] == newText[newText.length()-1-suffix]) {
+		suffix++;
+	}
+
+	_pos = prefix;
+	_removed = oldText.mid(prefix, oldText.length() - prefix - suffix);
+	_inserted = newText.mid(prefix, newText.length() - prefix - suffix);
+
+	updateByteSize();
+}
+
+int LineTextCommand::id() const {
+	return Id;
+}
+bool LineTextCommand::mergeWith(const QUndoCommand *other) {
+
+	const LineTextCommand* next = dynamic_cast<const LineTextCommand*>(other);
+
+	if (next == nullptr) {
+		return false;
+	}
+
+	if (next->_nodePath != _nodePath or next->_lineIndex != _lineIndex) {
+		return false;
+	}
+
+	bool typing = _removed.isEmpty() and next->_removed.isEmpty();
+	bool erasing = _inserted.isEmpty() and next->_inserted.isEmpty();
+
+	if (typing and next->_pos == _pos + _inserted.length()) {
+
+		//a new word starts a new command.
+		if (!_inserted.isEmpty() and !next->_inserted.isEmpty() and
+				next->_inserted.front().isSpace() and !_inserted.back().isSpace()) {
+			return false;
+		}
+
+		_inserted += next->_inserted;
+
+	} else if (erasing and next->_pos + next->_removed.length() == _pos) {
+
+		if (!_removed.isEmpty() and !next->_removed.isEmpty() and
+				next->_removed.back().isSpace() and !_removed.front().isSpace()) {
+			return false;
+		}
+
+		_removed.prepend(next->_removed);
+		_pos = next->_pos;
+
+	} else {
+		return false;
+	}
+
+	_cursorAfter = next->_cursorAfter;
+	updateByteSize();
+
+	return true;
+}
+
+bool LineTextCommand::isEmpty() const {
+	return _removed.isEmpty() and _inserted.isEmpty();
+}
+
+
+void LineTextCommand::undoEdit() {
+
+	TextLine* line = targetLine();
+
+	if (line == nullptr) {
+		return;
+	}
+
+	QString txt = line->getText();
+	txt.replace(_pos, _inserted.length(), _removed);
+	line->setText(txt);
+}
+void LineTextCommand::redoEdit() {
+
+	TextLine* line = targetLine();
+
+	if (line == nullptr) {
+		return;
+	}
+
+	QString txt = line->getText();
+	txt.replace(_pos, _removed.length(), _inserted);
+	line->setText(txt);
+}
+void LineTextCommand::updateByteSize() {
+	_byteSize = sizeof(LineTextCommand) + pathByteSize(_nodePath) + (_removed.size() + _inserted.size())*sizeof(QChar);
+}
+
+TextLine* LineTextCommand::targetLine() {
+
+	TextNode* node = _document->nodeAtPath(_nodePath);
+
+	if (node == nullptr or _lineIndex >= node->nbTextLines()) {
+		return nullptr;
+	}
+
+	return node->lineAt(_lineIndex);
+}
+
+
+NodeInsertionCommand::NodeInsertionCommand(TextNode* document, TextNode* parent, int row, QVector<TextNode::NodeSnapshot> const& snapshots, bool insertion) :
+	TextEditCommand(document),
+	_parentPath(parent->nodePath()),
+	_row(row),
+	_snapshots(snapshots),
+	_insertion(insertion)
+{
+	_byteSize = sizeof(NodeInsertionCommand) + pathByteSize(_parentPath);
+
+	for (TextNode::NodeSnapshot const& snapshot : _snapshots) {
+		_byteSize += snapshotByteSize(snapshot);
+	}
+}
+
+void NodeInsertionCommand::undoEdit() {
+	if (_insertion) {
+		remove();
+	} else {
+		insert();
+	}
+}
+void NodeInsertionCommand::redoEdit() {
+	if (_insertion) {
+		insert();
+	} else {
+		remove();
+	}
+}
+
+void NodeInsertionCommand::insert() {
+
+	TextNode* parent = _document->nodeAtPath(_parentPath);
+
+	if (parent == nullptr or _row > parent->nbChildren()) {
+		return;
+	}
+
+	parent->insertSnapshotsBelow(_snapshots, _row);
+}
+void NodeInsertionCommand::remove() {
+
+	TextNode* parent = _document->nodeAtPath(_parentPath);
+
+	if (parent == nullptr or _row + _snapshots.size() > parent->nbChildren()) {
+		return;
+	}
+
+	for (int i = _row + _snapshots.size() - 1; i >= _row; i--) {
+		parent->childNodes()[i]->clearFromDoc();
+	}
+}
+
+qint64 NodeInsertionCommand::snapshotByteSize(TextNode::NodeSnapshot const& snapshot) {
+
+	qint64 size = sizeof(TextNode::NodeSnapshot) + linesByteSize(snapshot.lines);
+
+	for (TextNode::NodeSnapshot const& child : snapshot.children) {
+		size += snapshotByteSize(child);
+	}
+
+	return size;
+}
+
+
+NodeMoveCommand::NodeMoveCommand(TextNode* document,
+								 QVector<int> const& pathBefore,
+								 QVector<int> const& newParentPathBefore,
+								 int newRow,
+								 QVector<int> const& pathAfter,
+								 QVector<int> const& oldParentPathAfter,
+								 int oldRow) :
+	TextEditCommand(document),
+	_pathBefore(pathBefore),
+	_newParentPathBefore(newParentPathBefore),
+	_newRow(newRow),
+	_pathAfter(pathAfter),
+	_oldParentPathAfter(oldParentPathAfter),
+	_oldRow(oldRow)
+{
+	_byteSize = sizeof(NodeMoveCommand) +
+			pathByteSize(_pathBefore) + pathByteSize(_newParentPathBefore) +
+			pathByteSize(_pathAfter) + pathByteSize(_oldParentPathAfter);
+}
+
+void NodeMoveCommand::undoEdit() {
+
+	TextNode* node = _document->nodeAtPath(_pathAfter);
+	TextNode* parent = _document->nodeAtPath(_oldParentPathAfter);
+
+	if (node == nullptr or parent == nullptr) {
+		return;
+	}
+
+	node->moveNode(parent, _oldRow);
+}
+void NodeMoveCommand::redoEdit() {
+
+	TextNode* node = _document->nodeAtPath(_pathBefore);
+	TextNode* parent = _document->nodeAtPath(_newParentPathBefore);
+
+	if (node == nullptr or parent == nullptr) {
+		return;
+	}
+
+	node->moveNode(parent, _newRow);
+}
+
+
+NodeStyleCommand::NodeStyleCommand(TextNode* document, TextNode* node, int oldStyle, int newStyle) :
+	TextEditCommand(document),
+	_nodePath(node->nodePath()),
+	_oldStyle(oldStyle),
+	_newStyle(newStyle)
+{
+	_byteSize = sizeof(NodeStyleCommand) + pathByteSize(_nodePath);
+}
+
+void NodeStyleCommand::undoEdit() {
+
+	TextNode* node = _document->nodeAtPath(_nodePath);
+
+	if (node != nullptr) {
+		node->setStyleId(_oldStyle);
+	}
+}
+void NodeStyleCommand::redoEdit() {
+
+	TextNode* node = _document->nodeAtPath(_nodePath);
+
+	if (node != nullptr) {
+		node->setStyleId(_newStyle);
+	}
+}
+
+
+NodeLinesCountCommand::NodeLinesCountCommand(TextNode* document, TextNode* node, int newCount) :
+	TextEditCommand(document),
+	_nodePath(node->nodePath()),
+	_oldCount(node->nbTextLines()),
+	_newCount(newCount)
+{
+	for (int i = newCount; i < _oldCount; i++) {
+		_removedLines.push_back(node->lineAt(i)->getText());
+	}
+
+	_byteSize = sizeof(NodeLinesCountCommand) + pathByteSize(_nodePath) + linesByteSize(_removedLines);
+}
+
+void NodeLinesCountCommand::undoEdit() {
+
+	TextNode* node = _document->nodeAtPath(_nodePath);
+
+	if (node == nullptr) {
+		return;
+	}
+
+	node->setNbTextLines(_oldCount);
+
+	for (int i = 0; i < _removedLines.size(); i++) {
+		node->lineAt(_newCount + i)->setText(_removedLines[i]);
+	}
+}
+void NodeLinesCountCommand::redoEdit() {
+
+	TextNode* node = _document->nodeAtPath(_nodePath);
+
+	if (node != nullptr) {
+		node->setNbTextLines(_newCount);
+	}
+}
+
+
+TextEditHistory::TextEditHistory(int countLimit, qint64 memoryBudget) :
+	_index(0),
+	_byteSize(0),
+	_countLimit(std::max(countLimit, 1)),
+	_memoryBudget(memoryBudget)
+{
+
+}
+TextEditHistory::~TextEditHistory() {
+	qDeleteAll(_commands);
+}
+
+void TextEditHistory::push(TextEditCommand* command) {
+
+	dropRedoCommands();
+
+	if (_index > 0 and command->id() >= 0 and _commands[_index-1]->id() == command->id()) {
+
+		TextEditCommand* last = _commands[_index-1];
+		qint64 oldSize = last->byteSize();
+
+		if (last->mergeWith(command)) {
+			_byteSize += last->byteSize() - oldSize;
+			delete command;
+			trim();
+			return;
+		}
+	}
+
+	_commands.push_back(command);
+	_index++;
+	_byteSize += command->byteSize();
+
+	trim();
+}
+void TextEditHistory::clear() {
+	qDeleteAll(_commands);
+	_commands.clear();
+	_index = 0;
+	_byteSize = 0;
+}
+
+bool TextEditHistory::canUndo() const {
+	return _index > 0;
+}
+bool TextEditHistory::canRedo() const {
+	return _index < _commands.size();
+}
+TextEditCommand const* TextEditHistory::undoCommand() const {
+	return (canUndo()) ? _commands[_index-1] : nullptr;
+}
+TextEditCommand const* TextEditHistory::redoCommand() const {
+	return (canRedo()) ? _commands[_index] : nullptr;
+}
+
+void TextEditHistory::undo() {
+
+	if (!canUndo()) {
+		return;
+	}
+
+	_index--;
+	_commands[_index]->undo();
+}
+void TextEditHistory::redo() {
+
+	if (!canRedo()) {
+		return;
+	}
+
+	_commands[_index]->redo();
+	_index++;
+}
+
+int TextEditHistory::count() const {
+	return _commands.size();
+}
+int TextEditHistory::index() const {
+	return _index;
+}
+qint64 TextEditHistory::byteSize() const {
+	return _byteSize;
+}
+
+void TextEditHistory::dropRedoCommands() {
+
+	while (_commands.size() > _index) {
+		TextEditCommand* command = _commands.takeLast();
+		_byteSize -= command->byteSize();
+		delete command;
+	}
+}
+void TextEditHistory::trim() {
+
+	//trim is called after a push, when all the commands can be undone, the oldest ones are the first of the list.
+	while (_commands.size() > 1 and (_commands.size() > _countLimit or _byteSize > _memoryBudget)) {
+		TextEditCommand* command = _commands.takeFirst();
+		_byteSize -= command->byteSize();
+		_index--;
+		delete command;
+	}
+}
+
+} // namespace Sabrina
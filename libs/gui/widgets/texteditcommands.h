@@ -0,0 +1,269 @@
+#ifndef SABRINA_TEXTEDITCOMMANDS_H
+#define SABRINA_TEXTEDITCOMMANDS_H
+
+/*
+This file is part of the project Sabrina
+Copyright (C) 2023  Paragon <french.paragon@gmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include <QUndoCommand>
+#include <QList>
+#include <QVector>
+#include <QStringList>
+
+#include "text/textnode.h"
+
+namespace Sabrina {
+
+/*!
+ * \brief The TextEditCommand class is the base class of the commands stored in the TextEditHistory of a TextEditWidget.
+ *
+ * The commands only store what changed (a text delta, a node position, a style...) and address the nodes by their path in the document,
+ * as the nodes objects might be deleted and recreated between an undo and a redo.
+ * A command is recorded once the edit it represents has been applied, it is not redone when it is pushed in the history.
+ *
+ * The removal of nodes stores snapshots of the whole removed subtrees, so the size of a command is not bounded.
+ * byteSize gives an approximation of the memory held by a command, computed when the command is built or merged.
+ */
+class TextEditCommand : public QUndoCommand
+{
+public:
+
+	struct CursorState {
+		CursorState() : line(-1), pos(0), extend(0) {}
+		CursorState(int l, int p, int e = 0) : line(l), pos(p), extend(e) {}
+		inline bool isValid() const { return line >= 0; }
+		int line;
+		int pos;
+		int extend;
+	};
+
+	explicit TextEditCommand(TextNode* document);
+
+	void undo() override;
+	void redo() override;
+
+	CursorState cursorBefore() const;
+	CursorState cursorAfter() const;
+	void setCursorStates(CursorState const& before, CursorState const& after);
+
+	//! \brief an approximation of the memory used by the command, in bytes.
+	qint64 byteSize() const;
+
+protected:
+
+	virtual void undoEdit() = 0;
+	virtual void redoEdit() = 0;
+
+	static qint64 pathByteSize(QVector<int> const& path);
+	static qint64 linesByteSize(QStringList const& lines);
+
+	TextNode* _document;
+	qint64 _byteSize;
+
+	CursorState _cursorBefore;
+	CursorState _cursorAfter;
+
+	friend class TextEditGroupCommand;
+};
+
+//! \brief The TextEditGroupCommand class group the commands of a compound edit, which are undone and redone as a single step.
+class TextEditGroupCommand : public TextEditCommand
+{
+public:
+	explicit TextEditGroupCommand(TextNode* document, QString const& text = QString());
+	~TextEditGroupCommand();
+
+	//! \brief add an already applied command to the group, the group takes the ownership of the command.
+	void addCommand(TextEditCommand* command);
+	int commandsCount() const;
+	//! \brief remove the only command of the group, to push it directly in the stack.
+	TextEditCommand* takeSingleCommand();
+
+protected:
+
+	void undoEdit() override;
+	void redoEdit() override;
+
+	QVector<TextEditCommand*> _commands;
+};
+
+/*!
+ * \brief The LineTextCommand class store the change of the text of a line as the replaced part only.
+ *
+ * Consecutive keystrokes on the same line are merged in a single command, up to the end of each word.
+ */
+class LineTextCommand : public TextEditCommand
+{
+public:
+
+	static const int Id;
+
+	LineTextCommand(TextNode* document, TextLine* line, QString const& oldText, QString const& newText);
+
+	int id() const override;
+	bool mergeWith(const QUndoCommand *other) override;
+
+	bool isEmpty() const;
+
+protected:
+
+	void undoEdit() override;
+	void redoEdit() override;
+
+	void updateByteSize();
+
+	TextLine* targetLine();
+
+	QVector<int> _nodePath;
+	int _lineIndex;
+	int _pos;
+	QString _removed;
+	QString _inserted;
+};
+
+/*!
+ * \brief The NodeInsertionCommand class store the insertion or the removal of consecutive nodes with their content and children.
+ *
+ * The nodes occupy the rows row to row + snapshots.size() - 1 of the parent, they are restored in a single insertion.
+ */
+class NodeInsertionCommand : public TextEditCommand
+{
+public:
+	NodeInsertionCommand(TextNode* document, TextNode* parent, int row, QVector<TextNode::NodeSnapshot> const& snapshots, bool insertion);
+
+protected:
+
+	void undoEdit() override;
+	void redoEdit() override;
+
+	static qint64 snapshotByteSize(TextNode::NodeSnapshot const& snapshot);
+
+	void insert();
+	void remove();
+
+	QVector<int> _parentPath;
+	int _row;
+	QVector<TextNode::NodeSnapshot> _snapshots;
+	bool _insertion;
+};
+
+//! \brief The NodeMoveCommand class store the move of a node, the paths are those before the move for the redo and after the move for the undo.
+class NodeMoveCommand : public TextEditCommand
+{
+public:
+	NodeMoveCommand(TextNode* document,
+					QVector<int> const& pathBefore,
+					QVector<int> const& newParentPathBefore,
+					int newRow,
+					QVector<int> const& pathAfter,
+					QVector<int> const& oldParentPathAfter,
+					int oldRow);
+
+protected:
+
+	void undoEdit() override;
+	void redoEdit() override;
+
+	QVector<int> _pathBefore;
+	QVector<int> _newParentPathBefore;
+	int _newRow;
+	QVector<int> _pathAfter;
+	QVector<int> _oldParentPathAfter;
+	int _oldRow;
+};
+
+//! \brief The NodeStyleCommand class store the change of the style of a node.
+class NodeStyleCommand : public TextEditCommand
+{
+public:
+	NodeStyleCommand(TextNode* document, TextNode* node, int oldStyle, int newStyle);
+
+protected:
+
+	void undoEdit() override;
+	void redoEdit() override;
+
+	QVector<int> _nodePath;
+	int _oldStyle;
+	int _newStyle;
+};
+
+//! \brief The NodeLinesCountCommand class store the change of the number of lines of a node, with the text of the removed lines.
+class NodeLinesCountCommand : public TextEditCommand
+{
+public:
+	NodeLinesCountCommand(TextNode* document, TextNode* node, int newCount);
+
+protected:
+
+	void undoEdit() override;
+	void redoEdit() override;
+
+	QVector<int> _nodePath;
+	int _oldCount;
+	int _newCount;
+	QStringList _removedLines;
+};
+
+/*!
+ * \brief The TextEditHistory class store the commands of a TextEditWidget which can be undone and redone.
+ *
+ * As in a QUndoStack, the commands with the same id are merged with the last one when pushed, and pushing a command drops the commands which can be redone.
+ * The oldest commands are deleted once the history holds more than countLimit commands or more than memoryBudget bytes,
+ * the memory is tracked with a running total of the size of the commands, so a push does not depend on the length of the history.
+ * The last pushed command is always kept.
+ */
+class TextEditHistory
+{
+public:
+	TextEditHistory(int countLimit, qint64 memoryBudget);
+	~TextEditHistory();
+
+	//! \brief push an already applied command, the history takes the ownership of the command.
+	void push(TextEditCommand* command);
+	void clear();
+
+	bool canUndo() const;
+	bool canRedo() const;
+	//! \brief the command undone by the next call to undo, nullptr if there is none.
+	TextEditCommand const* undoCommand() const;
+	//! \brief the command redone by the next call to redo, nullptr if there is none.
+	TextEditCommand const* redoCommand() const;
+
+	void undo();
+	void redo();
+
+	int count() const;
+	int index() const;
+	qint64 byteSize() const;
+
+protected:
+
+	void dropRedoCommands();
+	void trim();
+
+	QList<TextEditCommand*> _commands;
+	int _index;
+	qint64 _byteSize;
+
+	int _countLimit;
+	qint64 _memoryBudget;
+};
+
+} // namespace Sabrina
+
+#endif // SABRINA_TEXTEDITCOMMANDS_H
@@ -17,6 +17,7 @@ along with this program.  If not, see <https://www.gnu.org/licenses/>.
 */
 
 #include "texteditwidget.h"
+#include "kineticscroller.h"
 
 #include <QPainter>
 #include <QGuiApplication>
@@ -24,11 +25,14 @@ along with this program.  If not, see <https://www.gnu.org/licenses/>.
 #include <QMimeData>
 #include <QAction>
 #include <QJsonDocument>
+#include <QElapsedTimer>
 #include <QJsonArray>
 #include <QJsonObject>
 
 #include <cmath>
 
+#include "text/textdocumentmimedata.h"
+
 #include "utils/envvars.h"
 
 #include <QDebug>
@@ -38,18 +42,40 @@ namespace Sabrina {
 TextEditWidget::TextEditWidget(QWidget *parent) :
 	QWidget(parent),
 	_styleManager(nullptr),
+	_layoutIndex(nullptr),
+	_searchEngine(nullptr),
+	_lineDecorator(nullptr),
+	_scroller(nullptr),
+	_scrollDirection(1),
 	_currentScript(nullptr),
 	_baseIndex(nullptr),
 	_baseIndexLine(0),
 	_baseIndexHeightDelta(0),
 	_endIndex(nullptr),
 	_endIndexMargin(-1),
+	_editGroup(nullptr),
+	_editGroupDepth(0),
+	_pasteStage(nullptr),
+	_pasteStageParent(nullptr),
+	_pasteStageRow(0),
 	_internalMargins(25, 25, 25, 25),
 	_nodeSupprBehavior(NodeSupprBehavior::MergeContent),
 	_selectionMode(SelectionMode::Text),
 	_highlightCurrent(true)
 {
+	_layoutIndex = new TextLayoutIndex(this); //the cursor uses the index to find its line.
 	_cursor = new Cursor(this, 0, 0, 0);
+	connect(_layoutIndex, &TextLayoutIndex::nodeRelaidOut, this, &TextEditWidget::onNodeRelaidOut);
+	connect(_layoutIndex, &TextLayoutIndex::layoutInvalidated, this, &TextEditWidget::invalidateResolvedSelection); //nodes positions changed.
+
+	_searchEngine = new TextSearchEngine(this);
+
+	_scroller = new KineticScroller(this);
+	connect(_scroller, &KineticScroller::step, this, &TextEditWidget::onScrollStep);
+	connect(_scroller, &KineticScroller::frameDone, this, &TextEditWidget::layOutAhead);
+
+	_history = new TextEditHistory(UndoLimit, UndoMemoryBudget); //the removals store whole subtrees, so the memory of the history is bounded too.
+
 	setFocusPolicy(Qt::StrongFocus);
 	setAttribute(Qt::WA_InputMethodEnabled, true);
 
@@ -81,10 +107,43 @@ void TextEditWidget::configureActions() {
 
 	addAction(paste);
 
+	QAction* undo = new QAction("Undo", this);
+	undo->setShortcut(QKeySequence::Undo);
+
+	connect(undo, &QAction::triggered, this, &TextEditWidget::undo);
+
+	addAction(undo);
+
+	QAction* redo = new QAction("Redo", this);
+	redo->setShortcuts({QKeySequence::Redo, QKeySequence(Qt::CTRL+Qt::Key_Y)});
+
+	connect(redo, &QAction::triggered, this, &TextEditWidget::redo);
+
+	addAction(redo);
+
+	QAction* findNext = new QAction("Find next", this);
+	findNext->setShortcut(QKeySequence::FindNext);
+
+	connect(findNext, &QAction::triggered, this, &TextEditWidget::findNext);
+
+	addAction(findNext);
+
+	QAction* findPrevious = new QAction("Find previous", this);
+	findPrevious->setShortcut(QKeySequence::FindPrevious);
+
+	connect(findPrevious, &QAction::triggered, this, &TextEditWidget::findPrevious);
+
+	addAction(findPrevious);
+
 }
 
+const int TextEditWidget::UndoLimit = 1000;
+const qint64 TextEditWidget::UndoMemoryBudget = 16*1024*1024;
+const int TextEditWidget::FrameLayoutBudget = 4;
+
 TextEditWidget::~TextEditWidget() {
 	delete _cursor;
+	delete _history;
 }
 
 void TextEditWidget::setStyleManager(TextStyleManager *styleManager)
@@ -95,6 +154,7 @@ void TextEditWidget::setStyleManager(TextStyleManager *styleManager)
 	}
 
 	_styleManager = styleManager;
+	_layoutIndex->setStyleManager(_styleManager);
 
 	if (_styleManager != nullptr) {
 		connect(_styleManager, &TextStyleManager::styleUpdated, this, static_cast<void(TextEditWidget::*)()>(&TextEditWidget::update));
@@ -108,7 +168,13 @@ TextNode* TextEditWidget::getDocument() const {
 	return _currentScript;
 }
 TextNode* TextEditWidget::getCurrentNode() const {
-	return _currentScript->nodeAtLine(_cursor->line());
+	TextLine* l = _cursor->currentLine();
+
+	if (l == nullptr) {
+		return nullptr;
+	}
+
+	return l->nodeParent();
 }
 void TextEditWidget::setCurrentScript(TextNode *root) {
 
@@ -118,26 +184,31 @@ void TextEditWidget::setCurrentScript(TextNode *root) {
 			disconnect(_currentScript, &QObject::destroyed, this, &TextEditWidget::clearCurrentScript);
 
 			disconnect(_currentScript, &TextNode::nodeAdded, this, static_cast<void(TextEditWidget::*)()>(&TextEditWidget::update));
+			disconnect(_currentScript, &TextNode::nodesAdded, this, static_cast<void(TextEditWidget::*)()>(&TextEditWidget::update));
 			disconnect(_currentScript, &TextNode::nodeRemoved, this, static_cast<void(TextEditWidget::*)()>(&TextEditWidget::update));
-			disconnect(_currentScript, &TextNode::nodeEdited, this, static_cast<void(TextEditWidget::*)()>(&TextEditWidget::update));
 			disconnect(_currentScript, &TextNode::nodeLineLayoutChanged, this, static_cast<void(TextEditWidget::*)()>(&TextEditWidget::update));
 			disconnect(_currentScript, &TextNode::nodeMoved, this, static_cast<void(TextEditWidget::*)()>(&TextEditWidget::update));
 		}
 
 		_currentScript = root;
+		_layoutIndex->setDocument(_currentScript); //edits are reported by the index, once the edited node is measured again.
+		_searchEngine->setDocument(_currentScript);
 
 		if (_currentScript != nullptr) {
 			connect(_currentScript, &QObject::destroyed, this, &TextEditWidget::clearCurrentScript);
 
 			connect(_currentScript, &TextNode::nodeAdded, this, static_cast<void(TextEditWidget::*)()>(&TextEditWidget::update));
+			connect(_currentScript, &TextNode::nodesAdded, this, static_cast<void(TextEditWidget::*)()>(&TextEditWidget::update));
 			connect(_currentScript, &TextNode::nodeRemoved, this, static_cast<void(TextEditWidget::*)()>(&TextEditWidget::update));
-			connect(_currentScript, &TextNode::nodeEdited, this, static_cast<void(TextEditWidget::*)()>(&TextEditWidget::update));
 			connect(_currentScript, &TextNode::nodeLineLayoutChanged, this, static_cast<void(TextEditWidget::*)()>(&TextEditWidget::update));
 			connect(_currentScript, &TextNode::nodeMoved, this, static_cast<void(TextEditWidget::*)()>(&TextEditWidget::update));
 		}
 
+		_scroller->stop();
 		_baseIndex = _currentScript;
 		_cursor->reset();
+		_history->clear(); //the commands address the nodes of the previous script.
+		invalidateResolvedSelection();
 		update();
 	}
 
@@ -147,6 +218,11 @@ void TextEditWidget::clearCurrentScript() {
 	if (_currentScript != nullptr) {
 		disconnect(_currentScript, &QObject::destroyed, this, &TextEditWidget::clearCurrentScript);
 		_currentScript = nullptr;
+		_layoutIndex->setDocument(nullptr);
+		_searchEngine->setDocument(nullptr);
+		_scroller->stop();
+		_paintedNodes.clear();
+		_history->clear();
 		update();
 	}
 }
@@ -201,6 +277,8 @@ void TextEditWidget::paintEvent(QPaintEvent *event) {
 					 event->rect().height(),
 					 QColor(255, 255, 255));
 
+	_paintedNodes.clear();
+
 	if (_styleManager == nullptr or _currentScript == nullptr) {
 		return;
 	}
@@ -216,34 +294,12 @@ void TextEditWidget::paintEvent(QPaintEvent *event) {
 
 	int availableWidth = computeLineWidth();
 
-	int selStart = 0;
-	int selEnd = -1;
-
-	Cursor::CursorState selectionState = _cursor->getExtendedSelectionState();
-
-	TextLine* startSelectionLine = nullptr;
-	TextLine* endSelectionLine = nullptr;
-
-	if (selectionState.extend > 0) {
-		startSelectionLine = _currentScript->getLineAtLine(selectionState.line);
-		selStart = selectionState.pos;
-		endSelectionLine = startSelectionLine->lineAfterOffset(selectionState.pos,selectionState.extend, selEnd);
-	} else if (selectionState.extend < 0) {
-		endSelectionLine = _currentScript->getLineAtLine(selectionState.line);
-		selEnd = selectionState.pos;
-		startSelectionLine = endSelectionLine->lineAfterOffset(selectionState.pos,selectionState.extend, selStart);
-	}
-
-	bool selection_running = false;
+	ResolvedSelection const& selection = resolvedSelection();
+	Cursor::CursorState selectionState = selection.state;
+	bool hasSelection = selection.startNode >= 0 and selection.endNode >= 0;
 
-	if (startSelectionLine != nullptr and endSelectionLine != nullptr) {
-
-		selection_running = n->isBetweenNode(*startSelectionLine->nodeParent(),
-											 *endSelectionLine->nodeParent(),
-											 true);
-
-	}
-	bool currentNodeInSelection = selection_running;
+	TextLine* cursorLine = _cursor->currentLine();
+	TextNode* cursorNode = (cursorLine != nullptr) ? cursorLine->nodeParent() : nullptr;
 
 	while(v_pos < height()) {
 		Cursor::CursorState* c = nullptr;
@@ -258,21 +314,21 @@ void TextEditWidget::paintEvent(QPaintEvent *event) {
 
 		TextNode::NodeCoordinate sEnd = TextNode::NodeCoordinate(0,0);
 
-		if (startSelectionLine != nullptr and endSelectionLine != nullptr) {
+		bool currentNodeInSelection = false;
 
-			if (startSelectionLine->nodeParent() == n) {
-				selection_running = true;
-				currentNodeInSelection = true;
-				sStart = TextNode::NodeCoordinate(startSelectionLine->lineNodeIndexNumber(), selStart);
-			}
+		if (hasSelection) {
 
-			if (endSelectionLine->nodeParent() == n) {
-				selection_running = false;
-				sEnd = TextNode::NodeCoordinate(endSelectionLine->lineNodeIndexNumber(), selEnd);
-			} else if (selection_running) {
-				sEnd = TextNode::NodeCoordinate(-1,-1);
-			}
+			int p = _layoutIndex->nodePosition(n);
+			currentNodeInSelection = p >= selection.startNode and p <= selection.endNode;
+
+			if (currentNodeInSelection) {
+
+				if (p == selection.startNode) {
+					sStart = selection.startCoord;
+				}
 
+				sEnd = (p == selection.endNode) ? selection.endCoord : TextNode::NodeCoordinate(-1,-1);
+			}
 		}
 
 		AbstractTextNodeStyle* s = nodeStyle(n);
@@ -283,26 +339,26 @@ void TextEditWidget::paintEvent(QPaintEvent *event) {
 
 		QPointF o(computeLineStartingX(), v_pos);
 
-		int nodeHeight = s->nodeHeight(n, availableWidth);
+		int nHeight = nodeHeight(n);
+		_paintedNodes.insert(n, QRect(0, v_pos, width(), nHeight));
 
 		if (highlightCurrent()) {
-			if (currentNodeInSelection or n == _currentScript->getLineAtLine(_cursor->line())->nodeParent()) {
+			if (currentNodeInSelection or n == cursorNode) {
 				painter.fillRect(0,
 								 v_pos,
 								 width(),
-								 nodeHeight,
+								 nHeight,
 								 QColor(230, 240, 255));
 			}
 		}
 
 		if (c != nullptr) {
-			s->renderNode(n, o, availableWidth, painter, sStart, sEnd, c->line - l, c->pos, _selectionFormat);
+			s->renderNode(n, o, availableWidth, painter, sStart, sEnd, c->line - l, c->pos, _selectionFormat, _lineDecorator);
 		} else {
-			s->renderNode(n, o, availableWidth, painter, sStart, sEnd, -1, 0, _selectionFormat);
+			s->renderNode(n, o, availableWidth, painter, sStart, sEnd, -1, 0, _selectionFormat, _lineDecorator);
 		}
-		currentNodeInSelection = selection_running;
 
-		v_pos += nodeHeight;
+		v_pos += nHeight;
 		l += n->nbTextLines();
 		_endIndex = n;
 		n = n->nextNode();
@@ -315,6 +371,11 @@ void TextEditWidget::paintEvent(QPaintEvent *event) {
 	_endIndexMargin = v_pos - height();
 
 }
+void TextEditWidget::resizeEvent(QResizeEvent *event) {
+	_layoutIndex->setAvailableWidth(computeLineWidth());
+	_scroller->setMaxStep(event->size().height()); //at most a viewport of nodes is laid out by a scroll step.
+	QWidget::resizeEvent(event);
+}
 void TextEditWidget::keyPressEvent(QKeyEvent *event) {
 
 	if (event->key() == Qt::Key_Left) {
@@ -337,13 +398,15 @@ void TextEditWidget::keyPressEvent(QKeyEvent *event) {
 		update();
 	} else if (event->key() == Qt::Key_Return or event->key() == Qt::Key_Enter) {
 		int idL;
-		TextNode* n = _currentScript->nodeAtLine(_cursor->line(), &idL);
+		TextNode* n = _layoutIndex->nodeAtLine(_cursor->line(), &idL);
 		if (n == nullptr) {
 			return;
 		}
 
+		beginEdit(tr("New block"));
 		insertNextType(n, event->modifiers());
 		_cursor->setLine(idL + n->nbTextLines());
+		endEdit();
 
 		scrollToLine(_cursor->line());
 		update();
@@ -355,8 +418,7 @@ void TextEditWidget::keyPressEvent(QKeyEvent *event) {
 
 	} else if(!event->text().isEmpty()) {
 
-		insertText(event->text());
-		update();
+		insertText(event->text()); //the edited node schedule its own repaint.
 
 	} else {
 		QWidget::keyPressEvent(event);
@@ -369,7 +431,6 @@ void TextEditWidget::inputMethodEvent(QInputMethodEvent *event) {
 
 	if (!s.isEmpty()) {
 		insertText(s);
-		update();
 	}
 
 }
@@ -379,12 +440,13 @@ void TextEditWidget::wheelEvent(QWheelEvent *event) {
 	QPoint numPixels = event->pixelDelta();
 	QPoint numDegrees = event->angleDelta() / 8;
 
+	//the deltas are accumulated and applied at the next frame, trackpads already send smooth deltas so only the wheel ones are eased.
 	if (!numPixels.isNull() and getEnvVar("XDG_SESSION_TYPE").toLower() != "x11") {
-		scroll(-numPixels.y());
+		_scroller->addDelta(-numPixels.y(), false);
 	} else if (!numDegrees.isNull()) {
-		scroll(-numDegrees.y());
+		_scroller->addDelta(-numDegrees.y(), true);
 	}
-	update();
+	event->accept();
 }
 
 void TextEditWidget::mousePressEvent(QMouseEvent *event) {
@@ -408,16 +470,91 @@ void TextEditWidget::mouseMoveEvent(QMouseEvent *event) {
 	}
 }
 
+TextEditWidget::ResolvedSelection const& TextEditWidget::resolvedSelection() {
+
+	int line = _cursor->line();
+	int pos = _cursor->pos();
+	int extend = _cursor->extend();
+
+	if (_resolvedSelection.valid and
+			_resolvedSelection.line == line and
+			_resolvedSelection.pos == pos and
+			_resolvedSelection.extend == extend and
+			_resolvedSelection.mode == _selectionMode) {
+		return _resolvedSelection;
+	}
+
+	_resolvedSelection = ResolvedSelection();
+	_resolvedSelection.valid = true;
+	_resolvedSelection.line = line;
+	_resolvedSelection.pos = pos;
+	_resolvedSelection.extend = extend;
+	_resolvedSelection.mode = _selectionMode;
+	_resolvedSelection.state = _cursor->getExtendedSelectionState();
+
+	Cursor::CursorState const& state = _resolvedSelection.state;
+
+	if (state.extend == 0) {
+		return _resolvedSelection;
+	}
+
+	TextLine* startLine = nullptr;
+	TextLine* endLine = nullptr;
+	int selStart = 0;
+	int selEnd = -1;
+
+	if (state.extend > 0) {
+		startLine = lineAtLine(state.line);
+		selStart = state.pos;
+		endLine = (startLine != nullptr) ? startLine->lineAfterOffset(state.pos, state.extend, selEnd) : nullptr;
+	} else {
+		endLine = lineAtLine(state.line);
+		selEnd = state.pos;
+		startLine = (endLine != nullptr) ? endLine->lineAfterOffset(state.pos, state.extend, selStart) : nullptr;
+	}
+
+	if (startLine == nullptr or endLine == nullptr) {
+		return _resolvedSelection;
+	}
+
+	_resolvedSelection.startNode = _layoutIndex->nodePosition(startLine->nodeParent());
+	_resolvedSelection.endNode = _layoutIndex->nodePosition(endLine->nodeParent());
+	_resolvedSelection.startCoord = TextNode::NodeCoordinate(startLine->lineNodeIndexNumber(), selStart);
+	_resolvedSelection.endCoord = TextNode::NodeCoordinate(endLine->lineNodeIndexNumber(), selEnd);
+
+	return _resolvedSelection;
+}
+void TextEditWidget::invalidateResolvedSelection() {
+	_resolvedSelection.valid = false;
+}
+
 int TextEditWidget::nodeHeight(TextNode* n) {
-	AbstractTextNodeStyle* s = nodeStyle(n);
 
-	if (s == nullptr) {
+	if (nodeStyle(n) == nullptr) {
 		return 0;
 	}
 
-	return s->nodeHeight(n, computeLineWidth());
+	_layoutIndex->setAvailableWidth(computeLineWidth());
+	return _layoutIndex->nodeHeight(n);
 
 }
+void TextEditWidget::onNodeRelaidOut(TextNode* n, int heightDelta) {
+
+	invalidateResolvedSelection(); //the characters offsets in the node might have changed.
+
+	if (heightDelta > 0 and (n == _endIndex or n->nextNode() == _endIndex)) {
+		scroll(heightDelta); //keep the edited node in view when it grows at the bottom of the viewport.
+		update();
+		return;
+	}
+
+	if (heightDelta == 0 and _paintedNodes.contains(n)) {
+		update(_paintedNodes.value(n)); //the rest of the viewport did not move.
+		return;
+	}
+
+	update();
+}
 int TextEditWidget::scroolableUpDistance(int maxScroll) {
 
 	if (_endIndexMargin < 0) {
@@ -491,7 +628,34 @@ TextNode::NodeCoordinate TextEditWidget::textCordAtPoint(QPoint const& point) {
 	int pos;
 	TextLine* tl = lineAtPos(point, &pos);
 
-	return {tl->lineLineNumber(), pos};
+	return {lineNumber(tl), pos};
+}
+
+TextLine* TextEditWidget::lineAtLine(int line) const {
+
+	int firstLine;
+	TextNode* n = _layoutIndex->nodeAtLine(line, &firstLine);
+
+	if (n == nullptr) {
+		return nullptr;
+	}
+
+	return n->lineAt(line - firstLine);
+}
+int TextEditWidget::lineNumber(TextLine* line) const {
+
+	if (line == nullptr) {
+		return -1;
+	}
+
+	int firstLine = _layoutIndex->nodeFirstLine(line->nodeParent());
+	int id = line->lineNodeIndexNumber();
+
+	if (firstLine < 0 or id < 0) {
+		return -1;
+	}
+
+	return firstLine + id;
 }
 
 TextNode* TextEditWidget::nodeAtHeight(int y, int * nodeH) {
@@ -701,8 +865,53 @@ void TextEditWidget::scroll (int offset) {
 		}
 	}
 
-	_baseIndexLine = _baseIndex->nodeLine();
+	_baseIndexLine = _layoutIndex->nodeFirstLine(_baseIndex);
+
+	Q_EMIT viewportChanged();
+}
+
+void TextEditWidget::onScrollStep(int pixels) {
+
+	TextNode* baseIndex = _baseIndex;
+	int baseIndexHeightDelta = _baseIndexHeightDelta;
+
+	scroll(pixels);
+
+	if (_baseIndex == baseIndex and _baseIndexHeightDelta == baseIndexHeightDelta) { //reached an end of the document.
+		_scroller->stop();
+		return;
+	}
+
+	_scrollDirection = (pixels > 0) ? 1 : -1;
+	update();
+}
+void TextEditWidget::layOutAhead() {
+
+	if (_currentScript == nullptr or _endIndex == nullptr) {
+		return;
+	}
+
+	int p = _layoutIndex->nodePosition((_scrollDirection > 0) ? _endIndex : _baseIndex);
+
+	if (p < 0) {
+		return;
+	}
+
+	QElapsedTimer timer;
+	timer.start();
+
+	int covered = 0;
+
+	for (p += _scrollDirection; covered < height() and timer.elapsed() < FrameLayoutBudget; p += _scrollDirection) {
+
+		TextNode* n = _layoutIndex->nodeAt(p);
+
+		if (n == nullptr) {
+			break;
+		}
 
+		covered += nodeHeight(n); //a no-op for the nodes already measured.
+	}
 }
 
 void TextEditWidget::scrollToLine (int l) {
@@ -720,13 +929,15 @@ void TextEditWidget::scrollToLine (int l) {
 		_endIndexMargin += nodeHeight(_endIndex);
 	}
 
-	int endIndexLine = _endIndex->nodeLine();
+	int endIndexLine = _layoutIndex->nodeFirstLine(_endIndex);
 
 	if (l > _baseIndexLine and l < endIndexLine) {
 		return;
 	}
 
-	TextNode* target = _currentScript->nodeAtLine(l);
+	_scroller->stop(); //the jump to the line replaces any scroll in progress.
+
+	TextNode* target = _layoutIndex->nodeAtLine(l);
 
 	if (l > 0 and target == nullptr) {
 		return;
@@ -780,7 +991,7 @@ TextEditWidget::Cursor::CursorPos TextEditWidget::computeNewPosAfterJump(int nbP
 
 	style->layNodeOut(n, computeLineWidth());
 
-	int aLine = _cursor->line() - n->nodeLine();
+	int aLine = _cursor->line() - _layoutIndex->nodeFirstLine(n);
 
 	TextLine* tl = n->lineAt(aLine);
 
@@ -839,7 +1050,7 @@ TextEditWidget::Cursor::CursorPos TextEditWidget::computeNewPosAfterJump(int nbP
 					aLine = 0;
 
 					if (tmp == nullptr) {
-						return {n->nodeLine() + n->nbTextLines()-1, n->lineAt(n->nbTextLines()-1)->getText().length()};
+						return {_layoutIndex->nodeFirstLine(n) + n->nbTextLines()-1, n->lineAt(n->nbTextLines()-1)->getText().length()};
 					}
 
 					n = tmp;
@@ -873,14 +1084,17 @@ TextEditWidget::Cursor::CursorPos TextEditWidget::computeNewPosAfterJump(int nbP
 void TextEditWidget::insertText(QString commited) {
 
 	int idLine;
-	TextNode* n = _currentScript->nodeAtLine(_cursor->line(), &idLine);
+	TextNode* n = _layoutIndex->nodeAtLine(_cursor->line(), &idLine);
 
 	if (n == nullptr) {
 		return;
 	}
 
+	beginEdit(tr("Typing"));
+
 	if (_cursor->extend() != 0) {
 		removeText();
+		update(); //the selection highlight has to be cleared everywhere.
 	}
 
 	TextLine* tLine = n->lineAt(_cursor->line() - idLine);
@@ -913,18 +1127,11 @@ void TextEditWidget::insertText(QString commited) {
 
 	int c_offset = line.length() - pLen;
 
-	int pH = nodeHeight(n);
-
-	tLine->setText(line);
-
-	int dH = nodeHeight(n) - pH;
-
-	if ((n == _endIndex or n->nextNode() == _endIndex)
-			and dH > 0) {
-		scroll(dH);
-	}
+	editLineText(tLine, line); //height changes are handled in onNodeRelaidOut.
 	_cursor->move(c_offset);
 
+	endEdit();
+
 }
 
 void TextEditWidget::insertNextType(TextNode* n, Qt::KeyboardModifiers modifiers) {
@@ -949,30 +1156,55 @@ void TextEditWidget::insertNextType(TextNode* n, Qt::KeyboardModifiers modifiers
 
 TextNode* TextEditWidget::insertNode(TextNode* n, int codeStyle, TextStyleManager::LevelJump level) {
 
-	TextNode* inserted = nullptr;
+	TextNode* parent;
+	int pos;
+
+	if (!insertionTarget(n, level, parent, pos)) {
+		return nullptr;
+	}
+
+	beginEdit(tr("New block"));
+
+	TextNode* inserted = editInsertNodeBelow(parent, codeStyle, pos);
+
+	int exptexdLines = _styleManager->getStyleByCode(codeStyle)->expectedNodeNbTextLines();
+
+	if (inserted->nbTextLines() != exptexdLines) {
+		editNbTextLines(inserted, exptexdLines);
+	}
+
+	endEdit();
+
+	return inserted;
+}
+bool TextEditWidget::insertionTarget(TextNode* n, TextStyleManager::LevelJump level, TextNode*& parent, int& pos) const {
+
+	parent = nullptr;
+	pos = 0;
 
 	switch (level) {
 	case TextStyleManager::LevelJump::Below:
-		inserted = n->insertNodeBelow(codeStyle);
+		parent = n;
 		break;
 	case TextStyleManager::LevelJump::After:
-		inserted = n->insertNodeAfter(codeStyle);
+		parent = n->parentNode();
+		pos = n->nodeIndex()+1;
 		break;
 	case TextStyleManager::LevelJump::Above:
-		inserted = n->insertNodeAbove(codeStyle);
+		if (n->parentNode() != nullptr) {
+			parent = n->parentNode()->parentNode();
+			pos = n->parentNode()->nodeIndex()+1;
+		}
 		break;
 	case TextStyleManager::LevelJump::UnderRoot:
-		inserted = n->insertNodeSubRoot(codeStyle);
+		if (n->subRootNode() != nullptr) {
+			parent = n->subRootNode()->parentNode();
+			pos = n->subRootNode()->nodeIndex()+1;
+		}
 		break;
 	}
 
-	int exptexdLines = _styleManager->getStyleByCode(codeStyle)->expectedNodeNbTextLines();
-
-	if (inserted->nbTextLines() != exptexdLines) {
-		inserted->setNbTextLines(exptexdLines);
-	}
-
-	return inserted;
+	return parent != nullptr;
 }
 TextNode* TextEditWidget::setNodeStyleId(TextNode* n, int codeStyle) {
 
@@ -1028,17 +1260,17 @@ TextNode* TextEditWidget::setNodeStyleId(TextNode* n, int codeStyle) {
 		return n;
 	}
 
-	_currentScript->blockSignals(true);
+	beginEdit(tr("Change block style"));
 
 	if (parent != n->parentNode()) {
-		n->moveNode(parent, nodePos);
+		editMoveNode(n, parent, nodePos);
 	}
 
-	n->setStyleId(codeStyle);
-	n->setNbTextLines(newLinesN);
+	editNodeStyle(n, codeStyle);
+	editNbTextLines(n, newLinesN);
 
 	update();
-	_currentScript->blockSignals(false);
+	endEdit();
 
 	return n;
 }
@@ -1049,7 +1281,9 @@ void TextEditWidget::removeText() {
 		return;
 	}
 
-	TextLine* sl = _currentScript->getLineAtLine(_cursor->line());
+	beginEdit(tr("Delete"));
+
+	TextLine* sl = _cursor->currentLine();
 	int offset = (_cursor->extend() != 0) ? _cursor->extend() : -1;
 	int sPos = _cursor->pos();
 	int ePos;
@@ -1081,7 +1315,7 @@ void TextEditWidget::removeText() {
 		TextLine* tmp = l->nextLine();
 
 		if (l != sl and l != tl and (n == sN or n == tN)) {
-			l->setText(""); //empty the lines of non removable blocks;
+			editLineText(l, ""); //empty the lines of non removable blocks;
 		}
 
 		l = tmp;
@@ -1103,7 +1337,7 @@ void TextEditWidget::removeText() {
 
 	if (ePos == e.length()) {
 		if (sl != tl) {
-			tl->setText("");
+			editLineText(tl, "");
 
 			if (sN != tN and tN->lines().last() == tl) {
 				emptiedNodes.push_back(tN);
@@ -1112,26 +1346,28 @@ void TextEditWidget::removeText() {
 	} else if ((tN->lines().last() != tl or _nodeSupprBehavior == NodeSupprBehavior::KeepNonEmptyBlocks)
 			   and sl != tl) {
 
-		tl->setText(e.mid(ePos));
+		editLineText(tl, e.mid(ePos));
 
 	} else {
 
 		back = e.mid(ePos);
-		tl->setText("");
+		editLineText(tl, "");
 
 		if (tN != sN) {
 			emptiedNodes.push_back(tN);
 		}
 	}
 
-	sl->setText(front + back);
+	editLineText(sl, front + back);
 
-	_cursor->setLine(sl->lineLineNumber());
+	_cursor->setLine(lineNumber(sl));
 	_cursor->setPos(sPos);
 	for (TextNode* n : emptiedNodes) {
-		n->clearFromDoc();
+		editRemoveNode(n);
 	}
 
+	endEdit();
+
 }
 
 void TextEditWidget::copyTextToClipboard() const {
@@ -1144,15 +1380,8 @@ void TextEditWidget::copyTextToClipboard() const {
 
 	QClipboard *clipboard = QGuiApplication::clipboard();
 
-	QMimeData* data = new QMimeData();
-
-	data->setText(getTextInSelection());
-	data->setHtml(getHtmlInSelection());
-
-	QByteArray jsondata = getJsonInSelection().toJson();
-	data->setData(TextNode::TextNodeMimeTypeInfos::DocumentData, jsondata);
-
-	clipboard->setMimeData(data);
+	//the other formats are generated from the range only if another application asks for them.
+	clipboard->setMimeData(new TextDocumentMimeData(getJsonInSelection().object()));
 }
 void TextEditWidget::cutTextToClipboard() {
 
@@ -1190,7 +1419,11 @@ void TextEditWidget::pasteTextFromClipboard() {
 
 	if (data != nullptr) {
 
-		if (data->hasFormat(TextNode::TextNodeMimeTypeInfos::DocumentData)) {
+		const TextDocumentMimeData* docData = qobject_cast<const TextDocumentMimeData*>(data);
+
+		if (docData != nullptr) { //copied from the application, no need to go through the serialized data.
+			pasteDoc(docData->range());
+		} else if (data->hasFormat(TextNode::TextNodeMimeTypeInfos::DocumentData)) {
 			QByteArray jsonData = data->data(TextNode::TextNodeMimeTypeInfos::DocumentData);
 			pasteDoc(jsonData);
 		} else if (data->hasText()) {
@@ -1211,6 +1444,8 @@ void TextEditWidget::pasteTxt(QString const& txt) {
 
 	auto lines = txt.splitRef("\n", Qt::SkipEmptyParts);
 
+	beginEdit(tr("Paste"));
+
 	if (_cursor->extend() != 0) { //first clear the current selection (it is expected pasted text replace it).
 		removeText();
 	}
@@ -1218,17 +1453,18 @@ void TextEditWidget::pasteTxt(QString const& txt) {
 	int startLine = _cursor->line();
 	int startPos = _cursor->pos();
 
-	TextLine* line = _currentScript->getLineAtLine(startLine);
+	TextLine* line = lineAtLine(startLine);
 
 	QString remaining = line->getText().mid(startPos);
 	auto first = lines.takeFirst();
 
-	line->setText(line->getText().mid(0, startPos) + first);
+	editLineText(line, line->getText().mid(0, startPos) + first);
 
 	TextNode* initialNode = line->nodeParent();
 	TextNode* currentNode = initialNode;
 
 	if (currentNode == nullptr) {
+		endEdit();
 		return;
 	}
 
@@ -1263,24 +1499,34 @@ void TextEditWidget::pasteTxt(QString const& txt) {
 				}
 			}
 
-			currentNode = insertNode(currentNode, jump.code, jump.levelJump);
+			TextNode* inserted = stageNode(currentNode, jump.code, jump.levelJump);
+
+			if (inserted == nullptr) {
+				break;
+			}
+
+			currentNode = inserted;
 			line = currentNode->lineAt(0);
 		} else {
 			line = next;
 		}
 
-		line->setText(txtline.toString());
+		editLineText(line, txtline.toString());
 		move += txtline.length();
 	}
 
 	if (line != nullptr) {
 		if (!remaining.isEmpty()) {
-			line->setText(line->getText()+remaining); //add the remaining to the line
+			editLineText(line, line->getText()+remaining); //add the remaining to the line
 		}
 	}
 
+	flushPasteStage();
+
 	_cursor->move(move);
 
+	endEdit();
+
 }
 
 void TextEditWidget::pasteDoc(QByteArray const& docData) {
@@ -1300,7 +1546,13 @@ void TextEditWidget::pasteDoc(QByteArray const& docData) {
 		return;
 	}
 
-	QJsonObject obj = doc.object();
+	pasteDoc(doc.object());
+}
+void TextEditWidget::pasteDoc(QJsonObject const& obj) {
+
+	if (_currentScript == nullptr) {
+		return;
+	}
 
 	QJsonArray nodes;
 
@@ -1353,6 +1605,8 @@ void TextEditWidget::pasteDoc(QByteArray const& docData) {
 		}
 	}
 
+	beginEdit(tr("Paste"));
+
 	if (_cursor->extend() != 0) { //first clear the current selection (it is expected pasted text replace it).
 		removeText();
 	}
@@ -1361,7 +1615,7 @@ void TextEditWidget::pasteDoc(QByteArray const& docData) {
 	int startPos = _cursor->pos();
 	int writtenLines = 0;
 
-	TextLine* line = _currentScript->getLineAtLine(startLine);
+	TextLine* line = lineAtLine(startLine);
 
 	TextNode* n = line->nodeParent();
 	int lId = line->lineNodeIndexNumber();
@@ -1421,6 +1675,7 @@ void TextEditWidget::pasteDoc(QByteArray const& docData) {
 	TextNode* currentNode = initialNode;
 
 	if (currentNode == nullptr) {
+		endEdit();
 		return;
 	}
 
@@ -1438,13 +1693,17 @@ void TextEditWidget::pasteDoc(QByteArray const& docData) {
 
 		configureNodeFromJson(currentNode, obj, eraseStyle, (i == nodes.size()-1) ? linesAfter : QStringList());
 
+		if (currentNode == initialNode) {
+			flushPasteStage(); //the children of the initial node, so that they are counted below.
+		}
+
 		writtenLines += currentNode->maxLine();
 
 		if (i < nodes.size()-1) {
 
 			for (int i2 = i+1; i2 < nodes.size(); i2++) {
 
-				QJsonValue nodeValue = nodes.at(i);
+				QJsonValue nodeValue = nodes.at(i2);
 
 				if (nodeValue.isObject()) {
 					QJsonObject obj = nodeValue.toObject();
@@ -1455,6 +1714,10 @@ void TextEditWidget::pasteDoc(QByteArray const& docData) {
 						if (nJumps > 0) {
 							for (int j = 0; j < nJumps; j++) {
 								auto p = currentNode->parentNode();
+								if (p != nullptr and p == _pasteStage) { //climbing out of the staged nodes.
+									flushPasteStage();
+									p = currentNode->parentNode();
+								}
 								if (p == nullptr) {
 									break;
 								}
@@ -1469,7 +1732,7 @@ void TextEditWidget::pasteDoc(QByteArray const& docData) {
 			}
 
 
-			TextNode* next = currentNode->insertNodeAfter(currentNode->styleId());
+			TextNode* next = stageNodeBelow(currentNode->parentNode(), currentNode->styleId(), currentNode->nodeIndex()+1);
 
 			if (next != nullptr) {
 				currentNode = next;
@@ -1479,8 +1742,10 @@ void TextEditWidget::pasteDoc(QByteArray const& docData) {
 		}
 	}
 
+	flushPasteStage();
+
 	int finalLine = startLine + writtenLines;
-	TextLine* fline = _currentScript->getLineAtLine(finalLine);
+	TextLine* fline = lineAtLine(finalLine);
 
 	int finalPos = fline->getText().length() - remaining.length();
 	if (finalPos < 0) {
@@ -1489,6 +1754,8 @@ void TextEditWidget::pasteDoc(QByteArray const& docData) {
 
 	_cursor->setState(Cursor::CursorPos(finalLine, finalPos));
 
+	endEdit();
+
 }
 
 
@@ -1519,7 +1786,7 @@ TextNode* TextEditWidget::configureNodeFromJson(TextNode* currentNode, QJsonObje
 
 	int expectedLines = _styleManager->getStyleByCode(styleCode)->expectedNodeNbTextLines();
 	if (expectedLines > currentNode->lines().size()) {
-		currentNode->setNbTextLines(expectedLines); //ensure the node will not be brocken up at that stage.
+		editNbTextLines(currentNode, expectedLines); //ensure the node will not be brocken up at that stage.
 	}
 	setNodeStyleId(currentNode, styleCode);
 
@@ -1570,7 +1837,7 @@ TextNode* TextEditWidget::configureNodeFromJson(TextNode* currentNode, QJsonObje
 		int subCode = _styleManager->defaultFollowingStyle(currentNode->styleId())
 					.value(TextStyleManager::LevelJump::Below, TextStyleManager::SpecialNodeStyles::NOSTYLE);
 
-		TextNode* target = currentNode->insertNodeBelow();
+		TextNode* target = stageNodeBelow(currentNode, 0, 0);
 
 		for (int i = 0; i < childrenArray.size(); i++) {
 
@@ -1579,7 +1846,7 @@ TextNode* TextEditWidget::configureNodeFromJson(TextNode* currentNode, QJsonObje
 			configureNodeFromJson(target, val.toObject(), true, (i == childrenArray.size()-1) ? lastLines: QStringList());
 
 			if (i < childrenArray.size()-1) {
-				TextNode* next = target->insertNodeAfter(subCode);
+				TextNode* next = stageNodeBelow(target->parentNode(), subCode, target->nodeIndex()+1);
 
 				if (next != nullptr) {
 					target = next;
@@ -1598,13 +1865,415 @@ TextNode* TextEditWidget::configureNodeFromJson(TextNode* currentNode, QJsonObje
 TextNode* TextEditWidget::setLinesInTextNode(TextNode* node, QStringList const& lines) {
 
 	for (int i = 0; i < std::min(node->lines().size(), lines.size()); i++) {
-		node->lines()[i]->setText(lines[i]);
+		editLineText(node->lines()[i], lines[i]);
 	}
 
 	return node;
 
 }
 
+TextNode* TextEditWidget::stageNodeBelow(TextNode* parent, int styleCode, int pos) {
+
+	if (parent == nullptr) {
+		return nullptr;
+	}
+
+	if (isStaged(parent)) {
+		return parent->insertNodeBelow(styleCode, pos);
+	}
+
+	int row = (pos < 0) ? parent->nbChildren() + 1 + pos : pos;
+
+	if (_pasteStage != nullptr and
+			(_pasteStageParent != parent or _pasteStageRow + _pasteStage->nbChildren() != row)) {
+		flushPasteStage(); //the node does not follow the staged ones.
+	}
+
+	if (_pasteStage == nullptr) {
+		_pasteStage = new TextNode(nullptr);
+		_pasteStage->setStyleId(parent->styleId()); //the stage stands for the parent when checking the styles.
+		_pasteStageParent = parent;
+		_pasteStageRow = row;
+	}
+
+	return _pasteStage->insertNodeBelow(styleCode, -1);
+}
+TextNode* TextEditWidget::stageNode(TextNode* n, int codeStyle, TextStyleManager::LevelJump level) {
+
+	TextNode* parent;
+	int pos;
+
+	if (isStaged(n)) {
+		//the target might be outside of the staged nodes, then they need to be in the document first.
+		if (level == TextStyleManager::LevelJump::UnderRoot or !insertionTarget(n, level, parent, pos)) {
+			flushPasteStage();
+		}
+	}
+
+	if (!insertionTarget(n, level, parent, pos)) {
+		return nullptr;
+	}
+
+	TextNode* inserted = stageNodeBelow(parent, codeStyle, pos);
+
+	if (inserted == nullptr) {
+		return nullptr;
+	}
+
+	int exptexdLines = _styleManager->getStyleByCode(codeStyle)->expectedNodeNbTextLines();
+
+	if (inserted->nbTextLines() != exptexdLines) {
+		editNbTextLines(inserted, exptexdLines);
+	}
+
+	return inserted;
+}
+void TextEditWidget::flushPasteStage() {
+
+	if (_pasteStage == nullptr) {
+		return;
+	}
+
+	TextNode* stage = _pasteStage;
+	_pasteStage = nullptr;
+
+	QList<TextNode*> nodes = stage->takeChildNodes();
+	delete stage;
+
+	if (nodes.isEmpty()) {
+		return;
+	}
+
+	QVector<TextNode::NodeSnapshot> snapshots;
+	snapshots.reserve(nodes.size());
+
+	for (TextNode* n : nodes) {
+		snapshots.push_back(n->snapshot());
+	}
+
+	if (!_pasteStageParent->adoptNodes(nodes, _pasteStageRow)) {
+		qDeleteAll(nodes);
+		return;
+	}
+
+	recordCommand(new NodeInsertionCommand(_currentScript, _pasteStageParent, _pasteStageRow, snapshots, true));
+}
+bool TextEditWidget::isStaged(TextNode* n) const {
+	return _pasteStage != nullptr and n != nullptr and n->rootNode() == _pasteStage;
+}
+bool TextEditWidget::isInDocument(TextNode* n) const {
+	return _currentScript != nullptr and n != nullptr and n->rootNode() == _currentScript;
+}
+
+void TextEditWidget::beginEdit(QString const& text) {
+
+	if (_editGroupDepth == 0) {
+		_editGroup = new TextEditGroupCommand(_currentScript, text);
+		_editGroup->setCursorStates(cursorState(), TextEditCommand::CursorState());
+	}
+
+	_editGroupDepth++;
+}
+void TextEditWidget::endEdit() {
+
+	if (_editGroupDepth <= 0) {
+		return;
+	}
+
+	_editGroupDepth--;
+
+	if (_editGroupDepth > 0) {
+		return;
+	}
+
+	TextEditGroupCommand* group = _editGroup;
+	_editGroup = nullptr;
+
+	if (group->commandsCount() == 0) {
+		delete group;
+		return;
+	}
+
+	TextEditCommand::CursorState before = group->cursorBefore();
+	TextEditCommand::CursorState after = cursorState();
+
+	TextEditCommand* command = group->takeSingleCommand(); //single commands are pushed directly, so that they can be merged.
+
+	if (command != nullptr) {
+		command->setText(group->text());
+		delete group;
+	} else {
+		command = group;
+	}
+
+	command->setCursorStates(before, after);
+	_history->push(command);
+}
+void TextEditWidget::recordCommand(TextEditCommand* command) {
+
+	if (_editGroup == nullptr) { //edit done outside of beginEdit and endEdit, the cursor cannot be restored.
+		_history->push(command);
+		return;
+	}
+
+	_editGroup->addCommand(command);
+}
+
+TextEditCommand::CursorState TextEditWidget::cursorState() const {
+	return TextEditCommand::CursorState(_cursor->line(), _cursor->pos(), _cursor->extend());
+}
+void TextEditWidget::restoreCursorState(TextEditCommand::CursorState const& state) {
+
+	if (!state.isValid()) {
+		return;
+	}
+
+	_cursor->setState(Cursor::CursorPos(state.line, state.pos));
+
+	if (state.extend != 0) {
+		_cursor->setExtent(state.extend);
+	}
+
+	scrollToLine(_cursor->line());
+}
+
+void TextEditWidget::editLineText(TextLine* line, QString const& text) {
+
+	QString old = line->getText();
+
+	if (old == text) {
+		return;
+	}
+
+	if (isInDocument(line->nodeParent())) {
+		recordCommand(new LineTextCommand(_currentScript, line, old, text));
+	}
+	line->setText(text);
+}
+TextNode* TextEditWidget::editInsertNodeBelow(TextNode* parent, int styleCode, int pos) {
+
+	if (parent == nullptr) {
+		return nullptr;
+	}
+
+	TextNode* n = parent->insertNodeBelow(styleCode, pos);
+
+	if (isInDocument(parent)) {
+		recordCommand(new NodeInsertionCommand(_currentScript, parent, n->nodeIndex(), {n->snapshot()}, true));
+	}
+
+	return n;
+}
+bool TextEditWidget::editRemoveNode(TextNode* n) {
+
+	TextNode* parent = n->parentNode();
+
+	if (parent == nullptr) {
+		return false;
+	}
+
+	if (isInDocument(parent)) {
+		recordCommand(new NodeInsertionCommand(_currentScript, parent, n->nodeIndex(), {n->snapshot()}, false));
+	}
+
+	return n->clearFromDoc();
+}
+TextNode* TextEditWidget::editMoveNode(TextNode* n, TextNode* newParent, int newPos) {
+
+	if (newParent == nullptr or n->parentNode() == nullptr) {
+		return nullptr;
+	}
+
+	int pos = (newPos < 0) ? newParent->nbChildren() + 1 + newPos : newPos; //same convention as TextNode::insertNodeBelow.
+
+	if (!isInDocument(n)) {
+		return n->moveNode(newParent, pos);
+	}
+
+	QVector<int> pathBefore = n->nodePath();
+	QVector<int> newParentPathBefore = newParent->nodePath();
+	TextNode* oldParent = n->parentNode();
+	int oldRow = n->nodeIndex();
+
+	if (n->moveNode(newParent, pos) == nullptr) {
+		return nullptr;
+	}
+
+	recordCommand(new NodeMoveCommand(_currentScript, pathBefore, newParentPathBefore, pos, n->nodePath(), oldParent->nodePath(), oldRow));
+
+	return n;
+}
+void TextEditWidget::editNodeStyle(TextNode* n, int styleCode) {
+
+	if (n->styleId() == styleCode) {
+		return;
+	}
+
+	if (isInDocument(n)) {
+		recordCommand(new NodeStyleCommand(_currentScript, n, n->styleId(), styleCode));
+	}
+	n->setStyleId(styleCode);
+}
+void TextEditWidget::editNbTextLines(TextNode* n, int nbLines) {
+
+	if (nbLines < 1 or nbLines == n->nbTextLines()) {
+		return;
+	}
+
+	if (isInDocument(n)) {
+		recordCommand(new NodeLinesCountCommand(_currentScript, n, nbLines));
+	}
+	n->setNbTextLines(nbLines);
+}
+
+TextEditHistory* TextEditWidget::history() const {
+	return _history;
+}
+void TextEditWidget::undo() {
+
+	if (!_history->canUndo()) {
+		return;
+	}
+
+	TextEditCommand::CursorState state = _history->undoCommand()->cursorBefore();
+
+	_history->undo();
+
+	restoreCursorState(state);
+	update();
+}
+void TextEditWidget::redo() {
+
+	if (!_history->canRedo()) {
+		return;
+	}
+
+	TextEditCommand::CursorState state = _history->redoCommand()->cursorAfter();
+
+	_history->redo();
+
+	restoreCursorState(state);
+	update();
+}
+
+TextLayoutIndex* TextEditWidget::layoutIndex() const {
+	return _layoutIndex;
+}
+int TextEditWidget::viewportTop() {
+
+	if (_currentScript == nullptr or _baseIndex == nullptr) {
+		return 0;
+	}
+
+	return _layoutIndex->nodeTop(_baseIndex) + _baseIndexHeightDelta;
+}
+void TextEditWidget::setViewportTop(int y) {
+
+	if (_currentScript == nullptr) {
+		return;
+	}
+
+	_scroller->stop();
+
+	int top;
+	TextNode* n = _layoutIndex->nodeAtHeight(std::max(0, std::min(y, _layoutIndex->totalHeight()-1)), &top);
+
+	if (n == nullptr) {
+		return;
+	}
+
+	_baseIndex = n;
+	_baseIndexHeightDelta = std::max(0, std::min(y - top, nodeHeight(n)-1)); //the height of the node might have been an estimation.
+	_baseIndexLine = _layoutIndex->nodeFirstLine(_baseIndex);
+
+	Q_EMIT viewportChanged();
+	update();
+}
+
+TextLineDecorator* TextEditWidget::lineDecorator() const {
+	return _lineDecorator;
+}
+void TextEditWidget::setLineDecorator(TextLineDecorator* decorator) {
+	_lineDecorator = decorator;
+	update();
+}
+
+TextSearchEngine* TextEditWidget::searchEngine() const {
+	return _searchEngine;
+}
+bool TextEditWidget::findNext() {
+
+	if (_currentScript == nullptr or _searchEngine->matchCount() == 0) {
+		return false;
+	}
+
+	int after = _cursor->pos() + ((_cursor->extend() != 0) ? 1 : 0); //do not select the current match again.
+	int id = _searchEngine->matchIndexAfter(_cursor->line(), after);
+
+	if (id < 0) {
+		id = 0;
+	}
+
+	TextSearchEngine::Match const& match = _searchEngine->matches()[id];
+
+	_cursor->setState(Cursor::CursorPos(match.lineNumber, match.pos));
+	_cursor->setExtent(match.length);
+
+	scrollToLine(match.lineNumber);
+	update();
+
+	return true;
+}
+bool TextEditWidget::findPrevious() {
+
+	if (_currentScript == nullptr or _searchEngine->matchCount() == 0) {
+		return false;
+	}
+
+	int id = _searchEngine->matchIndexBefore(_cursor->line(), _cursor->pos());
+
+	if (id < 0) {
+		id = _searchEngine->matchCount()-1;
+	}
+
+	TextSearchEngine::Match const& match = _searchEngine->matches()[id];
+
+	_cursor->setState(Cursor::CursorPos(match.lineNumber, match.pos));
+	_cursor->setExtent(match.length);
+
+	scrollToLine(match.lineNumber);
+	update();
+
+	return true;
+}
+int TextEditWidget::replaceAll(QString const& replacement) {
+
+	if (_currentScript == nullptr) {
+		return 0;
+	}
+
+	const QVector<TextSearchEngine::LineReplacement> replacements = _searchEngine->replacements(replacement);
+
+	if (replacements.isEmpty()) {
+		return 0;
+	}
+
+	beginEdit(tr("Replace all"));
+
+	_cursor->clearSelection(); //the selected match might not exist anymore.
+
+	for (TextSearchEngine::LineReplacement const& r : replacements) {
+		editLineText(r.line, r.text);
+	}
+
+	_cursor->setPos(_cursor->pos()); //constrain the cursor in its line, which might be shorter.
+
+	endEdit();
+	update();
+
+	return replacements.size();
+}
+
 TextEditWidget::NodeSupprBehavior TextEditWidget::getNodeSupprBehavior() const
 {
     return _nodeSupprBehavior;
@@ -1620,7 +2289,7 @@ QString TextEditWidget::getTextInSelection() const {
 
 	Cursor::CursorState extended = _cursor->getExtendedSelectionState();
 
-	TextLine* line = _currentScript->getLineAtLine(extended.line);
+	TextLine* line = lineAtLine(extended.line);
 
 	if (line == nullptr) {
 		return txt;
@@ -1634,7 +2303,7 @@ QString TextEditWidget::getTextInSelection() const {
 		return txt;
 	}
 
-	int nLines = end->lineLineNumber() - line->lineLineNumber();
+	int nLines = lineNumber(end) - lineNumber(line);
 
 	txt.reserve(extended.extend + nLines + 1);
 
@@ -1666,7 +2335,7 @@ QString TextEditWidget::getHtmlInSelection() const {
 
 	Cursor::CursorState extended = _cursor->getExtendedSelectionState();
 
-	TextLine* line = _currentScript->getLineAtLine(extended.line);
+	TextLine* line = lineAtLine(extended.line);
 
 	if (line == nullptr) {
 		return txt;
@@ -1681,7 +2350,7 @@ QString TextEditWidget::getHtmlInSelection() const {
 	}
 
 	TextNode::NodeCoordinate startCoord(extended.line, extended.pos);
-	TextNode::NodeCoordinate endCoord(end->lineLineNumber(), endPos);
+	TextNode::NodeCoordinate endCoord(lineNumber(end), endPos);
 	QMap<int, QString> styleName = _styleManager->getStyleMapNames();
 
 	return _currentScript->getHtmlRepresentation(startCoord, endCoord, styleName);
@@ -1710,6 +2379,7 @@ TextEditWidget::Cursor::Cursor(TextEditWidget* widget,
                                int pos,
                                int extend) :
 	_widget(widget),
+	_anchor(nullptr),
 	_line(line),
 	_pos(pos),
 	_extend(extend)
@@ -1719,6 +2389,7 @@ TextEditWidget::Cursor::Cursor(TextEditWidget* widget,
 }
 
 int TextEditWidget::Cursor::line() const {
+	resolveAnchor();
 	return _line;
 }
 int TextEditWidget::Cursor::pos() const {
@@ -1728,8 +2399,13 @@ int TextEditWidget::Cursor::extend() const {
 	return _extend;
 }
 
+TextLine* TextEditWidget::Cursor::currentLine() const {
+	resolveAnchor();
+	return _anchor;
+}
+
 TextNode::NodeCoordinate TextEditWidget::Cursor::currentCoordinate() const {
-	return {_line, _pos};
+	return {line(), _pos};
 }
 
 TextEditWidget::Cursor::DecomposedCursorPos TextEditWidget::Cursor::decomposePos(TextLine* currentLine) {
@@ -1759,10 +2435,10 @@ TextEditWidget::Cursor::DecomposedCursorPos TextEditWidget::Cursor::decomposePos
 	QTextLine subLine = s->lineLayout(currentLine).lineForTextPosition(_pos + s->getPrefix(currentLine).length());
 
 	if (!subLine.isValid()) {
-		return {_line, 0, 0};
+		return {line(), 0, 0};
 	}
 
-	return {_line, subLine.lineNumber(), _pos - subLine.textStart() + ((subLine.textStart() > 0) ? s->getPrefix(currentLine).length() : 0) };
+	return {line(), subLine.lineNumber(), _pos - subLine.textStart() + ((subLine.textStart() > 0) ? s->getPrefix(currentLine).length() : 0) };
 }
 
 TextEditWidget::Cursor::CursorPos TextEditWidget::Cursor::composePos(TextLine* currentLine, DecomposedCursorPos decomposed) {
@@ -1798,19 +2474,25 @@ TextEditWidget::Cursor::CursorPos TextEditWidget::Cursor::composePos(TextLine* c
 
 TextEditWidget::Cursor::CursorState TextEditWidget::Cursor::getPositiveExtendState() {
 
+	int l = line();
+
 	if (_extend >= 0) {
-		return {_line, _pos, _extend};
+		return {l, _pos, _extend};
+	}
+
+	if (-_extend <= _pos) { //the selection starts on the current line.
+		return {l, _pos + _extend, -_extend};
 	}
 
 	TextNode::NodeCoordinate newCord = _widget->_currentScript->getCoordinateAfterOffset(
-				TextNode::NodeCoordinate(_line, _pos),
+				TextNode::NodeCoordinate(l, _pos),
 				_extend);
 
 	if (newCord.isValid()) {
 		return {newCord.lineIndex, newCord.linePos, -_extend};
 	}
 
-	TextLine* tl = _widget->_currentScript->getLineAtLine(_line);
+	TextLine* tl = currentLine();
 
 	if (tl != nullptr) {
 		return {0,0,tl->nCharsBefore()+_pos};
@@ -1831,7 +2513,7 @@ TextEditWidget::Cursor::CursorState TextEditWidget::Cursor::getExtendedSelection
 			sMode == SelectionMode::FullMultiNodesWithChild or
 			sMode == SelectionMode::FullLeveldMultiNodes) {
 
-			TextLine* tl = _widget->_currentScript->getLineAtLine(state.line);
+			TextLine* tl = _widget->lineAtLine(state.line);
 
 			int linePos = tl->lineNodeIndexNumber();
 
@@ -1846,7 +2528,7 @@ TextEditWidget::Cursor::CursorState TextEditWidget::Cursor::getExtendedSelection
 			TextNode::NodeCoordinate source(state.line, state.pos);
 			TextNode::NodeCoordinate offseted = _widget->_currentScript->getCoordinateAfterOffset(source, state.extend);
 
-			TextLine* fl = _widget->_currentScript->getLineAtLine(offseted.lineIndex);
+			TextLine* fl = _widget->lineAtLine(offseted.lineIndex);
 			state.extend += fl->nCharsAfterInNode() + fl->getText().length() - offseted.linePos;
 
 			if (sMode == SelectionMode::FullMultiNodesWithChild) {
@@ -1877,10 +2559,11 @@ TextEditWidget::Cursor::CursorState TextEditWidget::Cursor::getExtendedSelection
 void TextEditWidget::Cursor::reset() {
 	_line = 0;
 	_pos = 0;
+	constrainLine();
 	Q_EMIT _widget->currentLineChanged(0);
 }
 void TextEditWidget::Cursor::move(int offset) {
-	int oldLine = _line;
+	int oldLine = line();
 	_pos = _pos + offset;
 	constrainPos();
 	clearSelection();
@@ -1890,7 +2573,7 @@ void TextEditWidget::Cursor::move(int offset) {
 	}
 }
 void TextEditWidget::Cursor::jumpLines(int offset) {
-	int oldLine = _line;
+	int oldLine = line();
 	_line += offset;
 	constrainLine();
 	constrainPosOnLine();
@@ -1901,7 +2584,7 @@ void TextEditWidget::Cursor::jumpLines(int offset) {
 	}
 }
 void TextEditWidget::Cursor::setLine(int line) {
-	int oldLine = _line;
+	int oldLine = this->line();
 	_line = line;
 	constrainLine();
 	constrainPosOnLine();
@@ -1916,14 +2599,14 @@ void TextEditWidget::Cursor::setPos(int pos) {
 	constrainPosOnLine();
 }
 void TextEditWidget::Cursor::setState(CursorPos state) {
-	int oldLine = _line;
+	int oldLine = line();
 	_pos = state.pos;
 	_line = state.line;
 	constrainLine();
 	constrainPosOnLine();
 	clearSelection();
 
-	if (state.line != oldLine) {
+	if (_line != oldLine) {
 		Q_EMIT _widget->currentLineChanged(_line);
 	}
 }
@@ -1937,14 +2620,22 @@ void TextEditWidget::Cursor::setExtent(int extend) {
 		return;
 	}
 
-	TextLine* tl = _widget->_currentScript->getLineAtLine(_line);
+	TextLine* tl = currentLine();
 
 	if (tl == nullptr) {
 		return;
 	}
 
+	int lLen = tl->nChars();
+
+	if ((extend < 0 and -extend <= _pos) or (extend >= 0 and extend <= lLen - _pos)) {
+		_extend = extend; //the selection stays on the current line, no need to look at the rest of the document.
+		constrainExtend();
+		return;
+	}
+
 	int textPos = tl->nCharsBefore() + _pos + _line;
-	int remainingText = tl->nChars() - _pos + tl->nCharsAfter() + _widget->_currentScript->maxLine() - _line - 1;
+	int remainingText = lLen - _pos + tl->nCharsAfter() + _widget->_layoutIndex->lineCount() - _line - 1;
 
 	if (extend < 0) {
 		_extend = std::max(extend, -textPos);
@@ -1970,7 +2661,11 @@ void TextEditWidget::Cursor::limitExtendToLine() {
 		return;
 	}
 
-	TextLine* tl = _widget->_currentScript->getLineAtLine(_line);
+	TextLine* tl = currentLine();
+
+	if (tl == nullptr) {
+		return;
+	}
 
 	int lLen = tl->nChars();
 
@@ -1987,7 +2682,12 @@ void TextEditWidget::Cursor::limitExtendToNode() {
 		return;
 	}
 
-	TextLine* tl = _widget->_currentScript->getLineAtLine(_line);
+	TextLine* tl = currentLine();
+
+	if (tl == nullptr) {
+		return;
+	}
+
 	TextNode* tn = tl->nodeParent();
 
 	int lLen = tn->nCharsInNode();
@@ -2004,14 +2704,16 @@ void TextEditWidget::Cursor::limitExtendToNode() {
 
 int TextEditWidget::Cursor::charDistance(CursorPos target) {
 
-	if (target.line == _line) {
+	int l = line();
+
+	if (target.line == l) {
 		return target.pos - _pos;
 	}
 
-	int d = target.line - _line;
+	int d = target.line - l;
 	int dir = (d < 0) ? -1 : 1;
 
-	TextLine* sl = _widget->getCurrentNode()->getLineAtLine(_line);
+	TextLine* sl = currentLine();
 
 	int dist = 0;
 
@@ -2046,8 +2748,31 @@ int TextEditWidget::Cursor::charDistance(CursorPos target) {
 
 }
 
-void TextEditWidget::Cursor::constrainLine() {
+void TextEditWidget::Cursor::resolveAnchor() const {
+
+	if (!_anchor.isNull()) {
+
+		int l = _widget->lineNumber(_anchor);
+
+		if (l >= 0) {
+			_line = l;
+			return;
+		}
+	}
+
+	constrainLine(); //the line has been removed, the cursor stays at the same line number.
+}
+void TextEditWidget::Cursor::constrainLine() const {
+
 	if (_widget->_currentScript == nullptr) {
+		_anchor = nullptr;
+		return;
+	}
+
+	int maxLine = _widget->_layoutIndex->lineCount();
+
+	if (maxLine <= 0) {
+		_anchor = nullptr;
 		return;
 	}
 
@@ -2055,10 +2780,11 @@ void TextEditWidget::Cursor::constrainLine() {
 		_line = 0;
 	}
 
-	int maxLine = _widget->_currentScript->maxLine();
 	if (_line >= maxLine) {
 		_line = maxLine-1;
 	}
+
+	_anchor = _widget->lineAtLine(_line);
 }
 void TextEditWidget::Cursor::constrainPos() {
 
@@ -2066,7 +2792,7 @@ void TextEditWidget::Cursor::constrainPos() {
 		return;
 	}
 
-	TextLine* tl = _widget->_currentScript->getLineAtLine(_line);
+	TextLine* tl = currentLine();
 
 	if (tl == nullptr) {
 		return;
@@ -2074,70 +2800,46 @@ void TextEditWidget::Cursor::constrainPos() {
 
 	int len = tl->getText().length();
 
-	if (len < 0) {
-		_pos = 0;
-		return;
-	}
-
-	if (_pos < 0) {
-		while (_pos < 0) {
-			if (_line > 0) {
-				_line--;
-
-				tl =  tl->previousLine();
-
-				if (tl == nullptr) {
-					_pos = 0;
-					return;
-				}
+	//the cursor moves relatively to its line, following the lines chain.
+	while (_pos < 0) {
 
-				len = tl->getText().length();
-				if (len < 0) {
-					_pos = 0;
-					return;
-				}
+		TextLine* prev = tl->previousLine();
 
-				_pos += len+1;
-			} else {
-				_pos = 0;
-			}
+		if (prev == nullptr) {
+			_pos = 0;
+			break;
 		}
-	}
-
-	if (_pos > len) {
 
-		int nLines  = _widget->_currentScript->maxLine();
+		tl = prev;
+		_line--;
+		len = tl->getText().length();
+		_pos += len+1;
+	}
 
-		while(_pos > len) {
-			if (_line < nLines-1) {
-				_pos -= len+1;
-				_line++;
+	while (_pos > len) {
 
-				tl =  tl->nextLine();
+		TextLine* next = tl->nextLine();
 
-				if (tl == nullptr) {
-					_pos = 0;
-					return;
-				}
-
-				len = tl->getText().length();
-				if (len < 0) {
-					_pos = 0;
-					return;
-				}
-			} else {
-				_pos = len;
-			}
+		if (next == nullptr) {
+			_pos = len;
+			break;
 		}
+
+		_pos -= len+1;
+		tl = next;
+		_line++;
+		len = tl->getText().length();
 	}
 
+	_anchor = tl;
+
 }
 void TextEditWidget::Cursor::constrainPosOnLine() {
 	if (_widget->_currentScript == nullptr) {
 		return;
 	}
 
-	TextLine* tl = _widget->_currentScript->getLineAtLine(_line);
+	TextLine* tl = currentLine();
 
 	if (tl == nullptr) {
 		return;
@@ -2145,12 +2847,6 @@ void TextEditWidget::Cursor::constrainPosOnLine() {
 
 	int len = tl->getText().length();
 
-	if (len < 0) {
-		_pos = 0;
-		return;
-	}
-
-
 	if (_pos < 0) {
 		_pos = 0;
 	}
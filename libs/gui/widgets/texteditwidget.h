@@ -24,9 +24,19 @@ along with this program.  If not, see <https://www.gnu.org/licenses/>.
 #include "text/textnode.h"
 #include "text/abstracttextstyle.h"
 #include "text/textstylemanager.h"
+#include "text/textlayoutindex.h"
+#include "text/textsearchengine.h"
+
+#include "texteditcommands.h"
+
+#include <QHash>
+#include <QPointer>
+
 
 namespace Sabrina {
 
+class KineticScroller;
+
 class TextEditWidget : public QWidget
 {
 	Q_OBJECT
@@ -78,9 +88,35 @@ public:
 	QString getHtmlInSelection() const;
 	QJsonDocument getJsonInSelection() const;
 
+	//! \brief the stack of the edits of the current script, it is cleared when the script changes.
+	TextEditHistory* history() const;
+	void undo();
+	void redo();
+
+	//! \brief the heights and order of the nodes of the current script, kept up to date with the document.
+	TextLayoutIndex* layoutIndex() const;
+	//! \brief the vertical position in the document of the top of the viewport.
+	int viewportTop();
+	//! \brief scroll directly to a vertical position in the document, in O(log n) whatever the distance.
+	void setViewportTop(int y);
+
+	TextLineDecorator* lineDecorator() const;
+	//! \brief set the formats drawn over the lines (for example by a spell checker), the widget does not take the ownership.
+	void setLineDecorator(TextLineDecorator* decorator);
+
+	//! \brief the engine searching the current script, its query is set by the find interface.
+	TextSearchEngine* searchEngine() const;
+	//! \brief select the first match after the cursor, continuing from the start of the document, false if nothing match.
+	bool findNext();
+	//! \brief select the last match before the cursor, continuing from the end of the document, false if nothing match.
+	bool findPrevious();
+	//! \brief replace all the matches of the search engine query in a single edit, return the number of lines changed.
+	int replaceAll(QString const& replacement);
+
 Q_SIGNALS:
 
 	void currentLineChanged(int line);
+	void viewportChanged();
 
 protected:
 
@@ -124,6 +160,9 @@ protected:
 		int pos() const;
 		int extend() const;
 
+		//! \brief the line the cursor is on. The cursor is anchored on that line and follows it when the document is edited elsewhere.
+		TextLine* currentLine() const;
+
 		TextNode::NodeCoordinate currentCoordinate() const;
 
 		DecomposedCursorPos decomposePos(TextLine* currentLine);
@@ -151,25 +190,58 @@ protected:
 
 	private:
 
-		void constrainLine();
+		//! \brief update the line number from the anchor, or anchor the cursor again if its line has been removed.
+		void resolveAnchor() const;
+
+		void constrainLine() const;
 		void constrainPos();
 		void constrainPosOnLine();
 
 		TextEditWidget* _widget;
 
-		int _line;
+		mutable QPointer<TextLine> _anchor;
+		mutable int _line; //line number of the anchor, at the last time it has been resolved.
 		int _pos;
 		int _extend;
 	};
 
+	/*!
+	 * \brief The ResolvedSelection struct store the selection endpoints as nodes positions in the layout index and coordinates in those nodes.
+	 *
+	 * It is computed once per change of the cursor or of the document, then testing if a node is selected is a comparison of positions.
+	 */
+	struct ResolvedSelection {
+		ResolvedSelection() : valid(false), line(0), pos(0), extend(0), mode(SelectionMode::Text), startNode(-1), endNode(-1) {}
+		bool valid;
+		int line; //cursor state the selection has been resolved for.
+		int pos;
+		int extend;
+		SelectionMode mode;
+		Cursor::CursorState state;
+		int startNode;
+		int endNode;
+		TextNode::NodeCoordinate startCoord; //line index relative to the start node.
+		TextNode::NodeCoordinate endCoord; //line index relative to the end node.
+	};
+
+	ResolvedSelection const& resolvedSelection();
+	void invalidateResolvedSelection();
+
 	void paintEvent(QPaintEvent *event) override;
+	void resizeEvent(QResizeEvent *event) override;
 	void keyPressEvent(QKeyEvent *event) override;
 	void inputMethodEvent(QInputMethodEvent *event) override;
 	void wheelEvent(QWheelEvent *event) override;
 	void mousePressEvent(QMouseEvent *event) override;
 	void mouseMoveEvent(QMouseEvent *event) override;
 
+	//! \brief the line at a given line number in the document, found using the layout index.
+	TextLine* lineAtLine(int line) const;
+	//! \brief the line number of a line in the document, -1 if the line is not part of the document.
+	int lineNumber(TextLine* line) const;
+
 	int nodeHeight(TextNode* n);
+	void onNodeRelaidOut(TextNode* n, int heightDelta);
 	int scroolableUpDistance(int maxScroll);
 	AbstractTextNodeStyle* nodeStyle(TextNode* n);
 
@@ -180,6 +252,10 @@ protected:
 	TextLine* lineAtPos(QPoint const& pos, int *cursorPos = nullptr);
 
 	void scroll (int offset);
+	//! \brief apply the scroll of a frame of the kinetic scroller, at most one per frame whatever the number of wheel events.
+	void onScrollStep(int pixels);
+	//! \brief measure the nodes the next frames will scroll to, up to a viewport away and within the layout budget of a frame.
+	void layOutAhead();
 	void scrollToLine (int l);
 	void scrollToLine (int l, int subL);
 	Cursor::CursorPos computeNewPosAfterJump(int nbPseudoLinesJump);
@@ -187,6 +263,8 @@ protected:
 	void insertText(QString commited);
 	void insertNextType(TextNode* n, Qt::KeyboardModifiers modifiers);
 	TextNode* insertNode(TextNode* n, int codeStyle, TextStyleManager::LevelJump level);
+	//! \brief the parent and the position in the parent of a node inserted from n with the given level jump.
+	bool insertionTarget(TextNode* n, TextStyleManager::LevelJump level, TextNode*& parent, int& pos) const;
 	TextNode* setNodeStyleId(TextNode* n, int codeStyle);
 	void removeText();
 
@@ -196,13 +274,60 @@ protected:
 	void pasteTextFromClipboard();
 	void pasteTxt(QString const& txt);
 	void pasteDoc(QByteArray const& docData);
+	void pasteDoc(QJsonObject const& obj);
 
 	TextNode* configureNodeFromJson(TextNode* currentNode, QJsonObject const& obj, bool eraseStyle = true, QStringList lastLines = {});
 	TextNode* setLinesInTextNode(TextNode* node, QStringList const& lines);
 
+	/*!
+	 * \brief stageNodeBelow insert a node for a paste operation.
+	 *
+	 * When parent is part of the document, the node is built in a detached staging node instead,
+	 * consecutive nodes staged for the same place are then spliced in the document at once by flushPasteStage,
+	 * with a single notification and a single relayout, whatever the number of nodes.
+	 * When parent is itself staged the node is inserted directly, as nobody observes the staged nodes.
+	 */
+	TextNode* stageNodeBelow(TextNode* parent, int styleCode, int pos);
+	//! \brief same as insertNode, but through stageNodeBelow.
+	TextNode* stageNode(TextNode* n, int codeStyle, TextStyleManager::LevelJump level);
+	//! \brief splice the staged nodes in the document and record their insertion.
+	void flushPasteStage();
+	bool isStaged(TextNode* n) const;
+	//! \brief if the node is part of the current document, changes to detached nodes are not recorded in the history.
+	bool isInDocument(TextNode* n) const;
+
+	/*!
+	 * \brief beginEdit start a compound edit, all the changes recorded until the matching call to endEdit are undone in a single step.
+	 *
+	 * Calls can be nested, only the outermost pair of calls delimit the edit.
+	 */
+	void beginEdit(QString const& text = QString());
+	void endEdit();
+	void recordCommand(TextEditCommand* command);
+
+	TextEditCommand::CursorState cursorState() const;
+	void restoreCursorState(TextEditCommand::CursorState const& state);
+
+	//! \brief the editXXX functions change the document and record the change in the history.
+	void editLineText(TextLine* line, QString const& text);
+	TextNode* editInsertNodeBelow(TextNode* parent, int styleCode, int pos);
+	bool editRemoveNode(TextNode* n);
+	TextNode* editMoveNode(TextNode* n, TextNode* newParent, int newPos);
+	void editNodeStyle(TextNode* n, int styleCode);
+	void editNbTextLines(TextNode* n, int nbLines);
+
+	static const int UndoLimit;
+	static const qint64 UndoMemoryBudget; //bytes
+	static const int FrameLayoutBudget; //ms
+
 	Cursor* _cursor;
 
 	TextStyleManager* _styleManager;
+	TextLayoutIndex* _layoutIndex;
+	TextSearchEngine* _searchEngine;
+	TextLineDecorator* _lineDecorator;
+	KineticScroller* _scroller;
+	int _scrollDirection;
 	TextNode* _currentScript;
 	TextNode* _baseIndex;
 	int _baseIndexLine;
@@ -210,6 +335,17 @@ protected:
 	TextNode* _endIndex;
 	int _endIndexMargin;
 
+	QHash<TextNode*, QRect> _paintedNodes; //area covered by each node at the last paint event.
+	ResolvedSelection _resolvedSelection;
+
+	TextEditHistory* _history;
+	TextEditGroupCommand* _editGroup;
+	int _editGroupDepth;
+
+	TextNode* _pasteStage;
+	TextNode* _pasteStageParent;
+	int _pasteStageRow;
+
 	QMargins _internalMargins;
 	NodeSupprBehavior _nodeSupprBehavior;
 
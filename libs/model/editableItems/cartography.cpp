@@ -20,34 +20,50 @@ along with this program.  If not, see <https://www.gnu.org/licenses/>.
 #include "model/editableitemmanager.h"
 
 #include <QFileInfo>
+#include <QHash>
 #include <QMetaEnum>
 #include <QIcon>
+#include <QRegularExpression>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
 
 namespace Sabrina {
 
 const QString Cartography::CARTOGRAPHY_TYPE_ID = "sabrina_jdr_cartography";
 const QString CartographyItem::CARTOGRAPHY_ITEM_TYPE_ID = Cartography::CARTOGRAPHY_TYPE_ID + "_item";
 const QString CartographyCategory::CARTOGRAPHY_CATEGORY_TYPE_ID = Cartography::CARTOGRAPHY_TYPE_ID + "_category";
+const QString CartographyVectorItem::CARTOGRAPHY_VECTOR_ITEM_TYPE_ID = Cartography::CARTOGRAPHY_TYPE_ID + "_vector";
 
 Cartography::Cartography(QString ref, Aline::EditableItemManager *parent) :
 	EditableItem(ref, parent),
 	_background(""),
+	_nextDrawOrder(0),
+	_insertionBatchDepth(0),
 	_categoryListModel(nullptr)
 {
 	connect(this, &Cartography::backgroundChanged,
 			this, &Cartography::newUnsavedChanges);
+	connect(this, &Cartography::toggledBackgroundLayersChanged,
+			this, &Cartography::newUnsavedChanges);
 	connect(this, &Cartography::sizeChanged,
 			this, &Cartography::newUnsavedChanges);
 
-	connect(this, &Cartography::cartographyCategoryInserted,
+	connect(this, &Cartography::cartographyCategoriesInserted,
 			this, &Cartography::newUnsavedChanges);
 	connect(this, &Cartography::cartographyCategoryRemoved,
 			this, &Cartography::newUnsavedChanges);
 
-	connect(this, &Cartography::cartographyItemInserted,
+	connect(this, &Cartography::cartographyItemsInserted,
 			this, &Cartography::newUnsavedChanges);
 	connect(this, &Cartography::cartographyItemRemoved,
 			this, &Cartography::newUnsavedChanges);
+
+	connect(this, &Cartography::cartographyVectorItemsInserted,
+			this, &Cartography::newUnsavedChanges);
+	connect(this, &Cartography::cartographyVectorItemRemoved,
+			this, &Cartography::newUnsavedChanges);
 }
 
 QString Cartography::getTypeId() const {
@@ -65,15 +81,25 @@ QString Cartography::background() const {
 	return _background;
 }
 
+QStringList Cartography::toggledBackgroundLayers() const {
+	return _toggledBackgroundLayers;
+}
+bool Cartography::isBackgroundLayerToggled(QString const& layerId) const {
+	return _toggledBackgroundLayers.contains(layerId);
+}
+
 void Cartography::insertSubItem(Aline::EditableItem* item) {
 
 	CartographyItem* cartoItem = qobject_cast<CartographyItem*>(item);
 	CartographyCategory* cartoCat = qobject_cast<CartographyCategory*>(item);
+	CartographyVectorItem* vectorItem = qobject_cast<CartographyVectorItem*>(item);
 
 	if (cartoItem != nullptr) {
 		insertCartoItem(cartoItem);
 	} else if (cartoCat != nullptr) {
 		insertCartoCat(cartoCat);
+	} else if (vectorItem != nullptr) {
+		insertVectorItem(vectorItem);
 	} else {
 		Aline::EditableItem::insertSubItem(item);
 	}
@@ -87,7 +113,30 @@ void Cartography::setBackground(QString url) {
 	}
 }
 
-void Cartography::addCartoItem(QString const& referedItemRef) {
+void Cartography::setToggledBackgroundLayers(QStringList const& layers) {
+	if (layers != _toggledBackgroundLayers) {
+		_toggledBackgroundLayers = layers;
+		emit toggledBackgroundLayersChanged(_toggledBackgroundLayers);
+	}
+}
+void Cartography::setBackgroundLayerToggled(QString const& layerId, bool toggled) {
+
+	if (toggled == isBackgroundLayerToggled(layerId)) {
+		return;
+	}
+
+	QStringList layers = _toggledBackgroundLayers;
+
+	if (toggled) {
+		layers.push_back(layerId);
+	} else {
+		layers.removeAll(layerId);
+	}
+
+	setToggledBackgroundLayers(layers);
+}
+
+CartographyItem* Cartography::addCartoItem(QString const& referedItemRef) {
 
 	Sabrina::EditableItem* referedItem;
 
@@ -96,11 +145,11 @@ void Cartography::addCartoItem(QString const& referedItemRef) {
 		referedItem = qobject_cast<Sabrina::EditableItem*>(getManager()->loadItem(referedItemRef));
 
 	} catch (ItemIOException const& e) {
-		return;
+		return nullptr;
 	}
 
 	if (referedItem == nullptr) {
-		return;
+		return nullptr;
 	}
 
 	referedItem->addOutRef(getRef());
@@ -122,9 +171,22 @@ void Cartography::addCartoItem(QString const& referedItemRef) {
 
 	insertCartoItem(item);
 
+	return item;
+
 }
 
-void Cartography::addCartoPoint(QString const& name) {
+void Cartography::addCartoItems(QStringList const& referedItemsRefs) {
+
+	beginInsertionBatch();
+
+	for (QString const& ref : referedItemsRefs) {
+		addCartoItem(ref);
+	}
+
+	endInsertionBatch();
+}
+
+CartographyItem* Cartography::addCartoPoint(QString const& name) {
 
 	QString carto_item_ref = EditableItem::simplifyRef(name + "_cartoitem");
 
@@ -140,6 +202,19 @@ void Cartography::addCartoPoint(QString const& name) {
 	item->setPosition(_mPos);
 
 	insertCartoItem(item);
+
+	return item;
+}
+
+void Cartography::addCartoPoints(QStringList const& names) {
+
+	beginInsertionBatch();
+
+	for (QString const& name : names) {
+		addCartoPoint(name);
+	}
+
+	endInsertionBatch();
 }
 
 void Cartography::addCartoPoint() {
@@ -148,15 +223,68 @@ void Cartography::addCartoPoint() {
 
 void Cartography::insertCartoItem(CartographyItem* item) {
 
-	if (!_items.contains(item)) {
+	if (!_spatialIndex.contains(item)) { //the spatial index is hashed, _items would be searched linearly.
 		Aline::EditableItem::insertSubItem(item);
 		_items.push_back(item);
-		emit cartographyItemInserted(item);
+
+		_spatialIndex.insert(item, item->getPosition());
+		connect(item, &CartographyItem::positionChanged, this, [this, item] (QPointF position) {
+			_spatialIndex.move(item, position);
+		});
+
+		if (_insertionBatchDepth > 0) {
+			_batchInsertedItems.push_back(item);
+		} else {
+			emit cartographyItemsInserted({item});
+		}
 	}
 
 }
 
-void Cartography::addCategory(QString const& cat_name) {
+void Cartography::beginInsertionBatch() {
+	_insertionBatchDepth++;
+}
+
+void Cartography::endInsertionBatch() {
+
+	if (_insertionBatchDepth <= 0) {
+		return;
+	}
+
+	_insertionBatchDepth--;
+
+	if (_insertionBatchDepth > 0) {
+		return;
+	}
+
+	//the categories first, so that the receivers of the items signal already know them.
+	if (!_batchInsertedCategories.isEmpty()) {
+
+		QVector<CartographyCategory*> categories;
+		categories.swap(_batchInsertedCategories);
+
+		relinkItemsCategories(categories);
+		emit cartographyCategoriesInserted(categories);
+	}
+
+	if (!_batchInsertedItems.isEmpty()) {
+
+		QVector<CartographyItem*> items;
+		items.swap(_batchInsertedItems);
+
+		emit cartographyItemsInserted(items);
+	}
+
+	if (!_batchInsertedVectorItems.isEmpty()) {
+
+		QVector<CartographyVectorItem*> items;
+		items.swap(_batchInsertedVectorItems);
+
+		emit cartographyVectorItemsInserted(items);
+	}
+}
+
+CartographyCategory* Cartography::addCategory(QString const& cat_name) {
 
 	QString ref = EditableItem::simplifyRef(cat_name + "_cartocategory");
 
@@ -168,6 +296,19 @@ void Cartography::addCategory(QString const& cat_name) {
 
 	insertCartoCat(cat);
 
+	return cat;
+
+}
+
+void Cartography::addCategories(QStringList const& cat_names) {
+
+	beginInsertionBatch();
+
+	for (QString const& name : cat_names) {
+		addCategory(name);
+	}
+
+	endInsertionBatch();
 }
 
 void Cartography::clearCartographyItems() {
@@ -186,6 +327,8 @@ void Cartography::loadCartographyItems(QList<Aline::EditableItem*> const& items)
 		clearCartographyItems();
 	}
 
+	beginInsertionBatch();
+
 	for (Aline::EditableItem* item : items) {
 
 		CartographyItem* cartoItem = qobject_cast<CartographyItem*>(item);
@@ -196,6 +339,8 @@ void Cartography::loadCartographyItems(QList<Aline::EditableItem*> const& items)
 
 	}
 
+	endInsertionBatch();
+
 }
 
 void Cartography::clearCartographyCategories() {
@@ -214,6 +359,8 @@ void Cartography::loadCartographyCategories(QList<Aline::EditableItem*> const& i
 		clearCartographyCategories();
 	}
 
+	beginInsertionBatch();
+
 	for (Aline::EditableItem* item : items) {
 
 		CartographyCategory* cat = qobject_cast<CartographyCategory*>(item);
@@ -224,6 +371,64 @@ void Cartography::loadCartographyCategories(QList<Aline::EditableItem*> const& i
 
 	}
 
+	endInsertionBatch();
+
+}
+
+CartographyVectorItem* Cartography::addVectorItem(QString const& name, CartographyVectorItem::Kind kind, QVector<QPointF> const& points) {
+
+	QString ref = EditableItem::simplifyRef(name + "_cartovector");
+
+	ref = makeSubItemRefUniq(ref);
+
+	CartographyVectorItem* item = new CartographyVectorItem(ref, this);
+
+	item->setObjectName(name);
+	item->setKind(kind);
+	item->setPoints(points);
+
+	CartographyCategory* defaultCat = getDefaultCat();
+	item->setStrokeCategory(defaultCat);
+
+	if (kind == CartographyVectorItem::POLYGON) {
+		item->setFillCategory(defaultCat);
+	}
+
+	insertVectorItem(item);
+
+	return item;
+}
+
+void Cartography::clearCartographyVectorItems() {
+
+	QVector<CartographyVectorItem*> items = _vectorItems;
+
+	for (CartographyVectorItem* item : items) {
+		removeVectorItem(item);
+	}
+
+}
+
+void Cartography::loadCartographyVectorItems(QList<Aline::EditableItem*> const& items) {
+
+	if (_vectorItems.count() > 0) {
+		clearCartographyVectorItems();
+	}
+
+	beginInsertionBatch();
+
+	for (Aline::EditableItem* item : items) {
+
+		CartographyVectorItem* vectorItem = qobject_cast<CartographyVectorItem*>(item);
+
+		if (vectorItem != nullptr) {
+			insertVectorItem(vectorItem);
+		}
+
+	}
+
+	endInsertionBatch();
+
 }
 
 void Cartography::removeCartoItem(CartographyItem* item) {
@@ -231,7 +436,12 @@ void Cartography::removeCartoItem(CartographyItem* item) {
 	if (item->_cartographyParent == this) {
 
 		_items.removeOne(item);
-		emit cartographyItemRemoved(item->getRef());
+		_spatialIndex.remove(item);
+		disconnect(item, &CartographyItem::positionChanged, this, nullptr);
+
+		if (!_batchInsertedItems.removeOne(item)) { //an item removed in the batch which inserted it is never announced.
+			emit cartographyItemRemoved(item->getRef());
+		}
 
 		item->deleteLater();
 
@@ -246,13 +456,42 @@ void Cartography::removeCartoCategory(CartographyCategory* item) {
 	if (item->_cartographyParent == this) {
 
 		_categories.remove(item->getRef());
-		emit cartographyCategoryRemoved(item->getRef());
+
+		if (item->_styleIndex >= 0 and item->_styleIndex < _categoryTable.size()) {
+			disconnect(item, &CartographyCategory::styleChanged, this, nullptr);
+			_categoryTable[item->_styleIndex] = nullptr;
+			invalidateCategoryStyle(item->_styleIndex);
+		}
+
+		if (!_batchInsertedCategories.removeOne(item)) { //an item removed in the batch which inserted it is never announced.
+			emit cartographyCategoryRemoved(item->getRef());
+		}
+
+		item->deleteLater();
+
+		removeSubItemRef(item);
+
+	}
+}
+
+void Cartography::removeVectorItem(CartographyVectorItem* item) {
+
+	if (item->_cartographyParent == this) {
+
+		_vectorItems.removeOne(item);
+		_vectorIndex.remove(item);
+		disconnect(item, &CartographyVectorItem::geometryChanged, this, nullptr);
+
+		if (!_batchInsertedVectorItems.removeOne(item)) { //an item removed in the batch which inserted it is never announced.
+			emit cartographyVectorItemRemoved(item->getRef());
+		}
 
 		item->deleteLater();
 
 		removeSubItemRef(item);
 
 	}
+
 }
 
 void Cartography::insertCartoCat(CartographyCategory* item) {
@@ -260,8 +499,93 @@ void Cartography::insertCartoCat(CartographyCategory* item) {
 	if (!_categories.values().contains(item)) {
 		Aline::EditableItem::insertSubItem(item);
 		_categories.insert(item->getRef(), item);
-		emit cartographyCategoryInserted(item);
+
+		int index = _categoryTable.size();
+
+		item->_styleIndex = index;
+		_categoryTable.push_back(item);
+		_styleTable.push_back(item->getStyle());
+		_styleValid.push_back(true);
+
+		connect(item, &CartographyCategory::styleChanged, this, [this, index] () {
+			invalidateCategoryStyle(index);
+		});
+
+		if (_insertionBatchDepth > 0) {
+			_batchInsertedCategories.push_back(item); //the items are relinked once, at the end of the batch.
+		} else {
+			relinkItemsCategories({item});
+			emit cartographyCategoriesInserted({item});
+		}
+	}
+
+}
+
+void Cartography::insertVectorItem(CartographyVectorItem* item) {
+
+	if (!_vectorIndex.contains(item)) {
+		Aline::EditableItem::insertSubItem(item);
+		_vectorItems.push_back(item);
+		item->_drawOrder = _nextDrawOrder++; //the items are always appended, their order in _vectorItems is their draw order.
+
+		_vectorIndex.insert(item, item->getBoundingRect());
+		connect(item, &CartographyVectorItem::geometryChanged, this, [this, item] () {
+			_vectorIndex.move(item, item->getBoundingRect());
+		});
+
+		if (_insertionBatchDepth > 0) {
+			_batchInsertedVectorItems.push_back(item);
+		} else {
+			emit cartographyVectorItemsInserted({item});
+		}
+	}
+
+}
+
+void Cartography::relinkItemsCategories(QVector<CartographyCategory*> const& categories) {
+
+	if ((_items.isEmpty() and _vectorItems.isEmpty()) or categories.isEmpty()) {
+		return;
+	}
+
+	QHash<QString, int> indices;
+
+	for (CartographyCategory* category : categories) {
+		indices.insert(category->getRef(), category->_styleIndex);
+	}
+
+	for (CartographyItem* cartoItem : qAsConst(_items)) {
+
+		auto it = indices.constFind(cartoItem->_category);
+
+		if (it != indices.constEnd() and getCategoryByIndex(cartoItem->_categoryIndex) == nullptr) {
+			cartoItem->_categoryIndex = it.value();
+		}
+	}
+
+	for (CartographyVectorItem* vectorItem : qAsConst(_vectorItems)) {
+
+		auto stroke = indices.constFind(vectorItem->_strokeCategory);
+		auto fill = indices.constFind(vectorItem->_fillCategory);
+
+		if (stroke != indices.constEnd() and getCategoryByIndex(vectorItem->_strokeIndex) == nullptr) {
+			vectorItem->_strokeIndex = stroke.value();
+		}
+
+		if (fill != indices.constEnd() and getCategoryByIndex(vectorItem->_fillIndex) == nullptr) {
+			vectorItem->_fillIndex = fill.value();
+		}
 	}
+}
+
+void Cartography::invalidateCategoryStyle(int index) {
+
+	if (index < 0 or index >= _styleValid.size()) {
+		return;
+	}
+
+	_styleValid[index] = false;
+	emit categoryStyleChanged(index);
 
 }
 
@@ -307,6 +631,46 @@ CartographyCategory* Cartography::getCategoryByRef(QString ref, bool returnDefau
 
 }
 
+CartographyCategory* Cartography::getCategoryByIndex(int index) const {
+
+	if (index < 0 or index >= _categoryTable.size()) {
+		return nullptr;
+	}
+
+	return _categoryTable.at(index);
+
+}
+
+CartographyStyle const& Cartography::categoryStyle(int index) const {
+
+	static const CartographyStyle defaultStyle;
+
+	if (index < 0 or index >= _styleTable.size()) {
+		return defaultStyle;
+	}
+
+	if (!_styleValid.at(index)) {
+		CartographyCategory* category = _categoryTable.at(index);
+		_styleTable[index] = (category != nullptr) ? category->getStyle() : CartographyStyle();
+		_styleValid[index] = true;
+	}
+
+	return _styleTable.at(index);
+
+}
+
+QVector<CartographyStyle> Cartography::categoryStyles() const {
+
+	for (int i = 0; i < _styleValid.size(); i++) {
+		if (!_styleValid.at(i)) {
+			categoryStyle(i);
+		}
+	}
+
+	return _styleTable;
+
+}
+
 CartographyCategroryListModel* Cartography::getCategoryListModel() {
 
 	if (_categoryListModel == nullptr) {
@@ -385,6 +749,62 @@ QVector<CartographyItem *> const& Cartography::getItems() const
     return _items;
 }
 
+QVector<CartographyItem *> Cartography::itemsInRect(QRectF const& rect) const {
+	return _spatialIndex.query(rect);
+}
+CartographyItem* Cartography::itemNearestTo(QPointF const& pos, qreal maxDistance) const {
+
+	CartographyItem* item = nullptr;
+
+	if (!_spatialIndex.nearest(pos, maxDistance, &item)) {
+		return nullptr;
+	}
+
+	return item;
+}
+
+QList<Aline::EditableItem*> Cartography::cartographyVectorItems() const {
+
+	QList<Aline::EditableItem*> ret;
+	ret.reserve(_vectorItems.size());
+
+	for (CartographyVectorItem * item : _vectorItems) {
+		ret << item;
+	}
+
+	return ret;
+}
+
+QVector<CartographyVectorItem *> const& Cartography::getVectorItems() const {
+	return _vectorItems;
+}
+
+QVector<CartographyVectorItem *> Cartography::vectorItemsInRect(QRectF const& rect) const {
+
+	QVector<CartographyVectorItem *> items = _vectorIndex.query(rect);
+
+	std::sort(items.begin(), items.end(), [] (CartographyVectorItem * a, CartographyVectorItem * b) {
+		return a->_drawOrder < b->_drawOrder;
+	});
+
+	return items;
+}
+QVector<CartographyVectorItem *> Cartography::vectorItemsAt(QPointF const& pos, qreal tolerance) const {
+
+	qreal margin = std::max(tolerance, 0.0);
+	QVector<CartographyVectorItem *> candidates = vectorItemsInRect(QRectF(pos.x() - margin, pos.y() - margin, 2*margin, 2*margin));
+
+	QVector<CartographyVectorItem *> items;
+
+	for (auto it = candidates.crbegin(); it != candidates.crend(); ++it) {
+		if ((*it)->hitTest(pos, tolerance)) {
+			items.push_back(*it);
+		}
+	}
+
+	return items;
+}
+
 Cartography::CartographyFactory::CartographyFactory(QObject *parent) :
     Aline::EditableItemFactory(parent)
 {
@@ -398,6 +818,7 @@ Aline::EditableItem* Cartography::CartographyFactory::createItem(QString ref, Al
 CartographyCategory::CartographyCategory(QString ref, Cartography* parent) :
 	Aline::EditableItem(ref, parent),
 	_cartographyParent(parent),
+	_styleIndex(-1),
 	_color(207, 85, 64),
 	_radius(5),
 	_border_color(0, 0, 0),
@@ -430,6 +851,29 @@ CartographyCategory::CartographyCategory(QString ref, Cartography* parent) :
 			this, &CartographyCategory::newUnsavedChanges);
 	connect(this, &CartographyCategory::legendColorChanged,
 			this, &CartographyCategory::newUnsavedChanges);
+
+	connect(this, &CartographyCategory::colorChanged,
+			this, &CartographyCategory::styleChanged);
+	connect(this, &CartographyCategory::radiusChanged,
+			this, &CartographyCategory::styleChanged);
+
+	connect(this, &CartographyCategory::borderColorChanged,
+			this, &CartographyCategory::styleChanged);
+	connect(this, &CartographyCategory::borderChanged,
+			this, &CartographyCategory::styleChanged);
+
+	connect(this, &CartographyCategory::legendFontChanged,
+			this, &CartographyCategory::styleChanged);
+	connect(this, &CartographyCategory::legendUnderlinedChanged,
+			this, &CartographyCategory::styleChanged);
+	connect(this, &CartographyCategory::legendBoldChanged,
+			this, &CartographyCategory::styleChanged);
+	connect(this, &CartographyCategory::legendItalicChanged,
+			this, &CartographyCategory::styleChanged);
+	connect(this, &CartographyCategory::legendSizeChanged,
+			this, &CartographyCategory::styleChanged);
+	connect(this, &CartographyCategory::legendColorChanged,
+			this, &CartographyCategory::styleChanged);
 }
 
 QString CartographyCategory::getTypeId() const {
@@ -574,6 +1018,30 @@ void CartographyCategory::setLegendColor(const QColor &legendColor)
 	}
 }
 
+int CartographyCategory::getStyleIndex() const {
+	return _styleIndex;
+}
+
+CartographyStyle CartographyCategory::getStyle() const {
+
+	CartographyStyle style;
+
+	style.color = _color;
+	style.radius = _radius;
+
+	style.borderColor = _border_color;
+	style.border = _border;
+
+	style.legendFont = _legend_font;
+	style.legendUnderlined = _legend_underlined;
+	style.legendBold = _legend_bold;
+	style.legendItalic = _legend_italic;
+	style.legendSize = _legend_size;
+	style.legendColor = _legendColor;
+
+	return style;
+}
+
 CartographyCategory::CartographyCategoryFactory::CartographyCategoryFactory(QObject *parent) :
 	Aline::EditableSubItemFactory(parent)
 {
@@ -596,6 +1064,7 @@ CartographyItem::CartographyItem(QString ref, Cartography *parent) :
 	Aline::EditableItem(ref, parent),
 	_cartographyParent(parent),
 	_category(""),
+	_categoryIndex(-1),
 	_referedItem(QString()),
 	_scale(1.0),
 	_legendPos(TOP_MIDDLE)
@@ -633,16 +1102,11 @@ QString CartographyItem::iconInternalUrl() const {
 }
 
 void CartographyItem::setCategory(CartographyCategory* category) {
-
-	disconnectPipedSignals();
-
 	linkCategory(category);
 }
 
 void CartographyItem::setCategory(QString ref) {
 
-	disconnectPipedSignals();
-
 	_category = ref;
 	linkCategory(_cartographyParent->getCategoryByRef(_category, true));
 }
@@ -711,48 +1175,70 @@ void CartographyItem::setPosition(const QPointF &position)
 
 QString CartographyItem::getCategoryRef() const
 {
+	if (_cartographyParent != nullptr) {
+
+		CartographyCategory* category = _cartographyParent->getCategoryByIndex(_categoryIndex);
+
+		if (category != nullptr) {
+			return category->getRef(); //follows the changes of ref of the category.
+		}
+	}
+
 	return _category;
 }
 
-QColor CartographyItem::getPointColor() const {
+int CartographyItem::getCategoryIndex() const {
+	return _categoryIndex;
+}
+
+CartographyStyle const& CartographyItem::getStyle() const {
 
-	return _linkedCategory->getColor();
+	static const CartographyStyle defaultStyle;
 
+	if (_cartographyParent == nullptr) {
+		return defaultStyle;
+	}
+
+	return _cartographyParent->categoryStyle(_categoryIndex);
+}
+
+QColor CartographyItem::getPointColor() const {
+	return getStyle().color;
 }
 qreal CartographyItem::getRadius() const {
-	return _linkedCategory->getRadius();
+	return getStyle().radius;
 }
 
 QColor CartographyItem::getBorderColor() const {
-	return _linkedCategory->getBorderColor();
+	return getStyle().borderColor;
 }
 
 qreal CartographyItem::getBorder() const {
-	return _linkedCategory->getBorder();
+	return getStyle().border;
 }
 
 QString CartographyItem::getLegendFont() const {
-	return _linkedCategory->getLegendFont();
+	return getStyle().legendFont;
 }
 
 bool CartographyItem::getLegendUnderlined() const {
-	return _linkedCategory->getLegendUnderlined();
+	return getStyle().legendUnderlined;
 }
 
 bool CartographyItem::getLegendBold() const {
-	return _linkedCategory->getLegendBold();
+	return getStyle().legendBold;
 }
 
 bool CartographyItem::getLegendItalic() const {
-	return _linkedCategory->getLegendItalic();
+	return getStyle().legendItalic;
 }
 
 int CartographyItem::getLegendSize() const {
-	return _linkedCategory->getLegendSize();
+	return getStyle().legendSize;
 }
 
 QColor CartographyItem::getLegendColor() const {
-	return _linkedCategory->getLegendColor();
+	return getStyle().legendColor;
 }
 
 qreal CartographyItem::getScale() const {
@@ -806,103 +1292,359 @@ void CartographyItem::checkWithin(QSizeF const& mapSize) {
 void CartographyItem::linkCategory(CartographyCategory* category) {
 
 	_category = category->getRef();
-	_linkedCategory = category;
+	_categoryIndex = category->getStyleIndex();
 
-	_colorPipeConnection = connect(category, &CartographyCategory::colorChanged,
-								   this, &CartographyItem::colorChanged);
+	emit categoryChanged(category->getRef());
 
-	_radiusPipeConnection = connect(category, &CartographyCategory::radiusChanged,
-									this, &CartographyItem::radiusChanged);
+}
 
+Cartography *CartographyItem::getCartographyParent() const
+{
+    return _cartographyParent;
+}
 
-	_borderColorPipeConnection = connect(category, &CartographyCategory::borderColorChanged,
-										 this, &CartographyItem::borderColorChanged);
 
-	_borderPipeConnection = connect(category, &CartographyCategory::borderChanged,
-									this, &CartographyItem::borderChanged);
+CartographyItem::CartographyItemFactory::CartographyItemFactory(QObject *parent) :
+    Aline::EditableSubItemFactory(parent)
+{
+
+}
 
+Aline::EditableItem* CartographyItem::CartographyItemFactory::createItem(QString ref, Aline::EditableItem* parent) const {
+
+	Cartography* cParent = qobject_cast<Cartography*>(parent);
+
+	if (cParent == nullptr && parent != nullptr) {
+		return nullptr; //parent has to be a Cartography or a nullptr.
+	}
 
-	_legendFontPipeConnection = connect(category, &CartographyCategory::legendFontChanged,
-										this, &CartographyItem::legendFontChanged);
+	return new CartographyItem(ref, cParent);
 
-	_legendUnderlinedPipeConnection = connect(category, &CartographyCategory::legendUnderlinedChanged,
-											  this, &CartographyItem::legendUnderlinedChanged);
+}
 
-	_legendBoldPipeConnection = connect(category, &CartographyCategory::legendBoldChanged,
-										this, &CartographyItem::legendBoldChanged);
 
-	_legendItalicPipeConnection = connect(category, &CartographyCategory::legendItalicChanged,
-										  this, &CartographyItem::legendItalicChanged);
+CartographyVectorItem::CartographyVectorItem(QString ref, Cartography *parent) :
+	Aline::EditableItem(ref, parent),
+	_cartographyParent(parent),
+	_drawOrder(0),
+	_kind(POLYLINE),
+	_strokeCategory(""),
+	_strokeIndex(-1),
+	_fillCategory(""),
+	_fillIndex(-1)
+{
+	this->blockSignals(true);
+	setObjectName(EditableItem::simplifyRef(ref));
+	this->blockSignals(false);
 
-	_legendSizePipeConnection = connect(category, &CartographyCategory::legendSizeChanged,
-										this, &CartographyItem::legendSizeChanged);
+	connect(this, &CartographyVectorItem::kindChanged,
+			this, &CartographyVectorItem::newUnsavedChanges);
+	connect(this, &CartographyVectorItem::geometryChanged,
+			this, &CartographyVectorItem::newUnsavedChanges);
+	connect(this, &CartographyVectorItem::categoriesChanged,
+			this, &CartographyVectorItem::newUnsavedChanges);
+}
 
-	_legendColorPipeConnection = connect(category, &CartographyCategory::legendColorChanged,
-										 this, &CartographyItem::legendColorChanged);
+QString CartographyVectorItem::getTypeId() const {
+	return CARTOGRAPHY_VECTOR_ITEM_TYPE_ID;
+}
 
-	emit categoryChanged(category->getRef());
+QString CartographyVectorItem::getTypeName() const {
+	return tr("Tracé de carte");
+}
 
+QString CartographyVectorItem::iconInternalUrl() const {
+	return ":/icons/icons/editable_item_map.svg";
+}
+
+CartographyVectorItem::Kind CartographyVectorItem::getKind() const {
+	return _kind;
 }
 
-void CartographyItem::disconnectPipedSignals() {
+void CartographyVectorItem::setKind(Kind kind) {
+
+	if (kind != _kind) {
+		_kind = kind;
+		emit kindChanged(_kind);
+	}
+
+}
+
+bool CartographyVectorItem::isClosed() const {
+	return _kind == POLYGON;
+}
+
+QVector<qreal> const& CartographyVectorItem::getCoordinates() const {
+	return _coordinates;
+}
+
+void CartographyVectorItem::setCoordinates(QVector<qreal> const& coordinates) {
+
+	QVector<qreal> points = coordinates;
 
-	if (_colorPipeConnection) {
-		disconnect(_colorPipeConnection);
+	if (points.size() % 2 != 0) {
+		points.removeLast(); //an incomplete point.
 	}
 
-	if (_radiusPipeConnection) {
-		disconnect(_radiusPipeConnection);
+	if (points == _coordinates) {
+		return;
 	}
 
+	_coordinates = points;
+
+	if (_coordinates.isEmpty()) {
+		_bounds = QRectF();
+	} else {
+
+		qreal left = std::numeric_limits<qreal>::infinity();
+		qreal top = left;
+		qreal right = -left;
+		qreal bottom = -left;
 
-	if (_borderColorPipeConnection) {
-		disconnect(_borderColorPipeConnection);
+		for (int i = 0; i < _coordinates.size(); i += 2) {
+			left = std::min(left, _coordinates[i]);
+			right = std::max(right, _coordinates[i]);
+			top = std::min(top, _coordinates[i+1]);
+			bottom = std::max(bottom, _coordinates[i+1]);
+		}
+
+		_bounds = QRectF(QPointF(left, top), QPointF(right, bottom));
 	}
 
-	if (_borderPipeConnection) {
-		disconnect(_borderPipeConnection);
+	emit geometryChanged();
+}
+
+int CartographyVectorItem::pointsCount() const {
+	return _coordinates.size()/2;
+}
+
+QPointF CartographyVectorItem::point(int index) const {
+	return QPointF(_coordinates[2*index], _coordinates[2*index+1]);
+}
+
+QVector<QPointF> CartographyVectorItem::getPoints() const {
+
+	QVector<QPointF> points;
+	points.reserve(pointsCount());
+
+	for (int i = 0; i < pointsCount(); i++) {
+		points.push_back(point(i));
+	}
+
+	return points;
+}
+
+void CartographyVectorItem::setPoints(QVector<QPointF> const& points) {
+
+	QVector<qreal> coordinates;
+	coordinates.reserve(2*points.size());
+
+	for (QPointF const& p : points) {
+		coordinates.push_back(p.x());
+		coordinates.push_back(p.y());
 	}
 
+	setCoordinates(coordinates);
+}
+
+QString CartographyVectorItem::getCoordinatesString() const {
+
+	QString out;
+	out.reserve(_coordinates.size()*8);
+
+	for (int i = 0; i < _coordinates.size(); i++) {
+
+		if (i > 0) {
+			out += ' ';
+		}
 
-	if (_legendFontPipeConnection) {
-		disconnect(_legendFontPipeConnection);
+		out += QString::number(_coordinates[i], 'g', 10);
 	}
 
-	if (_legendUnderlinedPipeConnection) {
-		disconnect(_legendUnderlinedPipeConnection);
+	return out;
+}
+
+void CartographyVectorItem::setCoordinatesString(QString const& coordinates) {
+
+	static const QRegularExpression separators("[\\s,]+");
+
+	QVector<QStringRef> values = coordinates.splitRef(separators, Qt::SkipEmptyParts);
+
+	QVector<qreal> parsed;
+	parsed.reserve(values.size());
+
+	for (QStringRef const& value : values) {
+
+		bool ok;
+		qreal v = value.toDouble(&ok);
+
+		if (!ok) {
+			return; //keep the current outline rather than a shifted one.
+		}
+
+		parsed.push_back(v);
 	}
 
-	if (_legendBoldPipeConnection) {
-		disconnect(_legendBoldPipeConnection);
+	setCoordinates(parsed);
+}
+
+QRectF CartographyVectorItem::getBoundingRect() const {
+	return _bounds;
+}
+
+bool CartographyVectorItem::hitTest(QPointF const& pos, qreal tolerance) const {
+
+	int n = pointsCount();
+
+	if (n == 0) {
+		return false;
 	}
 
-	if (_legendItalicPipeConnection) {
-		disconnect(_legendItalicPipeConnection);
+	if (_kind == POLYGON and n >= 3) {
+
+		bool inside = false;
+
+		for (int i = 0, j = n-1; i < n; j = i++) {
+
+			QPointF a = point(i);
+			QPointF b = point(j);
+
+			if ((a.y() > pos.y()) != (b.y() > pos.y()) and
+					pos.x() < (b.x() - a.x())*(pos.y() - a.y())/(b.y() - a.y()) + a.x()) {
+				inside = !inside;
+			}
+		}
+
+		if (inside) {
+			return true;
+		}
 	}
 
-	if (_legendFontPipeConnection) {
-		disconnect(_legendItalicPipeConnection);
+	return distanceToOutline(pos) <= std::max(tolerance, 0.0);
+}
+
+qreal CartographyVectorItem::distanceToOutline(QPointF const& pos) const {
+
+	int n = pointsCount();
+
+	if (n == 0) {
+		return std::numeric_limits<qreal>::infinity();
 	}
 
-	if (_legendColorPipeConnection) {
-		disconnect(_legendColorPipeConnection);
+	QPointF d0 = point(0) - pos;
+	qreal best2 = QPointF::dotProduct(d0, d0);
+
+	int segments = (isClosed() and n >= 3) ? n : n-1;
+
+	for (int i = 0; i < segments; i++) {
+
+		QPointF a = point(i);
+		QPointF ab = point((i+1)%n) - a;
+		qreal length2 = QPointF::dotProduct(ab, ab);
+
+		qreal t = (length2 > 0) ? QPointF::dotProduct(pos - a, ab)/length2 : 0;
+		t = std::min(std::max(t, 0.0), 1.0);
+
+		QPointF d = a + t*ab - pos;
+		best2 = std::min(best2, QPointF::dotProduct(d, d));
 	}
 
+	return std::sqrt(best2);
 }
 
-Cartography *CartographyItem::getCartographyParent() const
-{
-    return _cartographyParent;
+void CartographyVectorItem::setStrokeCategory(CartographyCategory* category) {
+
+	_strokeCategory = (category != nullptr) ? category->getRef() : QString();
+	_strokeIndex = (category != nullptr) ? category->getStyleIndex() : -1;
+
+	emit categoriesChanged();
 }
 
+void CartographyVectorItem::setStrokeCategory(QString ref) {
 
-CartographyItem::CartographyItemFactory::CartographyItemFactory(QObject *parent) :
-    Aline::EditableSubItemFactory(parent)
+	_strokeCategory = ref;
+	_strokeIndex = linkedIndex(_cartographyParent, ref); //-1 until the category is loaded, then relinked by the cartography.
+
+	emit categoriesChanged();
+}
+
+void CartographyVectorItem::setFillCategory(CartographyCategory* category) {
+
+	_fillCategory = (category != nullptr) ? category->getRef() : QString();
+	_fillIndex = (category != nullptr) ? category->getStyleIndex() : -1;
+
+	emit categoriesChanged();
+}
+
+void CartographyVectorItem::setFillCategory(QString ref) {
+
+	_fillCategory = ref;
+	_fillIndex = linkedIndex(_cartographyParent, ref);
+
+	emit categoriesChanged();
+}
+
+QString CartographyVectorItem::getStrokeCategoryRef() const {
+	return categoryRef(_strokeCategory, _strokeIndex);
+}
+
+QString CartographyVectorItem::getFillCategoryRef() const {
+	return categoryRef(_fillCategory, _fillIndex);
+}
+
+int CartographyVectorItem::getStrokeIndex() const {
+	return _strokeIndex;
+}
+
+int CartographyVectorItem::getFillIndex() const {
+
+	if (_kind != POLYGON) {
+		return -1;
+	}
+
+	return _fillIndex;
+}
+
+Cartography *CartographyVectorItem::getCartographyParent() const {
+	return _cartographyParent;
+}
+
+int CartographyVectorItem::linkedIndex(Cartography* cartography, QString const& ref) {
+
+	if (cartography == nullptr or ref.isEmpty()) {
+		return -1;
+	}
+
+	CartographyCategory* category = cartography->getCategoryByRef(ref);
+
+	if (category == nullptr) {
+		return -1;
+	}
+
+	return category->getStyleIndex();
+}
+
+QString CartographyVectorItem::categoryRef(QString const& ref, int index) const {
+
+	if (_cartographyParent != nullptr) {
+
+		CartographyCategory* category = _cartographyParent->getCategoryByIndex(index);
+
+		if (category != nullptr) {
+			return category->getRef(); //follows the changes of ref of the category.
+		}
+	}
+
+	return ref;
+}
+
+CartographyVectorItem::CartographyVectorItemFactory::CartographyVectorItemFactory(QObject *parent) :
+	Aline::EditableSubItemFactory(parent)
 {
 
 }
 
-Aline::EditableItem* CartographyItem::CartographyItemFactory::createItem(QString ref, Aline::EditableItem* parent) const {
+Aline::EditableItem* CartographyVectorItem::CartographyVectorItemFactory::createItem(QString ref, Aline::EditableItem* parent) const {
 
 	Cartography* cParent = qobject_cast<Cartography*>(parent);
 
@@ -910,11 +1652,10 @@ Aline::EditableItem* CartographyItem::CartographyItemFactory::createItem(QString
 		return nullptr; //parent has to be a Cartography or a nullptr.
 	}
 
-	return new CartographyItem(ref, cParent);
+	return new CartographyVectorItem(ref, cParent);
 
 }
 
-
 CartographyCategroryListModel::CartographyCategroryListModel(Cartography* carto) :
 	QAbstractListModel(carto),
 	_parentCarto(carto)
@@ -931,8 +1672,8 @@ CartographyCategroryListModel::CartographyCategroryListModel(Cartography* carto)
 		}
 	}
 
-	connect(carto, &Cartography::cartographyCategoryInserted, this,
-			&CartographyCategroryListModel::insertCategory);
+	connect(carto, &Cartography::cartographyCategoriesInserted, this,
+			&CartographyCategroryListModel::insertCategories);
 
 	connect(carto, &Cartography::cartographyCategoryRemoved,
 			this, &CartographyCategroryListModel::removeCategory);
@@ -991,26 +1732,37 @@ bool CartographyCategroryListModel::setData(const QModelIndex &index, const QVar
 
 }
 
-void CartographyCategroryListModel::insertCategory(CartographyCategory* cat) {
+void CartographyCategroryListModel::insertCategories(QVector<CartographyCategory*> const& categories) {
 
-	if (_dict.contains(cat->getRef())) {
+	QVector<CartographyCategory*> added;
+
+	for (CartographyCategory* cat : categories) {
+		if (!_dict.contains(cat->getRef()) and !added.contains(cat)) {
+			added.push_back(cat);
+		}
+	}
+
+	if (added.isEmpty()) {
 		return;
 	}
 
-	beginInsertRows(QModelIndex(), _categories.count(), _categories.count());
+	beginInsertRows(QModelIndex(), _categories.count(), _categories.count() + added.count() - 1);
+
+	for (CartographyCategory* cat : added) {
 
-	_categories.push_back(cat);
-	_dict.insert(cat->getRef(), cat);
-	connect(cat, &Aline::EditableItem::refSwap,
-			this, &CartographyCategroryListModel::onRefSwap);
+		_categories.push_back(cat);
+		_dict.insert(cat->getRef(), cat);
+		connect(cat, &Aline::EditableItem::refSwap,
+				this, &CartographyCategroryListModel::onRefSwap);
 
-	std::function<void()> onCartographyCategroyDataChanged = [this, cat] () {
-		int row = this->_categories.indexOf(cat);
-		emit this->dataChanged(this->index(row), this->index(row));
-	};
+		std::function<void()> onCartographyCategroyDataChanged = [this, cat] () {
+			int row = this->_categories.indexOf(cat);
+			emit this->dataChanged(this->index(row), this->index(row));
+		};
 
-	connect(cat, &QObject::objectNameChanged, onCartographyCategroyDataChanged);
-	connect(cat, &CartographyCategory::colorChanged, onCartographyCategroyDataChanged);
+		connect(cat, &QObject::objectNameChanged, onCartographyCategroyDataChanged);
+		connect(cat, &CartographyCategory::colorChanged, onCartographyCategroyDataChanged);
+	}
 
 	endInsertRows();
 
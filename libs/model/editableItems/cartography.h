@@ -25,16 +25,55 @@ along with this program.  If not, see <https://www.gnu.org/licenses/>.
 #include <Aline/model/editableitem.h>
 
 #include "model/model_global.h"
+#include "utils/pointquadtree.h"
+#include "utils/rectquadtree.h"
 
 #include <QColor>
 #include <QPointF>
+#include <QRectF>
 #include <QSize>
+#include <QVector>
 
 namespace Sabrina {
 
 class Cartography;
 class CartographyCategory;
 
+/*!
+ * \brief The CartographyStyle struct hold the style of a category, shared by all the items of the category.
+ *
+ * The styles are stored in a table of the cartography, indexed by the style index of the categories.
+ */
+struct CartographyStyle {
+
+	CartographyStyle() :
+		color(207, 85, 64),
+		radius(5),
+		borderColor(0, 0, 0),
+		border(2),
+		legendFont("sans"),
+		legendUnderlined(false),
+		legendBold(true),
+		legendItalic(false),
+		legendSize(10)
+	{
+
+	}
+
+	QColor color;
+	qreal radius;
+
+	QColor borderColor;
+	qreal border;
+
+	QString legendFont;
+	bool legendUnderlined;
+	bool legendBold;
+	bool legendItalic;
+	int legendSize;
+	QColor legendColor;
+};
+
 class CATHIA_MODEL_EXPORT CartographyItemLegendPosListModel : public QAbstractListModel {
 
 	Q_OBJECT
@@ -87,18 +126,19 @@ public:
 	Q_PROPERTY(qreal scale READ getScale WRITE setScale NOTIFY scaleChanged )
 	Q_PROPERTY(LegendPos legendPosition READ getLegendPosition WRITE setLegendPosition NOTIFY legendPositionChanged)
 
-	Q_PROPERTY(QColor color READ getPointColor NOTIFY colorChanged STORED false)
-	Q_PROPERTY(qreal radius READ getRadius NOTIFY radiusChanged STORED false)
+	//the style properties are read from the style table of the cartography, their changes are signaled by Cartography::categoryStyleChanged.
+	Q_PROPERTY(QColor color READ getPointColor STORED false)
+	Q_PROPERTY(qreal radius READ getRadius STORED false)
 
-	Q_PROPERTY(QColor borderColor READ getBorderColor NOTIFY borderColorChanged STORED false)
-	Q_PROPERTY(qreal border READ getBorder NOTIFY borderChanged STORED false)
+	Q_PROPERTY(QColor borderColor READ getBorderColor STORED false)
+	Q_PROPERTY(qreal border READ getBorder STORED false)
 
-	Q_PROPERTY(QString legendFont READ getLegendFont NOTIFY legendFontChanged STORED false)
-	Q_PROPERTY(bool legendUnderlined READ getLegendUnderlined NOTIFY legendUnderlinedChanged STORED false)
-	Q_PROPERTY(bool legendBold READ getLegendBold NOTIFY legendBoldChanged STORED false)
-	Q_PROPERTY(bool legendItalic READ getLegendItalic NOTIFY legendItalicChanged STORED false)
-	Q_PROPERTY(int legendSize READ getLegendSize NOTIFY legendSizeChanged STORED false)
-	Q_PROPERTY(QColor legendColor READ getLegendColor NOTIFY legendColorChanged STORED false)
+	Q_PROPERTY(QString legendFont READ getLegendFont STORED false)
+	Q_PROPERTY(bool legendUnderlined READ getLegendUnderlined STORED false)
+	Q_PROPERTY(bool legendBold READ getLegendBold STORED false)
+	Q_PROPERTY(bool legendItalic READ getLegendItalic STORED false)
+	Q_PROPERTY(int legendSize READ getLegendSize STORED false)
+	Q_PROPERTY(QColor legendColor READ getLegendColor STORED false)
 
 	virtual QString getTypeId() const;
 	virtual QString getTypeName() const;
@@ -115,6 +155,11 @@ public:
 	void setPosition(const QPointF &position);
 
 	QString getCategoryRef() const;
+	//! \brief the style index of the category of the item, -1 if the item has no category.
+	int getCategoryIndex() const;
+
+	//! \brief the style of the category of the item, the default style if the category was removed.
+	CartographyStyle const& getStyle() const;
 
 	QColor getPointColor() const;
 	qreal getRadius() const;
@@ -152,19 +197,6 @@ signals:
 
 	void legendPositionChanged(LegendPos pos);
 
-	void colorChanged(QColor color);
-	void radiusChanged(qreal radius);
-
-	void borderColorChanged(QColor col);
-	void borderChanged(qreal border);
-
-	void legendFontChanged(QString font);
-	void legendUnderlinedChanged(bool underlined);
-	void legendBoldChanged(bool bold);
-	void legendItalicChanged(bool italic);
-	void legendSizeChanged(int size);
-	void legendColorChanged(QColor col);
-
 public slots:
 
 protected:
@@ -172,31 +204,132 @@ protected:
 	void checkWithin(QSizeF const& mapSize);
 
 	void linkCategory(CartographyCategory* cat);
-	void disconnectPipedSignals();
 
 	Cartography* _cartographyParent;
-	mutable QString _category;
-	mutable CartographyCategory* _linkedCategory;
+	QString _category;
+	int _categoryIndex;
 
 	QString _referedItem;
 	QPointF _position;
 
-	mutable QMetaObject::Connection _colorPipeConnection;
-	mutable QMetaObject::Connection _radiusPipeConnection;
+	qreal _scale;
 
-	mutable QMetaObject::Connection _borderColorPipeConnection;
-	mutable QMetaObject::Connection _borderPipeConnection;
+	LegendPos _legendPos;
 
-	mutable QMetaObject::Connection _legendFontPipeConnection;
-	mutable QMetaObject::Connection _legendUnderlinedPipeConnection;
-	mutable QMetaObject::Connection _legendBoldPipeConnection;
-	mutable QMetaObject::Connection _legendItalicPipeConnection;
-	mutable QMetaObject::Connection _legendSizePipeConnection;
-	mutable QMetaObject::Connection _legendColorPipeConnection;
+};
 
-	qreal _scale;
+/*!
+ * \brief The CartographyVectorItem class is a path or a region drawn over the background of a cartography, as a road, a border or a country.
+ *
+ * The outline is stored as a flat array of coordinates (x0, y0, x1, y1, ...) in map coordinates, and saved as a single string of numbers.
+ * The outline of a polyline is stroked with the border style of its stroke category, a polygon is also filled with the color of its fill category.
+ * A polygon has a single ring, its last point is implicitly linked to the first one.
+ */
+class CATHIA_MODEL_EXPORT CartographyVectorItem : public Aline::EditableItem
+{
+	Q_OBJECT
 
-	LegendPos _legendPos;
+	friend class Cartography;
+
+public:
+
+	enum Kind {
+		POLYLINE = 0,
+		POLYGON = 1
+	};
+	Q_ENUM(Kind)
+
+	static const QString CARTOGRAPHY_VECTOR_ITEM_TYPE_ID;
+
+	class CATHIA_MODEL_EXPORT CartographyVectorItemFactory : public Aline::EditableSubItemFactory
+	{
+	public:
+		explicit CartographyVectorItemFactory(QObject *parent = nullptr);
+		Aline::EditableItem* createItem(QString ref, Aline::EditableItem* parent) const;
+
+	};
+
+	explicit CartographyVectorItem(QString ref, Cartography* parent);
+
+	Q_PROPERTY(Kind kind READ getKind WRITE setKind NOTIFY kindChanged)
+	Q_PROPERTY(QString coordinates READ getCoordinatesString WRITE setCoordinatesString NOTIFY geometryChanged)
+	Q_PROPERTY(QString strokeCategory READ getStrokeCategoryRef WRITE setStrokeCategory)
+	Q_PROPERTY(QString fillCategory READ getFillCategoryRef WRITE setFillCategory)
+
+	virtual QString getTypeId() const;
+	virtual QString getTypeName() const;
+
+	virtual QString iconInternalUrl() const;
+
+	Kind getKind() const;
+	void setKind(Kind kind);
+
+	bool isClosed() const;
+
+	//! \brief the coordinates of the points of the outline, two values per point.
+	QVector<qreal> const& getCoordinates() const;
+	void setCoordinates(QVector<qreal> const& coordinates);
+
+	int pointsCount() const;
+	QPointF point(int index) const;
+	QVector<QPointF> getPoints() const;
+	void setPoints(QVector<QPointF> const& points);
+
+	//! \brief the coordinates as a string of numbers separated by spaces, as they are saved.
+	QString getCoordinatesString() const;
+	void setCoordinatesString(QString const& coordinates);
+
+	//! \brief the bounding rectangle of the outline, without the width of the stroke.
+	QRectF getBoundingRect() const;
+
+	/*!
+	 * \brief if the item is hit at pos, in map coordinates.
+	 *
+	 * A polygon is hit inside its outline (even-odd rule), any item is hit closer than tolerance from its outline.
+	 */
+	bool hitTest(QPointF const& pos, qreal tolerance = 0) const;
+	//! \brief the distance from pos to the outline of the item, the closing segment of a polygon included.
+	qreal distanceToOutline(QPointF const& pos) const;
+
+	void setStrokeCategory(CartographyCategory* category);
+	void setStrokeCategory(QString ref);
+	void setFillCategory(CartographyCategory* category);
+	void setFillCategory(QString ref);
+
+	QString getStrokeCategoryRef() const;
+	QString getFillCategoryRef() const;
+
+	//! \brief the style index of the stroke category, -1 if the outline is not stroked.
+	int getStrokeIndex() const;
+	//! \brief the style index of the fill category, -1 if the item is not filled. Polylines are never filled.
+	int getFillIndex() const;
+
+	Cartography *getCartographyParent() const;
+
+signals:
+
+	void kindChanged(Kind kind);
+	void geometryChanged();
+	//! \brief emitted when the stroke or the fill category changed.
+	void categoriesChanged();
+
+protected:
+
+	static int linkedIndex(Cartography* cartography, QString const& ref);
+	QString categoryRef(QString const& ref, int index) const;
+
+	Cartography* _cartographyParent;
+
+	qint64 _drawOrder;
+
+	Kind _kind;
+	QVector<qreal> _coordinates;
+	QRectF _bounds;
+
+	QString _strokeCategory;
+	int _strokeIndex;
+	QString _fillCategory;
+	int _fillIndex;
 
 };
 
@@ -268,6 +401,10 @@ public:
 	QColor getLegendColor() const;
 	void setLegendColor(const QColor &legendColor);
 
+	//! \brief the index of the style of the category in the style table of its cartography, -1 if it is not in a cartography.
+	int getStyleIndex() const;
+	CartographyStyle getStyle() const;
+
 signals:
 
 	void colorChanged(QColor col);
@@ -283,11 +420,15 @@ signals:
 	void legendSizeChanged(int size);
 	void legendColorChanged(QColor col);
 
+	//! \brief emitted after any of the style properties changed.
+	void styleChanged();
+
 public slots:
 
 protected:
 
 	Cartography* _cartographyParent;
+	int _styleIndex;
 
 	QColor _color;
 	qreal _radius;
@@ -321,7 +462,7 @@ public:
 
 protected:
 
-	void insertCategory(CartographyCategory* cat);
+	void insertCategories(QVector<CartographyCategory*> const& categories);
 	void removeCategory(QString ref);
 	void onRefSwap(QString oldRef, QString newRef);
 
@@ -349,10 +490,12 @@ public:
 	explicit Cartography(QString ref, Aline::EditableItemManager* parent = nullptr);
 
 	Q_PROPERTY(QString background READ background WRITE setBackground NOTIFY backgroundChanged)
+	Q_PROPERTY(QStringList toggledBackgroundLayers READ toggledBackgroundLayers WRITE setToggledBackgroundLayers NOTIFY toggledBackgroundLayersChanged)
 	Q_PROPERTY(QSizeF size READ getSize WRITE setSize NOTIFY sizeChanged)
 
 	Q_PROPERTY(QList<Aline::EditableItem*> cartographyCategories READ cartographyCategories WRITE loadCartographyCategories)
 	Q_PROPERTY(QList<Aline::EditableItem*> cartographyItems READ cartographyItems WRITE loadCartographyItems)
+	Q_PROPERTY(QList<Aline::EditableItem*> cartographyVectorItems READ cartographyVectorItems WRITE loadCartographyVectorItems)
 
 	virtual QString getTypeId() const;
 	virtual QString getTypeName() const;
@@ -361,6 +504,14 @@ public:
 
 	QString background() const;
 
+	/*!
+	 * \brief the layers of a layered background whose visibility is the opposite of their visibility in the image file.
+	 *
+	 * The layers are given by their id, made of the names of their groups and their own name, as the names alone are not unique.
+	 */
+	QStringList toggledBackgroundLayers() const;
+	bool isBackgroundLayerToggled(QString const& layerId) const;
+
 	virtual void insertSubItem(Aline::EditableItem* item);
 
 	QSizeF getSize() const;
@@ -369,6 +520,18 @@ public:
 	QList<Aline::EditableItem *> cartographyCategories() const;
 	QList<QString> getCurrentCategoriesRefs() const;
 	CartographyCategory* getCategoryByRef(QString ref, bool returnDefaultIfNotFound = false);
+	//! \brief the category with a given style index, nullptr if the category was removed.
+	CartographyCategory* getCategoryByIndex(int index) const;
+
+	/*!
+	 * \brief the style of a category, by style index.
+	 *
+	 * A record of the table is rebuilt only when its category changed since it was last read.
+	 * An invalid index, or the index of a removed category, gives the default style.
+	 */
+	CartographyStyle const& categoryStyle(int index) const;
+	//! \brief the whole style table, indexed by style index, for renderers drawing many items at once.
+	QVector<CartographyStyle> categoryStyles() const;
 
 	CartographyCategroryListModel* getCategoryListModel();
 
@@ -377,25 +540,60 @@ public:
 	QList<Aline::EditableItem *> cartographyItems() const;
 	const QVector<CartographyItem *> &getItems() const;
 
+	//! \brief the items placed in the rectangle (in map coordinates), found with the spatial index.
+	QVector<CartographyItem *> itemsInRect(QRectF const& rect) const;
+	//! \brief the item closest to pos, nullptr if no item is closer than maxDistance (any distance if negative).
+	CartographyItem* itemNearestTo(QPointF const& pos, qreal maxDistance = -1) const;
+
+	QList<Aline::EditableItem *> cartographyVectorItems() const;
+	//! \brief the vector items, in drawing order.
+	const QVector<CartographyVectorItem *> &getVectorItems() const;
+
+	//! \brief the vector items whose bounding rectangle intersects rect (in map coordinates), in drawing order.
+	QVector<CartographyVectorItem *> vectorItemsInRect(QRectF const& rect) const;
+	//! \brief the vector items hit at pos (see CartographyVectorItem::hitTest), the topmost first.
+	QVector<CartographyVectorItem *> vectorItemsAt(QPointF const& pos, qreal tolerance = 0) const;
+
+	/*!
+	 * \brief start a batch of insertions, the items and categories inserted until endInsertionBatch are announced by a single signal.
+	 *
+	 * The batches can be nested, the signals are emitted when the outermost batch ends.
+	 */
+	void beginInsertionBatch();
+	void endInsertionBatch();
+
 signals:
 
 	void backgroundChanged(QString bg);
+	void toggledBackgroundLayersChanged(QStringList layers);
 	void sizeChanged(QSizeF size);
 
-	void cartographyItemInserted(CartographyItem* item);
-	void cartographyCategoryInserted(CartographyCategory* category);
+	//! \brief emitted once per insertion or batch of insertions, the items are appended at the end of getItems().
+	void cartographyItemsInserted(QVector<Sabrina::CartographyItem*> items);
+	void cartographyCategoriesInserted(QVector<Sabrina::CartographyCategory*> categories);
+	void cartographyVectorItemsInserted(QVector<Sabrina::CartographyVectorItem*> items);
 
 	void cartographyItemRemoved(QString oldRef);
 	void cartographyCategoryRemoved(QString oldRef);
+	void cartographyVectorItemRemoved(QString oldRef);
+
+	//! \brief emitted once when the style of a category changed, whatever the number of items in the category.
+	void categoryStyleChanged(int index);
 
 public slots:
 
 	void setBackground(QString url);
-
-	void addCartoItem(QString const& referedItemRef);
-	void addCartoPoint(QString const& name);
+	void setToggledBackgroundLayers(QStringList const& layers);
+	void setBackgroundLayerToggled(QString const& layerId, bool toggled);
+
+	//! \brief add an item refering to another editable item, nullptr if the refered item could not be loaded.
+	CartographyItem* addCartoItem(QString const& referedItemRef);
+	void addCartoItems(QStringList const& referedItemsRefs);
+	CartographyItem* addCartoPoint(QString const& name);
+	void addCartoPoints(QStringList const& names);
 	void addCartoPoint();
-	void addCategory(QString const& cat_name);
+	CartographyCategory* addCategory(QString const& cat_name);
+	void addCategories(QStringList const& cat_names);
 
 	void clearCartographyItems();
 	void loadCartographyItems(QList<Aline::EditableItem*> const& items);
@@ -403,8 +601,15 @@ public slots:
 	void clearCartographyCategories();
 	void loadCartographyCategories(QList<Aline::EditableItem*> const& items);
 
+	//! \brief add a path or a region, stroked (and filled for a region) with the default category.
+	CartographyVectorItem* addVectorItem(QString const& name, Sabrina::CartographyVectorItem::Kind kind, QVector<QPointF> const& points);
+
+	void clearCartographyVectorItems();
+	void loadCartographyVectorItems(QList<Aline::EditableItem*> const& items);
+
 	void removeCartoItem(CartographyItem* item);
 	void removeCartoCategory(CartographyCategory* item);
+	void removeVectorItem(CartographyVectorItem* item);
 
 protected:
 	CartographyCategory* getDefaultCat();
@@ -412,17 +617,37 @@ protected:
 
 	void insertCartoItem(CartographyItem* item);
 	void insertCartoCat(CartographyCategory* item);
+	void insertVectorItem(CartographyVectorItem* item);
+	//! \brief give back their style to the items loaded before their category.
+	void relinkItemsCategories(QVector<CartographyCategory*> const& categories);
+
+	void invalidateCategoryStyle(int index);
 
 	virtual void treatDeletedRef(QString deletedRef);
 	virtual void treatChangedRef(QString oldRef, QString newRef);
 
 	QString _background;
+	QStringList _toggledBackgroundLayers;
 
 	QVector<CartographyItem*> _items;
+	PointQuadTree<CartographyItem*> _spatialIndex; //kept up to date with the positions of the items.
+	QVector<CartographyVectorItem*> _vectorItems;
+	RectQuadTree<CartographyVectorItem*> _vectorIndex; //kept up to date with the bounds of the vector items.
+	qint64 _nextDrawOrder;
 	QMap<QString, CartographyCategory*> _categories;
 
+	//the indices are never reused, so that the items of a removed category do not take the style of another one.
+	QVector<CartographyCategory*> _categoryTable;
+	mutable QVector<CartographyStyle> _styleTable;
+	mutable QVector<bool> _styleValid;
+
 	QSizeF _size;
 
+	int _insertionBatchDepth;
+	QVector<CartographyItem*> _batchInsertedItems;
+	QVector<CartographyCategory*> _batchInsertedCategories;
+	QVector<CartographyVectorItem*> _batchInsertedVectorItems;
+
 	CartographyCategroryListModel* _categoryListModel;
 };
 
@@ -0,0 +1,769 @@
+/*
+This file is part of the project Sabrina
+Copyright (C) 2023  Paragon <french.paragon@gmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "cartographygeojson.h"
+
+#include "cartography.h"
+
+#include <QFile>
+#include <QHash>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QMetaEnum>
+#include <QSaveFile>
+
+namespace Sabrina {
+
+const QString CartographyGeoJson::DefaultCategoryProperty = "category";
+
+namespace {
+
+const char* SizeMember = "sabrina:size";
+const char* CategoriesMember = "sabrina:categories";
+const char* ReferedItemProperty = "sabrina:referedItem";
+const char* ScaleProperty = "scale";
+const char* LegendPositionProperty = "legendPosition";
+const char* StrokeCategoryProperty = "sabrina:strokeCategory";
+const char* FillCategoryProperty = "sabrina:fillCategory";
+
+const int ReadChunkSize = 64*1024;
+
+/*!
+ * \brief The JsonStreamReader class split a json document read from a device in raw values, without parsing them.
+ *
+ * Only the structure needed to walk the members of an object and the elements of an array is read,
+ * each value is then parsed on its own, so that the memory used is bounded by the largest value.
+ */
+class JsonStreamReader
+{
+public:
+
+	explicit JsonStreamReader(QIODevice* device) :
+		_device(device),
+		_pos(0)
+	{
+
+	}
+
+	int peek() {
+
+		if (_pos >= _buffer.size()) {
+
+			_buffer = _device->read(ReadChunkSize);
+			_pos = 0;
+
+			if (_buffer.isEmpty()) {
+				return -1;
+			}
+		}
+
+		return static_cast<unsigned char>(_buffer[_pos]);
+	}
+
+	int get() {
+		int c = peek();
+
+		if (c >= 0) {
+			_pos++;
+		}
+
+		return c;
+	}
+
+	int skipSpaces() {
+
+		int c = peek();
+
+		while (c == ' ' or c == '\t' or c == '\n' or c == '\r') {
+			_pos++;
+			c = peek();
+		}
+
+		return c;
+	}
+
+	bool expect(char expected) {
+
+		if (skipSpaces() != expected) {
+			return false;
+		}
+
+		_pos++;
+		return true;
+	}
+
+	//! \brief read the next value as raw json text, strings, objects and arrays are matched without being parsed.
+	bool readRawValue(QByteArray* raw) {
+
+		raw->clear();
+
+		int c = skipSpaces();
+
+		if (c == '"') {
+			return readRawString(raw);
+		}
+
+		if (c == '{' or c == '[') {
+
+			int depth = 0;
+
+			do {
+
+				c = peek();
+
+				if (c < 0) {
+					return false;
+				}
+
+				if (c == '"') {
+					if (!readRawString(raw)) {
+						return false;
+					}
+					continue;
+				}
+
+				if (c == '{' or c == '[') {
+					depth++;
+				} else if (c == '}' or c == ']') {
+					depth--;
+				}
+
+				raw->append(static_cast<char>(c));
+				_pos++;
+
+			} while (depth > 0);
+
+			return true;
+		}
+
+		//numbers, booleans and null, up to the next delimiter.
+		while (c >= 0 and c != ',' and c != '}' and c != ']' and c != ' ' and c != '\t' and c != '\n' and c != '\r') {
+			raw->append(static_cast<char>(c));
+			_pos++;
+			c = peek();
+		}
+
+		return !raw->isEmpty();
+	}
+
+	static QJsonValue parse(QByteArray const& raw) {
+
+		if (raw.startsWith('{')) {
+			return QJsonDocument::fromJson(raw).object();
+		}
+
+		QJsonArray wrapper = QJsonDocument::fromJson("[" + raw + "]").array(); //scalars are not documents on their own.
+
+		return wrapper.isEmpty() ? QJsonValue() : wrapper.first();
+	}
+
+protected:
+
+	bool readRawString(QByteArray* raw) {
+
+		raw->append(static_cast<char>(get())); //the opening quote.
+
+		while (true) {
+
+			int c = get();
+
+			if (c < 0) {
+				return false;
+			}
+
+			raw->append(static_cast<char>(c));
+
+			if (c == '\\') {
+
+				int escaped = get();
+
+				if (escaped < 0) {
+					return false;
+				}
+
+				raw->append(static_cast<char>(escaped));
+				continue;
+			}
+
+			if (c == '"') {
+				return true;
+			}
+		}
+	}
+
+	QIODevice* _device;
+	QByteArray _buffer;
+	int _pos;
+};
+
+QJsonObject categoryToJson(CartographyCategory const* category) {
+
+	QJsonObject obj;
+
+	obj.insert("name", category->objectName());
+	obj.insert("color", category->getColor().name(QColor::HexArgb));
+	obj.insert("radius", category->getRadius());
+	obj.insert("borderColor", category->getBorderColor().name(QColor::HexArgb));
+	obj.insert("border", category->getBorder());
+	obj.insert("legendFont", category->getLegendFont());
+	obj.insert("legendUnderlined", category->getLegendUnderlined());
+	obj.insert("legendBold", category->getLegendBold());
+	obj.insert("legendItalic", category->getLegendItalic());
+	obj.insert("legendSize", category->getLegendSize());
+	obj.insert("legendColor", category->getLegendColor().name(QColor::HexArgb));
+
+	return obj;
+}
+
+//! \brief the positions of a GeoJSON geometry, with the y axis pointing up, as map points.
+QVector<QPointF> pointsFromJson(QJsonArray const& positions) {
+
+	QVector<QPointF> points;
+	points.reserve(positions.size());
+
+	for (QJsonValue const& value : positions) {
+
+		QJsonArray position = value.toArray();
+
+		if (position.size() >= 2) {
+			points.push_back(QPointF(position.at(0).toDouble(), -position.at(1).toDouble()));
+		}
+	}
+
+	return points;
+}
+
+QJsonArray pointsToJson(QVector<QPointF> const& points) {
+
+	QJsonArray positions;
+
+	for (QPointF const& p : points) {
+		positions.push_back(QJsonArray({p.x(), -p.y()}));
+	}
+
+	return positions;
+}
+
+void categoryFromJson(CartographyCategory* category, QJsonObject const& obj) {
+
+	//only the members present are applied, so that partial styles written by other tools keep the defaults.
+	if (obj.contains("color")) {
+		category->setColor(QColor(obj.value("color").toString()));
+	}
+	if (obj.contains("radius")) {
+		category->setRadius(obj.value("radius").toDouble());
+	}
+	if (obj.contains("borderColor")) {
+		category->setBorderColor(QColor(obj.value("borderColor").toString()));
+	}
+	if (obj.contains("border")) {
+		category->setBorder(obj.value("border").toDouble());
+	}
+	if (obj.contains("legendFont")) {
+		category->setLegendFont(obj.value("legendFont").toString());
+	}
+	if (obj.contains("legendUnderlined")) {
+		category->setLegendUnderlined(obj.value("legendUnderlined").toBool());
+	}
+	if (obj.contains("legendBold")) {
+		category->setLegendBold(obj.value("legendBold").toBool());
+	}
+	if (obj.contains("legendItalic")) {
+		category->setLegendItalic(obj.value("legendItalic").toBool());
+	}
+	if (obj.contains("legendSize")) {
+		category->setLegendSize(obj.value("legendSize").toInt());
+	}
+	if (obj.contains("legendColor")) {
+		category->setLegendColor(QColor(obj.value("legendColor").toString()));
+	}
+}
+
+} // namespace
+
+CartographyGeoJson::CartographyGeoJson() :
+	_categoryProperty(DefaultCategoryProperty),
+	_nameProperty("name")
+{
+
+}
+
+QString CartographyGeoJson::categoryProperty() const {
+	return _categoryProperty;
+}
+void CartographyGeoJson::setCategoryProperty(QString const& property) {
+	_categoryProperty = property;
+}
+
+QString CartographyGeoJson::nameProperty() const {
+	return _nameProperty;
+}
+void CartographyGeoJson::setNameProperty(QString const& property) {
+	_nameProperty = property;
+}
+
+bool CartographyGeoJson::exportCartography(Cartography const* cartography, QIODevice* device) const {
+
+	if (cartography == nullptr or device == nullptr or !device->isWritable()) {
+		return false;
+	}
+
+	auto write = [device] (QByteArray const& data) {
+		return device->write(data) == data.size();
+	};
+
+	QSizeF size = cartography->getSize();
+
+	bool ok = write("{\"type\":\"FeatureCollection\",\n");
+	ok = ok and write(QString("\"%1\":").arg(SizeMember).toUtf8());
+	ok = ok and write(QJsonDocument(QJsonArray({size.width(), size.height()})).toJson(QJsonDocument::Compact)); //without losing precision.
+	ok = ok and write(",\n");
+
+	//the categories are written before the features, so that a streaming reader knows them when it reads the items.
+	QJsonArray categories;
+	int stylesCount = cartography->categoryStyles().size();
+
+	for (int i = 0; i < stylesCount; i++) {
+
+		CartographyCategory* category = cartography->getCategoryByIndex(i);
+
+		if (category != nullptr) {
+			categories.push_back(categoryToJson(category));
+		}
+	}
+
+	ok = ok and write(QString("\"%1\":").arg(CategoriesMember).toUtf8());
+	ok = ok and write(QJsonDocument(categories).toJson(QJsonDocument::Compact));
+	ok = ok and write(",\n\"features\":[");
+
+	QMetaEnum legendPositions = QMetaEnum::fromType<CartographyItem::LegendPos>();
+	bool first = true;
+
+	for (CartographyItem* item : cartography->getItems()) {
+
+		if (!ok) {
+			break;
+		}
+
+		QPointF pos = item->getPosition();
+
+		QJsonObject geometry;
+		geometry.insert("type", "Point");
+		geometry.insert("coordinates", QJsonArray({pos.x(), -pos.y()}));
+
+		QJsonObject properties;
+		properties.insert(_nameProperty, item->objectName());
+
+		CartographyCategory* category = cartography->getCategoryByIndex(item->getCategoryIndex());
+
+		if (category != nullptr) {
+			properties.insert(_categoryProperty, category->objectName());
+		}
+
+		properties.insert(ScaleProperty, item->getScale());
+		properties.insert(LegendPositionProperty, QString(legendPositions.valueToKey(item->getLegendPosition())));
+
+		if (!item->getReferedItem().isEmpty()) {
+			properties.insert(ReferedItemProperty, item->getReferedItem());
+		}
+
+		QJsonObject feature;
+		feature.insert("type", "Feature");
+		feature.insert("geometry", geometry);
+		feature.insert("properties", properties);
+
+		ok = ok and write(first ? "\n" : ",\n");
+		ok = ok and write(QJsonDocument(feature).toJson(QJsonDocument::Compact));
+
+		first = false;
+	}
+
+	auto categoryName = [cartography] (int index) -> QJsonValue {
+
+		CartographyCategory* category = cartography->getCategoryByIndex(index);
+
+		if (category == nullptr) {
+			return QJsonValue(QJsonValue::Null);
+		}
+
+		return category->objectName();
+	};
+
+	for (CartographyVectorItem* item : cartography->getVectorItems()) {
+
+		if (!ok) {
+			break;
+		}
+
+		QVector<QPointF> points = item->getPoints();
+
+		QJsonObject geometry;
+		QJsonObject properties;
+		properties.insert(_nameProperty, item->objectName());
+
+		if (item->isClosed()) {
+
+			if (!points.isEmpty()) {
+				points.push_back(points.first()); //the rings of GeoJSON are explicitly closed.
+			}
+
+			geometry.insert("type", "Polygon");
+			QJsonArray rings;
+			rings.push_back(pointsToJson(points));
+
+			geometry.insert("coordinates", rings);
+
+			properties.insert(_categoryProperty, categoryName(item->getFillIndex()));
+			properties.insert(FillCategoryProperty, categoryName(item->getFillIndex()));
+
+		} else {
+			geometry.insert("type", "LineString");
+			geometry.insert("coordinates", pointsToJson(points));
+
+			properties.insert(_categoryProperty, categoryName(item->getStrokeIndex()));
+		}
+
+		properties.insert(StrokeCategoryProperty, categoryName(item->getStrokeIndex()));
+
+		QJsonObject feature;
+		feature.insert("type", "Feature");
+		feature.insert("geometry", geometry);
+		feature.insert("properties", properties);
+
+		ok = ok and write(first ? "\n" : ",\n");
+		ok = ok and write(QJsonDocument(feature).toJson(QJsonDocument::Compact));
+
+		first = false;
+	}
+
+	ok = ok and write("\n]}\n");
+
+	return ok;
+}
+
+bool CartographyGeoJson::exportCartography(Cartography const* cartography, QString const& fileName) const {
+
+	QSaveFile file(fileName);
+
+	if (!file.open(QIODevice::WriteOnly)) {
+		return false;
+	}
+
+	if (!exportCartography(cartography, &file)) {
+		file.cancelWriting();
+		return false;
+	}
+
+	return file.commit();
+}
+
+int CartographyGeoJson::importCartography(Cartography* cartography, QIODevice* device) const {
+
+	_error.clear();
+
+	if (cartography == nullptr or device == nullptr or !device->isReadable()) {
+		_error = QObject::tr("Rien à importer");
+		return -1;
+	}
+
+	QHash<QString, CartographyCategory*> categories;
+
+	for (QString const& ref : cartography->getCurrentCategoriesRefs()) {
+
+		CartographyCategory* category = cartography->getCategoryByRef(ref);
+
+		if (category != nullptr) {
+			categories.insert(category->objectName(), category);
+		}
+	}
+
+	auto categoryNamed = [cartography, &categories] (QString const& name) {
+
+		CartographyCategory* category = categories.value(name, nullptr);
+
+		if (category == nullptr) {
+			category = cartography->addCategory(name);
+			categories.insert(name, category);
+		}
+
+		return category;
+	};
+
+	QMetaEnum legendPositions = QMetaEnum::fromType<CartographyItem::LegendPos>();
+	int imported = 0;
+
+	//a category given by name, nullptr for null (no category).
+	auto categoryValue = [&categoryNamed] (QJsonValue const& category) -> CartographyCategory* {
+
+		if (category.isNull()) {
+			return nullptr;
+		}
+
+		return categoryNamed(category.isString() ? category.toString() : category.toVariant().toString());
+	};
+
+	auto importVectors = [&] (QJsonObject const& geometry, QJsonObject const& properties) {
+
+		QString type = geometry.value("type").toString();
+		QJsonArray coordinates = geometry.value("coordinates").toArray();
+
+		//the parts of the multi geometries become separate items.
+		QVector<QJsonArray> parts;
+
+		if (type == "LineString" or type == "Polygon") {
+			parts.push_back(coordinates);
+		} else {
+			for (QJsonValue const& part : coordinates) {
+				parts.push_back(part.toArray());
+			}
+		}
+
+		bool polygon = type.endsWith("Polygon");
+
+		QString name = properties.value(_nameProperty).toString();
+
+		if (name.isEmpty()) {
+			name = polygon ? QObject::tr("Zone importée") : QObject::tr("Tracé importé");
+		}
+
+		//the items keep the default category when no category is given.
+		QJsonValue main = properties.value(_categoryProperty);
+		QJsonValue stroke = properties.contains(StrokeCategoryProperty) ? properties.value(StrokeCategoryProperty) : main;
+		QJsonValue fill = properties.contains(FillCategoryProperty) ? properties.value(FillCategoryProperty) : main;
+
+		for (QJsonArray const& part : parts) {
+
+			QVector<QPointF> points = pointsFromJson(polygon ? part.at(0).toArray() : part); //the holes of the polygons are ignored.
+
+			if (polygon and points.size() > 1 and points.first() == points.last()) {
+				points.removeLast();
+			}
+
+			if (points.size() < (polygon ? 3 : 2)) {
+				continue;
+			}
+
+			CartographyVectorItem* item = cartography->addVectorItem(name,
+																	 polygon ? CartographyVectorItem::POLYGON : CartographyVectorItem::POLYLINE,
+																	 points);
+
+			if (!stroke.isUndefined()) {
+				item->setStrokeCategory(categoryValue(stroke));
+			}
+
+			if (polygon and !fill.isUndefined()) {
+				item->setFillCategory(categoryValue(fill));
+			}
+
+			imported++;
+		}
+	};
+
+	auto importFeature = [&] (QJsonObject const& feature) {
+
+		QJsonObject geometry = feature.value("geometry").toObject();
+		QJsonArray coordinates = geometry.value("coordinates").toArray();
+		QString type = geometry.value("type").toString();
+
+		QJsonObject properties = feature.value("properties").toObject();
+
+		if (type == "LineString" or type == "MultiLineString" or type == "Polygon" or type == "MultiPolygon") {
+			importVectors(geometry, properties);
+			return;
+		}
+
+		if (type != "Point" or coordinates.size() < 2) {
+			return;
+		}
+
+		QString name = properties.value(_nameProperty).toString();
+		QString refered = properties.value(ReferedItemProperty).toString();
+
+		CartographyItem* item = nullptr;
+
+		if (!refered.isEmpty() and cartography->getManager() != nullptr) {
+			item = cartography->addCartoItem(refered); //nullptr if the refered item is not in the project.
+		}
+
+		if (item == nullptr) {
+
+			if (name.isEmpty()) {
+				name = QObject::tr("Point importé");
+			}
+
+			item = cartography->addCartoPoint(name);
+			item->setObjectName(name);
+		}
+
+		//the item was not announced yet, so setting its properties does not notify the views.
+		item->setPosition(QPointF(coordinates.at(0).toDouble(), -coordinates.at(1).toDouble()));
+
+		QJsonValue category = properties.value(_categoryProperty);
+
+		if (!category.isUndefined() and !category.isNull()) {
+			QString categoryName = category.isString() ? category.toString() : category.toVariant().toString();
+			item->setCategory(categoryNamed(categoryName));
+		}
+
+		if (properties.contains(ScaleProperty)) {
+			item->setScale(properties.value(ScaleProperty).toDouble(1.0));
+		}
+
+		if (properties.contains(LegendPositionProperty)) {
+
+			bool ok;
+			int pos = legendPositions.keyToValue(properties.value(LegendPositionProperty).toString().toLatin1().constData(), &ok);
+
+			if (ok) {
+				item->setLegendPosition(static_cast<CartographyItem::LegendPos>(pos));
+			}
+		}
+
+		imported++;
+	};
+
+	JsonStreamReader reader(device);
+	QByteArray raw;
+
+	cartography->beginInsertionBatch();
+
+	auto fail = [this, cartography] (QString const& error) {
+		_error = error;
+		cartography->endInsertionBatch();
+		return -1;
+	};
+
+	if (!reader.expect('{')) {
+		return fail(QObject::tr("Le document GeoJSON n'est pas un objet"));
+	}
+
+	if (reader.skipSpaces() == '}') {
+		cartography->endInsertionBatch();
+		return 0;
+	}
+
+	while (true) {
+
+		if (!reader.readRawValue(&raw) or !raw.startsWith('"')) {
+			return fail(QObject::tr("Nom de membre invalide"));
+		}
+
+		QString member = JsonStreamReader::parse(raw).toString();
+
+		if (!reader.expect(':')) {
+			return fail(QObject::tr("Valeur manquante pour le membre %1").arg(member));
+		}
+
+		if (member == "features") {
+
+			if (!reader.expect('[')) {
+				return fail(QObject::tr("Les features ne sont pas un tableau"));
+			}
+
+			if (reader.skipSpaces() == ']') {
+				reader.get();
+			} else {
+
+				while (true) {
+
+					if (!reader.readRawValue(&raw)) {
+						return fail(QObject::tr("Feature tronquée"));
+					}
+
+					importFeature(JsonStreamReader::parse(raw).toObject());
+
+					int c = reader.skipSpaces();
+					reader.get();
+
+					if (c == ']') {
+						break;
+					}
+
+					if (c != ',') {
+						return fail(QObject::tr("Tableau de features invalide"));
+					}
+				}
+			}
+
+		} else {
+
+			if (!reader.readRawValue(&raw)) {
+				return fail(QObject::tr("Valeur invalide pour le membre %1").arg(member));
+			}
+
+			if (member == CategoriesMember) {
+
+				//the styles apply to the categories of the same name, whether the features were read before or not.
+				for (QJsonValue const& value : JsonStreamReader::parse(raw).toArray()) {
+
+					QJsonObject obj = value.toObject();
+					QString name = obj.value("name").toString();
+
+					if (!name.isEmpty()) {
+						categoryFromJson(categoryNamed(name), obj);
+					}
+				}
+
+			} else if (member == SizeMember and cartography->getItems().isEmpty()) {
+
+				QJsonArray size = JsonStreamReader::parse(raw).toArray();
+
+				if (size.size() == 2) {
+					cartography->setSize(QSizeF(size.at(0).toDouble(), size.at(1).toDouble()));
+				}
+
+			} else if (member == "type" and JsonStreamReader::parse(raw).toString() != "FeatureCollection") {
+				return fail(QObject::tr("Le document GeoJSON n'est pas une FeatureCollection"));
+			}
+		}
+
+		int c = reader.skipSpaces();
+		reader.get();
+
+		if (c == '}') {
+			break;
+		}
+
+		if (c != ',') {
+			return fail(QObject::tr("Objet GeoJSON invalide"));
+		}
+	}
+
+	cartography->endInsertionBatch();
+
+	return imported;
+}
+
+int CartographyGeoJson::importCartography(Cartography* cartography, QString const& fileName) const {
+
+	QFile file(fileName);
+
+	if (!file.open(QIODevice::ReadOnly)) {
+		_error = file.errorString();
+		return -1;
+	}
+
+	return importCartography(cartography, &file);
+}
+
+QString CartographyGeoJson::errorString() const {
+	return _error;
+}
+
+} // namespace Sabrina
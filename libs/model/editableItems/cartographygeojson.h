@@ -0,0 +1,87 @@
+#ifndef SABRINA_CARTOGRAPHYGEOJSON_H
+#define SABRINA_CARTOGRAPHYGEOJSON_H
+
+/*
+This file is part of the project Sabrina
+Copyright (C) 2023  Paragon <french.paragon@gmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "model/model_global.h"
+
+#include <QString>
+
+class QIODevice;
+
+namespace Sabrina {
+
+class Cartography;
+
+/*!
+ * \brief The CartographyGeoJson class import and export the items of a cartography as a GeoJSON FeatureCollection.
+ *
+ * Each item is a Point feature, its name, category, scale and legend position are stored in the properties of the feature.
+ * The paths are LineString features and the regions Polygon features, their stroke and fill categories are stored in the properties,
+ * the category property holding the stroke category of the paths and the fill category of the regions, for the other tools.
+ * The size of the map and the styles of the categories are stored as foreign members of the collection ("sabrina:size" and "sabrina:categories").
+ * The coordinates are the map coordinates with the y axis pointing up, as for an image without georeferencing in the GIS tools.
+ *
+ * The features are written and read one at a time, the collection is never held in memory as a whole.
+ */
+class CATHIA_MODEL_EXPORT CartographyGeoJson
+{
+public:
+
+	static const QString DefaultCategoryProperty;
+
+	CartographyGeoJson();
+
+	//! \brief the property of the features holding the name of their category, "category" by default.
+	QString categoryProperty() const;
+	void setCategoryProperty(QString const& property);
+
+	//! \brief the property of the features holding the name of the items, "name" by default.
+	QString nameProperty() const;
+	void setNameProperty(QString const& property);
+
+	//! \brief write the items, the paths and regions and the categories of the cartography to an already open device.
+	bool exportCartography(Cartography const* cartography, QIODevice* device) const;
+	//! \brief write the items and the categories of the cartography to a file, the file is only replaced if the export succeed.
+	bool exportCartography(Cartography const* cartography, QString const& fileName) const;
+
+	/*!
+	 * \brief add the features of a collection to the cartography, in a single insertion batch.
+	 *
+	 * The points become items, the (multi) line strings paths and the (multi) polygons regions, only the outer ring of the polygons is kept.
+	 * The categories are matched by name, the missing ones are created. The other geometries are skipped.
+	 * \return the number of items added, -1 if the collection could not be read (the items read before the error are kept).
+	 */
+	int importCartography(Cartography* cartography, QIODevice* device) const;
+	int importCartography(Cartography* cartography, QString const& fileName) const;
+
+	//! \brief the error of the last import, empty if it succeeded.
+	QString errorString() const;
+
+protected:
+
+	QString _categoryProperty;
+	QString _nameProperty;
+
+	mutable QString _error;
+};
+
+} // namespace Sabrina
+
+#endif // SABRINA_CARTOGRAPHYGEOJSON_H
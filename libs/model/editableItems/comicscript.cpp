@@ -41,6 +41,7 @@ Comicscript::Comicscript(QString ref, Aline::EditableItemManager *parent) :
 	connect(this, &Comicscript::titleChanged, this, &Comicscript::newUnsavedChanges);
 
 	connect(_document, &TextNode::nodeAdded, this, &Comicscript::newUnsavedChanges);
+	connect(_document, &TextNode::nodesAdded, this, &Comicscript::newUnsavedChanges);
 	connect(_document, &TextNode::nodeRemoved, this, &Comicscript::newUnsavedChanges);
 	connect(_document, &TextNode::nodeEdited, this, &Comicscript::newUnsavedChanges);
 	connect(_document, &TextNode::nodeLineLayoutChanged, this, &Comicscript::newUnsavedChanges);
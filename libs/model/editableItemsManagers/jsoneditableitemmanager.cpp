@@ -316,6 +316,17 @@ bool JsonEditableItemManager::isNetworkShared() const {
 	return false;
 }
 
+QStringList JsonEditableItemManager::itemsRefsOfType(QString const& typeId) const {
+
+	QStringList refs;
+
+	for (treeStruct* leaf : _itemsByTypes.value(typeId)) {
+		refs.push_back(leaf->_ref);
+	}
+
+	return refs;
+}
+
 void JsonEditableItemManager::addExtractorDelegate(QString const& type, Extractor const& e) {
 	_delegate_extractors.insert(type, e);
 }
@@ -71,6 +71,9 @@ public:
 
 	virtual bool isNetworkShared() const;
 
+	//! \brief the references of all the items of a given type in the project, without loading them.
+	QStringList itemsRefsOfType(QString const& typeId) const;
+
 	void addExtractorDelegate(QString const& type, Extractor const& e);
 	void addEncapsulatorDelegate(QString const& type, Encapsulator const& e);
 
@@ -19,16 +19,21 @@ along with this program.  If not, see <https://www.gnu.org/licenses/>.
 #include "abstracttextstyle.h"
 
 #include "textnode.h"
-
-#include <QFontMetrics>
+#include "textstylemanager.h"
 
 #include <cmath>
 
 namespace Sabrina {
 
-AbstractTextNodeStyle::AbstractTextNodeStyle(QObject *parent) : QObject(parent)
-{
+TextLineDecorator::~TextLineDecorator() {
+
+}
 
+AbstractTextNodeStyle::AbstractTextNodeStyle(QObject *parent) :
+	QObject(parent),
+	_styleManager(nullptr)
+{
+	connect(this, &AbstractTextNodeStyle::updated, this, &AbstractTextNodeStyle::clearCache);
 }
 
 QString AbstractTextNodeStyle::getPrefix(TextLine* line) const {
@@ -39,12 +44,13 @@ QString AbstractTextNodeStyle::getSuffix(TextLine* line) const {
 	Q_UNUSED(line);
 	return "";
 }
+QString AbstractTextNodeStyle::getNodeLabel(TextNode* node) const {
+	Q_UNUSED(node);
+	return "";
+}
 
 int AbstractTextNodeStyle::getLineHeight(TextLine* line) const {
-	QFont f = getFont(line);
-	QFontMetrics fm(f);
-
-	return fm.ascent() + fm.descent();
+	return metricsCache()->lineHeight(getFont(line));
 }
 
 QMargins AbstractTextNodeStyle::getLineMargins(TextLine* line) const {
@@ -100,7 +106,8 @@ void AbstractTextNodeStyle::renderNode(TextNode* node,
 									   TextNode::NodeCoordinate selectionEnd,
 									   int cursorLine,
 									   int cursorPos,
-									   QTextCharFormat const& selectionFormat) {
+									   QTextCharFormat const& selectionFormat,
+									   TextLineDecorator* decorator) {
 
 	layNodeOut(node, availableWidth);
 
@@ -125,9 +132,9 @@ void AbstractTextNodeStyle::renderNode(TextNode* node,
 		}
 
 		if (cursorLine == i) {
-			renderLine(node->lineAt(i), offset, painter, lSelStart, lSelEnd, cursorPos, selectionFormat);
+			renderLine(node->lineAt(i), offset, painter, lSelStart, lSelEnd, cursorPos, selectionFormat, decorator);
 		} else {
-			renderLine(node->lineAt(i), offset, painter, lSelStart, lSelEnd, -1, selectionFormat);
+			renderLine(node->lineAt(i), offset, painter, lSelStart, lSelEnd, -1, selectionFormat, decorator);
 		}
 	}
 
@@ -241,16 +248,45 @@ void AbstractTextNodeStyle::clearCache() {
 	_cache.clear();
 }
 
+TextStyleManager* AbstractTextNodeStyle::styleManager() const {
+	return _styleManager;
+}
+
+void AbstractTextNodeStyle::setStyleManager(TextStyleManager* manager) {
+	_styleManager = manager;
+	_ownMetricsCache.clear();
+}
+
+FontMetricsCache* AbstractTextNodeStyle::metricsCache() const {
+
+	if (_styleManager != nullptr) {
+		return _styleManager->metricsCache();
+	}
+
+	return &_ownMetricsCache;
+}
+
 void AbstractTextNodeStyle::renderLine(TextLine* line,
 				const QPointF &offset,
 				QPainter & painter,
 				int selectionStart,
 				int selectionEnd,
 				int cursorStart,
-				const QTextCharFormat &selectionFormat) const {
+				const QTextCharFormat &selectionFormat,
+				TextLineDecorator* decorator) const {
 
 	QVector<QTextLayout::FormatRange> selections;
 
+	if (decorator != nullptr) { //drawn before the selection, which stays on top.
+		selections = decorator->lineDecorations(line);
+
+		int p = getPrefix(line).size();
+
+		for (QTextLayout::FormatRange & range : selections) {
+			range.start += p;
+		}
+	}
+
 	int sStart = selectionStart < 0 ? 0 : selectionStart;
 	int sEnd = selectionEnd < 0 ? line->getText().length() + selectionEnd + 1 : selectionEnd;
 	int l = sEnd - sStart;
@@ -285,16 +321,41 @@ void AbstractTextNodeStyle::layOutLine(TextLine* line,
 						const QPointF &offset,
 						int availableWidth) const {
 
-	QTextLayout & layout = *(_cache[line].layout.get());
+	LineLayoutCache & cache = _cache[line];
+	QTextLayout & layout = *(cache.layout.get());
+
+	QMargins m = getLineMargins(line);
+	QString prefix = getPrefix(line);
+	QString suffix = getSuffix(line);
+
+	if (cache.usedAvailableWidth == availableWidth and
+		cache.usedRevision == line->revision() and
+		cache.usedMargins == m and
+		cache.usedPrefix == prefix and
+		cache.usedSuffix == suffix) {
+
+		if (cache.usedOffset != offset) { //the line only moved within the node, no need to break it again.
+			QPointF delta = offset - cache.usedOffset;
+
+			for (int i = 0; i < layout.lineCount(); i++) {
+				QTextLine textline = layout.lineAt(i);
+				textline.setPosition(textline.position() + delta);
+			}
+
+			cache.usedOffset = offset;
+		}
 
-	if (_cache[line].usedAvailableWidth == availableWidth and
-		layout.text() == getPrefix(line) + line->getText() + getSuffix(line)) {
 		return;
 	}
 
-	QMargins m = getLineMargins(line);
+	cache.usedAvailableWidth = availableWidth;
+	cache.usedRevision = line->revision();
+	cache.usedOffset = offset;
+	cache.usedMargins = m;
+	cache.usedPrefix = prefix;
+	cache.usedSuffix = suffix;
 
-	layout.setText(getPrefix(line) + line->getText() + getSuffix(line));
+	layout.setText(prefix + line->getText() + suffix);
 	layout.setFont(getFont(line));
 
 	float height = offset.y() + m.top();
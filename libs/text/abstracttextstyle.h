@@ -24,12 +24,26 @@ along with this program.  If not, see <https://www.gnu.org/licenses/>.
 #include <QTextLayout>
 
 #include "textnode.h"
+#include "fontmetricscache.h"
 
 #include "./text_global.h"
 
 namespace Sabrina {
 
 class TextLine;
+class TextStyleManager;
+
+/*!
+ * \brief The TextLineDecorator class provide formats drawn over the text of the lines when a node is rendered (for example spelling errors).
+ */
+class SABRINA_TEXT_EXPORT TextLineDecorator
+{
+public:
+	virtual ~TextLineDecorator();
+
+	//! \brief the formats to draw over the line, the ranges are relative to the text of the line (without its prefix).
+	virtual QVector<QTextLayout::FormatRange> lineDecorations(TextLine* line) = 0;
+};
 
 class SABRINA_TEXT_EXPORT AbstractTextNodeStyle : public QObject
 {
@@ -42,6 +56,8 @@ public:
 
 	virtual QString getPrefix(TextLine* line) const;
 	virtual QString getSuffix(TextLine* line) const;
+	//! \brief a label identifying the node, displayed before its first line (for example a page number), empty by default.
+	virtual QString getNodeLabel(TextNode* node) const;
 
 	virtual QFont getFont(TextLine* line) const = 0;
 	virtual int getLineHeight(TextLine* line) const;
@@ -64,7 +80,8 @@ public:
 							TextNode::NodeCoordinate selectionEnd = {0,0},
 							int cursorLine = -1,
 							int cursorPos = 0,
-							const QTextCharFormat &selectionFormat = QTextCharFormat());
+							const QTextCharFormat &selectionFormat = QTextCharFormat(),
+							TextLineDecorator* decorator = nullptr);
 
 
 	int nodeHeight(TextNode* node, int availableWidth) const;
@@ -74,19 +91,27 @@ public:
 
 	void clearCache();
 
+	TextStyleManager* styleManager() const;
+	//! \brief set the manager the style is registered in, called by TextStyleManager::registerStyle.
+	void setStyleManager(TextStyleManager* manager);
+
 Q_SIGNALS:
 
 	void updated();
 
 protected:
 
+	//! \brief the metrics cache of the style manager, or a private one if the style is not registered.
+	FontMetricsCache* metricsCache() const;
+
 	void renderLine(TextLine* line,
 	                const QPointF &offset,
 	                QPainter & painter,
 	                int selectionStart = 0,
 	                int selectionEnd = -1,
 					int cursorStart = -1,
-					const QTextCharFormat &selectionFormat = QTextCharFormat()) const;
+					const QTextCharFormat &selectionFormat = QTextCharFormat(),
+					TextLineDecorator* decorator = nullptr) const;
 	virtual void layOutLine(TextLine* line,
 							const QPointF &offset,
 							int availableWidth) const;
@@ -95,6 +120,7 @@ protected:
 
 		LineLayoutCache() :
 			usedAvailableWidth(-1),
+			usedRevision(0),
 			layout(new QTextLayout)
 		{
 
@@ -102,6 +128,11 @@ protected:
 
 		LineLayoutCache(LineLayoutCache const& other) :
 			usedAvailableWidth(other.usedAvailableWidth),
+			usedRevision(other.usedRevision),
+			usedOffset(other.usedOffset),
+			usedMargins(other.usedMargins),
+			usedPrefix(other.usedPrefix),
+			usedSuffix(other.usedSuffix),
 			layout(other.layout)
 		{
 
@@ -109,16 +140,29 @@ protected:
 
 		LineLayoutCache& operator=(LineLayoutCache const& other) {
 			usedAvailableWidth = other.usedAvailableWidth;
+			usedRevision = other.usedRevision;
+			usedOffset = other.usedOffset;
+			usedMargins = other.usedMargins;
+			usedPrefix = other.usedPrefix;
+			usedSuffix = other.usedSuffix;
 			layout = other.layout;
 			return *this;
 		}
 
 		int usedAvailableWidth;
+		quint64 usedRevision; //revision of the line text when the layout was computed.
+		QPointF usedOffset;
+		QMargins usedMargins;
+		QString usedPrefix; //the prefix and suffix can change without the line, for example when the nodes are renumbered.
+		QString usedSuffix;
 		std::shared_ptr<QTextLayout> layout;
 	};
 
 	mutable QMap<TextLine*, LineLayoutCache> _cache;
 
+	TextStyleManager* _styleManager;
+	mutable FontMetricsCache _ownMetricsCache;
+
 };
 
 } // namespace Sabrina
@@ -18,28 +18,30 @@ along with this program.  If not, see <https://www.gnu.org/licenses/>.
 
 #include "comicscript.h"
 
-#include <QFontMetrics>
 #include <QPainter>
 
 namespace Sabrina {
 
 ComicScriptStyle::ComicScriptStyle(QObject* parent) :
-	AbstractTextNodeStyle(parent)
+	AbstractTextNodeStyle(parent),
+	_font("Monospace", 12),
+	_boldFont(_font)
 {
-
+	_boldFont.setBold(true);
 }
 
 QFont ComicScriptStyle::getFont(TextLine* line) const {
 
 	Q_UNUSED(line);
-	return QFont("Monospace", 12);
+	return _font;
 }
 
 
 ComicScriptTitleStyle::ComicScriptTitleStyle(QObject* parent) :
 	ComicScriptStyle(parent)
 {
-
+	_font.setPointSize(18);
+	_boldFont.setPointSize(18);
 }
 
 int ComicScriptTitleStyle::typeId() const {
@@ -50,10 +52,6 @@ QString ComicScriptTitleStyle::typeName() const {
 }
 
 
-QFont ComicScriptTitleStyle::getFont(TextLine* line) const {
-	Q_UNUSED(line);
-	return QFont("Monospace", 18);
-}
 QMargins ComicScriptTitleStyle::getNodeMargins(TextNode* node) const {
 
 	if (node->isRootNode()) {
@@ -71,13 +69,13 @@ ComicScriptDescribedStyle::ComicScriptDescribedStyle(QObject* parent) :
 
 QMargins ComicScriptDescribedStyle::getLineMargins(TextLine* line) const {
 
-	QFont f = getFont(line);
-	f.setBold(true);
-
-	QFontMetrics fm(f);
 	QString descr = getDescr(line->nodeParent()) + ": ";
 
-	return QMargins(fm.horizontalAdvance(descr), 0, 0, 0);
+	return QMargins(metricsCache()->horizontalAdvance(_boldFont, descr), 0, 0, 0);
+}
+
+QString ComicScriptDescribedStyle::getNodeLabel(TextNode* node) const {
+	return getDescr(node);
 }
 
 void ComicScriptDescribedStyle::renderNode(TextNode* node,
@@ -88,20 +86,17 @@ void ComicScriptDescribedStyle::renderNode(TextNode* node,
 										   TextNode::NodeCoordinate selectionEnd,
 										   int cursorLine,
 										   int cursorPos,
-										   const QTextCharFormat &selectionFormat) {
+										   const QTextCharFormat &selectionFormat,
+										   TextLineDecorator* decorator) {
 
 	QMargins m = getNodeMargins(node);
 
-	QFont f = getFont(node->lineAt(0));
-	f.setBold(true);
-
-	QFontMetrics fm(f);
 	QString descr = getDescr(node) + ": ";
 
-	painter.setFont(f);
-	painter.drawText(QPointF(offset.x() + m.left(), offset.y() + fm.ascent() + m.top()), descr);
+	painter.setFont(_boldFont);
+	painter.drawText(QPointF(offset.x() + m.left(), offset.y() + metricsCache()->ascent(_boldFont) + m.top()), descr);
 
-	ComicScriptStyle::renderNode(node, offset, availableWidth, painter, selectionStart, selectionEnd, cursorLine, cursorPos, selectionFormat);
+	ComicScriptStyle::renderNode(node, offset, availableWidth, painter, selectionStart, selectionEnd, cursorLine, cursorPos, selectionFormat, decorator);
 
 }
 
@@ -202,18 +197,16 @@ QString ComicScriptDialogStyle::getSuffix(TextLine* line) const {
 
 QFont ComicScriptDialogStyle::getFont(TextLine* line) const {
 
-	QFont f = ComicScriptStyle::getFont(line);
-	f.setBold(line->nodeParent()->lineAt(0) == line);
-	return f;
+	if (line->nodeParent()->lineAt(0) == line) {
+		return _boldFont;
+	}
+
+	return _font;
 
 }
 int ComicScriptDialogStyle::getTabulation(TextLine* line) const {
 	if (line->nodeParent()->lineAt(1) == line) {
-		QFont f = getFont(line);
-
-		QFontMetrics fm(f);
-
-		return -fm.horizontalAdvance(getPrefix(line));
+		return -metricsCache()->horizontalAdvance(getFont(line), getPrefix(line));
 	}
 
 	return 0;
@@ -226,10 +219,7 @@ QMargins ComicScriptDialogStyle::getLineMargins(TextLine* line) const {
 
 	TextLine* d = line->nodeParent()->lineAt(1);
 
-	QFont f = getFont(line);
-	QFontMetrics fm(f);
-
-	QMargins r(fm.horizontalAdvance(getPrefix(d)), (line != line->nodeParent()->lineAt(0)) ? getLineHeight(line)/3 : 0, 0, 0);
+	QMargins r(metricsCache()->horizontalAdvance(getFont(line), getPrefix(d)), (line != line->nodeParent()->lineAt(0)) ? getLineHeight(line)/3 : 0, 0, 0);
 	return r;
 }
 
@@ -335,4 +325,8 @@ QVector<int> ComicScriptTextStyleManager::getAuthorizedChildrenStyles(int code)
 	return {};
 }
 
+TextStyleManager* ComicScriptTextStyleManager::clone(QObject* parent) const {
+	return new ComicScriptTextStyleManager(parent); //the comic script styles are not configurable.
+}
+
 } // namespace Sabrina
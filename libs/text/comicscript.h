@@ -43,6 +43,11 @@ public:
 	ComicScriptStyle(QObject* parent = nullptr);
 
 	QFont getFont(TextLine* line) const override;
+
+protected:
+
+	QFont _font;
+	QFont _boldFont;
 };
 
 class SABRINA_TEXT_EXPORT ComicScriptTitleStyle : public ComicScriptStyle
@@ -55,7 +60,6 @@ public:
 	int typeId() const override;
 	QString typeName() const override;
 
-	QFont getFont(TextLine* line) const override;
 	QMargins getNodeMargins(TextNode* node) const override;
 };
 
@@ -69,6 +73,7 @@ public:
 	QMargins getLineMargins(TextLine* line) const override;
 
 	virtual QString getDescr(TextNode* node) const = 0;
+	QString getNodeLabel(TextNode* node) const override;
 
 	void renderNode(TextNode* node,
 					const QPointF &offset,
@@ -78,7 +83,8 @@ public:
 					TextNode::NodeCoordinate selectionEnd = {0,0},
 					int cursorLine = -1,
 					int cursorPos = 0,
-					const QTextCharFormat &selectionFormat = QTextCharFormat()) override;
+					const QTextCharFormat &selectionFormat = QTextCharFormat(),
+					TextLineDecorator* decorator = nullptr) override;
 };
 
 class SABRINA_TEXT_EXPORT ComicScriptPageStyle : public ComicScriptDescribedStyle
@@ -156,6 +162,8 @@ public:
 	QMap<Qt::KeyboardModifiers, NextNodeStyleAndPos> getNextNodeStyleAndPos(int code) const override;
 	QMap<LevelJump, int> defaultFollowingStyle(int code) const override;
 	QVector<int> getAuthorizedChildrenStyles(int code) const override;
+
+	TextStyleManager* clone(QObject* parent = nullptr) const override;
 };
 
 } // namespace Sabrina
@@ -0,0 +1,411 @@
+/*
+This file is part of the project Sabrina
+Copyright (C) 2023  Paragon <french.paragon@gmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "documentexporters.h"
+
+#include "textnode.h"
+#include "textstylemanager.h"
+#include "abstracttextstyle.h"
+
+#include <QIODevice>
+#include <QSaveFile>
+
+#include <algorithm>
+
+namespace Sabrina {
+
+TextDocumentExporter* TextDocumentExporter::createExporter(QString const& format, TextStyleManager* styles) {
+
+	if (format == HtmlTextExporter::FORMAT_ID) {
+		return new HtmlTextExporter(styles);
+	}
+
+	if (format == PlainScriptTextExporter::FORMAT_ID) {
+		return new PlainScriptTextExporter(styles);
+	}
+
+	if (format == FlatOdtTextExporter::FORMAT_ID) {
+		return new FlatOdtTextExporter(styles);
+	}
+
+	return nullptr;
+}
+QStringList TextDocumentExporter::availableFormats() {
+	return {HtmlTextExporter::FORMAT_ID, PlainScriptTextExporter::FORMAT_ID, FlatOdtTextExporter::FORMAT_ID};
+}
+
+TextDocumentExporter::TextDocumentExporter(TextStyleManager* styles) :
+	_device(nullptr),
+	_styles(styles)
+{
+
+}
+TextDocumentExporter::~TextDocumentExporter() {
+
+}
+
+TextStyleManager* TextDocumentExporter::styleManager() const {
+	return _styles;
+}
+void TextDocumentExporter::setStyleManager(TextStyleManager* styles) {
+	_styles = styles;
+}
+
+QString TextDocumentExporter::title() const {
+	return _title;
+}
+void TextDocumentExporter::setTitle(QString const& title) {
+	_title = title;
+}
+
+bool TextDocumentExporter::exportDocument(TextNode* root, QIODevice* device) {
+
+	if (root == nullptr or device == nullptr) {
+		return false;
+	}
+
+	if (!device->isWritable()) {
+		return false;
+	}
+
+	_device = device;
+	_styleNames = (_styles != nullptr) ? _styles->getStyleMapNames() : QMap<int, QString>();
+
+	bool ok = writeHeader();
+	ok = ok and exportNode(root, 0);
+	ok = ok and writeFooter();
+
+	_device = nullptr;
+
+	return ok;
+}
+bool TextDocumentExporter::exportDocument(TextNode* root, QString const& fileName) {
+
+	QSaveFile file(fileName);
+
+	if (!file.open(QIODevice::WriteOnly)) {
+		return false;
+	}
+
+	if (!exportDocument(root, &file)) {
+		file.cancelWriting();
+		return false;
+	}
+
+	return file.commit();
+}
+
+bool TextDocumentExporter::exportNode(TextNode* node, int depth) {
+
+	if (!writeNodeStart(node, depth)) {
+		return false;
+	}
+
+	for (TextNode* child : node->childNodes()) {
+		if (!exportNode(child, depth+1)) {
+			return false;
+		}
+	}
+
+	return writeNodeEnd(node, depth);
+}
+
+QString TextDocumentExporter::styleName(int styleId) const {
+	return _styleNames.value(styleId, QString("style_%1").arg(styleId));
+}
+QString TextDocumentExporter::nodeLabel(TextNode* node) const {
+
+	if (_styles == nullptr) {
+		return "";
+	}
+
+	AbstractTextNodeStyle* style = _styles->getStyleByCode(node->styleId());
+
+	if (style == nullptr) {
+		return "";
+	}
+
+	return style->getNodeLabel(node);
+}
+QString TextDocumentExporter::lineText(TextLine* line) const {
+
+	if (_styles == nullptr) {
+		return line->getText();
+	}
+
+	AbstractTextNodeStyle* style = _styles->getStyleByCode(line->nodeParent()->styleId());
+
+	if (style == nullptr) {
+		return line->getText();
+	}
+
+	return style->getPrefix(line) + line->getText() + style->getSuffix(line);
+}
+
+
+const QString HtmlTextExporter::FORMAT_ID = "html";
+
+HtmlTextExporter::HtmlTextExporter(TextStyleManager* styles) :
+	TextDocumentExporter(styles)
+{
+	_out.setCodec("UTF-8");
+}
+
+QString HtmlTextExporter::formatId() const {
+	return FORMAT_ID;
+}
+QString HtmlTextExporter::fileExtension() const {
+	return ".html";
+}
+
+bool HtmlTextExporter::writeHeader() {
+
+	_out.setDevice(_device);
+
+	_out << "<!DOCTYPE html>\n<html>\n<head>\n<meta charset=\"utf-8\">\n";
+	_out << "<title>" << _title.toHtmlEscaped() << "</title>\n";
+	_out << "</head>\n<body>\n";
+
+	return _out.status() == QTextStream::Ok;
+}
+bool HtmlTextExporter::writeNodeStart(TextNode* node, int depth) {
+
+	QString indent(depth+1, '\t');
+
+	_out << indent << "<div class=\"" << styleName(node->styleId()).toHtmlEscaped() << "\" data-style-id=\"" << node->styleId() << "\">\n";
+
+	QString label = nodeLabel(node);
+
+	for (int i = 0; i < node->nbTextLines(); i++) {
+
+		_out << indent << "\t<p>";
+
+		if (i == 0 and !label.isEmpty()) {
+			_out << "<span class=\"label\">" << label.toHtmlEscaped() << ": </span>";
+		}
+
+		_out << lineText(node->lineAt(i)).toHtmlEscaped() << "</p>\n";
+	}
+
+	return _out.status() == QTextStream::Ok;
+}
+bool HtmlTextExporter::writeNodeEnd(TextNode* node, int depth) {
+
+	Q_UNUSED(node);
+
+	_out << QString(depth+1, '\t') << "</div>\n";
+
+	return _out.status() == QTextStream::Ok;
+}
+bool HtmlTextExporter::writeFooter() {
+
+	_out << "</body>\n</html>\n";
+	_out.flush();
+
+	bool ok = _out.status() == QTextStream::Ok;
+	_out.setDevice(nullptr);
+
+	return ok;
+}
+
+
+const QString PlainScriptTextExporter::FORMAT_ID = "txt";
+
+PlainScriptTextExporter::PlainScriptTextExporter(TextStyleManager* styles) :
+	TextDocumentExporter(styles)
+{
+	_out.setCodec("UTF-8");
+}
+
+QString PlainScriptTextExporter::formatId() const {
+	return FORMAT_ID;
+}
+QString PlainScriptTextExporter::fileExtension() const {
+	return ".txt";
+}
+
+bool PlainScriptTextExporter::writeHeader() {
+
+	_out.setDevice(_device);
+
+	if (!_title.isEmpty()) {
+		_out << "Title: " << _title << "\n\n";
+	}
+
+	return _out.status() == QTextStream::Ok;
+}
+bool PlainScriptTextExporter::writeNodeStart(TextNode* node, int depth) {
+
+	QString indent(2*std::max(depth-1, 0), ' ');
+
+	if (depth > 0) {
+		_out << "\n"; //blocks are separated by blank lines.
+	}
+
+	QString label = nodeLabel(node);
+
+	for (int i = 0; i < node->nbTextLines(); i++) {
+
+		QString txt = lineText(node->lineAt(i));
+
+		if (i == 0 and !label.isEmpty()) {
+			txt = label.toUpper() + (txt.isEmpty() ? QString() : QString(": ") + txt);
+		}
+
+		_out << indent << txt << "\n";
+	}
+
+	return _out.status() == QTextStream::Ok;
+}
+bool PlainScriptTextExporter::writeNodeEnd(TextNode* node, int depth) {
+	Q_UNUSED(node);
+	Q_UNUSED(depth);
+	return true;
+}
+bool PlainScriptTextExporter::writeFooter() {
+
+	_out.flush();
+
+	bool ok = _out.status() == QTextStream::Ok;
+	_out.setDevice(nullptr);
+
+	return ok;
+}
+
+
+const QString FlatOdtTextExporter::FORMAT_ID = "fodt";
+
+namespace {
+
+const QString OfficeNs = "urn:oasis:names:tc:opendocument:xmlns:office:1.0";
+const QString StyleNs = "urn:oasis:names:tc:opendocument:xmlns:style:1.0";
+const QString TextNs = "urn:oasis:names:tc:opendocument:xmlns:text:1.0";
+const QString FoNs = "urn:oasis:names:tc:opendocument:xmlns:xsl-fo-compatible:1.0";
+const QString DcNs = "http://purl.org/dc/elements/1.1/";
+
+const QString LabelStyleName = "SabrinaLabel";
+
+} // namespace
+
+FlatOdtTextExporter::FlatOdtTextExporter(TextStyleManager* styles) :
+	TextDocumentExporter(styles)
+{
+
+}
+
+QString FlatOdtTextExporter::formatId() const {
+	return FORMAT_ID;
+}
+QString FlatOdtTextExporter::fileExtension() const {
+	return ".fodt";
+}
+
+bool FlatOdtTextExporter::writeHeader() {
+
+	_xml.setDevice(_device);
+	_xml.setAutoFormatting(true);
+
+	_xml.writeStartDocument();
+
+	_xml.writeNamespace(OfficeNs, "office");
+	_xml.writeNamespace(StyleNs, "style");
+	_xml.writeNamespace(TextNs, "text");
+	_xml.writeNamespace(FoNs, "fo");
+	_xml.writeNamespace(DcNs, "dc");
+
+	_xml.writeStartElement(OfficeNs, "document");
+	_xml.writeAttribute(OfficeNs, "version", "1.2");
+	_xml.writeAttribute(OfficeNs, "mimetype", "application/vnd.oasis.opendocument.text");
+
+	_xml.writeStartElement(OfficeNs, "meta");
+	_xml.writeTextElement(DcNs, "title", _title);
+	_xml.writeEndElement();
+
+	_xml.writeStartElement(OfficeNs, "styles");
+
+	_xml.writeStartElement(StyleNs, "style");
+	_xml.writeAttribute(StyleNs, "name", LabelStyleName);
+	_xml.writeAttribute(StyleNs, "family", "text");
+	_xml.writeEmptyElement(StyleNs, "text-properties");
+	_xml.writeAttribute(FoNs, "font-weight", "bold");
+	_xml.writeEndElement();
+
+	for (auto it = _styleNames.constBegin(); it != _styleNames.constEnd(); it++) {
+		_xml.writeStartElement(StyleNs, "style");
+		_xml.writeAttribute(StyleNs, "name", paragraphStyleName(it.key()));
+		_xml.writeAttribute(StyleNs, "display-name", it.value());
+		_xml.writeAttribute(StyleNs, "family", "paragraph");
+		_xml.writeEndElement();
+	}
+
+	_xml.writeEndElement(); //styles
+
+	_xml.writeStartElement(OfficeNs, "body");
+	_xml.writeStartElement(OfficeNs, "text");
+
+	return !_xml.hasError();
+}
+bool FlatOdtTextExporter::writeNodeStart(TextNode* node, int depth) {
+
+	Q_UNUSED(depth);
+
+	QString label = nodeLabel(node);
+	QString pStyle = paragraphStyleName(node->styleId());
+
+	for (int i = 0; i < node->nbTextLines(); i++) {
+
+		_xml.writeStartElement(TextNs, "p");
+		_xml.writeAttribute(TextNs, "style-name", pStyle);
+
+		if (i == 0 and !label.isEmpty()) {
+			_xml.writeStartElement(TextNs, "span");
+			_xml.writeAttribute(TextNs, "style-name", LabelStyleName);
+			_xml.writeCharacters(label + ": ");
+			_xml.writeEndElement();
+		}
+
+		_xml.writeCharacters(lineText(node->lineAt(i)));
+		_xml.writeEndElement();
+	}
+
+	return !_xml.hasError();
+}
+bool FlatOdtTextExporter::writeNodeEnd(TextNode* node, int depth) {
+	Q_UNUSED(node);
+	Q_UNUSED(depth);
+	return !_xml.hasError();
+}
+bool FlatOdtTextExporter::writeFooter() {
+
+	_xml.writeEndElement(); //text
+	_xml.writeEndElement(); //body
+	_xml.writeEndElement(); //document
+
+	_xml.writeEndDocument();
+
+	bool ok = !_xml.hasError();
+	_xml.setDevice(nullptr);
+
+	return ok;
+}
+
+QString FlatOdtTextExporter::paragraphStyleName(int styleId) const {
+	return QString("Sabrina_%1").arg(styleId);
+}
+
+} // namespace Sabrina
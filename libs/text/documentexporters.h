@@ -0,0 +1,162 @@
+#ifndef SABRINA_DOCUMENTEXPORTERS_H
+#define SABRINA_DOCUMENTEXPORTERS_H
+
+/*
+This file is part of the project Sabrina
+Copyright (C) 2023  Paragon <french.paragon@gmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include <QString>
+#include <QStringList>
+#include <QMap>
+#include <QTextStream>
+#include <QXmlStreamWriter>
+
+#include "./text_global.h"
+
+class QIODevice;
+
+namespace Sabrina {
+
+class TextNode;
+class TextLine;
+class TextStyleManager;
+
+/*!
+ * \brief The TextDocumentExporter class is the base class of the streaming exporters of text documents.
+ *
+ * The exporter walks the node tree and write each node to the output device as soon as it is visited,
+ * so the memory used does not depend on the size of the document.
+ * Subclasses implement one format by writing the header, the start and end of each node and the footer.
+ */
+class SABRINA_TEXT_EXPORT TextDocumentExporter
+{
+public:
+
+	//! \brief create an exporter for a format id (see availableFormats), nullptr if the format is unknown.
+	static TextDocumentExporter* createExporter(QString const& format, TextStyleManager* styles = nullptr);
+	static QStringList availableFormats();
+
+	explicit TextDocumentExporter(TextStyleManager* styles = nullptr);
+	virtual ~TextDocumentExporter();
+
+	virtual QString formatId() const = 0;
+	virtual QString fileExtension() const = 0;
+
+	TextStyleManager* styleManager() const;
+	//! \brief set the styles used to get the prefixes, suffixes and labels of the lines, as well as the styles names.
+	void setStyleManager(TextStyleManager* styles);
+
+	QString title() const;
+	void setTitle(QString const& title);
+
+	//! \brief write the document to an already open device.
+	bool exportDocument(TextNode* root, QIODevice* device);
+	//! \brief write the document to a file, the file is only replaced if the export succeed.
+	bool exportDocument(TextNode* root, QString const& fileName);
+
+protected:
+
+	virtual bool writeHeader() = 0;
+	virtual bool writeNodeStart(TextNode* node, int depth) = 0;
+	virtual bool writeNodeEnd(TextNode* node, int depth) = 0;
+	virtual bool writeFooter() = 0;
+
+	bool exportNode(TextNode* node, int depth);
+
+	QString styleName(int styleId) const;
+	QString nodeLabel(TextNode* node) const;
+	//! \brief the text of the line, with the prefix and suffix of its style.
+	QString lineText(TextLine* line) const;
+
+	QIODevice* _device;
+	TextStyleManager* _styles;
+	QString _title;
+
+	QMap<int, QString> _styleNames;
+};
+
+//! \brief The HtmlTextExporter class export a document as a html page, with one div per node and one paragraph per line.
+class SABRINA_TEXT_EXPORT HtmlTextExporter : public TextDocumentExporter
+{
+public:
+
+	static const QString FORMAT_ID;
+
+	explicit HtmlTextExporter(TextStyleManager* styles = nullptr);
+
+	QString formatId() const override;
+	QString fileExtension() const override;
+
+protected:
+
+	bool writeHeader() override;
+	bool writeNodeStart(TextNode* node, int depth) override;
+	bool writeNodeEnd(TextNode* node, int depth) override;
+	bool writeFooter() override;
+
+	QTextStream _out;
+};
+
+//! \brief The PlainScriptTextExporter class export a document as plain text, indented by level, in the spirit of the screenplay plain text formats.
+class SABRINA_TEXT_EXPORT PlainScriptTextExporter : public TextDocumentExporter
+{
+public:
+
+	static const QString FORMAT_ID;
+
+	explicit PlainScriptTextExporter(TextStyleManager* styles = nullptr);
+
+	QString formatId() const override;
+	QString fileExtension() const override;
+
+protected:
+
+	bool writeHeader() override;
+	bool writeNodeStart(TextNode* node, int depth) override;
+	bool writeNodeEnd(TextNode* node, int depth) override;
+	bool writeFooter() override;
+
+	QTextStream _out;
+};
+
+//! \brief The FlatOdtTextExporter class export a document as an OpenDocument text in a single xml file (.fodt), one paragraph style per node style.
+class SABRINA_TEXT_EXPORT FlatOdtTextExporter : public TextDocumentExporter
+{
+public:
+
+	static const QString FORMAT_ID;
+
+	explicit FlatOdtTextExporter(TextStyleManager* styles = nullptr);
+
+	QString formatId() const override;
+	QString fileExtension() const override;
+
+protected:
+
+	bool writeHeader() override;
+	bool writeNodeStart(TextNode* node, int depth) override;
+	bool writeNodeEnd(TextNode* node, int depth) override;
+	bool writeFooter() override;
+
+	QString paragraphStyleName(int styleId) const;
+
+	QXmlStreamWriter _xml;
+};
+
+} // namespace Sabrina
+
+#endif // SABRINA_DOCUMENTEXPORTERS_H
@@ -20,12 +20,162 @@ along with this program.  If not, see <https://www.gnu.org/licenses/>.
 #include "textnode.h"
 #include "textstylemanager.h"
 #include "abstracttextstyle.h"
+#include "textpaginator.h"
+
+#include "textlayoutindex.h"
 
 #include <QtPrintSupport/QPrinter>
 #include <QPainter>
+#include <QPicture>
+#include <QFile>
+#include <QRunnable>
+#include <QThreadPool>
+#include <QThread>
+#include <QMutex>
+#include <QWaitCondition>
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <vector>
 
 namespace Sabrina {
 
+namespace {
+
+AbstractTextNodeStyle* styleForNode(TextStyleManager* styles, TextNode* node) {
+
+	AbstractTextNodeStyle* s = styles->getStyleByCode(node->styleId());
+
+	if (s == nullptr) {
+		s = styles->getStyleByCode(styles->getDefaultStyleCode());
+	}
+
+	return s;
+}
+
+//! \brief The StylesCopyWorker class process items with its own copy of a style manager, until no item is left.
+class StylesCopyWorker : public QRunnable
+{
+public:
+
+	struct SharedState {
+
+		SharedState(int nItems) :
+			next(0),
+			cancelled(false),
+			ready(nItems, false)
+		{
+
+		}
+
+		std::atomic<int> next;
+		std::atomic<bool> cancelled;
+
+		QMutex mutex;
+		QWaitCondition itemReady;
+		std::vector<bool> ready;
+	};
+
+	StylesCopyWorker(SharedState* state,
+					 TextStyleManager const* prototype,
+					 std::function<void(TextStyleManager*, int)> const& job) :
+		_state(state),
+		_prototype(prototype),
+		_job(job)
+	{
+
+	}
+
+	void run() override {
+
+		std::unique_ptr<TextStyleManager> styles(_prototype->clone()); //created in the worker thread, the styles cache are not thread safe.
+		int nItems = static_cast<int>(_state->ready.size());
+
+		while (!_state->cancelled) {
+
+			int i = _state->next.fetch_add(1);
+
+			if (i >= nItems) {
+				break;
+			}
+
+			_job(styles.get(), i);
+
+			QMutexLocker lock(&_state->mutex);
+			_state->ready[i] = true;
+			_state->itemReady.wakeAll();
+		}
+	}
+
+protected:
+
+	SharedState* _state;
+	TextStyleManager const* _prototype;
+	std::function<void(TextStyleManager*, int)> _job;
+};
+
+/*!
+ * \brief runOnStylesCopies run a job on each item with a pool of threads, each thread having its own copy of the styles.
+ *
+ * consume is called on the calling thread for each item, in order, once the item is ready.
+ * progress is called on the calling thread as well, regularly, even when no item is ready.
+ *
+ * \return false if consume or progress cancelled the processing.
+ */
+bool runOnStylesCopies(TextStyleManager const* prototype,
+					   int nItems,
+					   std::function<void(TextStyleManager*, int)> const& job,
+					   std::function<bool(int)> const& consume,
+					   ExportProgressCallback const& progress) {
+
+	if (nItems <= 0) {
+		return true;
+	}
+
+	StylesCopyWorker::SharedState state(nItems);
+
+	QThreadPool pool;
+	int nThreads = std::max(1, std::min(QThread::idealThreadCount(), nItems));
+	pool.setMaxThreadCount(nThreads);
+
+	for (int t = 0; t < nThreads; t++) {
+		pool.start(new StylesCopyWorker(&state, prototype, job));
+	}
+
+	bool ok = true;
+
+	for (int i = 0; i < nItems and ok; i++) {
+
+		QMutexLocker lock(&state.mutex);
+
+		while (!state.ready[i] and ok) {
+			state.itemReady.wait(&state.mutex, 100);
+
+			if (!state.ready[i] and progress) {
+				lock.unlock();
+				ok = progress(i, nItems);
+				lock.relock();
+			}
+		}
+
+		lock.unlock();
+
+		ok = ok and consume(i);
+		ok = ok and (!progress or progress(i+1, nItems));
+	}
+
+	if (!ok) {
+		state.cancelled = true;
+	}
+
+	pool.waitForDone();
+
+	return ok;
+}
+
+} // namespace
+
 bool savePdf(TextNode* node,
 			 TextStyleManager* stylesheet,
 			 QPageLayout const& pLayout,
@@ -39,55 +189,169 @@ bool savePdf(TextNode* node,
 		return false;
 	}
 
-	QPageLayout layout = pLayout;
-	layout.setMode(QPageLayout::StandardMode);
+	QPrinter printer; //only used to get the default resolution.
+
+	TextPaginator paginator;
+	paginator.setStyleManager(stylesheet);
+	paginator.setPageLayout(pLayout, printer.resolution());
+	paginator.setDocument(node);
+
+	return savePdf(&paginator, outFile, ExportProgressCallback());
+
+}
+
+bool savePdf(TextPaginator* paginator,
+			 QString const& outFile,
+			 ExportProgressCallback const& progress) {
+
+	if (paginator == nullptr) {
+		return false;
+	}
+
+	TextStyleManager* stylesheet = paginator->styleManager();
+
+	if (paginator->document() == nullptr or stylesheet == nullptr) {
+		return false;
+	}
+
+	std::unique_ptr<TextStyleManager> probe(stylesheet->clone());
+	bool parallel = probe != nullptr and QThread::idealThreadCount() > 1;
+	probe.reset();
+
+	int width = paginator->pageArea().width();
+
+	if (parallel) {
+
+		//measure the nodes whose height is not known yet with copies of the styles.
+		TextLayoutIndex* index = paginator->layoutIndex();
+		QVector<TextNode*> unmeasured;
+
+		for (int i = 0; i < index->nodeCount(); i++) {
+			TextNode* node = index->nodeAt(i);
+
+			if (!index->isNodeHeightExact(node)) {
+				AbstractTextNodeStyle* style = styleForNode(stylesheet, node);
+
+				if (style == nullptr) {
+					return false;
+				}
+
+				if (node->nbTextLines() != style->expectedNodeNbTextLines()) {
+					node->setNbTextLines(style->expectedNodeNbTextLines()); //done here as the workers are only allowed to read the document.
+				}
+
+				unmeasured.push_back(node);
+			}
+		}
+
+		std::vector<int> heights(unmeasured.size(), 0);
+
+		bool ok = runOnStylesCopies(stylesheet,
+									unmeasured.size(),
+									[&unmeasured, &heights, width] (TextStyleManager* styles, int i) {
+										AbstractTextNodeStyle* style = styleForNode(styles, unmeasured.at(i));
+										heights[i] = (style == nullptr) ? 0 : style->nodeHeight(unmeasured.at(i), width);
+									},
+									[] (int i) {
+										Q_UNUSED(i);
+										return true;
+									},
+									progress);
+
+		if (!ok) {
+			return false;
+		}
+
+		for (int i = 0; i < unmeasured.size(); i++) {
+			index->setNodeHeight(unmeasured[i], heights[i]);
+		}
+	}
+
+	int nPages = paginator->pageCount();
+
+	if (nPages <= 0) {
+		return false;
+	}
 
 	QPrinter printer;
 
-	printer.setPageLayout(layout);
+	printer.setResolution(paginator->resolution());
+	printer.setPageLayout(paginator->pageLayout());
 	printer.setOutputFormat(QPrinter::PdfFormat);
 	printer.setOutputFileName(outFile);
 
-	QRect area = layout.paintRectPixels(printer.resolution());
-
 	QPainter painter;
-	painter.setWindow(area);
-	painter.begin(&printer);
 
-	TextNode* currentNode = node;
-	TextNode* final = node->lastNode()->nextNode();
+	if (!painter.begin(&printer)) {
+		return false;
+	}
 
-	int h = 0;
+	bool ok = true;
 
-	do {
+	if (parallel) {
 
-		AbstractTextNodeStyle* style = stylesheet->getStyleByCode(currentNode->styleId());
+		//render the pages in pictures on worker threads, and replay them in the pdf in order as soon as they are ready.
+		QVector<QVector<TextNode*>> pagesNodes(nPages); //the workers only read the document, never the paginator.
 
-		style->clearCache();
-		style->layNodeOut(currentNode, area.width());
+		for (int p = 0; p < nPages; p++) {
+			pagesNodes[p] = paginator->nodesOfPage(p);
+		}
 
-		if (h + style->nodeHeight(currentNode, area.width()) >= area.height()) {
+		std::vector<QPicture> pictures(nPages);
 
-			bool ok = printer.newPage();
+		ok = runOnStylesCopies(stylesheet,
+							   nPages,
+							   [&pagesNodes, &pictures, width] (TextStyleManager* styles, int p) {
 
-			if (!ok) {
-				return false;
-			}
+								   QPainter picturePainter(&pictures[p]);
+								   int h = 0;
 
-			h = 0;
-		}
+								   for (TextNode* node : pagesNodes.at(p)) {
+									   AbstractTextNodeStyle* style = styleForNode(styles, node);
+
+									   if (style == nullptr) {
+										   continue;
+									   }
+
+									   style->renderNode(node, QPointF(0, h), width, picturePainter);
+									   h += style->nodeHeight(node, width);
+								   }
+
+								   picturePainter.end();
+							   },
+							   [&printer, &painter, &pictures] (int p) {
+
+								   if (p > 0 and !printer.newPage()) {
+									   return false;
+								   }
+
+								   painter.drawPicture(0, 0, pictures[p]);
+								   pictures[p] = QPicture(); //release the page as soon as it is written.
 
-		style->renderNode(currentNode, QPointF(0, h), area.width(), painter);
+								   return true;
+							   },
+							   progress);
 
-		h += style->nodeHeight(currentNode, area.width());
+	} else {
 
-		currentNode = currentNode->nextNode();
+		for (int p = 0; p < nPages and ok; p++) {
 
-	} while (currentNode != final and currentNode != nullptr);
+			if (p > 0) {
+				ok = printer.newPage();
+			}
+
+			ok = ok and paginator->renderPage(p, painter);
+			ok = ok and (!progress or progress(p+1, nPages));
+		}
+	}
 
 	painter.end();
 
-	return true;
+	if (!ok) {
+		QFile::remove(outFile); //do not leave a truncated document behind.
+	}
+
+	return ok;
 
 }
 
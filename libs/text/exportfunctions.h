@@ -21,11 +21,21 @@ along with this program.  If not, see <https://www.gnu.org/licenses/>.
 
 #include <QPageLayout>
 
+#include <functional>
+
 namespace Sabrina {
 
 class TextNode;
 class TextLine;
 class TextStyleManager;
+class TextPaginator;
+
+/*!
+ * \brief ExportProgressCallback is called regularly during long exports, with the number of steps done and the current total number of steps.
+ *
+ * The callback is always called on the thread which started the export. It returns false to cancel the export.
+ */
+typedef std::function<bool(int, int)> ExportProgressCallback;
 
 /*!
  * \brief savePdf save a text document (or part of it) to pdf
@@ -41,6 +51,21 @@ bool savePdf(TextNode* node,
 			 QPageLayout const& layout,
 			 QString const& outFile);
 
+/*!
+ * \brief savePdf save a paginated text document to pdf, reusing the page breaks already computed by the paginator.
+ *
+ * If the stylesheet can be cloned, the nodes not yet measured and the pages are laid out on worker threads, each with its own copy of the styles,
+ * the pages are then written in order in the pdf. The document must not be modified during the export.
+ *
+ * \param paginator the paginator, with its document, stylesheet and page layout set.
+ * \param outFile The target file
+ * \param progress An optional callback reporting the progress, which can cancel the export.
+ * \return true if the file was saved, false otherwise (including when the export has been cancelled).
+ */
+bool savePdf(TextPaginator* paginator,
+			 QString const& outFile,
+			 ExportProgressCallback const& progress = ExportProgressCallback());
+
 } //namespace Sabrina
 
 #endif // SABRINA_TEXT_EXPORTFUNCTIONS_H
@@ -0,0 +1,83 @@
+/*
+This file is part of the project Sabrina
+Copyright (C) 2023  Paragon <french.paragon@gmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "fontmetricscache.h"
+
+namespace Sabrina {
+
+const int FontMetricsCache::MaxCachedAdvancesPerFont = 1024;
+
+FontMetricsCache::FontMetricsCache()
+{
+
+}
+
+QFontMetrics FontMetricsCache::metrics(QFont const& font) const {
+	return entry(font).metrics;
+}
+
+int FontMetricsCache::lineHeight(QFont const& font) const {
+	return entry(font).lineHeight;
+}
+
+int FontMetricsCache::ascent(QFont const& font) const {
+	return entry(font).metrics.ascent();
+}
+
+int FontMetricsCache::horizontalAdvance(QFont const& font, QString const& text) const {
+
+	if (text.isEmpty()) {
+		return 0;
+	}
+
+	FontEntry& e = entry(font);
+
+	auto it = e.advances.constFind(text);
+
+	if (it != e.advances.constEnd()) {
+		return it.value();
+	}
+
+	if (e.advances.size() >= MaxCachedAdvancesPerFont) {
+		e.advances.clear(); //the strings measured are mostly prefixes and descriptions, this should almost never happen.
+	}
+
+	int advance = e.metrics.horizontalAdvance(text);
+	e.advances.insert(text, advance);
+
+	return advance;
+}
+
+void FontMetricsCache::clear() {
+	_entries.clear();
+}
+
+FontMetricsCache::FontEntry& FontMetricsCache::entry(QFont const& font) const {
+
+	QString key = font.key();
+
+	auto it = _entries.find(key);
+
+	if (it == _entries.end()) {
+		it = _entries.insert(key, std::make_shared<FontEntry>(font));
+	}
+
+	return *(it.value().get());
+}
+
+} // namespace Sabrina
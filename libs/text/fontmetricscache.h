@@ -0,0 +1,79 @@
+#ifndef SABRINA_FONTMETRICSCACHE_H
+#define SABRINA_FONTMETRICSCACHE_H
+
+/*
+This file is part of the project Sabrina
+Copyright (C) 2023  Paragon <french.paragon@gmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include <QFont>
+#include <QFontMetrics>
+#include <QHash>
+#include <QString>
+
+#include <memory>
+
+#include "./text_global.h"
+
+namespace Sabrina {
+
+/*!
+ * \brief The FontMetricsCache class keep the font metrics used by the text styles.
+ *
+ * Building a QFontMetrics and measuring strings is expensive, and the styles do it for each line at each layout.
+ * The cache is keyed by QFont::key(), so that equivalent fonts built in different places share the same entry.
+ * It is owned by a TextStyleManager and is not thread safe.
+ */
+class SABRINA_TEXT_EXPORT FontMetricsCache
+{
+public:
+	FontMetricsCache();
+
+	QFontMetrics metrics(QFont const& font) const;
+	int lineHeight(QFont const& font) const;
+	int ascent(QFont const& font) const;
+
+	//! \brief the horizontal advance of text when rendered with font, the result is cached.
+	int horizontalAdvance(QFont const& font, QString const& text) const;
+
+	void clear();
+
+protected:
+
+	static const int MaxCachedAdvancesPerFont;
+
+	struct FontEntry {
+
+		FontEntry(QFont const& font) :
+			metrics(font),
+			lineHeight(metrics.ascent() + metrics.descent())
+		{
+
+		}
+
+		QFontMetrics metrics;
+		int lineHeight;
+		QHash<QString, int> advances;
+	};
+
+	FontEntry& entry(QFont const& font) const;
+
+	mutable QHash<QString, std::shared_ptr<FontEntry>> _entries;
+};
+
+} // namespace Sabrina
+
+#endif // SABRINA_FONTMETRICSCACHE_H
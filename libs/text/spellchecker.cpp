@@ -0,0 +1,660 @@
+/*
+This file is part of the project Sabrina
+Copyright (C) 2023  Paragon <french.paragon@gmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "spellchecker.h"
+
+#include "textnode.h"
+
+#include <QFile>
+#include <QTextCodec>
+#include <QTextStream>
+#include <QThread>
+#include <QTimer>
+
+#include <algorithm>
+
+namespace Sabrina {
+
+namespace {
+
+const QChar TypographicApostrophe(0x2019);
+
+bool isWordSeparator(QChar c) {
+	return c == '\'' or c == TypographicApostrophe or c == '-';
+}
+
+//! \brief check a word made of several parts (l'homme, peut-être), each part being checked alone if the whole word is not known.
+bool compoundIsCorrect(QString const& word, SpellDictionary const& dictionary) {
+
+	int start = 0;
+
+	for (int i = 0; i < word.size(); i++) {
+
+		if (!isWordSeparator(word[i])) {
+			continue;
+		}
+
+		QString part = word.mid(start, i - start);
+		bool ok = dictionary.contains(part);
+
+		if (!ok and word[i] != '-') { //elisions are listed with their apostrophe in most dictionaries.
+			ok = part.size() == 1 or
+					dictionary.contains(part + '\'') or
+					dictionary.contains(part + TypographicApostrophe);
+		}
+
+		if (!ok) {
+			return false;
+		}
+
+		start = i+1;
+	}
+
+	return dictionary.contains(word.mid(start));
+}
+
+} // namespace
+
+SpellDictionary::SpellDictionary() :
+	_flagMode(FlagMode::Char),
+	_maxSuffixLength(0),
+	_maxPrefixLength(0)
+{
+
+}
+
+bool SpellDictionary::load(QString const& dicFile, QString const& affFile) {
+
+	_stems.clear();
+	_suffixes.clear();
+	_prefixes.clear();
+	_maxSuffixLength = 0;
+	_maxPrefixLength = 0;
+	_flagMode = FlagMode::Char;
+
+	QByteArray encoding = "UTF-8";
+
+	if (!affFile.isEmpty() and !readAffixes(affFile, encoding)) {
+		return false;
+	}
+
+	QFile file(dicFile);
+
+	if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+		return false;
+	}
+
+	QTextStream in(&file);
+	QTextCodec* codec = QTextCodec::codecForName(encoding);
+	if (codec != nullptr) {
+		in.setCodec(codec);
+	}
+
+	bool firstLine = true;
+
+	while (!in.atEnd()) {
+
+		QString line = in.readLine().trimmed();
+
+		if (line.isEmpty()) {
+			continue;
+		}
+
+		if (firstLine) { //hunspell dictionaries start with the number of words.
+			firstLine = false;
+			bool isCount;
+			line.toInt(&isCount);
+			if (isCount) {
+				continue;
+			}
+		}
+
+		//morphological fields, if any, are separated by spaces or tabs.
+		QString entry = line.section(QRegularExpression("\\s"), 0, 0);
+		int slash = entry.indexOf('/');
+
+		QString word = (slash > 0) ? entry.left(slash) : entry;
+		QStringList flags = (slash > 0) ? parseFlags(entry.mid(slash+1)) : QStringList();
+
+		_stems[word].append(flags);
+	}
+
+	return true;
+}
+
+bool SpellDictionary::isEmpty() const {
+	return _stems.isEmpty();
+}
+int SpellDictionary::stemsCount() const {
+	return _stems.size();
+}
+
+bool SpellDictionary::contains(QString const& word) const {
+
+	if (word.isEmpty()) {
+		return false;
+	}
+
+	auto check = [this] (QString const& w) -> bool {
+
+		if (containsExact(w) or containsWithSuffix(w)) {
+			return true;
+		}
+
+		int maxLength = std::min(_maxPrefixLength, w.size()-1);
+
+		for (int l = 0; l <= maxLength; l++) {
+
+			auto it = _prefixes.constFind(w.left(l));
+
+			if (it == _prefixes.constEnd()) {
+				continue;
+			}
+
+			for (AffixRule const& rule : *it) {
+
+				QString stem = rule.strip + w.mid(l);
+
+				if (!rule.condition.match(stem).hasMatch()) {
+					continue;
+				}
+
+				if (stemHasFlag(stem, rule.flag)) {
+					return true;
+				}
+
+				if (rule.crossProduct and containsWithSuffix(stem, rule.flag)) {
+					return true;
+				}
+			}
+		}
+
+		return false;
+	};
+
+	if (check(word)) {
+		return true;
+	}
+
+	QString lower = word.toLower();
+	return lower != word and check(lower);
+}
+
+bool SpellDictionary::readAffixes(QString const& affFile, QByteArray & encoding) {
+
+	QFile file(affFile);
+
+	if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+		return false;
+	}
+
+	QByteArray data = file.readAll();
+
+	//the encoding has to be known before decoding the rules.
+	for (QByteArray const& rawLine : data.split('\n')) {
+		QByteArray line = rawLine.trimmed();
+		if (line.startsWith("SET ")) {
+			encoding = line.mid(4).trimmed();
+			break;
+		}
+	}
+
+	QTextCodec* codec = QTextCodec::codecForName(encoding);
+	QString content = (codec != nullptr) ? codec->toUnicode(data) : QString::fromUtf8(data);
+
+	QHash<QString, bool> crossProducts;
+	QRegularExpression spaces("\\s+");
+
+	for (QString const& line : content.split('\n')) {
+
+		QStringList tokens = line.split(spaces, Qt::SkipEmptyParts);
+
+		if (tokens.isEmpty() or tokens.first().startsWith('#')) {
+			continue;
+		}
+
+		QString const& keyword = tokens.first();
+
+		if (keyword == "FLAG" and tokens.size() > 1) {
+			if (tokens[1] == "long") {
+				_flagMode = FlagMode::Long;
+			} else if (tokens[1] == "num") {
+				_flagMode = FlagMode::Num;
+			}
+			continue;
+		}
+
+		bool isSuffix = keyword == "SFX";
+
+		if (!isSuffix and keyword != "PFX") {
+			continue;
+		}
+
+		if (tokens.size() == 4) { //header: flag, cross product and number of rules.
+			crossProducts.insert(tokens[1], tokens[2] == "Y");
+			continue;
+		}
+
+		if (tokens.size() < 5) {
+			continue;
+		}
+
+		AffixRule rule;
+		rule.flag = tokens[1];
+		rule.strip = (tokens[2] == "0") ? QString() : tokens[2];
+		rule.add = tokens[3].section('/', 0, 0); //continuation classes are ignored.
+		if (rule.add == "0") {
+			rule.add.clear();
+		}
+		rule.crossProduct = crossProducts.value(rule.flag, false);
+
+		QString condition = tokens[4];
+		if (condition == ".") {
+			rule.condition = QRegularExpression();
+		} else {
+			rule.condition = QRegularExpression(isSuffix ? condition + "$" : "^" + condition);
+		}
+
+		if (isSuffix) {
+			_suffixes[rule.add].push_back(rule);
+			_maxSuffixLength = std::max(_maxSuffixLength, rule.add.size());
+		} else {
+			_prefixes[rule.add].push_back(rule);
+			_maxPrefixLength = std::max(_maxPrefixLength, rule.add.size());
+		}
+	}
+
+	return true;
+}
+
+QStringList SpellDictionary::parseFlags(QString const& flags) const {
+
+	QStringList out;
+
+	switch (_flagMode) {
+	case FlagMode::Char:
+		for (QChar c : flags) {
+			out.push_back(QString(c));
+		}
+		break;
+	case FlagMode::Long:
+		for (int i = 0; i+1 < flags.size(); i += 2) {
+			out.push_back(flags.mid(i, 2));
+		}
+		break;
+	case FlagMode::Num:
+		out = flags.split(',', Qt::SkipEmptyParts);
+		break;
+	}
+
+	return out;
+}
+
+bool SpellDictionary::containsExact(QString const& word) const {
+	return _stems.contains(word);
+}
+bool SpellDictionary::containsWithSuffix(QString const& word, QString const& requiredFlag) const {
+
+	int maxLength = std::min(_maxSuffixLength, word.size()-1);
+
+	for (int l = 0; l <= maxLength; l++) {
+
+		auto it = _suffixes.constFind(word.right(l));
+
+		if (it == _suffixes.constEnd()) {
+			continue;
+		}
+
+		for (AffixRule const& rule : *it) {
+
+			if (!requiredFlag.isEmpty() and !rule.crossProduct) {
+				continue;
+			}
+
+			QString stem = word.left(word.size() - l) + rule.strip;
+
+			if (!rule.condition.match(stem).hasMatch()) {
+				continue;
+			}
+
+			if (stemHasFlag(stem, rule.flag) and (requiredFlag.isEmpty() or stemHasFlag(stem, requiredFlag))) {
+				return true;
+			}
+		}
+	}
+
+	return false;
+}
+bool SpellDictionary::stemHasFlag(QString const& stem, QString const& flag) const {
+
+	auto it = _stems.constFind(stem);
+
+	if (it == _stems.constEnd()) {
+		return false;
+	}
+
+	return it->contains(flag);
+}
+
+
+SpellCheckWorker::SpellCheckWorker(QObject* parent) :
+	QObject(parent)
+{
+
+}
+
+void SpellCheckWorker::loadDictionary(QString const& dicFile, QString const& affFile) {
+
+	std::unique_ptr<SpellDictionary> dictionary(new SpellDictionary());
+
+	if (!dictionary->load(dicFile, affFile) or dictionary->isEmpty()) {
+		_dictionary.reset();
+		Q_EMIT dictionaryLoaded(false);
+		return;
+	}
+
+	_dictionary = std::move(dictionary);
+	Q_EMIT dictionaryLoaded(true);
+}
+
+void SpellCheckWorker::checkBatch(SpellCheckBatch batch) {
+
+	batch.errors.resize(batch.texts.size());
+
+	if (_dictionary != nullptr) {
+		for (int i = 0; i < batch.texts.size(); i++) {
+			batch.errors[i] = misspelledWords(batch.texts[i], *_dictionary);
+		}
+	}
+
+	Q_EMIT batchChecked(batch);
+}
+
+QVector<QPair<int, int>> SpellCheckWorker::misspelledWords(QString const& text, SpellDictionary const& dictionary) {
+
+	QVector<QPair<int, int>> errors;
+
+	int i = 0;
+	int n = text.size();
+
+	while (i < n) {
+
+		if (!text[i].isLetter()) {
+			i++;
+			continue;
+		}
+
+		int start = i;
+
+		while (i < n) {
+			if (text[i].isLetter() or text[i].isMark()) {
+				i++;
+			} else if (isWordSeparator(text[i]) and i+1 < n and text[i+1].isLetter()) {
+				i++;
+			} else {
+				break;
+			}
+		}
+
+		QString word = text.mid(start, i - start);
+
+		if (word.size() < 2 or dictionary.contains(word)) {
+			continue;
+		}
+
+		if (std::any_of(word.begin(), word.end(), isWordSeparator) and compoundIsCorrect(word, dictionary)) {
+			continue;
+		}
+
+		errors.push_back(qMakePair(start, word.size()));
+	}
+
+	return errors;
+}
+
+
+const int SpellChecker::BatchSize = 32;
+const int SpellChecker::MaxRecentLines = 64;
+
+SpellChecker::SpellChecker(QObject* parent) :
+	QObject(parent),
+	_root(nullptr),
+	_thread(new QThread(this)),
+	_worker(new SpellCheckWorker()),
+	_hasDictionary(false),
+	_dispatchScheduled(false)
+{
+	qRegisterMetaType<Sabrina::SpellCheckBatch>();
+
+	_errorFormat.setUnderlineStyle(QTextCharFormat::SpellCheckUnderline);
+	_errorFormat.setUnderlineColor(Qt::red);
+
+	_worker->moveToThread(_thread);
+	connect(_thread, &QThread::finished, _worker, &QObject::deleteLater);
+
+	connect(_worker, &SpellCheckWorker::batchChecked, this, &SpellChecker::onBatchChecked);
+	connect(_worker, &SpellCheckWorker::dictionaryLoaded, this, &SpellChecker::onDictionaryLoaded);
+
+	_thread->start(QThread::LowPriority);
+}
+SpellChecker::~SpellChecker() {
+	_thread->quit();
+	_thread->wait();
+}
+
+TextNode* SpellChecker::document() const {
+	return _root;
+}
+void SpellChecker::setDocument(TextNode* root) {
+
+	if (root == _root) {
+		return;
+	}
+
+	if (_root != nullptr) {
+		disconnect(_root, &TextNode::nodeEdited, this, &SpellChecker::onNodeEdited);
+	}
+
+	_root = root;
+
+	if (_root != nullptr) {
+		connect(_root, &TextNode::nodeEdited, this, &SpellChecker::onNodeEdited);
+	}
+
+	clearResults();
+	_visibleQueue.clear();
+	_recentQueue.clear();
+}
+
+void SpellChecker::setDictionaryFiles(QString const& dicFile, QString const& affFile) {
+
+	SpellCheckWorker* worker = _worker;
+
+	QMetaObject::invokeMethod(_worker, [worker, dicFile, affFile] () {
+		worker->loadDictionary(dicFile, affFile);
+	}, Qt::QueuedConnection);
+}
+bool SpellChecker::hasDictionary() const {
+	return _hasDictionary;
+}
+
+QTextCharFormat SpellChecker::errorFormat() const {
+	return _errorFormat;
+}
+void SpellChecker::setErrorFormat(QTextCharFormat const& format) {
+	_errorFormat = format;
+	Q_EMIT linesChecked();
+}
+
+QVector<QTextLayout::FormatRange> SpellChecker::lineDecorations(TextLine* line) {
+
+	if (!_hasDictionary or line == nullptr) {
+		return {};
+	}
+
+	auto it = _results.constFind(line);
+
+	if (it == _results.constEnd() or it->revision != line->revision()) {
+		queueLine(line, true);
+		return {};
+	}
+
+	QVector<QTextLayout::FormatRange> ranges;
+	ranges.reserve(it->errors.size());
+
+	for (QPair<int, int> const& error : it->errors) {
+		QTextLayout::FormatRange range;
+		range.start = error.first;
+		range.length = error.second;
+		range.format = _errorFormat;
+		ranges.push_back(range);
+	}
+
+	return ranges;
+}
+
+void SpellChecker::queueLine(TextLine* line, bool visible) {
+
+	if (_inFlight.contains(line->revision())) {
+		return;
+	}
+
+	QList<QPointer<TextLine>> & queue = (visible) ? _visibleQueue : _recentQueue;
+
+	for (QPointer<TextLine> const& queued : qAsConst(queue)) {
+		if (queued == line) {
+			return;
+		}
+	}
+
+	if (visible) {
+		queue.push_back(line);
+	} else {
+		queue.push_front(line); //the most recent edits first.
+		while (queue.size() > MaxRecentLines) {
+			queue.removeLast();
+		}
+	}
+
+	scheduleDispatch();
+}
+void SpellChecker::scheduleDispatch() {
+
+	if (_dispatchScheduled) {
+		return;
+	}
+
+	_dispatchScheduled = true;
+	QTimer::singleShot(0, this, &SpellChecker::dispatch);
+}
+void SpellChecker::dispatch() {
+
+	_dispatchScheduled = false;
+
+	if (!_hasDictionary or !_inFlight.isEmpty()) { //the next batch is sent once the current one is back.
+		return;
+	}
+
+	SpellCheckBatch batch;
+
+	auto take = [this, &batch] (QList<QPointer<TextLine>> & queue) {
+		while (!queue.isEmpty() and batch.revisions.size() < BatchSize) {
+
+			QPointer<TextLine> line = queue.takeFirst();
+
+			if (line.isNull() or _inFlight.contains(line->revision())) {
+				continue;
+			}
+
+			auto it = _results.constFind(line.data());
+			if (it != _results.constEnd() and it->revision == line->revision()) {
+				continue;
+			}
+
+			batch.revisions.push_back(line->revision());
+			batch.texts.push_back(line->getText());
+			_inFlight.insert(line->revision(), line);
+		}
+	};
+
+	take(_visibleQueue);
+	take(_recentQueue);
+
+	if (batch.revisions.isEmpty()) {
+		return;
+	}
+
+	SpellCheckWorker* worker = _worker;
+
+	QMetaObject::invokeMethod(_worker, [worker, batch] () {
+		worker->checkBatch(batch);
+	}, Qt::QueuedConnection);
+}
+
+void SpellChecker::clearResults() {
+
+	for (auto it = _results.constBegin(); it != _results.constEnd(); ++it) {
+		disconnect(it.key(), &QObject::destroyed, this, nullptr);
+	}
+
+	_results.clear();
+}
+
+void SpellChecker::onNodeEdited(TextNode* node, TextLine* line) {
+
+	Q_UNUSED(node);
+
+	if (line != nullptr and _hasDictionary) {
+		queueLine(line, false);
+	}
+}
+void SpellChecker::onBatchChecked(SpellCheckBatch batch) {
+
+	for (int i = 0; i < batch.revisions.size(); i++) {
+
+		QPointer<TextLine> line = _inFlight.take(batch.revisions[i]);
+
+		//lines deleted or edited while the batch was checked are dropped.
+		if (line.isNull() or line->revision() != batch.revisions[i]) {
+			continue;
+		}
+
+		if (!_results.contains(line.data())) {
+			//the lines of the removed nodes are deleted with them, their results are dropped then.
+			TextLine* key = line.data();
+			connect(key, &QObject::destroyed, this, [this, key] () {
+				_results.remove(key);
+			});
+		}
+
+		_results.insert(line.data(), {batch.revisions[i], batch.errors.value(i)});
+	}
+
+	Q_EMIT linesChecked();
+	scheduleDispatch();
+}
+void SpellChecker::onDictionaryLoaded(bool ok) {
+
+	_hasDictionary = ok;
+	clearResults(); //the results are those of the previous dictionary.
+
+	Q_EMIT dictionaryLoaded(ok);
+	Q_EMIT linesChecked();
+}
+
+} // namespace Sabrina
@@ -0,0 +1,197 @@
+#ifndef SABRINA_SPELLCHECKER_H
+#define SABRINA_SPELLCHECKER_H
+
+/*
+This file is part of the project Sabrina
+Copyright (C) 2023  Paragon <french.paragon@gmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include <QObject>
+#include <QHash>
+#include <QPointer>
+#include <QRegularExpression>
+#include <QStringList>
+#include <QTextCharFormat>
+#include <QVector>
+
+#include <memory>
+
+#include "./text_global.h"
+#include "./abstracttextstyle.h"
+
+class QThread;
+
+namespace Sabrina {
+
+class TextNode;
+class TextLine;
+
+/*!
+ * \brief The SpellDictionary class is a word list, read from a hunspell dictionary (.dic and .aff files) or from a plain list of words.
+ *
+ * The prefixes and suffixes rules of the affix file are applied when checking a word, by removing them from the word
+ * and looking for the resulting stem, so the dictionary only stores the stems. Compound words are not supported.
+ * Once loaded a dictionary is never modified, so it can be used by several threads.
+ */
+class SABRINA_TEXT_EXPORT SpellDictionary
+{
+public:
+	SpellDictionary();
+
+	//! \brief load a dictionary, the affix file is optional. Return false if the dictionary cannot be read.
+	bool load(QString const& dicFile, QString const& affFile = QString());
+
+	bool isEmpty() const;
+	int stemsCount() const;
+
+	//! \brief if the word, as written or in lower case, is in the dictionary.
+	bool contains(QString const& word) const;
+
+protected:
+
+	struct AffixRule {
+		QString flag;
+		QString strip;
+		QString add;
+		QRegularExpression condition;
+		bool crossProduct;
+	};
+
+	bool readAffixes(QString const& affFile, QByteArray & encoding);
+	QStringList parseFlags(QString const& flags) const;
+
+	bool containsExact(QString const& word) const;
+	bool containsWithSuffix(QString const& word, QString const& requiredFlag = QString()) const;
+	bool stemHasFlag(QString const& stem, QString const& flag) const;
+
+	enum class FlagMode {
+		Char,
+		Long,
+		Num
+	};
+
+	FlagMode _flagMode;
+	QHash<QString, QStringList> _stems;
+	QHash<QString, QVector<AffixRule>> _suffixes; //indexed by the appended string.
+	QHash<QString, QVector<AffixRule>> _prefixes;
+	int _maxSuffixLength;
+	int _maxPrefixLength;
+};
+
+//! \brief The SpellCheckBatch struct is a group of lines sent to the worker thread, identified by their revisions.
+struct SpellCheckBatch {
+	QVector<quint64> revisions;
+	QStringList texts;
+	QVector<QVector<QPair<int, int>>> errors; //pos and length of the misspelled words, filled by the worker.
+};
+
+//! \brief The SpellCheckWorker class check the batches of lines in the thread of the SpellChecker.
+class SABRINA_TEXT_EXPORT SpellCheckWorker : public QObject
+{
+	Q_OBJECT
+public:
+	explicit SpellCheckWorker(QObject* parent = nullptr);
+
+	void loadDictionary(QString const& dicFile, QString const& affFile);
+	void checkBatch(SpellCheckBatch batch);
+
+	static QVector<QPair<int, int>> misspelledWords(QString const& text, SpellDictionary const& dictionary);
+
+Q_SIGNALS:
+
+	void dictionaryLoaded(bool ok);
+	void batchChecked(Sabrina::SpellCheckBatch batch);
+
+protected:
+
+	std::unique_ptr<SpellDictionary> _dictionary;
+};
+
+/*!
+ * \brief The SpellChecker class check the spelling of the lines of a document on a worker thread.
+ *
+ * The results are cached with the revision of each line, so a line is checked again only once its text changed.
+ * Only the lines requested by the rendering (visible lines) and the recently edited lines are checked, the visible lines first.
+ * One batch of lines is sent to the worker at a time, so that the queue can still be reordered while the user scrolls or types.
+ */
+class SABRINA_TEXT_EXPORT SpellChecker : public QObject, public TextLineDecorator
+{
+	Q_OBJECT
+public:
+	explicit SpellChecker(QObject* parent = nullptr);
+	~SpellChecker();
+
+	TextNode* document() const;
+	//! \brief set the document whose edits are tracked.
+	void setDocument(TextNode* root);
+
+	//! \brief load a dictionary on the worker thread, the lines are checked again once it is loaded.
+	void setDictionaryFiles(QString const& dicFile, QString const& affFile = QString());
+	bool hasDictionary() const;
+
+	QTextCharFormat errorFormat() const;
+	void setErrorFormat(QTextCharFormat const& format);
+
+	//! \brief the misspelled words of the line if the line has been checked in its current state, the line is queued otherwise.
+	QVector<QTextLayout::FormatRange> lineDecorations(TextLine* line) override;
+
+	static const int BatchSize;
+	static const int MaxRecentLines;
+
+Q_SIGNALS:
+
+	//! \brief emitted when new results are available, the lines using them need to be painted again.
+	void linesChecked();
+	void dictionaryLoaded(bool ok);
+
+protected:
+
+	struct LineErrors {
+		quint64 revision;
+		QVector<QPair<int, int>> errors;
+	};
+
+	void queueLine(TextLine* line, bool visible);
+	void scheduleDispatch();
+	void dispatch();
+	//! \brief drop the cached results and stop tracking the destruction of their lines.
+	void clearResults();
+
+	void onNodeEdited(TextNode* node, TextLine* line);
+	void onBatchChecked(SpellCheckBatch batch);
+	void onDictionaryLoaded(bool ok);
+
+	TextNode* _root;
+
+	QThread* _thread;
+	SpellCheckWorker* _worker;
+	bool _hasDictionary;
+
+	QTextCharFormat _errorFormat;
+
+	QHash<TextLine*, LineErrors> _results;
+
+	QList<QPointer<TextLine>> _visibleQueue;
+	QList<QPointer<TextLine>> _recentQueue;
+	QHash<quint64, QPointer<TextLine>> _inFlight;
+	bool _dispatchScheduled;
+};
+
+} // namespace Sabrina
+
+Q_DECLARE_METATYPE(Sabrina::SpellCheckBatch)
+
+#endif // SABRINA_SPELLCHECKER_H
@@ -0,0 +1,158 @@
+/*
+This file is part of the project Sabrina
+Copyright (C) 2023  Paragon <french.paragon@gmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "textdocumentmimedata.h"
+
+#include "textnode.h"
+
+#include <QJsonDocument>
+
+namespace Sabrina {
+
+namespace {
+
+const QString PlainTextFormat = "text/plain";
+const QString HtmlFormat = "text/html";
+
+} // namespace
+
+TextDocumentMimeData::TextDocumentMimeData(QJsonObject const& range) :
+	QMimeData(),
+	_range(range)
+{
+
+}
+
+QJsonObject const& TextDocumentMimeData::range() const {
+	return _range;
+}
+
+bool TextDocumentMimeData::hasFormat(const QString &mimetype) const {
+	return mimetype == TextNode::TextNodeMimeTypeInfos::DocumentData or
+			mimetype == PlainTextFormat or
+			mimetype == HtmlFormat;
+}
+QStringList TextDocumentMimeData::formats() const {
+	return {TextNode::TextNodeMimeTypeInfos::DocumentData, HtmlFormat, PlainTextFormat};
+}
+
+QVariant TextDocumentMimeData::retrieveData(const QString &mimetype, QVariant::Type preferredType) const {
+
+	Q_UNUSED(preferredType);
+
+	if (mimetype == TextNode::TextNodeMimeTypeInfos::DocumentData) {
+		if (_json.isEmpty()) {
+			_json = QJsonDocument(_range).toJson(QJsonDocument::Compact);
+		}
+		return _json;
+	}
+
+	if (mimetype == PlainTextFormat) {
+		if (_text.isNull()) {
+			_text = textFromRange(_range);
+		}
+		return _text;
+	}
+
+	if (mimetype == HtmlFormat) {
+		if (_html.isNull()) {
+			_html = htmlFromRange(_range);
+		}
+		return _html;
+	}
+
+	return QVariant();
+}
+
+QString TextDocumentMimeData::textFromRange(QJsonObject const& range) {
+
+	QStringList lines;
+
+	if (range.contains(TextNode::TextNodeJsonRepresentationInfos::NODES_KEY)) {
+		const QJsonArray nodes = range.value(TextNode::TextNodeJsonRepresentationInfos::NODES_KEY).toArray();
+
+		for (QJsonValue const& node : nodes) {
+			appendNodeText(node.toObject(), lines);
+		}
+	} else {
+		appendNodeText(range, lines);
+	}
+
+	return lines.join("\n");
+}
+QString TextDocumentMimeData::htmlFromRange(QJsonObject const& range) {
+
+	QString out;
+
+	if (range.contains(TextNode::TextNodeJsonRepresentationInfos::NODES_KEY)) {
+		const QJsonArray nodes = range.value(TextNode::TextNodeJsonRepresentationInfos::NODES_KEY).toArray();
+
+		for (QJsonValue const& node : nodes) {
+			appendNodeHtml(node.toObject(), out);
+		}
+	} else {
+		appendNodeHtml(range, out);
+	}
+
+	return out;
+}
+
+void TextDocumentMimeData::appendNodeText(QJsonObject const& node, QStringList & lines) {
+
+	const QJsonArray nodeLines = node.value(TextNode::TextNodeJsonRepresentationInfos::LINES_KEY).toArray();
+
+	for (QJsonValue const& l : nodeLines) {
+		lines.append(l.toString());
+	}
+
+	const QJsonArray children = node.value(TextNode::TextNodeJsonRepresentationInfos::CHILDREN_KEY).toArray();
+
+	for (QJsonValue const& c : children) {
+		appendNodeText(c.toObject(), lines);
+	}
+}
+void TextDocumentMimeData::appendNodeHtml(QJsonObject const& node, QString & out) {
+
+	//same markup as TextNode::getHtmlRepresentation.
+	out += "<p";
+
+	if (node.contains(TextNode::TextNodeJsonRepresentationInfos::STYLE_NAME_KEY)) {
+		out += " class=\"";
+		out += node.value(TextNode::TextNodeJsonRepresentationInfos::STYLE_NAME_KEY).toString().toHtmlEscaped() + "\"";
+	}
+	out += " styleId=\"";
+	out += QString::number(node.value(TextNode::TextNodeJsonRepresentationInfos::STYLE_ID_KEY).toInt());
+	out += "\">";
+
+	const QJsonArray nodeLines = node.value(TextNode::TextNodeJsonRepresentationInfos::LINES_KEY).toArray();
+
+	for (QJsonValue const& l : nodeLines) {
+		out += l.toString().toHtmlEscaped();
+		out += "<br>";
+	}
+
+	const QJsonArray children = node.value(TextNode::TextNodeJsonRepresentationInfos::CHILDREN_KEY).toArray();
+
+	for (QJsonValue const& c : children) {
+		appendNodeHtml(c.toObject(), out);
+	}
+
+	out += "</p>";
+}
+
+} // namespace Sabrina
@@ -0,0 +1,68 @@
+#ifndef SABRINA_TEXTDOCUMENTMIMEDATA_H
+#define SABRINA_TEXTDOCUMENTMIMEDATA_H
+
+/*
+This file is part of the project Sabrina
+Copyright (C) 2023  Paragon <french.paragon@gmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "./text_global.h"
+
+#include <QMimeData>
+#include <QJsonObject>
+#include <QJsonArray>
+
+namespace Sabrina {
+
+/*!
+ * \brief The TextDocumentMimeData class hold a copied range of a document in the clipboard.
+ *
+ * The range is kept as its json representation (see TextNode::rangeJsonRepresentation), which is implicitly shared,
+ * so the copy is not duplicated when pasted back in the application.
+ * The plain text, html and serialized json formats are only produced when they are requested, typically by another application.
+ */
+class SABRINA_TEXT_EXPORT TextDocumentMimeData : public QMimeData
+{
+	Q_OBJECT
+public:
+	explicit TextDocumentMimeData(QJsonObject const& range);
+
+	//! \brief the copied range, to paste it without going through a serialized format.
+	QJsonObject const& range() const;
+
+	bool hasFormat(const QString &mimetype) const override;
+	QStringList formats() const override;
+
+	static QString textFromRange(QJsonObject const& range);
+	static QString htmlFromRange(QJsonObject const& range);
+
+protected:
+
+	QVariant retrieveData(const QString &mimetype, QVariant::Type preferredType) const override;
+
+	static void appendNodeText(QJsonObject const& node, QStringList & lines);
+	static void appendNodeHtml(QJsonObject const& node, QString & out);
+
+	QJsonObject _range;
+
+	mutable QString _text;
+	mutable QString _html;
+	mutable QByteArray _json;
+};
+
+} // namespace Sabrina
+
+#endif // SABRINA_TEXTDOCUMENTMIMEDATA_H
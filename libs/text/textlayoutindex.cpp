@@ -0,0 +1,729 @@
+/*
+This file is part of the project Sabrina
+Copyright (C) 2023  Paragon <french.paragon@gmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "textlayoutindex.h"
+
+#include "textnode.h"
+#include "abstracttextstyle.h"
+#include "textstylemanager.h"
+
+#include <algorithm>
+
+namespace Sabrina {
+
+TextLayoutIndex::TextLayoutIndex(QObject *parent) :
+	QObject(parent),
+	_root(nullptr),
+	_styleManager(nullptr),
+	_availableWidth(0),
+	_structureDirty(true)
+{
+
+}
+
+TextNode* TextLayoutIndex::document() const {
+	return _root;
+}
+void TextLayoutIndex::setDocument(TextNode* root) {
+
+	if (root == _root) {
+		return;
+	}
+
+	disconnectDocument();
+	_root = root;
+	connectDocument();
+
+	_knownHeights.clear();
+	onStructureChanged();
+}
+
+TextStyleManager* TextLayoutIndex::styleManager() const {
+	return _styleManager;
+}
+void TextLayoutIndex::setStyleManager(TextStyleManager* manager) {
+
+	if (manager == _styleManager) {
+		return;
+	}
+
+	if (_styleManager != nullptr) {
+		disconnect(_styleManager, nullptr, this, nullptr);
+	}
+
+	_styleManager = manager;
+
+	if (_styleManager != nullptr) {
+		connect(_styleManager, &TextStyleManager::styleUpdated, this, &TextLayoutIndex::invalidate);
+		connect(_styleManager, &TextStyleManager::styleInserted, this, &TextLayoutIndex::invalidate);
+		connect(_styleManager, &TextStyleManager::styleRemoved, this, &TextLayoutIndex::invalidate);
+		connect(_styleManager, &QObject::destroyed, this, [this] () {
+			_styleManager = nullptr;
+			invalidate();
+		});
+	}
+
+	invalidate();
+}
+
+int TextLayoutIndex::availableWidth() const {
+	return _availableWidth;
+}
+void TextLayoutIndex::setAvailableWidth(int width) {
+
+	if (width == _availableWidth) {
+		return;
+	}
+
+	_availableWidth = width;
+	invalidate();
+}
+
+int TextLayoutIndex::nodeCount() {
+	ensureStructure();
+	return _nodes.size();
+}
+int TextLayoutIndex::nodePosition(TextNode* node) {
+	ensureStructure();
+	return _positions.value(node, -1);
+}
+TextNode* TextLayoutIndex::nodeAt(int position) {
+	ensureStructure();
+	return _nodes.value(position, nullptr);
+}
+
+int TextLayoutIndex::nodeHeight(TextNode* node) {
+
+	ensureStructure();
+
+	int pos = _positions.value(node, -1);
+
+	if (pos < 0) {
+		return computeNodeHeight(node);
+	}
+
+	if (!_exact[pos]) {
+		setHeight(pos, computeNodeHeight(node), true);
+	}
+
+	return _heights[pos];
+}
+int TextLayoutIndex::nodeHeightHint(TextNode* node) {
+
+	ensureStructure();
+
+	int pos = _positions.value(node, -1);
+
+	if (pos < 0) {
+		return estimateNodeHeight(node);
+	}
+
+	return _heights[pos];
+}
+bool TextLayoutIndex::isNodeHeightExact(TextNode* node) {
+
+	ensureStructure();
+
+	int pos = _positions.value(node, -1);
+
+	if (pos < 0) {
+		return false;
+	}
+
+	return _exact[pos];
+}
+
+int TextLayoutIndex::nodeTop(TextNode* node) {
+
+	ensureStructure();
+
+	int pos = _positions.value(node, -1);
+
+	if (pos < 0) {
+		return -1;
+	}
+
+	return treePrefix(_heightTree, pos);
+}
+TextNode* TextLayoutIndex::nodeAtHeight(int y, int* nodeTop) {
+
+	ensureStructure();
+
+	if (y < 0 or _nodes.isEmpty()) {
+		return nullptr;
+	}
+
+	int before;
+	int pos = treeLowerBound(_heightTree, y, &before);
+
+	if (pos >= _nodes.size()) {
+		return nullptr;
+	}
+
+	if (nodeTop != nullptr) {
+		*nodeTop = before;
+	}
+
+	return _nodes[pos];
+}
+int TextLayoutIndex::totalHeight() {
+	ensureStructure();
+	return treePrefix(_heightTree, _nodes.size());
+}
+
+int TextLayoutIndex::lineCount() {
+	ensureStructure();
+	return treePrefix(_lineTree, _nodes.size());
+}
+int TextLayoutIndex::nodeFirstLine(TextNode* node) {
+
+	ensureStructure();
+
+	int pos = _positions.value(node, -1);
+
+	if (pos < 0) {
+		return -1;
+	}
+
+	return treePrefix(_lineTree, pos);
+}
+TextNode* TextLayoutIndex::nodeAtLine(int line, int* firstLine) {
+
+	ensureStructure();
+
+	if (line < 0 or _nodes.isEmpty()) {
+		return nullptr;
+	}
+
+	int before;
+	int pos = treeLowerBound(_lineTree, line, &before);
+
+	if (pos >= _nodes.size()) {
+		return nullptr;
+	}
+
+	if (firstLine != nullptr) {
+		*firstLine = before;
+	}
+
+	return _nodes[pos];
+}
+
+void TextLayoutIndex::layOutAll() {
+
+	ensureStructure();
+
+	for (int i = 0; i < _nodes.size(); i++) {
+		if (!_exact[i]) {
+			setHeight(i, computeNodeHeight(_nodes[i]), true);
+		}
+	}
+}
+
+void TextLayoutIndex::setNodeHeight(TextNode* node, int height) {
+
+	ensureStructure();
+
+	int pos = _positions.value(node, -1);
+
+	if (pos < 0) {
+		return;
+	}
+
+	bool wasExact = _exact[pos];
+	int oldHeight = _heights[pos];
+
+	setHeight(pos, height, true);
+
+	if (wasExact and height != oldHeight) {
+		Q_EMIT nodeRelaidOut(node, height - oldHeight);
+	}
+}
+
+void TextLayoutIndex::invalidateNode(TextNode* node) {
+
+	_knownHeights.remove(node);
+
+	if (_structureDirty) {
+		return;
+	}
+
+	int pos = _positions.value(node, -1);
+
+	if (pos < 0) {
+		return;
+	}
+
+	if (_lineCounts[pos] != node->nbTextLines()) {
+		treeAdd(_lineTree, pos, node->nbTextLines() - _lineCounts[pos]);
+		_lineCounts[pos] = node->nbTextLines();
+	}
+
+	setHeight(pos, estimateNodeHeight(node), false);
+	Q_EMIT layoutInvalidated(pos);
+}
+void TextLayoutIndex::invalidate() {
+	_knownHeights.clear();
+
+	_structureDirty = true; //force a rebuild even if the structure was already considered dirty.
+	Q_EMIT layoutInvalidated(0);
+}
+
+AbstractTextNodeStyle* TextLayoutIndex::nodeStyle(TextNode* node) const {
+
+	if (_styleManager == nullptr or node == nullptr) {
+		return nullptr;
+	}
+
+	AbstractTextNodeStyle* s = _styleManager->getStyleByCode(node->styleId());
+
+	if (s == nullptr) {
+		s = _styleManager->getStyleByCode(_styleManager->getDefaultStyleCode());
+	}
+
+	return s;
+}
+int TextLayoutIndex::computeNodeHeight(TextNode* node) const {
+
+	AbstractTextNodeStyle* s = nodeStyle(node);
+
+	if (s == nullptr) {
+		return 0;
+	}
+
+	return s->nodeHeight(node, _availableWidth);
+}
+int TextLayoutIndex::estimateNodeHeight(TextNode* node) const {
+
+	AbstractTextNodeStyle* s = nodeStyle(node);
+
+	if (s == nullptr) {
+		return 0;
+	}
+
+	QMargins m = s->getNodeMargins(node);
+	int nLines = std::max(node->nbTextLines(), s->expectedNodeNbTextLines());
+
+	return m.top() + m.bottom() + nLines*s->getLineHeight(node->lineAt(0));
+}
+
+void TextLayoutIndex::ensureStructure() {
+
+	if (!_structureDirty) {
+		return;
+	}
+
+	_nodes.clear();
+	_positions.clear();
+
+	if (_root != nullptr) {
+		collectNodes(_root, _nodes);
+	}
+
+	int n = _nodes.size();
+	_positions.reserve(n);
+
+	_heights.resize(n);
+	_exact.resize(n);
+	_lineCounts.resize(n);
+
+	QHash<TextNode*, int> known; //only keep the heights of the nodes still in the document.
+	known.reserve(_knownHeights.size());
+
+	for (int i = 0; i < n; i++) {
+		TextNode* node = _nodes[i];
+		auto it = _knownHeights.constFind(node);
+
+		_positions.insert(node, i);
+		_lineCounts[i] = node->nbTextLines();
+
+		if (it != _knownHeights.constEnd()) {
+			_heights[i] = it.value();
+			_exact[i] = true;
+			known.insert(node, it.value());
+		} else {
+			_heights[i] = estimateNodeHeight(node);
+			_exact[i] = false;
+		}
+	}
+
+	_knownHeights = known;
+
+	treeBuild(_heightTree, _heights);
+	treeBuild(_lineTree, _lineCounts);
+
+	_structureDirty = false;
+}
+void TextLayoutIndex::collectNodes(TextNode* node, QVector<TextNode*> & out) {
+
+	out.push_back(node);
+
+	for (TextNode* child : node->childNodes()) {
+		collectNodes(child, out);
+	}
+}
+void TextLayoutIndex::setHeight(int position, int height, bool exact) {
+
+	int delta = height - _heights[position];
+
+	_heights[position] = height;
+	_exact[position] = exact;
+
+	if (exact) {
+		_knownHeights.insert(_nodes[position], height);
+	} else {
+		_knownHeights.remove(_nodes[position]);
+	}
+
+	if (delta != 0) {
+		treeAdd(_heightTree, position, delta);
+	}
+}
+
+int TextLayoutIndex::subtreePosition(TextNode* parent, int row) {
+
+	int parentPos = _positions.value(parent, -1);
+
+	if (parentPos < 0 or row < 0 or row > parent->nbChildren()) {
+		return -1;
+	}
+
+	if (row == 0) {
+		return parentPos + 1;
+	}
+
+	//the subtree starts after the last descendant of the previous sibling.
+	int pos = _positions.value(parent->childNodes()[row-1]->lastNode(), -1);
+
+	return (pos < 0) ? -1 : pos + 1;
+}
+int TextLayoutIndex::subtreeSize(TextNode* node) {
+
+	int size = 1;
+
+	for (TextNode* child : node->childNodes()) {
+		size += subtreeSize(child);
+	}
+
+	return size;
+}
+void TextLayoutIndex::removeNodes(int start, int end, bool forget) {
+
+	for (int i = start; i < end; i++) {
+		_positions.remove(_nodes[i]);
+
+		if (forget) {
+			_knownHeights.remove(_nodes[i]);
+		}
+	}
+
+	int count = end - start;
+
+	_nodes.remove(start, count);
+	_heights.remove(start, count);
+	_exact.remove(start, count);
+	_lineCounts.remove(start, count);
+}
+void TextLayoutIndex::insertNodes(int position, QVector<TextNode*> const& nodes) {
+
+	int count = nodes.size();
+
+	_nodes.insert(position, count, nullptr);
+	_heights.insert(position, count, 0);
+	_exact.insert(position, count, false);
+	_lineCounts.insert(position, count, 0);
+
+	for (int i = 0; i < count; i++) {
+
+		TextNode* node = nodes[i];
+		int pos = position + i;
+		auto it = _knownHeights.constFind(node);
+
+		_nodes[pos] = node;
+		_lineCounts[pos] = node->nbTextLines();
+
+		if (it != _knownHeights.constEnd()) { //a moved node keeps its height.
+			_heights[pos] = it.value();
+			_exact[pos] = true;
+		} else {
+			_heights[pos] = estimateNodeHeight(node);
+			_exact[pos] = false;
+		}
+	}
+}
+void TextLayoutIndex::updateFrom(int position) {
+
+	for (int i = position; i < _nodes.size(); i++) {
+		_positions.insert(_nodes[i], i);
+	}
+
+	treeRebuildFrom(_heightTree, _heights, position);
+	treeRebuildFrom(_lineTree, _lineCounts, position);
+}
+
+void TextLayoutIndex::onNodeEdited(TextNode* node, TextLine* line) {
+
+	Q_UNUSED(line);
+
+	if (_structureDirty) { //the structure is rebuilt at the next query anyway
+		_knownHeights.remove(node);
+		return;
+	}
+
+	int pos = _positions.value(node, -1);
+
+	if (pos < 0) {
+		return;
+	}
+
+	if (!_exact[pos]) { //the node has never been measured, there is no previous height to compare to.
+		Q_EMIT nodeRelaidOut(node, 0);
+		return;
+	}
+
+	int oldHeight = _heights[pos];
+	setHeight(pos, computeNodeHeight(node), true);
+
+	Q_EMIT nodeRelaidOut(node, _heights[pos] - oldHeight);
+}
+void TextLayoutIndex::onNodeLineLayoutChanged(TextNode* node) {
+
+	if (!_structureDirty) {
+
+		int pos = _positions.value(node, -1);
+
+		if (pos >= 0 and _lineCounts[pos] != node->nbTextLines()) {
+			treeAdd(_lineTree, pos, node->nbTextLines() - _lineCounts[pos]);
+			_lineCounts[pos] = node->nbTextLines();
+		}
+	}
+
+	onNodeEdited(node, nullptr);
+}
+void TextLayoutIndex::onNodesAdded(TextNode* parent, int firstRow, int lastRow) {
+
+	if (_structureDirty) { //the structure is rebuilt at the next query anyway
+		return;
+	}
+
+	int position = subtreePosition(parent, firstRow);
+
+	if (position < 0 or lastRow >= parent->nbChildren()) {
+		onStructureChanged();
+		return;
+	}
+
+	QVector<TextNode*> added;
+
+	for (int row = firstRow; row <= lastRow; row++) {
+		collectNodes(parent->childNodes()[row], added);
+	}
+
+	insertNodes(position, added);
+	updateFrom(position);
+
+	Q_EMIT layoutInvalidated(position);
+}
+void TextLayoutIndex::onNodeRemoved(TextNode* parent, int oldRow) {
+
+	if (_structureDirty) {
+		return;
+	}
+
+	int start = subtreePosition(parent, oldRow);
+
+	if (start < 0 or start >= _nodes.size()) {
+		onStructureChanged();
+		return;
+	}
+
+	int end = start + subtreeSize(_nodes[start]); //the removed node still holds its children.
+
+	if (end > _nodes.size()) {
+		onStructureChanged();
+		return;
+	}
+
+	removeNodes(start, end, true);
+	updateFrom(start);
+
+	Q_EMIT layoutInvalidated(start);
+}
+void TextLayoutIndex::onNodeMoved(TextNode* node, TextNode* oldParent) {
+
+	Q_UNUSED(oldParent);
+
+	if (_structureDirty) {
+		return;
+	}
+
+	int start = _positions.value(node, -1);
+	int end = start + subtreeSize(node);
+
+	if (start < 0 or end > _nodes.size() or node->parentNode() == nullptr) {
+		onStructureChanged();
+		return;
+	}
+
+	QVector<TextNode*> moved = _nodes.mid(start, end - start);
+	removeNodes(start, end, false);
+
+	//the positions before start are still valid, the ones after it are only needed if the node moved down.
+	updateFrom(start);
+
+	int position = subtreePosition(node->parentNode(), node->nodeIndex());
+
+	if (position < 0) {
+		onStructureChanged();
+		return;
+	}
+
+	insertNodes(position, moved);
+	updateFrom(std::min(start, position));
+
+	Q_EMIT layoutInvalidated(std::min(start, position));
+}
+void TextLayoutIndex::onStructureChanged() {
+
+	if (_structureDirty) {
+		return;
+	}
+
+	_structureDirty = true;
+	Q_EMIT layoutInvalidated(0);
+}
+
+void TextLayoutIndex::connectDocument() {
+
+	if (_root == nullptr) {
+		return;
+	}
+
+	connect(_root, &TextNode::nodeEdited, this, &TextLayoutIndex::onNodeEdited);
+	connect(_root, &TextNode::nodeLineLayoutChanged, this, &TextLayoutIndex::onNodeLineLayoutChanged);
+	connect(_root, &TextNode::nodeAdded, this, [this] (TextNode* parent, int row) {
+		onNodesAdded(parent, row, row);
+	});
+	connect(_root, &TextNode::nodesAdded, this, &TextLayoutIndex::onNodesAdded);
+	connect(_root, &TextNode::nodeRemoved, this, &TextLayoutIndex::onNodeRemoved);
+	connect(_root, &TextNode::nodeMoved, this, &TextLayoutIndex::onNodeMoved);
+	connect(_root, &QObject::destroyed, this, [this] () {
+		_root = nullptr;
+		_knownHeights.clear();
+		onStructureChanged();
+	});
+}
+void TextLayoutIndex::disconnectDocument() {
+
+	if (_root == nullptr) {
+		return;
+	}
+
+	disconnect(_root, nullptr, this, nullptr);
+}
+
+void TextLayoutIndex::treeBuild(QVector<int> & tree, QVector<int> const& values) {
+
+	int n = values.size();
+
+	//linear time construction of the tree.
+	tree.fill(0, n+1);
+
+	for (int i = 1; i <= n; i++) {
+		tree[i] += values[i-1];
+		int j = i + (i & -i);
+
+		if (j <= n) {
+			tree[j] += tree[i];
+		}
+	}
+}
+void TextLayoutIndex::treeRebuildFrom(QVector<int> & tree, QVector<int> const& values, int position) {
+
+	int n = values.size();
+
+	//the entries up to position only cover the values before position, they are kept.
+	tree.resize(n+1);
+
+	for (int i = position+1; i <= n; i++) {
+		tree[i] = values[i-1];
+	}
+
+	//the kept entries covered by the recomputed ones are the ones on the prefix path of position.
+	for (int i = position; i > 0; i -= (i & -i)) {
+		int j = i + (i & -i);
+
+		if (j <= n) {
+			tree[j] += tree[i];
+		}
+	}
+
+	for (int i = position+1; i <= n; i++) {
+		int j = i + (i & -i);
+
+		if (j <= n) {
+			tree[j] += tree[i];
+		}
+	}
+}
+int TextLayoutIndex::treePrefix(QVector<int> const& tree, int position) {
+
+	int sum = 0;
+
+	for (int i = position; i > 0; i -= (i & -i)) {
+		sum += tree[i];
+	}
+
+	return sum;
+}
+void TextLayoutIndex::treeAdd(QVector<int> & tree, int position, int delta) {
+
+	int n = tree.size()-1;
+
+	for (int i = position+1; i <= n; i += (i & -i)) {
+		tree[i] += delta;
+	}
+}
+int TextLayoutIndex::treeLowerBound(QVector<int> const& tree, int value, int* before) {
+
+	int n = tree.size()-1;
+	int pos = 0;
+	int sum = 0;
+
+	int step = 1;
+	while (step*2 <= n) {
+		step *= 2;
+	}
+
+	for (; step > 0; step /= 2) {
+		int next = pos + step;
+
+		if (next <= n and sum + tree[next] <= value) {
+			pos = next;
+			sum += tree[next];
+		}
+	}
+
+	if (before != nullptr) {
+		*before = sum;
+	}
+
+	return pos;
+}
+
+} // namespace Sabrina
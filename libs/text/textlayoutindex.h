@@ -0,0 +1,162 @@
+#ifndef SABRINA_TEXTLAYOUTINDEX_H
+#define SABRINA_TEXTLAYOUTINDEX_H
+
+/*
+This file is part of the project Sabrina
+Copyright (C) 2023  Paragon <french.paragon@gmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include <QObject>
+#include <QVector>
+#include <QHash>
+
+#include "./text_global.h"
+
+namespace Sabrina {
+
+class TextNode;
+class TextLine;
+class TextStyleManager;
+class AbstractTextNodeStyle;
+
+/*!
+ * \brief The TextLayoutIndex class keep the height of each node of a document for a given width.
+ *
+ * The nodes are stored in document order, with their heights in a Fenwick tree, so that the vertical position of a node
+ * or the node at a given height can be found in O(log n).
+ * When a line is edited only the node containing it is measured again (and the style only lays out the edited line),
+ * the difference in height is then reported with the nodeRelaidOut signal.
+ * Nodes which have never been measured use an estimated height until they are queried.
+ * Structural changes (nodes added, removed or moved) are spliced in the node order: the nodes before the change keep their position,
+ * the following ones are shifted and only the entries of the trees covering them are recomputed, no node is laid out or estimated again.
+ * The known heights are kept, and the whole order is only rebuilt when the document or the styles change.
+ *
+ * The number of text lines of each node is kept in a second Fenwick tree, to convert between document line numbers and nodes in O(log n).
+ */
+class SABRINA_TEXT_EXPORT TextLayoutIndex : public QObject
+{
+	Q_OBJECT
+public:
+	explicit TextLayoutIndex(QObject *parent = nullptr);
+
+	TextNode* document() const;
+	//! \brief set the node to index, the node and all its descendants are indexed.
+	void setDocument(TextNode* root);
+
+	TextStyleManager* styleManager() const;
+	void setStyleManager(TextStyleManager* manager);
+
+	int availableWidth() const;
+	void setAvailableWidth(int width);
+
+	int nodeCount();
+	//! \brief the position of the node in document order, -1 if the node is not indexed.
+	int nodePosition(TextNode* node);
+	TextNode* nodeAt(int position);
+
+	//! \brief the exact height of the node, the node is laid out if needed.
+	int nodeHeight(TextNode* node);
+	//! \brief the height of the node if known, an estimation otherwise. Never lays the node out.
+	int nodeHeightHint(TextNode* node);
+	bool isNodeHeightExact(TextNode* node);
+
+	//! \brief the vertical position of the node, relative to the start of the document.
+	int nodeTop(TextNode* node);
+	//! \brief the node spanning the vertical position y, and optionally the vertical position of that node.
+	TextNode* nodeAtHeight(int y, int* nodeTop = nullptr);
+	int totalHeight();
+
+	//! \brief the number of text lines in the document.
+	int lineCount();
+	//! \brief the document line number of the first line of the node, -1 if the node is not indexed.
+	int nodeFirstLine(TextNode* node);
+	//! \brief the node containing the document line, and optionally the line number of the first line of that node.
+	TextNode* nodeAtLine(int line, int* firstLine = nullptr);
+
+	//! \brief measure all the nodes whose height is not yet known.
+	void layOutAll();
+	//! \brief set the height of a node measured elsewhere, for example with a copy of the styles on another thread.
+	void setNodeHeight(TextNode* node, int height);
+
+	//! \brief forget the height of a node, for changes the index cannot see (for example when the document signals are blocked).
+	void invalidateNode(TextNode* node);
+	//! \brief forget the heights of all nodes.
+	void invalidate();
+
+Q_SIGNALS:
+
+	//! \brief emitted when a node has been measured again after an edit, heightDelta is the difference with the previous height.
+	void nodeRelaidOut(TextNode* node, int heightDelta);
+	//! \brief emitted when the nodes order changed or the heights have been reset, the nodes before fromPosition kept their position and their height.
+	void layoutInvalidated(int fromPosition);
+
+protected:
+
+	AbstractTextNodeStyle* nodeStyle(TextNode* node) const;
+	int computeNodeHeight(TextNode* node) const;
+	int estimateNodeHeight(TextNode* node) const;
+
+	void ensureStructure();
+	static void collectNodes(TextNode* node, QVector<TextNode*> & out);
+	void setHeight(int position, int height, bool exact);
+
+	//! \brief the position at which the subtree of the child at row of parent starts, -1 if it cannot be found in the current order.
+	int subtreePosition(TextNode* parent, int row);
+	static int subtreeSize(TextNode* node);
+	//! \brief remove the nodes between start (included) and end (excluded), forget their heights if forget is true.
+	void removeNodes(int start, int end, bool forget);
+	void insertNodes(int position, QVector<TextNode*> const& nodes);
+	//! \brief update the positions and the trees after a splice at position.
+	void updateFrom(int position);
+
+	void onNodeEdited(TextNode* node, TextLine* line);
+	void onNodeLineLayoutChanged(TextNode* node);
+	void onNodesAdded(TextNode* parent, int firstRow, int lastRow);
+	void onNodeRemoved(TextNode* parent, int oldRow);
+	void onNodeMoved(TextNode* node, TextNode* oldParent);
+	//! \brief rebuild the whole order at the next query.
+	void onStructureChanged();
+
+	void connectDocument();
+	void disconnectDocument();
+
+	static void treeBuild(QVector<int> & tree, QVector<int> const& values);
+	//! \brief recompute the entries of the tree covering the values from position, the values before position must not have changed.
+	static void treeRebuildFrom(QVector<int> & tree, QVector<int> const& values, int position);
+	static int treePrefix(QVector<int> const& tree, int position);
+	static void treeAdd(QVector<int> & tree, int position, int delta);
+	static int treeLowerBound(QVector<int> const& tree, int value, int* before);
+
+	TextNode* _root;
+	TextStyleManager* _styleManager;
+	int _availableWidth;
+
+	bool _structureDirty;
+
+	QVector<TextNode*> _nodes;
+	QHash<TextNode*, int> _positions;
+	QVector<int> _heights;
+	QVector<bool> _exact;
+	QVector<int> _heightTree;
+	QVector<int> _lineCounts;
+	QVector<int> _lineTree;
+
+	QHash<TextNode*, int> _knownHeights;
+};
+
+} // namespace Sabrina
+
+#endif // SABRINA_TEXTLAYOUTINDEX_H
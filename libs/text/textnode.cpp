@@ -19,6 +19,8 @@ along with this program.  If not, see <https://www.gnu.org/licenses/>.
 #include "textnode.h"
 
 #include <cmath>
+#include <atomic>
+#include <algorithm>
 
 #include <QJsonArray>
 #include <QJsonValue>
@@ -27,7 +29,8 @@ namespace Sabrina {
 
 TextLine::TextLine(TextNode *parent ) :
 	QObject(parent),
-	_text("")
+	_text(""),
+	_revision(nextRevision())
 {
 
 }
@@ -39,10 +42,20 @@ QString TextLine::getText() const {
 void TextLine::setText(QString const& text) {
 	if (_text != text) {
 		_text = text;
-		void lineEdited(TextLine* line);
+		_revision = nextRevision();
+		Q_EMIT lineEdited(this);
 	}
 }
 
+quint64 TextLine::revision() const {
+	return _revision;
+}
+
+quint64 TextLine::nextRevision() {
+	static std::atomic<quint64> counter(0);
+	return ++counter;
+}
+
 TextNode * TextLine::nodeParent() const {
 	return qobject_cast<TextNode*>(parent());
 }
@@ -389,6 +402,33 @@ int TextNode::nodeLine() const {
 	return l;
 }
 
+QVector<int> TextNode::nodePath() const {
+
+	QVector<int> path;
+	const TextNode* n = this;
+
+	while (!n->isRootNode()) {
+		path.push_front(n->nodeIndex());
+		n = n->parentNode();
+	}
+
+	return path;
+}
+
+TextNode* TextNode::nodeAtPath(QVector<int> const& path) {
+
+	TextNode* n = this;
+
+	for (int id : path) {
+		if (id < 0 or id >= n->_children.size()) {
+			return nullptr;
+		}
+		n = n->_children[id];
+	}
+
+	return n;
+}
+
 int TextNode::nodeLevel() const {
 	int level = 0;
 
@@ -899,9 +939,7 @@ TextNode* TextNode::insertNodeBelow(int styleCode, int pos) {
 	}
 	_children.insert(n_pos, n);
 
-	connect(n, &TextNode::nodeAdded, this, &TextNode::nodeAdded);
-	connect(n, &TextNode::nodeRemoved, this, &TextNode::nodeRemoved);
-	connect(n, &TextNode::nodeEdited, this, &TextNode::nodeEdited);
+	connectChild(n);
 
 	Q_EMIT nodeAdded(this, n_pos);
 
@@ -926,18 +964,13 @@ TextNode* TextNode::moveNode(TextNode* newParent, int newPos) {
 
 	if (oldParent != nullptr) {
 		oldParent->_children.removeAt(nodeIndex());
-
-		disconnect(this, &TextNode::nodeAdded, oldParent, &TextNode::nodeAdded);
-		disconnect(this, &TextNode::nodeRemoved, oldParent, &TextNode::nodeRemoved);
-		disconnect(this, &TextNode::nodeEdited, oldParent, &TextNode::nodeEdited);
+		oldParent->disconnectChild(this);
 	}
 
 	newParent->_children.insert(newPos, this);
 	setParent(newParent);
 
-	connect(this, &TextNode::nodeAdded, newParent, &TextNode::nodeAdded);
-	connect(this, &TextNode::nodeRemoved, newParent, &TextNode::nodeRemoved);
-	connect(this, &TextNode::nodeEdited, newParent, &TextNode::nodeEdited);
+	newParent->connectChild(this);
 
 	Q_EMIT nodeMoved(this, oldParent);
 
@@ -945,6 +978,136 @@ TextNode* TextNode::moveNode(TextNode* newParent, int newPos) {
 
 }
 
+TextNode::NodeSnapshot TextNode::snapshot() const {
+
+	NodeSnapshot snap;
+
+	snap.styleId = _style_id;
+
+	for (TextLine* l : _lines) {
+		snap.lines.push_back(l->getText());
+	}
+
+	snap.children.reserve(_children.size());
+
+	for (TextNode* c : _children) {
+		snap.children.push_back(c->snapshot());
+	}
+
+	return snap;
+}
+
+TextNode* TextNode::insertSnapshotBelow(NodeSnapshot const& snapshot, int pos) {
+
+	QList<TextNode*> inserted = insertSnapshotsBelow({snapshot}, pos);
+
+	if (inserted.isEmpty()) {
+		return nullptr;
+	}
+
+	return inserted.first();
+}
+
+QList<TextNode*> TextNode::insertSnapshotsBelow(QVector<NodeSnapshot> const& snapshots, int pos) {
+
+	QList<TextNode*> nodes;
+	nodes.reserve(snapshots.size());
+
+	for (NodeSnapshot const& snapshot : snapshots) {
+		nodes.push_back(fromSnapshot(snapshot));
+	}
+
+	if (!adoptNodes(nodes, pos)) {
+		qDeleteAll(nodes);
+		return {};
+	}
+
+	return nodes;
+}
+
+TextNode* TextNode::fromSnapshot(NodeSnapshot const& snapshot, QObject* parent) {
+
+	//the node is built before being connected to anything, so setting its content does not notify anyone.
+	TextNode* n = new TextNode(parent, std::max(snapshot.lines.size(), 1));
+	n->_style_id = snapshot.styleId;
+
+	for (int i = 0; i < snapshot.lines.size(); i++) {
+		n->_lines[i]->setText(snapshot.lines[i]);
+	}
+
+	n->_children.reserve(snapshot.children.size());
+
+	for (NodeSnapshot const& child : snapshot.children) {
+		TextNode* c = fromSnapshot(child, n);
+		n->_children.push_back(c);
+		n->connectChild(c);
+	}
+
+	return n;
+}
+
+QList<TextNode*> TextNode::takeChildNodes() {
+
+	QList<TextNode*> nodes;
+	nodes.swap(_children);
+
+	for (TextNode* n : nodes) {
+		disconnectChild(n);
+		n->setParent(nullptr);
+	}
+
+	return nodes;
+}
+
+bool TextNode::adoptNodes(QList<TextNode*> const& nodes, int pos) {
+
+	int n_pos = (pos < 0) ? _children.size() + 1 + pos : pos;
+
+	if (n_pos < 0 or n_pos > _children.size()) {
+		return false;
+	}
+
+	for (TextNode* n : nodes) {
+		if (n == nullptr or !n->isRootNode() or n == rootNode()) {
+			return false;
+		}
+	}
+
+	if (nodes.isEmpty()) {
+		return true;
+	}
+
+	_children.reserve(_children.size() + nodes.size());
+
+	for (int i = 0; i < nodes.size(); i++) {
+		TextNode* n = nodes[i];
+		n->setParent(this);
+		_children.insert(n_pos + i, n);
+		connectChild(n);
+	}
+
+	Q_EMIT nodesAdded(this, n_pos, n_pos + nodes.size() - 1);
+
+	return true;
+}
+
+void TextNode::connectChild(TextNode* n) {
+	connect(n, &TextNode::nodeAdded, this, &TextNode::nodeAdded);
+	connect(n, &TextNode::nodesAdded, this, &TextNode::nodesAdded);
+	connect(n, &TextNode::nodeRemoved, this, &TextNode::nodeRemoved);
+	connect(n, &TextNode::nodeEdited, this, &TextNode::nodeEdited);
+	connect(n, &TextNode::nodeMoved, this, &TextNode::nodeMoved);
+	connect(n, &TextNode::nodeLineLayoutChanged, this, &TextNode::nodeLineLayoutChanged);
+}
+void TextNode::disconnectChild(TextNode* n) {
+	disconnect(n, &TextNode::nodeAdded, this, &TextNode::nodeAdded);
+	disconnect(n, &TextNode::nodesAdded, this, &TextNode::nodesAdded);
+	disconnect(n, &TextNode::nodeRemoved, this, &TextNode::nodeRemoved);
+	disconnect(n, &TextNode::nodeEdited, this, &TextNode::nodeEdited);
+	disconnect(n, &TextNode::nodeMoved, this, &TextNode::nodeMoved);
+	disconnect(n, &TextNode::nodeLineLayoutChanged, this, &TextNode::nodeLineLayoutChanged);
+}
+
 QString TextNode::getHtmlRepresentation(NodeCoordinate start,
 										NodeCoordinate end,
 										QMap<int, QString> const& styleNameMap) const {
@@ -1335,7 +1498,13 @@ int TextNode::styleId() const
 
 void TextNode::setStyleId(int style_id)
 {
+	if (style_id == _style_id) {
+		return;
+	}
+
 	_style_id = style_id;
+
+	Q_EMIT nodeLineLayoutChanged(this); //the new style might lay the lines out differently.
 }
 
 } // namespace Sabrina
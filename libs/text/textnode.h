@@ -24,6 +24,8 @@ along with this program.  If not, see <https://www.gnu.org/licenses/>.
 #include <QObject>
 #include <QMap>
 #include <QJsonObject>
+#include <QStringList>
+#include <QVector>
 
 
 namespace Sabrina {
@@ -40,6 +42,14 @@ public:
 	QString getText() const;
 	void setText(QString const& text);
 
+	/*!
+	 * \brief revision identify the current state of the text of the line
+	 *
+	 * The value change each time the text of the line is changed, and is unique among all lines,
+	 * so it can be used to validate cached information about the line (like its layout).
+	 */
+	quint64 revision() const;
+
 	TextNode * nodeParent() const;
 	TextLine* nextLine();
 	TextLine* previousLine();
@@ -65,7 +75,10 @@ Q_SIGNALS:
 
 protected:
 
+	static quint64 nextRevision();
+
 	QString _text;
+	quint64 _revision;
 };
 
 class SABRINA_TEXT_EXPORT TextNode : public QObject
@@ -104,6 +117,17 @@ public:
 
 	typedef std::pair<TextNode::NodeCoordinate, TextNode::NodeCoordinate> DocumentInterval;
 
+	/*!
+	 * \brief The NodeSnapshot struct store the content of a node and its children (styles and lines texts), without any object.
+	 * It is used to restore a part of the document which has been removed.
+	 */
+	struct NodeSnapshot{
+		NodeSnapshot() : styleId(0) {};
+		int styleId;
+		QStringList lines;
+		QVector<NodeSnapshot> children;
+	};
+
 	/*!
 	 * \brief nCharsBetweenNodes gives the number of text character present between two nodes
 	 * \param start The first node (inclusive)
@@ -141,6 +165,11 @@ public:
 	//! \brief the starting line of the node in the document
 	int nodeLine() const;
 
+	//! \brief the indices of the node and of all its parents in their parent children list, starting from the root node.
+	QVector<int> nodePath() const;
+	//! \brief the node at the given path (see nodePath) below this node, nullptr if the path does not exist.
+	TextNode* nodeAtPath(QVector<int> const& path);
+
 	//! \brief the level of the node in the document
 	int nodeLevel() const;
 
@@ -207,6 +236,24 @@ public:
 
 	TextNode* moveNode(TextNode* newParent, int newPos);
 
+	NodeSnapshot snapshot() const;
+	//! \brief recreate a node and its children from a snapshot at position pos in the children of this node.
+	TextNode* insertSnapshotBelow(NodeSnapshot const& snapshot, int pos);
+	//! \brief recreate consecutive nodes from their snapshots at position pos, the nodes are built detached and inserted with a single nodesAdded signal.
+	QList<TextNode*> insertSnapshotsBelow(QVector<NodeSnapshot> const& snapshots, int pos);
+	//! \brief build a detached node and its children from a snapshot, without emitting any signal.
+	static TextNode* fromSnapshot(NodeSnapshot const& snapshot, QObject* parent = nullptr);
+
+	//! \brief detach all the children of the node without any notification, meant for nodes built outside of a document.
+	QList<TextNode*> takeChildNodes();
+	/*!
+	 * \brief adoptNodes insert detached nodes (root nodes) at position pos in the children of this node.
+	 * \return false, without changing anything, if one of the nodes is not detached or pos is out of range.
+	 *
+	 * The insertion is notified with a single nodesAdded signal, whatever the number and size of the inserted nodes.
+	 */
+	bool adoptNodes(QList<TextNode*> const& nodes, int pos);
+
 	QString getHtmlRepresentation(NodeCoordinate start = NodeCoordinate(),
 								  NodeCoordinate end = NodeCoordinate(),
 								  QMap<int, QString> const& styleNameMap = {}) const;
@@ -222,6 +269,8 @@ Q_SIGNALS:
 
 	void nodeRemoved(TextNode* parent, int oldRow);
 	void nodeAdded(TextNode* parent, int newRow);
+	//! \brief emitted when the rows firstRow to lastRow (included) have been inserted at once, the nodes below them are not notified individually.
+	void nodesAdded(TextNode* parent, int firstRow, int lastRow);
 	void nodeEdited(TextNode* node, TextLine* line);
 	void nodeMoved(TextNode* node, TextNode* oldParent);
 	void nodeLineLayoutChanged(TextNode* node);
@@ -234,6 +283,9 @@ protected:
 
 	void onLineEdited(TextLine* line);
 
+	void connectChild(TextNode* n);
+	void disconnectChild(TextNode* n);
+
 	QList<TextNode*> _children;
 	QList<TextLine*> _lines;
 
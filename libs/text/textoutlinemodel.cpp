@@ -0,0 +1,475 @@
+/*
+This file is part of the project Sabrina
+Copyright (C) 2023  Paragon <french.paragon@gmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "textoutlinemodel.h"
+
+#include "textnode.h"
+
+namespace Sabrina {
+
+TextOutlineModel::TextOutlineModel(QObject *parent) :
+	QAbstractItemModel(parent),
+	_root(nullptr),
+	_maxDepth(0)
+{
+
+}
+
+TextNode* TextOutlineModel::document() const {
+	return _root;
+}
+void TextOutlineModel::setDocument(TextNode* root) {
+
+	if (root == _root) {
+		return;
+	}
+
+	beginResetModel();
+	disconnectDocument();
+	_root = root;
+	connectDocument();
+	resetEntries();
+	endResetModel();
+}
+
+int TextOutlineModel::maxDepth() const {
+	return _maxDepth;
+}
+void TextOutlineModel::setMaxDepth(int depth) {
+
+	if (depth == _maxDepth) {
+		return;
+	}
+
+	beginResetModel();
+	_maxDepth = depth;
+	resetEntries();
+	endResetModel();
+}
+
+TextNode* TextOutlineModel::nodeFromIndex(QModelIndex const& index) const {
+
+	if (!index.isValid() or index.model() != this) {
+		return nullptr;
+	}
+
+	return static_cast<TextNode*>(index.internalPointer());
+}
+QModelIndex TextOutlineModel::indexFromNode(TextNode* node) {
+
+	if (node == nullptr or _root == nullptr or node == _root or node->rootNode() != _root) {
+		return QModelIndex();
+	}
+
+	QVector<TextNode*> ancestors;
+
+	for (TextNode* p = node->parentNode(); p != nullptr; p = p->parentNode()) {
+		ancestors.push_front(p);
+	}
+
+	for (TextNode* p : qAsConst(ancestors)) {
+
+		if (!_entries.contains(p)) {
+			return QModelIndex();
+		}
+
+		QModelIndex index = indexOfNode(p);
+
+		if (canFetchMore(index)) {
+			fetchMore(index);
+		}
+	}
+
+	if (!_entries.contains(node)) { //below the maximal depth.
+		return QModelIndex();
+	}
+
+	return indexOfNode(node);
+}
+
+QModelIndex TextOutlineModel::index(int row, int column, const QModelIndex &parent) const {
+
+	TextNode* p = nodeForParent(parent);
+
+	auto it = _entries.constFind(p);
+
+	if (p == nullptr or it == _entries.constEnd() or column != 0 or row < 0 or row >= it->children.size()) {
+		return QModelIndex();
+	}
+
+	return createIndex(row, column, it->children[row]);
+}
+QModelIndex TextOutlineModel::parent(const QModelIndex &index) const {
+
+	TextNode* node = nodeFromIndex(index);
+
+	auto it = _entries.constFind(node);
+
+	if (node == nullptr or it == _entries.constEnd()) {
+		return QModelIndex();
+	}
+
+	return indexOfNode(it->parent);
+}
+
+int TextOutlineModel::rowCount(const QModelIndex &parent) const {
+
+	if (parent.column() > 0) {
+		return 0;
+	}
+
+	auto it = _entries.constFind(nodeForParent(parent));
+
+	if (it == _entries.constEnd()) {
+		return 0;
+	}
+
+	return it->children.size();
+}
+int TextOutlineModel::columnCount(const QModelIndex &parent) const {
+	Q_UNUSED(parent);
+	return 1;
+}
+bool TextOutlineModel::hasChildren(const QModelIndex &parent) const {
+
+	TextNode* p = nodeForParent(parent);
+
+	if (p == nullptr or parent.column() > 0) {
+		return false;
+	}
+
+	auto it = _entries.constFind(p);
+
+	if (it != _entries.constEnd() and it->fetched) {
+		return !it->children.isEmpty();
+	}
+
+	return isExpandable(p) and p->nbChildren() > 0;
+}
+
+bool TextOutlineModel::canFetchMore(const QModelIndex &parent) const {
+
+	auto it = _entries.constFind(nodeForParent(parent));
+
+	return it != _entries.constEnd() and !it->fetched;
+}
+void TextOutlineModel::fetchMore(const QModelIndex &parent) {
+
+	TextNode* p = nodeForParent(parent);
+
+	auto it = _entries.find(p);
+
+	if (it == _entries.end() or it->fetched) {
+		return;
+	}
+
+	QList<TextNode*> const& children = p->childNodes();
+
+	if (children.isEmpty()) {
+		it->fetched = true;
+		return;
+	}
+
+	beginInsertRows(parent, 0, children.size()-1);
+
+	it->children = children.toVector();
+	it->fetched = true;
+	it->rowsDirty = true;
+
+	for (TextNode* child : children) {
+		addEntry(child, p);
+	}
+
+	endInsertRows();
+}
+
+QVariant TextOutlineModel::data(const QModelIndex &index, int role) const {
+
+	TextNode* node = nodeFromIndex(index);
+
+	if (node == nullptr) {
+		return QVariant();
+	}
+
+	switch (role) {
+	case Qt::DisplayRole:
+		return (node->nbTextLines() > 0) ? node->lineAt(0)->getText() : QString();
+	case StyleIdRole:
+		return node->styleId();
+	case NodeLevelRole:
+		return node->nodeLevel();
+	default:
+		break;
+	}
+
+	return QVariant();
+}
+QHash<int, QByteArray> TextOutlineModel::roleNames() const {
+
+	QHash<int, QByteArray> roles = QAbstractItemModel::roleNames();
+
+	roles.insert(StyleIdRole, "styleId");
+	roles.insert(NodeLevelRole, "nodeLevel");
+
+	return roles;
+}
+
+bool TextOutlineModel::isExpandable(TextNode* node) const {
+	return _maxDepth <= 0 or node->nodeLevel() < _maxDepth;
+}
+TextNode* TextOutlineModel::nodeForParent(QModelIndex const& parent) const {
+
+	if (!parent.isValid()) {
+		return _root;
+	}
+
+	return nodeFromIndex(parent);
+}
+QModelIndex TextOutlineModel::indexOfNode(TextNode* node) const {
+
+	if (node == nullptr or node == _root) {
+		return QModelIndex();
+	}
+
+	return createIndex(rowOf(node), 0, node);
+}
+int TextOutlineModel::rowOf(TextNode* node) const {
+
+	auto it = _entries.constFind(node);
+
+	if (it == _entries.constEnd()) {
+		return -1;
+	}
+
+	auto parentIt = _entries.find(it->parent);
+
+	if (parentIt == _entries.end()) {
+		return -1;
+	}
+
+	if (parentIt->rowsDirty) {
+
+		QVector<TextNode*> const& children = parentIt->children;
+
+		for (int i = 0; i < children.size(); i++) {
+			_entries[children[i]].row = i;
+		}
+
+		_entries[it->parent].rowsDirty = false;
+	}
+
+	return _entries.value(node).row;
+}
+
+void TextOutlineModel::addEntry(TextNode* node, TextNode* parent) {
+
+	Entry entry;
+	entry.parent = parent;
+	entry.fetched = !isExpandable(node) or node->nbChildren() == 0; //nothing to fetch, new children are inserted as they come.
+
+	_entries.insert(node, entry);
+}
+void TextOutlineModel::removeEntries(TextNode* node) {
+
+	auto it = _entries.find(node);
+
+	if (it == _entries.end()) {
+		return;
+	}
+
+	QVector<TextNode*> children = it->children;
+	_entries.erase(it);
+
+	for (TextNode* child : children) {
+		removeEntries(child);
+	}
+}
+void TextOutlineModel::resetEntries() {
+
+	_entries.clear();
+
+	if (_root != nullptr) {
+		addEntry(_root, nullptr);
+	}
+}
+
+void TextOutlineModel::insertMirrorRows(TextNode* parent, int first, int last) {
+
+	auto it = _entries.find(parent);
+
+	if (it == _entries.end() or !it->fetched or !isExpandable(parent)) { //the rows will be read when fetched.
+		return;
+	}
+
+	if (first > it->children.size() or it->children.size() + last - first + 1 != parent->nbChildren()) { //the mirror is out of sync.
+		beginResetModel();
+		resetEntries();
+		endResetModel();
+		return;
+	}
+
+	beginInsertRows(indexOfNode(parent), first, last);
+
+	QList<TextNode*> const& children = parent->childNodes();
+
+	it = _entries.find(parent);
+	for (int i = first; i <= last; i++) {
+		it->children.insert(i, children[i]);
+	}
+	it->rowsDirty = true;
+
+	for (int i = first; i <= last; i++) {
+		addEntry(children[i], parent);
+	}
+
+	endInsertRows();
+}
+void TextOutlineModel::removeMirrorRow(TextNode* parent, int row) {
+
+	auto it = _entries.find(parent);
+
+	if (it == _entries.end() or row < 0 or row >= it->children.size()) {
+		return;
+	}
+
+	beginRemoveRows(indexOfNode(parent), row, row);
+
+	it = _entries.find(parent);
+	TextNode* child = it->children.takeAt(row);
+	it->rowsDirty = true;
+
+	removeEntries(child);
+
+	endRemoveRows();
+}
+
+void TextOutlineModel::onNodeAdded(TextNode* parent, int row) {
+	insertMirrorRows(parent, row, row);
+}
+void TextOutlineModel::onNodesAdded(TextNode* parent, int firstRow, int lastRow) {
+	insertMirrorRows(parent, firstRow, lastRow);
+}
+void TextOutlineModel::onNodeRemoved(TextNode* parent, int oldRow) {
+	removeMirrorRow(parent, oldRow);
+}
+void TextOutlineModel::onNodeMoved(TextNode* node, TextNode* oldParent) {
+
+	TextNode* newParent = node->parentNode();
+	int newRow = node->nodeIndex();
+
+	auto nodeIt = _entries.constFind(node);
+	int oldRow = (nodeIt != _entries.constEnd() and nodeIt->parent == oldParent) ? rowOf(node) : -1;
+
+	auto newIt = _entries.constFind(newParent);
+	bool inNewParent = newIt != _entries.constEnd() and newIt->fetched and isExpandable(newParent);
+
+	//a node changing level might be shown with a different depth, it is inserted again in that case.
+	bool sameLevel = _maxDepth <= 0 or oldParent == nullptr or oldParent->nodeLevel() == newParent->nodeLevel();
+
+	if (oldRow >= 0 and inNewParent and sameLevel) {
+
+		if (oldParent == newParent and oldRow == newRow) {
+			return;
+		}
+
+		int destination = (oldParent == newParent and newRow > oldRow) ? newRow+1 : newRow; //the row before the move.
+
+		if (beginMoveRows(indexOfNode(oldParent), oldRow, oldRow, indexOfNode(newParent), destination)) {
+
+			auto oldIt = _entries.find(oldParent);
+			oldIt->children.remove(oldRow);
+			oldIt->rowsDirty = true;
+
+			auto it = _entries.find(newParent);
+			it->children.insert(newRow, node);
+			it->rowsDirty = true;
+
+			_entries[node].parent = newParent;
+
+			endMoveRows();
+			return;
+		}
+	}
+
+	if (oldRow >= 0) {
+		removeMirrorRow(oldParent, oldRow);
+	}
+
+	if (inNewParent) {
+
+		auto it = _entries.find(newParent);
+
+		if (newRow > it->children.size()) {
+			return;
+		}
+
+		beginInsertRows(indexOfNode(newParent), newRow, newRow);
+
+		it = _entries.find(newParent);
+		it->children.insert(newRow, node);
+		it->rowsDirty = true;
+		addEntry(node, newParent);
+
+		endInsertRows();
+	}
+}
+void TextOutlineModel::onNodeEdited(TextNode* node, TextLine* line) {
+
+	if (node->nbTextLines() > 0 and line == node->lineAt(0)) { //only the first line is displayed.
+		onNodeChanged(node);
+	}
+}
+void TextOutlineModel::onNodeChanged(TextNode* node) {
+
+	if (node == _root or !_entries.contains(node)) {
+		return;
+	}
+
+	QModelIndex index = indexOfNode(node);
+	Q_EMIT dataChanged(index, index);
+}
+
+void TextOutlineModel::connectDocument() {
+
+	if (_root == nullptr) {
+		return;
+	}
+
+	connect(_root, &TextNode::nodeAdded, this, &TextOutlineModel::onNodeAdded);
+	connect(_root, &TextNode::nodesAdded, this, &TextOutlineModel::onNodesAdded);
+	connect(_root, &TextNode::nodeRemoved, this, &TextOutlineModel::onNodeRemoved);
+	connect(_root, &TextNode::nodeMoved, this, &TextOutlineModel::onNodeMoved);
+	connect(_root, &TextNode::nodeEdited, this, &TextOutlineModel::onNodeEdited);
+	connect(_root, &TextNode::nodeLineLayoutChanged, this, &TextOutlineModel::onNodeChanged); //style or lines changed.
+	connect(_root, &QObject::destroyed, this, [this] () {
+		beginResetModel();
+		_root = nullptr;
+		_entries.clear();
+		endResetModel();
+	});
+}
+void TextOutlineModel::disconnectDocument() {
+
+	if (_root == nullptr) {
+		return;
+	}
+
+	disconnect(_root, nullptr, this, nullptr);
+}
+
+} // namespace Sabrina
@@ -0,0 +1,118 @@
+#ifndef SABRINA_TEXTOUTLINEMODEL_H
+#define SABRINA_TEXTOUTLINEMODEL_H
+
+/*
+This file is part of the project Sabrina
+Copyright (C) 2023  Paragon <french.paragon@gmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include <QAbstractItemModel>
+#include <QHash>
+#include <QVector>
+
+#include "./text_global.h"
+
+namespace Sabrina {
+
+class TextNode;
+class TextLine;
+
+/*!
+ * \brief The TextOutlineModel class present the tree of the nodes of a document (for example the pages and panels of a comic script) as an item model.
+ *
+ * The children of a node are only read from the document when a view fetches them, and the model keeps a mirror of the rows it exposed.
+ * The document signals are mapped to the matching row insertions, removals and moves on that mirror, the model is never reset by an edit.
+ * The row of each node in its parent is cached and renumbered only when the children of the parent changed, so finding the parent
+ * of an index does not search the children list.
+ */
+class SABRINA_TEXT_EXPORT TextOutlineModel : public QAbstractItemModel
+{
+	Q_OBJECT
+public:
+
+	enum Roles {
+		StyleIdRole = Qt::UserRole+1,
+		NodeLevelRole = Qt::UserRole+2
+	};
+
+	explicit TextOutlineModel(QObject *parent = nullptr);
+
+	TextNode* document() const;
+	void setDocument(TextNode* root);
+
+	int maxDepth() const;
+	//! \brief the nodes at the given level are shown without their children, 0 shows the whole tree.
+	void setMaxDepth(int depth);
+
+	TextNode* nodeFromIndex(QModelIndex const& index) const;
+	//! \brief the index of a node of the document, the rows of its parents are fetched if needed. Invalid if the node is not shown.
+	QModelIndex indexFromNode(TextNode* node);
+
+	QModelIndex index(int row, int column, const QModelIndex &parent = QModelIndex()) const override;
+	QModelIndex parent(const QModelIndex &index) const override;
+
+	int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+	int columnCount(const QModelIndex &parent = QModelIndex()) const override;
+	bool hasChildren(const QModelIndex &parent = QModelIndex()) const override;
+
+	bool canFetchMore(const QModelIndex &parent) const override;
+	void fetchMore(const QModelIndex &parent) override;
+
+	QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+	QHash<int, QByteArray> roleNames() const override;
+
+protected:
+
+	struct Entry {
+		Entry() : parent(nullptr), row(0), fetched(false), rowsDirty(false) {}
+		TextNode* parent;
+		QVector<TextNode*> children; //the rows exposed by the model, only filled once fetched.
+		int row;
+		bool fetched;
+		bool rowsDirty; //the rows of the children have to be renumbered.
+	};
+
+	bool isExpandable(TextNode* node) const;
+	TextNode* nodeForParent(QModelIndex const& parent) const;
+	QModelIndex indexOfNode(TextNode* node) const;
+	int rowOf(TextNode* node) const;
+
+	void addEntry(TextNode* node, TextNode* parent);
+	void removeEntries(TextNode* node);
+	void resetEntries();
+
+	void insertMirrorRows(TextNode* parent, int first, int last);
+	void removeMirrorRow(TextNode* parent, int row);
+
+	void onNodeAdded(TextNode* parent, int row);
+	void onNodesAdded(TextNode* parent, int firstRow, int lastRow);
+	void onNodeRemoved(TextNode* parent, int oldRow);
+	void onNodeMoved(TextNode* node, TextNode* oldParent);
+	void onNodeEdited(TextNode* node, TextLine* line);
+	void onNodeChanged(TextNode* node);
+
+	void connectDocument();
+	void disconnectDocument();
+
+	TextNode* _root;
+	int _maxDepth;
+
+	mutable QHash<TextNode*, Entry> _entries; //rows are renumbered lazily, from const functions.
+};
+
+} // namespace Sabrina
+
+#endif // SABRINA_TEXTOUTLINEMODEL_H
@@ -0,0 +1,426 @@
+/*
+This file is part of the project Sabrina
+Copyright (C) 2023  Paragon <french.paragon@gmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "textpaginator.h"
+
+#include "textnode.h"
+#include "abstracttextstyle.h"
+#include "textstylemanager.h"
+#include "textlayoutindex.h"
+
+#include <QPainter>
+
+#include <algorithm>
+
+namespace Sabrina {
+
+TextPaginator::TextPaginator(QObject *parent) :
+	QObject(parent),
+	_index(new TextLayoutIndex(this)),
+	_pageLayout(QPageSize(QPageSize::A4), QPageLayout::Portrait, QMarginsF(40.0, 40.0, 40.0, 40.0), QPageLayout::Point),
+	_resolution(72),
+	_complete(false),
+	_forcedBreaksEnd(0)
+{
+	_index->setAvailableWidth(pageArea().width());
+
+	connect(_index, &TextLayoutIndex::nodeRelaidOut, this, &TextPaginator::onNodeRelaidOut);
+	connect(_index, &TextLayoutIndex::layoutInvalidated, this, &TextPaginator::onLayoutInvalidated);
+}
+
+TextNode* TextPaginator::document() const {
+	return _index->document();
+}
+void TextPaginator::setDocument(TextNode* root) {
+	_index->setDocument(root);
+}
+
+TextStyleManager* TextPaginator::styleManager() const {
+	return _index->styleManager();
+}
+void TextPaginator::setStyleManager(TextStyleManager* manager) {
+	_index->setStyleManager(manager);
+}
+
+QPageLayout TextPaginator::pageLayout() const {
+	return _pageLayout;
+}
+int TextPaginator::resolution() const {
+	return _resolution;
+}
+void TextPaginator::setPageLayout(QPageLayout const& layout, int resolution) {
+
+	if (layout.isEquivalentTo(_pageLayout) and resolution == _resolution) {
+		return;
+	}
+
+	_pageLayout = layout;
+	_pageLayout.setMode(QPageLayout::StandardMode);
+	_resolution = resolution;
+
+	int width = pageArea().width();
+
+	if (width != _index->availableWidth()) {
+		_index->setAvailableWidth(width); //invalidate the index, which invalidate the pages.
+	} else {
+		invalidateFromPage(0); //only the height of the pages changed.
+	}
+}
+
+QRect TextPaginator::pageArea() const {
+	return _pageLayout.paintRectPixels(_resolution);
+}
+
+QSet<int> TextPaginator::pageBreakStyles() const {
+	return _pageBreakStyles;
+}
+void TextPaginator::setPageBreakStyles(QSet<int> const& styles) {
+
+	if (styles == _pageBreakStyles) {
+		return;
+	}
+
+	_pageBreakStyles = styles;
+	invalidateForcedBreaks(0);
+	invalidateFromPage(0);
+}
+
+TextLayoutIndex* TextPaginator::layoutIndex() const {
+	return _index;
+}
+
+int TextPaginator::pageCount() {
+
+	while (computeNextPage()) {
+
+	}
+
+	return _pageStarts.size();
+}
+bool TextPaginator::isComplete() const {
+	return _complete;
+}
+int TextPaginator::knownPageCount() const {
+	return _pageStarts.size();
+}
+int TextPaginator::estimatedPageCount() {
+
+	if (_complete) {
+		return _pageStarts.size();
+	}
+
+	int n = _index->nodeCount();
+
+	if (n == 0) {
+		return 0;
+	}
+
+	updateForcedBreaks();
+
+	int known = std::max(_pageStarts.size() - 1, 0); //the last known page is not complete.
+	int start = _pageStarts.isEmpty() ? 0 : _pageStarts.last();
+
+	int pageHeight = pageArea().height();
+	int remainingHeight = _index->totalHeight() - _index->nodeTop(_index->nodeAt(start));
+	int byHeight = (pageHeight > 0) ? (remainingHeight + pageHeight - 1)/pageHeight : 1;
+
+	//each forced break after the start of the last known page starts at least one page.
+	int forced = static_cast<int>(_forcedBreaks.constEnd() - std::upper_bound(_forcedBreaks.constBegin(), _forcedBreaks.constEnd(), start));
+
+	return known + std::max(byHeight, forced + 1);
+}
+bool TextPaginator::computePages(int maxPages) {
+
+	for (int i = 0; i < maxPages; i++) {
+		if (!computeNextPage()) {
+			break;
+		}
+	}
+
+	return _complete;
+}
+int TextPaginator::pageOfNode(TextNode* node) {
+
+	int pos = _index->nodePosition(node);
+
+	if (pos < 0) {
+		return -1;
+	}
+
+	//the page of the node is known once the page after it has started, or all the pages are known.
+	while ((_pageStarts.isEmpty() or _pageStarts.last() <= pos) and computeNextPage()) {
+
+	}
+
+	return pageOfPosition(pos);
+}
+TextNode* TextPaginator::firstNodeOfPage(int page) {
+
+	if (page < 0) {
+		return nullptr;
+	}
+
+	while (_pageStarts.size() <= page and computeNextPage()) {
+
+	}
+
+	if (page >= _pageStarts.size()) {
+		return nullptr;
+	}
+
+	return _index->nodeAt(_pageStarts[page]);
+}
+QVector<TextNode*> TextPaginator::nodesOfPage(int page) {
+
+	QVector<TextNode*> ret;
+
+	if (firstNodeOfPage(page) == nullptr) {
+		return ret;
+	}
+
+	int end = pageEndPosition(page);
+
+	ret.reserve(end - _pageStarts[page]);
+
+	for (int i = _pageStarts[page]; i < end; i++) {
+		ret.push_back(_index->nodeAt(i));
+	}
+
+	return ret;
+}
+
+bool TextPaginator::renderPage(int page, QPainter & painter) {
+
+	if (firstNodeOfPage(page) == nullptr) {
+		return false;
+	}
+
+	int width = pageArea().width();
+	int end = pageEndPosition(page);
+	int h = 0;
+
+	for (int i = _pageStarts[page]; i < end; i++) {
+
+		TextNode* node = _index->nodeAt(i);
+		AbstractTextNodeStyle* style = nodeStyle(node);
+
+		if (style == nullptr) {
+			return false;
+		}
+
+		style->renderNode(node, QPointF(0, h), width, painter);
+
+		h += _index->nodeHeight(node);
+	}
+
+	return true;
+}
+
+AbstractTextNodeStyle* TextPaginator::nodeStyle(TextNode* node) const {
+
+	TextStyleManager* manager = _index->styleManager();
+
+	if (manager == nullptr or node == nullptr) {
+		return nullptr;
+	}
+
+	AbstractTextNodeStyle* s = manager->getStyleByCode(node->styleId());
+
+	if (s == nullptr) {
+		s = manager->getStyleByCode(manager->getDefaultStyleCode());
+	}
+
+	return s;
+}
+
+void TextPaginator::onNodeRelaidOut(TextNode* node, int heightDelta) {
+
+	int pos = _index->nodePosition(node);
+
+	if (pos < 0) {
+		return;
+	}
+
+	//the style of the node might have changed too.
+	bool breakChanged = false;
+
+	if (pos < _forcedBreaksEnd) {
+		bool isBreak = _pageBreakStyles.contains(node->styleId());
+		bool wasBreak = std::binary_search(_forcedBreaks.constBegin(), _forcedBreaks.constEnd(), pos);
+
+		if (isBreak != wasBreak) {
+			invalidateForcedBreaks(pos);
+			breakChanged = true;
+		}
+	}
+
+	if (heightDelta == 0 and !breakChanged) {
+		return;
+	}
+
+	int page = pageOfPosition(pos);
+
+	if (page > 0 and _pageStarts[page] == pos) {
+		page -= 1; //a node starting a page might now fit at the end of the previous one.
+	}
+
+	invalidateFromPage(page);
+}
+void TextPaginator::onLayoutInvalidated(int fromPosition) {
+
+	int pos = std::max(fromPosition, 0);
+
+	invalidateForcedBreaks(pos);
+
+	//the pages before the one containing the first changed node are kept.
+	int page = pageOfPosition(pos);
+
+	if (page > 0 and _pageStarts[page] == pos) {
+		page -= 1; //the previous page might now end further.
+	}
+
+	invalidateFromPage(page);
+}
+void TextPaginator::invalidateFromPage(int page) {
+
+	if (page <= 0) {
+		_pageStarts.clear();
+	} else if (page < _pageStarts.size()) {
+		_pageStarts.resize(page+1); //the start of the page itself is still valid.
+	}
+
+	_complete = false;
+
+	Q_EMIT pagesChanged(std::max(page, 0));
+}
+
+bool TextPaginator::computeNextPage() {
+
+	if (_complete) {
+		return false;
+	}
+
+	updateForcedBreaks();
+
+	int n = _index->nodeCount();
+
+	if (_pageStarts.isEmpty()) {
+
+		if (n == 0) {
+			_complete = true;
+			return false;
+		}
+
+		_pageStarts.push_back(0);
+		return true;
+	}
+
+	int next = nextPageStart(_pageStarts.last());
+
+	if (next >= n) {
+		_complete = true;
+		return false;
+	}
+
+	_pageStarts.push_back(next);
+	return true;
+}
+int TextPaginator::nextPageStart(int start) {
+
+	int n = _index->nodeCount();
+
+	if (start >= n) {
+		return n;
+	}
+
+	int pageHeight = pageArea().height();
+
+	auto forced = std::upper_bound(_forcedBreaks.constBegin(), _forcedBreaks.constEnd(), start);
+	int limit = (forced != _forcedBreaks.constEnd()) ? *forced : n;
+
+	//only the nodes of the page are laid out, a node larger than a page still get its own page.
+	int end = start+1;
+	int height = _index->nodeHeight(_index->nodeAt(start));
+
+	while (end < limit) {
+
+		height += _index->nodeHeight(_index->nodeAt(end));
+
+		if (height > pageHeight) { //a node fits on the page if its bottom is not below the bottom of the page.
+			break;
+		}
+
+		end++;
+	}
+
+	return end;
+}
+void TextPaginator::updateForcedBreaks() {
+
+	int n = _index->nodeCount();
+
+	if (_forcedBreaksEnd >= n) {
+		return;
+	}
+
+	if (!_pageBreakStyles.isEmpty()) {
+		for (int i = _forcedBreaksEnd; i < n; i++) {
+			if (_pageBreakStyles.contains(_index->nodeAt(i)->styleId())) {
+				_forcedBreaks.push_back(i);
+			}
+		}
+	}
+
+	_forcedBreaksEnd = n;
+}
+void TextPaginator::invalidateForcedBreaks(int position) {
+
+	if (position >= _forcedBreaksEnd) {
+		return;
+	}
+
+	auto it = std::lower_bound(_forcedBreaks.constBegin(), _forcedBreaks.constEnd(), position);
+	_forcedBreaks.resize(static_cast<int>(it - _forcedBreaks.constBegin()));
+
+	_forcedBreaksEnd = position;
+}
+
+int TextPaginator::pageOfPosition(int position) const {
+
+	if (_pageStarts.isEmpty() or position < 0) {
+		return -1;
+	}
+
+	auto it = std::upper_bound(_pageStarts.constBegin(), _pageStarts.constEnd(), position);
+
+	return static_cast<int>(it - _pageStarts.constBegin()) - 1;
+}
+int TextPaginator::pageEndPosition(int page) {
+
+	while (_pageStarts.size() <= page+1 and computeNextPage()) {
+
+	}
+
+	if (page+1 < _pageStarts.size()) {
+		return _pageStarts[page+1];
+	}
+
+	return _index->nodeCount();
+}
+
+} // namespace Sabrina
@@ -0,0 +1,134 @@
+#ifndef SABRINA_TEXTPAGINATOR_H
+#define SABRINA_TEXTPAGINATOR_H
+
+/*
+This file is part of the project Sabrina
+Copyright (C) 2023  Paragon <french.paragon@gmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include <QObject>
+#include <QPageLayout>
+#include <QRect>
+#include <QSet>
+#include <QVector>
+
+#include "./text_global.h"
+
+class QPainter;
+
+namespace Sabrina {
+
+class TextNode;
+class TextStyleManager;
+class TextLayoutIndex;
+class AbstractTextNodeStyle;
+
+/*!
+ * \brief The TextPaginator class split a document in pages for a given page layout.
+ *
+ * The paginator uses its own TextLayoutIndex, laid out at the width of the page. The breaks are computed lazily, page by page,
+ * and only the nodes of the computed pages are laid out, so finding the page of the cursor does not lay out the rest of the document.
+ * When a node height changes only the pages starting from the one containing the node are computed again.
+ *
+ * The number of pages is only known once all the pages are computed, estimatedPageCount give an estimate without laying anything out,
+ * and computePages allow to compute the remaining pages in small steps, for example when the application is idle.
+ *
+ * The paginator should use a style manager which is not shared with an editor, as the styles cache the layout of each line for a single width.
+ */
+class SABRINA_TEXT_EXPORT TextPaginator : public QObject
+{
+	Q_OBJECT
+public:
+	explicit TextPaginator(QObject *parent = nullptr);
+
+	TextNode* document() const;
+	void setDocument(TextNode* root);
+
+	TextStyleManager* styleManager() const;
+	void setStyleManager(TextStyleManager* manager);
+
+	QPageLayout pageLayout() const;
+	int resolution() const;
+	//! \brief set the page layout, and the resolution (in dpi) used to convert it to pixels.
+	void setPageLayout(QPageLayout const& layout, int resolution);
+
+	//! \brief the printable area of the pages, in pixels.
+	QRect pageArea() const;
+
+	QSet<int> pageBreakStyles() const;
+	//! \brief set the styles of the nodes which always start a new page.
+	void setPageBreakStyles(QSet<int> const& styles);
+
+	TextLayoutIndex* layoutIndex() const;
+
+	//! \brief the exact number of pages, all the pages are computed.
+	int pageCount();
+	//! \brief if all the pages are known.
+	bool isComplete() const;
+	//! \brief the number of pages computed so far.
+	int knownPageCount() const;
+	//! \brief the number of pages, the pages not yet computed are estimated from the height hints of the layout index.
+	int estimatedPageCount();
+	//! \brief compute at most maxPages more pages, return true once all the pages are known.
+	bool computePages(int maxPages);
+	//! \brief the page the node is on, -1 if the node is not part of the document.
+	int pageOfNode(TextNode* node);
+	TextNode* firstNodeOfPage(int page);
+	QVector<TextNode*> nodesOfPage(int page);
+
+	//! \brief render a page, the painter coordinates are expected to start at the top left corner of the page area.
+	bool renderPage(int page, QPainter & painter);
+
+Q_SIGNALS:
+
+	//! \brief emitted when the pages from firstPage onward might have changed.
+	void pagesChanged(int firstPage);
+
+protected:
+
+	AbstractTextNodeStyle* nodeStyle(TextNode* node) const;
+
+	void onNodeRelaidOut(TextNode* node, int heightDelta);
+	void onLayoutInvalidated(int fromPosition);
+	void invalidateFromPage(int page);
+
+	//! \brief compute the start of the next page, return false if all the pages are known.
+	bool computeNextPage();
+	int nextPageStart(int start);
+	//! \brief find the forced breaks in the nodes which have not been scanned yet.
+	void updateForcedBreaks();
+	//! \brief forget the forced breaks from position onward.
+	void invalidateForcedBreaks(int position);
+
+	int pageOfPosition(int position) const;
+	int pageEndPosition(int page);
+
+	TextLayoutIndex* _index;
+
+	QPageLayout _pageLayout;
+	int _resolution;
+	QSet<int> _pageBreakStyles;
+
+	bool _complete;
+	int _forcedBreaksEnd; //the forced breaks are known for the positions before this one.
+
+	QVector<int> _pageStarts; //position in the index of the first node of each page computed so far.
+	QVector<int> _forcedBreaks; //sorted positions of the nodes with a page break style.
+};
+
+} // namespace Sabrina
+
+#endif // SABRINA_TEXTPAGINATOR_H
@@ -0,0 +1,381 @@
+/*
+This file is part of the project Sabrina
+Copyright (C) 2023  Paragon <french.paragon@gmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "textsearchengine.h"
+
+#include "textnode.h"
+
+#include <algorithm>
+
+namespace Sabrina {
+
+namespace {
+
+bool matchBefore(TextSearchEngine::Match const& match, QPair<int, int> const& position) {
+	return match.lineNumber < position.first or (match.lineNumber == position.first and match.pos < position.second);
+}
+
+QString expandReplacement(QString const& replacement, QRegularExpressionMatch const& match) {
+
+	QString out;
+	out.reserve(replacement.size());
+
+	for (int i = 0; i < replacement.size(); i++) {
+
+		if (replacement[i] == '\\' and i+1 < replacement.size()) {
+
+			QChar next = replacement[i+1];
+
+			if (next.isDigit()) {
+				out += match.captured(next.digitValue());
+				i++;
+				continue;
+			}
+
+			if (next == '\\') {
+				out += next;
+				i++;
+				continue;
+			}
+		}
+
+		out += replacement[i];
+	}
+
+	return out;
+}
+
+} // namespace
+
+TextSearchEngine::TextSearchEngine(QObject *parent) :
+	QObject(parent),
+	_root(nullptr),
+	_dirty(true)
+{
+
+}
+
+TextNode* TextSearchEngine::document() const {
+	return _root;
+}
+void TextSearchEngine::setDocument(TextNode* root) {
+
+	if (root == _root) {
+		return;
+	}
+
+	disconnectDocument();
+	_root = root;
+	connectDocument();
+
+	_lineMatches.clear();
+	_dirty = true;
+	Q_EMIT matchesChanged();
+}
+
+TextSearchEngine::Query TextSearchEngine::query() const {
+	return _query;
+}
+void TextSearchEngine::setQuery(Query const& query) {
+
+	_query = query;
+	compileQuery();
+
+	_lineMatches.clear(); //the cached matches are those of the previous query.
+	_dirty = true;
+	Q_EMIT matchesChanged();
+}
+bool TextSearchEngine::isQueryValid() const {
+
+	if (_query.pattern.isEmpty()) {
+		return false;
+	}
+
+	return _query.mode == Mode::Plain or _regex.isValid();
+}
+
+int TextSearchEngine::matchCount() {
+	ensureMatches();
+	return _matches.size();
+}
+QVector<TextSearchEngine::Match> const& TextSearchEngine::matches() {
+	ensureMatches();
+	return _matches;
+}
+
+int TextSearchEngine::matchIndexAfter(int lineNumber, int pos) {
+
+	ensureMatches();
+
+	auto it = std::lower_bound(_matches.constBegin(), _matches.constEnd(), qMakePair(lineNumber, pos), matchBefore);
+
+	if (it == _matches.constEnd()) {
+		return -1;
+	}
+
+	return it - _matches.constBegin();
+}
+int TextSearchEngine::matchIndexBefore(int lineNumber, int pos) {
+
+	ensureMatches();
+
+	auto it = std::lower_bound(_matches.constBegin(), _matches.constEnd(), qMakePair(lineNumber, pos), matchBefore);
+
+	return (it - _matches.constBegin()) - 1;
+}
+
+QVector<TextSearchEngine::LineReplacement> TextSearchEngine::replacements(QString const& replacement) {
+
+	ensureMatches();
+
+	QVector<LineReplacement> out;
+
+	int i = 0;
+
+	while (i < _matches.size()) {
+
+		TextLine* line = _matches[i].line;
+
+		int last = i;
+		while (last+1 < _matches.size() and _matches[last+1].line == line) {
+			last++;
+		}
+
+		QString const original = line->getText();
+		QString txt = original;
+
+		for (int m = last; m >= i; m--) { //from the end, so that the positions of the previous matches stay valid.
+
+			Match const& match = _matches[m];
+
+			if (_query.mode == Mode::RegularExpression) {
+				//the groups are captured in the original text, the end of txt has already been replaced.
+				QRegularExpressionMatch reMatch = _regex.match(original, match.pos, QRegularExpression::NormalMatch, QRegularExpression::AnchoredMatchOption);
+				txt.replace(match.pos, match.length, expandReplacement(replacement, reMatch));
+			} else {
+				txt.replace(match.pos, match.length, replacement);
+			}
+		}
+
+		out.push_back({line, txt});
+		i = last+1;
+	}
+
+	return out;
+}
+
+void TextSearchEngine::compileQuery() {
+
+	QRegularExpression::PatternOptions options = QRegularExpression::UseUnicodePropertiesOption; //words can contain accented letters.
+
+	if (_query.caseSensitivity == Qt::CaseInsensitive) {
+		options |= QRegularExpression::CaseInsensitiveOption;
+	}
+
+	switch (_query.mode) {
+	case Mode::Plain:
+		_regex = QRegularExpression();
+		return;
+	case Mode::WholeWord:
+		_regex = QRegularExpression("\\b" + QRegularExpression::escape(_query.pattern) + "\\b", options);
+		break;
+	case Mode::RegularExpression:
+		_regex = QRegularExpression(_query.pattern, options);
+		break;
+	}
+
+	_regex.optimize();
+}
+TextSearchEngine::Spans TextSearchEngine::matchLine(QString const& text) const {
+
+	Spans spans;
+
+	if (!isQueryValid()) {
+		return spans;
+	}
+
+	if (_query.mode == Mode::Plain) {
+
+		int pos = text.indexOf(_query.pattern, 0, _query.caseSensitivity);
+
+		while (pos >= 0) {
+			spans.push_back(qMakePair(pos, _query.pattern.length()));
+			pos = text.indexOf(_query.pattern, pos + _query.pattern.length(), _query.caseSensitivity);
+		}
+
+		return spans;
+	}
+
+	QRegularExpressionMatchIterator it = _regex.globalMatch(text);
+
+	while (it.hasNext()) {
+		QRegularExpressionMatch match = it.next();
+
+		if (match.capturedLength() > 0) { //empty matches cannot be selected nor replaced in a meaningful way.
+			spans.push_back(qMakePair(match.capturedStart(), match.capturedLength()));
+		}
+	}
+
+	return spans;
+}
+bool TextSearchEngine::acceptNode(TextNode* node) const {
+	return _query.styles.isEmpty() or _query.styles.contains(node->styleId());
+}
+
+void TextSearchEngine::ensureMatches() {
+
+	if (!_dirty) {
+		return;
+	}
+
+	_matches.clear();
+
+	QHash<TextLine*, LineMatches> cache;
+
+	if (_root != nullptr and isQueryValid()) {
+		cache.reserve(_lineMatches.size());
+
+		int lineNumber = 0;
+		collectMatches(_root, lineNumber, cache);
+	}
+
+	_lineMatches.swap(cache); //the lines which are not in the document anymore are dropped.
+	_dirty = false;
+}
+void TextSearchEngine::collectMatches(TextNode* node, int & lineNumber, QHash<TextLine*, LineMatches> & cache) {
+
+	bool accepted = acceptNode(node);
+
+	for (TextLine* line : node->lines()) {
+
+		if (accepted) {
+
+			LineMatches lineMatches;
+			auto previous = _lineMatches.constFind(line);
+
+			if (previous != _lineMatches.constEnd() and previous->revision == line->revision()) {
+				lineMatches.spans = previous->spans;
+			} else {
+				lineMatches.spans = matchLine(line->getText());
+			}
+
+			lineMatches.revision = line->revision();
+			lineMatches.lineNumber = lineNumber;
+
+			for (QPair<int, int> const& span : qAsConst(lineMatches.spans)) {
+				_matches.push_back({line, lineNumber, span.first, span.second});
+			}
+
+			cache.insert(line, lineMatches);
+		}
+
+		lineNumber++;
+	}
+
+	for (TextNode* child : node->childNodes()) {
+		collectMatches(child, lineNumber, cache);
+	}
+}
+
+void TextSearchEngine::onNodeEdited(TextNode* node, TextLine* line) {
+
+	if (_dirty) {
+		return;
+	}
+
+	if (line == nullptr) {
+		onStructureChanged();
+		return;
+	}
+
+	auto it = _lineMatches.find(line);
+
+	if (it == _lineMatches.end()) {
+
+		if (acceptNode(node) and isQueryValid()) { //should not happen, but the list is rebuilt to be safe.
+			onStructureChanged();
+		}
+
+		return;
+	}
+
+	Spans spans = matchLine(line->getText());
+	it->revision = line->revision();
+
+	if (spans == it->spans) {
+		return;
+	}
+
+	//replace the matches of the line in place, the other lines did not move.
+	int first = std::lower_bound(_matches.begin(), _matches.end(), qMakePair(it->lineNumber, 0), matchBefore) - _matches.begin();
+
+	_matches.remove(first, it->spans.size());
+
+	QVector<Match> inserted;
+	inserted.reserve(spans.size());
+
+	for (QPair<int, int> const& span : qAsConst(spans)) {
+		inserted.push_back({line, it->lineNumber, span.first, span.second});
+	}
+
+	_matches.insert(first, inserted.size(), Match());
+	std::copy(inserted.constBegin(), inserted.constEnd(), _matches.begin() + first);
+
+	it->spans = spans;
+
+	Q_EMIT matchesChanged();
+}
+void TextSearchEngine::onStructureChanged() {
+
+	if (_dirty) { //the list is rebuilt at the next query anyway.
+		return;
+	}
+
+	_dirty = true;
+	Q_EMIT matchesChanged();
+}
+
+void TextSearchEngine::connectDocument() {
+
+	if (_root == nullptr) {
+		return;
+	}
+
+	connect(_root, &TextNode::nodeEdited, this, &TextSearchEngine::onNodeEdited);
+	connect(_root, &TextNode::nodeLineLayoutChanged, this, &TextSearchEngine::onStructureChanged); //lines count or style changed.
+	connect(_root, &TextNode::nodeAdded, this, &TextSearchEngine::onStructureChanged);
+	connect(_root, &TextNode::nodesAdded, this, &TextSearchEngine::onStructureChanged);
+	connect(_root, &TextNode::nodeRemoved, this, &TextSearchEngine::onStructureChanged);
+	connect(_root, &TextNode::nodeMoved, this, &TextSearchEngine::onStructureChanged);
+	connect(_root, &QObject::destroyed, this, [this] () {
+		_root = nullptr;
+		_lineMatches.clear();
+		_dirty = true;
+		Q_EMIT matchesChanged();
+	});
+}
+void TextSearchEngine::disconnectDocument() {
+
+	if (_root == nullptr) {
+		return;
+	}
+
+	disconnect(_root, nullptr, this, nullptr);
+}
+
+} // namespace Sabrina
@@ -0,0 +1,138 @@
+#ifndef SABRINA_TEXTSEARCHENGINE_H
+#define SABRINA_TEXTSEARCHENGINE_H
+
+/*
+This file is part of the project Sabrina
+Copyright (C) 2023  Paragon <french.paragon@gmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include <QObject>
+#include <QVector>
+#include <QHash>
+#include <QRegularExpression>
+
+#include "./text_global.h"
+
+namespace Sabrina {
+
+class TextNode;
+class TextLine;
+
+/*!
+ * \brief The TextSearchEngine class find the occurences of a query in a document.
+ *
+ * The matches of each line are cached with the revision of the line, so that only the lines whose text changed are searched again.
+ * When a line is edited its matches are replaced in place in the list of matches, structural changes (nodes added, removed or moved,
+ * lines added or removed, styles changed) rebuild the list at the next query, reusing the cached matches of the lines which did not change.
+ */
+class SABRINA_TEXT_EXPORT TextSearchEngine : public QObject
+{
+	Q_OBJECT
+public:
+
+	enum class Mode {
+		Plain,
+		WholeWord,
+		RegularExpression
+	};
+
+	struct Query {
+		Query() : mode(Mode::Plain), caseSensitivity(Qt::CaseInsensitive) {}
+		QString pattern;
+		Mode mode;
+		Qt::CaseSensitivity caseSensitivity;
+		//! \brief the styles of the nodes to search in, all nodes are searched if empty.
+		QVector<int> styles;
+	};
+
+	struct Match {
+		TextLine* line;
+		int lineNumber;
+		int pos;
+		int length;
+	};
+
+	struct LineReplacement {
+		TextLine* line;
+		QString text;
+	};
+
+	explicit TextSearchEngine(QObject *parent = nullptr);
+
+	TextNode* document() const;
+	void setDocument(TextNode* root);
+
+	Query query() const;
+	void setQuery(Query const& query);
+	//! \brief false if the query cannot match anything, for example with an invalid regular expression.
+	bool isQueryValid() const;
+
+	int matchCount();
+	//! \brief all the matches, in document order.
+	QVector<Match> const& matches();
+
+	//! \brief the index of the first match starting at or after the position, -1 if there is none.
+	int matchIndexAfter(int lineNumber, int pos);
+	//! \brief the index of the last match starting before the position, -1 if there is none.
+	int matchIndexBefore(int lineNumber, int pos);
+
+	/*!
+	 * \brief replacements compute the new text of each line containing a match.
+	 * \param replacement the replacement text, for regular expressions it can refer to the captured groups (\1, \2, ...).
+	 *
+	 * The lines are not changed, so that the caller can apply all the changes as a single edit.
+	 */
+	QVector<LineReplacement> replacements(QString const& replacement);
+
+Q_SIGNALS:
+
+	void matchesChanged();
+
+protected:
+
+	typedef QVector<QPair<int, int>> Spans; //pos and length of the matches in a line.
+
+	struct LineMatches {
+		quint64 revision;
+		int lineNumber;
+		Spans spans;
+	};
+
+	void compileQuery();
+	Spans matchLine(QString const& text) const;
+	bool acceptNode(TextNode* node) const;
+
+	void ensureMatches();
+	void collectMatches(TextNode* node, int & lineNumber, QHash<TextLine*, LineMatches> & cache);
+
+	void onNodeEdited(TextNode* node, TextLine* line);
+	void onStructureChanged();
+
+	void connectDocument();
+	void disconnectDocument();
+
+	TextNode* _root;
+	Query _query;
+	QRegularExpression _regex;
+
+	bool _dirty;
+	QHash<TextLine*, LineMatches> _lineMatches;
+	QVector<Match> _matches;
+};
+
+} // namespace Sabrina
+
+#endif // SABRINA_TEXTSEARCHENGINE_H
@@ -25,13 +25,23 @@ namespace Sabrina {
 TextStyleManager::TextStyleManager(QObject *parent) :
 	QObject(parent)
 {
-
+	connect(this, &TextStyleManager::styleUpdated, this, [this] () {
+		_metricsCache.clear();
+	});
+	connect(this, &TextStyleManager::styleRemoved, this, [this] () {
+		_metricsCache.clear();
+	});
 }
 
 bool TextStyleManager::registerStyle(AbstractTextNodeStyle* style) {
 	if (!_styles.contains(style->typeId())) {
-		_styles.insert(style->typeId(), style);
-		Q_EMIT styleInserted(style->typeId());
+		int code = style->typeId();
+		_styles.insert(code, style);
+		style->setStyleManager(this);
+		connect(style, &AbstractTextNodeStyle::updated, this, [this, code] () {
+			Q_EMIT styleUpdated(code);
+		});
+		Q_EMIT styleInserted(code);
 		return true;
 	}
 	return false;
@@ -42,11 +52,18 @@ AbstractTextNodeStyle* TextStyleManager::getStyleByCode(int code) {
 
 void TextStyleManager::removeStyle(int code) {
 	if (_styles.contains(code)) {
-		_styles.remove(code);
+		AbstractTextNodeStyle* style = _styles.take(code);
+		style->disconnect(this);
+		style->setStyleManager(nullptr);
 		Q_EMIT styleRemoved(code);
 	}
 }
 
+TextStyleManager* TextStyleManager::clone(QObject* parent) const {
+	Q_UNUSED(parent);
+	return nullptr;
+}
+
 int TextStyleManager::getDefaultStyleCode() const {
 	return 0;
 }
@@ -79,4 +96,8 @@ bool TextStyleManager::acceptableStyleAsChild(int parent, int child) const {
 	return false;
 }
 
+FontMetricsCache* TextStyleManager::metricsCache() const {
+	return &_metricsCache;
+}
+
 } // namespace Sabrina
@@ -23,6 +23,7 @@ along with this program.  If not, see <https://www.gnu.org/licenses/>.
 #include <QMap>
 
 #include "./text_global.h"
+#include "./fontmetricscache.h"
 
 namespace Sabrina {
 
@@ -73,6 +74,19 @@ public:
 	QMap<int, QString> getStyleMapNames() const;
 	bool acceptableStyleAsChild(int parent, int child) const;
 
+	//! \brief the font metrics shared by all the registered styles, cleared each time a style is updated.
+	FontMetricsCache* metricsCache() const;
+
+	/*!
+	 * \brief clone create a new manager with its own instances of the styles.
+	 *
+	 * The copy can be used on another thread, as long as the original manager is not modified while clone is called.
+	 *
+	 * \param parent the parent of the copy.
+	 * \return the copy, or nullptr if the manager cannot be copied (the default).
+	 */
+	virtual TextStyleManager* clone(QObject* parent = nullptr) const;
+
 Q_SIGNALS:
 
 	void styleUpdated(int code);
@@ -82,6 +96,8 @@ Q_SIGNALS:
 protected:
 
 	QMap<int, AbstractTextNodeStyle*> _styles;
+
+	mutable FontMetricsCache _metricsCache;
 };
 
 } // namespace Sabrina
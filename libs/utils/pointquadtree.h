@@ -0,0 +1,341 @@
+#ifndef SABRINA_POINTQUADTREE_H
+#define SABRINA_POINTQUADTREE_H
+
+/*
+This file is part of the project Sabrina
+Copyright (C) 2023  Paragon <french.paragon@gmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include <QHash>
+#include <QPair>
+#include <QPointF>
+#include <QRectF>
+#include <QVector>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <memory>
+
+namespace Sabrina {
+
+/*!
+ * \brief The PointQuadTree class is a spatial index of values placed at a point, answering rectangle and nearest point queries in O(log n).
+ *
+ * Each leaf stores up to bucketSize points and is split in four when it gets more, the leaves are merged back when points are removed.
+ * The position of each value is kept by the tree, so a value can be moved or removed knowing only the value.
+ * The bounds of the tree grow when a point is inserted outside of them.
+ */
+template<typename T>
+class PointQuadTree
+{
+public:
+
+	static const int MaxDepth = 16; //points closer than the size of the deepest cells stay in the same leaf.
+
+	explicit PointQuadTree(QRectF const& bounds = QRectF(0, 0, 1024, 1024), int bucketSize = 8) :
+		_root(new Node(bounds.isValid() ? bounds : QRectF(0, 0, 1024, 1024))),
+		_bucketSize(std::max(bucketSize, 1))
+	{
+
+	}
+
+	int size() const {
+		return _positions.size();
+	}
+	bool isEmpty() const {
+		return _positions.isEmpty();
+	}
+	QRectF bounds() const {
+		return _root->bounds;
+	}
+
+	bool contains(T const& value) const {
+		return _positions.contains(value);
+	}
+	QPointF position(T const& value) const {
+		return _positions.value(value);
+	}
+
+	void clear() {
+		_root.reset(new Node(_root->bounds));
+		_positions.clear();
+	}
+
+	//! \brief insert a value, or move it if it is already in the tree.
+	void insert(T const& value, QPointF const& pos) {
+
+		if (!std::isfinite(pos.x()) or !std::isfinite(pos.y())) {
+			return;
+		}
+
+		if (_positions.contains(value)) {
+			remove(value);
+		}
+
+		while (!_root->bounds.contains(pos)) {
+			grow(pos);
+		}
+
+		insertIn(_root.get(), value, pos, 0);
+		_positions.insert(value, pos);
+	}
+	bool remove(T const& value) {
+
+		auto it = _positions.find(value);
+
+		if (it == _positions.end()) {
+			return false;
+		}
+
+		QPointF pos = *it;
+		_positions.erase(it);
+
+		return removeFrom(_root.get(), value, pos);
+	}
+	void move(T const& value, QPointF const& pos) {
+		insert(value, pos);
+	}
+
+	//! \brief the values placed in the rectangle.
+	QVector<T> query(QRectF const& rect) const {
+
+		QVector<T> out;
+		queryIn(_root.get(), rect.normalized(), out);
+		return out;
+	}
+
+	/*!
+	 * \brief nearest find the value closest to a point.
+	 * \param maxDistance only values closer than this distance are considered, any distance if negative.
+	 * \return false if there is no value in range.
+	 */
+	bool nearest(QPointF const& pos, qreal maxDistance, T* value = nullptr, QPointF* valuePos = nullptr) const {
+
+		qreal bestDist2 = (maxDistance < 0) ? std::numeric_limits<qreal>::infinity() : maxDistance*maxDistance;
+		Entry const* best = nullptr;
+
+		nearestIn(_root.get(), pos, bestDist2, best);
+
+		if (best == nullptr) {
+			return false;
+		}
+
+		if (value != nullptr) {
+			*value = best->second;
+		}
+		if (valuePos != nullptr) {
+			*valuePos = best->first;
+		}
+
+		return true;
+	}
+
+protected:
+
+	typedef QPair<QPointF, T> Entry;
+
+	struct Node {
+		explicit Node(QRectF const& b) : bounds(b) {}
+		inline bool isLeaf() const { return children[0] == nullptr; }
+		QRectF bounds;
+		QVector<Entry> points;
+		std::unique_ptr<Node> children[4];
+		int count = 0; //number of points below the node, leaves included.
+	};
+
+	static int quadrant(Node const* node, QPointF const& pos) {
+		QPointF c = node->bounds.center();
+		return ((pos.x() >= c.x()) ? 1 : 0) + ((pos.y() >= c.y()) ? 2 : 0);
+	}
+	static qreal distance2(QRectF const& rect, QPointF const& pos) {
+		qreal dx = std::max({rect.left() - pos.x(), 0.0, pos.x() - rect.right()});
+		qreal dy = std::max({rect.top() - pos.y(), 0.0, pos.y() - rect.bottom()});
+		return dx*dx + dy*dy;
+	}
+
+	void split(Node* node) {
+
+		QRectF const& b = node->bounds;
+		qreal w = b.width()/2;
+		qreal h = b.height()/2;
+
+		for (int i = 0; i < 4; i++) {
+			node->children[i].reset(new Node(QRectF(b.left() + ((i & 1) ? w : 0), b.top() + ((i & 2) ? h : 0), w, h)));
+		}
+
+		QVector<Entry> points;
+		points.swap(node->points);
+
+		for (Entry const& e : points) {
+			Node* child = node->children[quadrant(node, e.first)].get();
+			child->points.push_back(e);
+			child->count++;
+		}
+	}
+
+	//! \brief double the size of the tree towards a point outside of it, the current root becomes a quadrant of the new one.
+	void grow(QPointF const& pos) {
+
+		QRectF b = _root->bounds;
+		bool left = pos.x() < b.left();
+		bool up = pos.y() < b.top();
+
+		QRectF nb(left ? b.left() - b.width() : b.left(), up ? b.top() - b.height() : b.top(), b.width()*2, b.height()*2);
+
+		std::unique_ptr<Node> root(new Node(nb));
+		root->count = _root->count;
+
+		if (_root->count == 0) {
+			_root = std::move(root);
+			return;
+		}
+
+		split(root.get());
+		int q = (left ? 1 : 0) + (up ? 2 : 0); //the old root is on the opposite side of the point.
+		root->children[q] = std::move(_root);
+		_root = std::move(root);
+	}
+
+	void insertIn(Node* node, T const& value, QPointF const& pos, int depth) {
+
+		node->count++;
+
+		if (node->isLeaf()) {
+
+			if (node->points.size() < _bucketSize or depth >= MaxDepth) {
+				node->points.push_back(Entry(pos, value));
+				return;
+			}
+
+			split(node);
+		}
+
+		insertIn(node->children[quadrant(node, pos)].get(), value, pos, depth+1);
+	}
+	bool removeFrom(Node* node, T const& value, QPointF const& pos) {
+
+		if (node->isLeaf()) {
+
+			for (int i = 0; i < node->points.size(); i++) {
+				if (node->points[i].second == value) {
+					node->points.remove(i);
+					node->count--;
+					return true;
+				}
+			}
+
+			return false;
+		}
+
+		bool removed = false;
+
+		//a point on the right or bottom edge of a root which became a quadrant when the tree grew is not in the quadrant given by quadrant(),
+		//so all the children containing the point are searched, as their bounds are closed.
+		for (int i = 0; i < 4 and !removed; i++) {
+			if (node->children[i]->bounds.contains(pos)) {
+				removed = removeFrom(node->children[i].get(), value, pos);
+			}
+		}
+
+		if (!removed) {
+			return false;
+		}
+
+		node->count--;
+
+		if (node->count <= _bucketSize) { //merge the children back.
+			QVector<Entry> points;
+			points.reserve(node->count);
+			collect(node, points);
+
+			for (int i = 0; i < 4; i++) {
+				node->children[i].reset();
+			}
+			node->points = points;
+		}
+
+		return true;
+	}
+	static void collect(Node const* node, QVector<Entry> & out) {
+
+		if (node->isLeaf()) {
+			out += node->points;
+			return;
+		}
+
+		for (int i = 0; i < 4; i++) {
+			collect(node->children[i].get(), out);
+		}
+	}
+
+	static void queryIn(Node const* node, QRectF const& rect, QVector<T> & out) {
+
+		if (node->count == 0 or !node->bounds.intersects(rect)) {
+			return;
+		}
+
+		if (node->isLeaf()) {
+			for (Entry const& e : node->points) {
+				if (rect.contains(e.first)) {
+					out.push_back(e.second);
+				}
+			}
+			return;
+		}
+
+		for (int i = 0; i < 4; i++) {
+			queryIn(node->children[i].get(), rect, out);
+		}
+	}
+	static void nearestIn(Node const* node, QPointF const& pos, qreal & bestDist2, Entry const* & best) {
+
+		if (node->count == 0 or distance2(node->bounds, pos) > bestDist2) {
+			return;
+		}
+
+		if (node->isLeaf()) {
+			for (Entry const& e : node->points) {
+				QPointF d = e.first - pos;
+				qreal dist2 = QPointF::dotProduct(d, d);
+				if (dist2 <= bestDist2) {
+					bestDist2 = dist2;
+					best = &e;
+				}
+			}
+			return;
+		}
+
+		//the quadrant of the point first, it is the most likely to contain the nearest value and prune the others.
+		int first = quadrant(node, pos);
+		nearestIn(node->children[first].get(), pos, bestDist2, best);
+
+		for (int i = 0; i < 4; i++) {
+			if (i != first) {
+				nearestIn(node->children[i].get(), pos, bestDist2, best);
+			}
+		}
+	}
+
+	std::unique_ptr<Node> _root;
+	int _bucketSize;
+
+	QHash<T, QPointF> _positions;
+};
+
+} // namespace Sabrina
+
+#endif // SABRINA_POINTQUADTREE_H
@@ -0,0 +1,321 @@
+#ifndef SABRINA_RECTQUADTREE_H
+#define SABRINA_RECTQUADTREE_H
+
+/*
+This file is part of the project Sabrina
+Copyright (C) 2023  Paragon <french.paragon@gmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include <QHash>
+#include <QPair>
+#include <QPointF>
+#include <QRectF>
+#include <QVector>
+
+#include <algorithm>
+#include <cmath>
+#include <memory>
+
+namespace Sabrina {
+
+/*!
+ * \brief The RectQuadTree class is a spatial index of values covering a rectangle, answering rectangle and point queries.
+ *
+ * Each value is stored in the smallest node whose bounds contain its whole rectangle, a node is split in four when it holds more than bucketSize values,
+ * the values straddling the center of a node stay in the node. The leaves are merged back when values are removed.
+ * As for PointQuadTree, the rectangle of each value is kept by the tree and the bounds of the tree grow when a value is inserted outside of them.
+ *
+ * The rectangles are closed: a rectangle of null width or height, as the bounds of a vertical or horizontal line, is still found by the queries.
+ */
+template<typename T>
+class RectQuadTree
+{
+public:
+
+	static const int MaxDepth = 16;
+
+	explicit RectQuadTree(QRectF const& bounds = QRectF(0, 0, 1024, 1024), int bucketSize = 8) :
+		_root(new Node(bounds.isValid() ? bounds : QRectF(0, 0, 1024, 1024))),
+		_bucketSize(std::max(bucketSize, 1))
+	{
+
+	}
+
+	int size() const {
+		return _rects.size();
+	}
+	bool isEmpty() const {
+		return _rects.isEmpty();
+	}
+	QRectF bounds() const {
+		return _root->bounds;
+	}
+
+	bool contains(T const& value) const {
+		return _rects.contains(value);
+	}
+	QRectF rect(T const& value) const {
+		return _rects.value(value);
+	}
+
+	void clear() {
+		_root.reset(new Node(_root->bounds));
+		_rects.clear();
+	}
+
+	//! \brief insert a value, or move it if it is already in the tree.
+	void insert(T const& value, QRectF const& rect) {
+
+		QRectF r = rect.normalized();
+
+		if (!std::isfinite(r.left()) or !std::isfinite(r.top()) or !std::isfinite(r.right()) or !std::isfinite(r.bottom())) {
+			return;
+		}
+
+		if (_rects.contains(value)) {
+			remove(value);
+		}
+
+		while (!encloses(_root->bounds, r)) {
+			grow(r);
+		}
+
+		insertIn(_root.get(), value, r, 0);
+		_rects.insert(value, r);
+	}
+	bool remove(T const& value) {
+
+		auto it = _rects.find(value);
+
+		if (it == _rects.end()) {
+			return false;
+		}
+
+		QRectF r = *it;
+		_rects.erase(it);
+
+		return removeFrom(_root.get(), value, r);
+	}
+	void move(T const& value, QRectF const& rect) {
+		insert(value, rect);
+	}
+
+	//! \brief the values whose rectangle intersects rect.
+	QVector<T> query(QRectF const& rect) const {
+
+		QVector<T> out;
+		queryIn(_root.get(), rect.normalized(), out);
+		return out;
+	}
+	//! \brief the values whose rectangle contains pos.
+	QVector<T> query(QPointF const& pos) const {
+		return query(QRectF(pos, pos));
+	}
+
+protected:
+
+	typedef QPair<QRectF, T> Entry;
+
+	struct Node {
+		explicit Node(QRectF const& b) : bounds(b) {}
+		inline bool isLeaf() const { return children[0] == nullptr; }
+		QRectF bounds;
+		QVector<Entry> values; //the values which do not fit in a child.
+		std::unique_ptr<Node> children[4];
+		int count = 0; //number of values in the node and below.
+	};
+
+	//QRectF::contains and QRectF::intersects ignore the empty rectangles.
+	static bool encloses(QRectF const& outer, QRectF const& inner) {
+		return inner.left() >= outer.left() and inner.right() <= outer.right() and
+				inner.top() >= outer.top() and inner.bottom() <= outer.bottom();
+	}
+	static bool overlaps(QRectF const& a, QRectF const& b) {
+		return a.left() <= b.right() and b.left() <= a.right() and
+				a.top() <= b.bottom() and b.top() <= a.bottom();
+	}
+
+	//! \brief the first child of the node containing the whole rectangle, -1 if the rectangle straddles the center of the node.
+	static int quadrant(Node const* node, QRectF const& rect) {
+
+		for (int i = 0; i < 4; i++) {
+			if (encloses(node->children[i]->bounds, rect)) {
+				return i;
+			}
+		}
+
+		return -1;
+	}
+
+	void split(Node* node) {
+
+		QRectF const& b = node->bounds;
+		qreal w = b.width()/2;
+		qreal h = b.height()/2;
+
+		for (int i = 0; i < 4; i++) {
+			node->children[i].reset(new Node(QRectF(b.left() + ((i & 1) ? w : 0), b.top() + ((i & 2) ? h : 0), w, h)));
+		}
+
+		QVector<Entry> values;
+		values.swap(node->values);
+
+		for (Entry const& e : values) {
+
+			int q = quadrant(node, e.first);
+
+			if (q < 0) {
+				node->values.push_back(e);
+				continue;
+			}
+
+			Node* child = node->children[q].get();
+			child->values.push_back(e);
+			child->count++;
+		}
+	}
+
+	//! \brief double the size of the tree towards a rectangle outside of it, the current root becomes a quadrant of the new one.
+	void grow(QRectF const& rect) {
+
+		QRectF b = _root->bounds;
+		bool left = rect.left() < b.left();
+		bool up = rect.top() < b.top();
+
+		QRectF nb(left ? b.left() - b.width() : b.left(), up ? b.top() - b.height() : b.top(), b.width()*2, b.height()*2);
+
+		std::unique_ptr<Node> root(new Node(nb));
+		root->count = _root->count;
+
+		if (_root->count == 0) {
+			_root = std::move(root);
+			return;
+		}
+
+		split(root.get());
+		int q = (left ? 1 : 0) + (up ? 2 : 0); //the old root is on the opposite side of the rectangle.
+		root->children[q] = std::move(_root);
+		_root = std::move(root);
+	}
+
+	void insertIn(Node* node, T const& value, QRectF const& rect, int depth) {
+
+		node->count++;
+
+		if (node->isLeaf()) {
+
+			if (node->values.size() < _bucketSize or depth >= MaxDepth) {
+				node->values.push_back(Entry(rect, value));
+				return;
+			}
+
+			split(node);
+		}
+
+		int q = quadrant(node, rect);
+
+		if (q < 0) {
+			node->values.push_back(Entry(rect, value));
+			return;
+		}
+
+		insertIn(node->children[q].get(), value, rect, depth+1);
+	}
+	bool removeFrom(Node* node, T const& value, QRectF const& rect) {
+
+		for (int i = 0; i < node->values.size(); i++) {
+			if (node->values[i].second == value) {
+				node->values.remove(i);
+				node->count--;
+				return true;
+			}
+		}
+
+		if (node->isLeaf()) {
+			return false;
+		}
+
+		bool removed = false;
+
+		//a rectangle on the edge between two children is enclosed by both, it may have been stored in either of them.
+		for (int i = 0; i < 4 and !removed; i++) {
+			if (encloses(node->children[i]->bounds, rect)) {
+				removed = removeFrom(node->children[i].get(), value, rect);
+			}
+		}
+
+		if (!removed) {
+			return false;
+		}
+
+		node->count--;
+
+		if (node->count <= _bucketSize) { //merge the children back.
+			QVector<Entry> values;
+			values.reserve(node->count);
+			collect(node, values);
+
+			for (int i = 0; i < 4; i++) {
+				node->children[i].reset();
+			}
+			node->values = values;
+		}
+
+		return true;
+	}
+	static void collect(Node const* node, QVector<Entry> & out) {
+
+		out += node->values;
+
+		if (node->isLeaf()) {
+			return;
+		}
+
+		for (int i = 0; i < 4; i++) {
+			collect(node->children[i].get(), out);
+		}
+	}
+
+	static void queryIn(Node const* node, QRectF const& rect, QVector<T> & out) {
+
+		if (node->count == 0 or !overlaps(node->bounds, rect)) {
+			return;
+		}
+
+		for (Entry const& e : node->values) {
+			if (overlaps(e.first, rect)) {
+				out.push_back(e.second);
+			}
+		}
+
+		if (node->isLeaf()) {
+			return;
+		}
+
+		for (int i = 0; i < 4; i++) {
+			queryIn(node->children[i].get(), rect, out);
+		}
+	}
+
+	std::unique_ptr<Node> _root;
+	int _bucketSize;
+
+	QHash<T, QRectF> _rects;
+};
+
+} // namespace Sabrina
+
+#endif // SABRINA_RECTQUADTREE_H
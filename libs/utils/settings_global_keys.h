@@ -20,5 +20,6 @@ along with this program.  If not, see <https://www.gnu.org/licenses/>.
 */
 
 #define IMAGE_OPEN_DIR_KEY "image_open_dir"
+#define GEOJSON_DIR_KEY "geojson_dir"
 
 #endif // SETTINGS_GLOBAL_KEYS_H
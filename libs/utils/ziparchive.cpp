@@ -0,0 +1,308 @@
+/*
+This file is part of the project Sabrina
+Copyright (C) 2023  Paragon <french.paragon@gmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "ziparchive.h"
+
+#include <QCoreApplication>
+#include <QFile>
+#include <QtEndian>
+
+#include <zlib.h>
+
+#include <algorithm>
+#include <climits>
+
+namespace Sabrina {
+
+namespace {
+
+const quint32 LocalHeaderSignature = 0x04034b50;
+const quint32 CentralHeaderSignature = 0x02014b50;
+const quint32 EndOfCentralDirectorySignature = 0x06054b50;
+
+const int LocalHeaderSize = 30;
+const int CentralHeaderSize = 46;
+const int EndOfCentralDirectorySize = 22;
+
+const quint16 StoredMethod = 0;
+const quint16 DeflatedMethod = 8;
+
+const quint32 Zip64Marker = 0xFFFFFFFF; //the real value is stored in the zip64 extra field.
+
+inline quint16 read16(char const* data) {
+	return qFromLittleEndian<quint16>(reinterpret_cast<uchar const*>(data));
+}
+inline quint32 read32(char const* data) {
+	return qFromLittleEndian<quint32>(reinterpret_cast<uchar const*>(data));
+}
+
+QByteArray inflateRaw(QByteArray const& compressed, qint64 size) {
+
+	if (size < 0 or size > INT_MAX) {
+		return QByteArray();
+	}
+
+	QByteArray out(static_cast<int>(size), Qt::Uninitialized);
+
+	z_stream stream;
+	stream.zalloc = Z_NULL;
+	stream.zfree = Z_NULL;
+	stream.opaque = Z_NULL;
+	stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(compressed.constData()));
+	stream.avail_in = static_cast<uInt>(compressed.size());
+	stream.next_out = reinterpret_cast<Bytef*>(out.data());
+	stream.avail_out = static_cast<uInt>(out.size());
+
+	if (inflateInit2(&stream, -MAX_WBITS) != Z_OK) { //negative window bits: raw deflate data, without the zlib header.
+		return QByteArray();
+	}
+
+	int status = inflate(&stream, Z_FINISH);
+	qint64 produced = static_cast<qint64>(stream.total_out);
+
+	inflateEnd(&stream);
+
+	if (status != Z_STREAM_END or produced != size) {
+		return QByteArray();
+	}
+
+	return out;
+}
+
+} // namespace
+
+ZipArchive::ZipArchive(QString const& file)
+{
+	if (!file.isEmpty()) {
+		open(file);
+	}
+}
+
+bool ZipArchive::open(QString const& file) {
+
+	close();
+
+	QFile zip(file);
+
+	if (!zip.open(QIODevice::ReadOnly)) {
+		return false;
+	}
+
+	qint64 fileSize = zip.size();
+
+	if (fileSize < EndOfCentralDirectorySize) {
+		return false;
+	}
+
+	//the end of central directory record is followed by a comment of at most 65535 bytes.
+	qint64 tailSize = std::min<qint64>(fileSize, EndOfCentralDirectorySize + 0xFFFF);
+
+	if (!zip.seek(fileSize - tailSize)) {
+		return false;
+	}
+
+	QByteArray tail = zip.read(tailSize);
+	int eocd = -1;
+
+	for (int i = tail.size() - EndOfCentralDirectorySize; i >= 0; i--) {
+		if (read32(tail.constData() + i) == EndOfCentralDirectorySignature) {
+			eocd = i;
+			break;
+		}
+	}
+
+	if (eocd < 0) {
+		return false;
+	}
+
+	char const* record = tail.constData() + eocd;
+
+	int entriesCount = read16(record + 10);
+	qint64 directorySize = read32(record + 12);
+	qint64 directoryOffset = read32(record + 16);
+
+	if (directoryOffset + directorySize > fileSize or !zip.seek(directoryOffset)) {
+		return false;
+	}
+
+	QByteArray directory = zip.read(directorySize);
+
+	if (directory.size() != directorySize) {
+		return false;
+	}
+
+	int pos = 0;
+
+	for (int i = 0; i < entriesCount; i++) {
+
+		if (pos + CentralHeaderSize > directory.size()) {
+			break;
+		}
+
+		char const* header = directory.constData() + pos;
+
+		if (read32(header) != CentralHeaderSignature) {
+			break;
+		}
+
+		int nameLength = read16(header + 28);
+		int extraLength = read16(header + 30);
+		int commentLength = read16(header + 32);
+
+		if (pos + CentralHeaderSize + nameLength > directory.size()) {
+			break;
+		}
+
+		Entry entry;
+		entry.method = read16(header + 10);
+		entry.crc = read32(header + 16);
+		entry.compressedSize = read32(header + 20);
+		entry.size = read32(header + 24);
+		entry.localHeaderOffset = read32(header + 42);
+
+		QString name = QString::fromUtf8(header + CentralHeaderSize, nameLength);
+
+		if (!_entries.contains(name)) {
+			_names.push_back(name);
+		}
+
+		_entries.insert(name, entry);
+
+		pos += CentralHeaderSize + nameLength + extraLength + commentLength;
+	}
+
+	if (_entries.isEmpty() and entriesCount > 0) {
+		return false;
+	}
+
+	_file = file;
+
+	return true;
+}
+
+void ZipArchive::close() {
+	_file.clear();
+	_names.clear();
+	_entries.clear();
+}
+
+bool ZipArchive::isValid() const {
+	return !_file.isEmpty();
+}
+
+QString ZipArchive::fileName() const {
+	return _file;
+}
+
+QStringList ZipArchive::entries() const {
+	return _names;
+}
+
+bool ZipArchive::contains(QString const& name) const {
+	return _entries.contains(name);
+}
+
+qint64 ZipArchive::entrySize(QString const& name) const {
+
+	auto it = _entries.constFind(name);
+
+	if (it == _entries.constEnd()) {
+		return -1;
+	}
+
+	return it->size;
+}
+
+QByteArray ZipArchive::read(QString const& name, QString* error) const {
+
+	auto fail = [error] (char const* message) -> QByteArray {
+		if (error != nullptr) {
+			*error = QCoreApplication::translate("ZipArchive", message);
+		}
+		return QByteArray();
+	};
+
+	if (error != nullptr) {
+		error->clear();
+	}
+
+	auto it = _entries.constFind(name);
+
+	if (it == _entries.constEnd()) {
+		return fail("Entry not found");
+	}
+
+	Entry const& entry = it.value();
+
+	if (entry.method != StoredMethod and entry.method != DeflatedMethod) {
+		return fail("Unsupported compression method");
+	}
+
+	if (entry.compressedSize == Zip64Marker or entry.size == Zip64Marker or entry.localHeaderOffset == Zip64Marker) {
+		return fail("Zip64 entries are not supported");
+	}
+
+	//a QByteArray cannot hold more than INT_MAX bytes.
+	if (entry.compressedSize > INT_MAX or entry.size > INT_MAX) {
+		return fail("Entry too large");
+	}
+
+	QFile zip(_file);
+
+	if (!zip.open(QIODevice::ReadOnly) or !zip.seek(entry.localHeaderOffset)) {
+		return fail("Cannot read the archive");
+	}
+
+	QByteArray header = zip.read(LocalHeaderSize);
+
+	if (header.size() != LocalHeaderSize or read32(header.constData()) != LocalHeaderSignature) {
+		return fail("Corrupted entry header");
+	}
+
+	//the sizes of the local header might be left to zero, those of the central directory are used.
+	qint64 dataOffset = entry.localHeaderOffset + LocalHeaderSize + read16(header.constData() + 26) + read16(header.constData() + 28);
+
+	if (!zip.seek(dataOffset)) {
+		return fail("Cannot read the archive");
+	}
+
+	QByteArray data = zip.read(entry.compressedSize);
+
+	if (data.size() != entry.compressedSize) {
+		return fail("Truncated entry");
+	}
+
+	if (entry.method == DeflatedMethod) {
+		data = inflateRaw(data, entry.size);
+	}
+
+	if (data.size() != entry.size) {
+		return fail("Corrupted entry data");
+	}
+
+	uLong crc = crc32(0L, Z_NULL, 0);
+	crc = crc32(crc, reinterpret_cast<Bytef const*>(data.constData()), static_cast<uInt>(data.size()));
+
+	if (crc != entry.crc) {
+		return fail("Checksum mismatch");
+	}
+
+	return data;
+}
+
+} // namespace Sabrina
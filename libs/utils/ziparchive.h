@@ -0,0 +1,76 @@
+#ifndef SABRINA_ZIPARCHIVE_H
+#define SABRINA_ZIPARCHIVE_H
+
+/*
+This file is part of the project Sabrina
+Copyright (C) 2023  Paragon <french.paragon@gmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "utils_global.h"
+
+#include <QByteArray>
+#include <QHash>
+#include <QString>
+#include <QStringList>
+
+namespace Sabrina {
+
+/*!
+ * \brief The ZipArchive class read the entries of a zip file, as used by the OpenRaster and Krita documents.
+ *
+ * Only the central directory is read when the archive is opened, each entry is read from the file when it is requested.
+ * Stored and deflated entries are supported, zip64 and encrypted archives are not.
+ * Reading entries from several threads is safe, each read opens its own file handle.
+ */
+class CATHIA_UTILS_EXPORT ZipArchive
+{
+public:
+
+	explicit ZipArchive(QString const& file = QString());
+
+	bool open(QString const& file);
+	void close();
+
+	bool isValid() const;
+	QString fileName() const;
+
+	//! \brief the names of the entries, in the order of the archive.
+	QStringList entries() const;
+	bool contains(QString const& name) const;
+	qint64 entrySize(QString const& name) const;
+
+	//! \brief read and inflate an entry, an empty array if the entry is missing, corrupted, too large or compressed with an unsupported method.
+	//! \param error if not null, receive the reason of the failure, or an empty string on success.
+	QByteArray read(QString const& name, QString* error = nullptr) const;
+
+protected:
+
+	struct Entry {
+		quint16 method;
+		quint32 crc;
+		qint64 compressedSize;
+		qint64 size;
+		qint64 localHeaderOffset;
+	};
+
+	QString _file;
+	QStringList _names;
+	QHash<QString, Entry> _entries;
+};
+
+} // namespace Sabrina
+
+#endif // SABRINA_ZIPARCHIVE_H
@@ -31,10 +31,29 @@ int main(int argc, char** argv) {
 	parser.addVersionOption();
 	parser.addPositionalArgument("project", QCoreApplication::translate("main", "project to open."));
 
+	QCommandLineOption exportFormatOption("export-format",
+										  QCoreApplication::translate("main", "export the comic scripts of the project in <format> (html, txt or fodt) and exit."),
+										  QCoreApplication::translate("main", "format"));
+	QCommandLineOption exportDirOption("export-dir",
+									   QCoreApplication::translate("main", "directory where the scripts are exported (default to the current directory)."),
+									   QCoreApplication::translate("main", "directory"),
+									   ".");
+	parser.addOption(exportFormatOption);
+	parser.addOption(exportDirOption);
+
 	parser.process(app);
 
 	const QStringList args = parser.positionalArguments();
 
+	if (parser.isSet(exportFormatOption)) { //batch export, no window is opened.
+
+		if (args.isEmpty()) {
+			parser.showHelp(1);
+		}
+
+		return app.exportProjectScripts(args.first(), parser.value(exportFormatOption), parser.value(exportDirOption));
+	}
+
 	if(!app.start()) {
 		return 1;
 	}
@@ -0,0 +1,511 @@
+#include <QTest>
+#include <QSignalSpy>
+#include <QBuffer>
+
+#include "model/editableItems/cartography.h"
+#include "model/editableItems/cartographygeojson.h"
+
+class CartographyModelTest : public QObject
+{
+	Q_OBJECT
+public:
+private slots :
+	void initTestCase();
+
+	void testStyleTable();
+	void testStyleInvalidation();
+	void testRemovedCategoryStyle();
+	void testBatchInsertion();
+	void testGeoJsonRoundTrip();
+	void testGeoJsonForeignCollection();
+	void testGeoJsonVectorItems();
+	void testVectorItemsQueries();
+	void testVectorItemCoordinates();
+
+	void cleanupTestCase();
+
+private:
+
+	static Sabrina::CartographyCategory* categoryNamed(Sabrina::Cartography & carto, QString const& name);
+	static Sabrina::CartographyItem* itemNamed(Sabrina::Cartography & carto, QString const& name);
+};
+
+Sabrina::CartographyCategory* CartographyModelTest::categoryNamed(Sabrina::Cartography & carto, QString const& name) {
+
+	for (QString const& ref : carto.getCurrentCategoriesRefs()) {
+
+		Sabrina::CartographyCategory* category = carto.getCategoryByRef(ref);
+
+		if (category->objectName() == name) {
+			return category;
+		}
+	}
+
+	return nullptr;
+}
+
+Sabrina::CartographyItem* CartographyModelTest::itemNamed(Sabrina::Cartography & carto, QString const& name) {
+
+	for (Sabrina::CartographyItem* item : carto.getItems()) {
+		if (item->objectName() == name) {
+			return item;
+		}
+	}
+
+	return nullptr;
+}
+
+void CartographyModelTest::initTestCase() {
+
+}
+
+void CartographyModelTest::testStyleTable() {
+
+	Sabrina::Cartography carto("carto");
+	carto.setSize(QSizeF(100, 100));
+
+	carto.addCategory("first");
+	carto.addCategory("second");
+
+	Sabrina::CartographyCategory* first = categoryNamed(carto, "first");
+	Sabrina::CartographyCategory* second = categoryNamed(carto, "second");
+
+	QVERIFY(first != nullptr);
+	QVERIFY(second != nullptr);
+	QVERIFY(first->getStyleIndex() != second->getStyleIndex());
+	QCOMPARE(carto.getCategoryByIndex(second->getStyleIndex()), second);
+
+	second->setColor(Qt::blue);
+	second->setRadius(12);
+
+	carto.addCartoPoint("point");
+	Sabrina::CartographyItem* item = itemNamed(carto, "point");
+	QVERIFY(item != nullptr);
+
+	item->setCategory(second);
+
+	QCOMPARE(item->getCategoryIndex(), second->getStyleIndex());
+	QCOMPARE(item->getCategoryRef(), second->getRef());
+	QCOMPARE(item->getPointColor(), QColor(Qt::blue));
+	QCOMPARE(item->getRadius(), 12.);
+
+	QVector<Sabrina::CartographyStyle> styles = carto.categoryStyles();
+	QCOMPARE(styles.size(), 2);
+	QCOMPARE(styles[second->getStyleIndex()].color, QColor(Qt::blue));
+}
+
+void CartographyModelTest::testStyleInvalidation() {
+
+	Sabrina::Cartography carto("carto");
+	carto.setSize(QSizeF(100, 100));
+
+	carto.addCategory("category");
+	Sabrina::CartographyCategory* category = categoryNamed(carto, "category");
+
+	for (int i = 0; i < 50; i++) {
+		carto.addCartoPoint(QString("point_%1").arg(i));
+		itemNamed(carto, QString("point_%1").arg(i))->setCategory(category);
+	}
+
+	QSignalSpy spy(&carto, &Sabrina::Cartography::categoryStyleChanged);
+
+	QVector<Sabrina::CartographyStyle> before = carto.categoryStyles();
+
+	category->setColor(Qt::green);
+
+	QCOMPARE(spy.count(), 1); //one signal for the category, not one per item.
+	QCOMPARE(spy.at(0).at(0).toInt(), category->getStyleIndex());
+
+	QCOMPARE(before[category->getStyleIndex()].color, QColor(207, 85, 64)); //the copies of the table are not changed.
+	QCOMPARE(carto.categoryStyle(category->getStyleIndex()).color, QColor(Qt::green));
+
+	for (Sabrina::CartographyItem* item : carto.getItems()) {
+		QCOMPARE(item->getPointColor(), QColor(Qt::green));
+	}
+}
+
+void CartographyModelTest::testRemovedCategoryStyle() {
+
+	Sabrina::Cartography carto("carto");
+	carto.setSize(QSizeF(100, 100));
+
+	carto.addCategory("removed");
+	Sabrina::CartographyCategory* removed = categoryNamed(carto, "removed");
+	removed->setColor(Qt::yellow);
+
+	carto.addCartoPoint("point");
+	Sabrina::CartographyItem* item = itemNamed(carto, "point");
+	item->setCategory(removed);
+
+	int index = removed->getStyleIndex();
+
+	carto.removeCartoCategory(removed);
+
+	QVERIFY(carto.getCategoryByIndex(index) == nullptr);
+	QCOMPARE(item->getPointColor(), Sabrina::CartographyStyle().color);
+
+	carto.addCategory("new");
+	Sabrina::CartographyCategory* added = categoryNamed(carto, "new");
+
+	QVERIFY(added->getStyleIndex() != index); //the index of the removed category is not reused.
+	QCOMPARE(item->getPointColor(), Sabrina::CartographyStyle().color);
+}
+
+void CartographyModelTest::testBatchInsertion() {
+
+	Sabrina::Cartography carto("carto");
+	carto.setSize(QSizeF(100, 100));
+
+	QVector<int> itemsBatches;
+	QVector<int> categoriesBatches;
+
+	connect(&carto, &Sabrina::Cartography::cartographyItemsInserted, [&itemsBatches] (QVector<Sabrina::CartographyItem*> const& items) {
+		itemsBatches.push_back(items.size());
+	});
+	connect(&carto, &Sabrina::Cartography::cartographyCategoriesInserted, [&categoriesBatches] (QVector<Sabrina::CartographyCategory*> const& categories) {
+		categoriesBatches.push_back(categories.size());
+	});
+
+	QStringList names;
+
+	for (int i = 0; i < 500; i++) {
+		names << QString("point_%1").arg(i);
+	}
+
+	carto.addCartoPoints(names);
+
+	QCOMPARE(itemsBatches, QVector<int>({500})); //one signal for the whole batch.
+	QCOMPARE(categoriesBatches, QVector<int>({1})); //the default category, created by the first point.
+	QCOMPARE(carto.getItems().size(), 500);
+	QCOMPARE(carto.itemsInRect(QRectF(0, 0, 100, 100)).size(), 500);
+
+	carto.addCategories({"forests", "cities"});
+	QCOMPARE(categoriesBatches, QVector<int>({1, 2}));
+
+	carto.addCartoPoint("alone");
+	QCOMPARE(itemsBatches, QVector<int>({500, 1}));
+
+	//nested batches emit when the outermost one ends.
+	carto.beginInsertionBatch();
+	carto.addCartoPoints({"a", "b"});
+	carto.addCartoPoint("c");
+	QCOMPARE(itemsBatches.size(), 2);
+	carto.endInsertionBatch();
+
+	QCOMPARE(itemsBatches, QVector<int>({500, 1, 3}));
+
+	//an item removed in the batch which inserted it is never announced.
+	QVector<int> vectorBatches;
+	QStringList removed;
+
+	connect(&carto, &Sabrina::Cartography::cartographyVectorItemsInserted, [&vectorBatches] (QVector<Sabrina::CartographyVectorItem*> const& items) {
+		vectorBatches.push_back(items.size());
+	});
+	connect(&carto, &Sabrina::Cartography::cartographyItemRemoved, [&removed] (QString ref) {
+		removed << ref;
+	});
+	connect(&carto, &Sabrina::Cartography::cartographyCategoryRemoved, [&removed] (QString ref) {
+		removed << ref;
+	});
+	connect(&carto, &Sabrina::Cartography::cartographyVectorItemRemoved, [&removed] (QString ref) {
+		removed << ref;
+	});
+
+	carto.beginInsertionBatch();
+
+	Sabrina::CartographyItem* transient = carto.addCartoPoint("transient");
+	carto.addCartoPoint("kept");
+	Sabrina::CartographyCategory* transientCat = carto.addCategory("transient category");
+	Sabrina::CartographyVectorItem* transientPath = carto.addVectorItem("transient path", Sabrina::CartographyVectorItem::POLYLINE,
+																		  {QPointF(0, 0), QPointF(10, 10)});
+
+	carto.removeCartoItem(transient);
+	carto.removeCartoCategory(transientCat);
+	carto.removeVectorItem(transientPath);
+
+	carto.endInsertionBatch();
+
+	QCOMPARE(itemsBatches, QVector<int>({500, 1, 3, 1}));
+	QCOMPARE(categoriesBatches, QVector<int>({1, 2})); //nothing left to announce.
+	QVERIFY(vectorBatches.isEmpty());
+	QVERIFY(removed.isEmpty());
+
+	carto.removeCartoItem(carto.getItems().back()); //once announced, the removal is announced as well.
+	QCOMPARE(removed.size(), 1);
+}
+
+void CartographyModelTest::testGeoJsonRoundTrip() {
+
+	Sabrina::Cartography source("source");
+	source.setSize(QSizeF(800.0123456789, 600)); //more than the 6 significant digits of QString::arg.
+
+	Sabrina::CartographyCategory* cities = source.addCategory("cities");
+	cities->setColor(Qt::blue);
+	cities->setLegendSize(14);
+
+	Sabrina::CartographyItem* capital = source.addCartoPoint("Capital \"{city}\"");
+	capital->setObjectName("Capital \"{city}\"");
+	capital->setPosition(QPointF(120.5, 300));
+	capital->setCategory(cities);
+	capital->setScale(2);
+	capital->setLegendPosition(Sabrina::CartographyItem::TOP_LEFT);
+
+	for (int i = 0; i < 1000; i++) {
+		Sabrina::CartographyItem* item = source.addCartoPoint(QString("village_%1").arg(i));
+		item->setObjectName(QString("village_%1").arg(i));
+		item->setPosition(QPointF(i % 800, i % 600));
+	}
+
+	QBuffer buffer;
+	QVERIFY(buffer.open(QIODevice::ReadWrite));
+
+	Sabrina::CartographyGeoJson geoJson;
+	QVERIFY(geoJson.exportCartography(&source, &buffer));
+
+	buffer.seek(0);
+
+	Sabrina::Cartography imported("imported");
+
+	QVector<int> itemsBatches;
+	connect(&imported, &Sabrina::Cartography::cartographyItemsInserted, [&itemsBatches] (QVector<Sabrina::CartographyItem*> const& items) {
+		itemsBatches.push_back(items.size());
+	});
+
+	QCOMPARE(geoJson.importCartography(&imported, &buffer), 1001);
+	QVERIFY(geoJson.errorString().isEmpty());
+
+	QCOMPARE(itemsBatches, QVector<int>({1001})); //the import is a single batch.
+	QCOMPARE(imported.getSize(), QSizeF(800.0123456789, 600));
+
+	Sabrina::CartographyItem* importedCapital = itemNamed(imported, "Capital \"{city}\"");
+	QVERIFY(importedCapital != nullptr);
+	QCOMPARE(importedCapital->getPosition(), QPointF(120.5, 300));
+	QCOMPARE(importedCapital->getScale(), 2.);
+	QCOMPARE(importedCapital->getLegendPosition(), Sabrina::CartographyItem::TOP_LEFT);
+
+	Sabrina::CartographyCategory* importedCities = categoryNamed(imported, "cities");
+	QVERIFY(importedCities != nullptr);
+	QCOMPARE(importedCapital->getCategoryIndex(), importedCities->getStyleIndex());
+	QCOMPARE(importedCities->getColor(), QColor(Qt::blue));
+	QCOMPARE(importedCities->getLegendSize(), 14);
+
+	QCOMPARE(itemNamed(imported, "village_999")->getPosition(), QPointF(999 % 800, 999 % 600));
+}
+
+void CartographyModelTest::testGeoJsonForeignCollection() {
+
+	//features first, a numeric category, a line and nested properties, as written by the GIS tools.
+	QByteArray json = "{ \"features\" : [\n"
+					  "  { \"type\": \"Feature\", \"properties\": { \"label\": \"Mill\", \"kind\": 3, \"meta\": {\"tags\": [\"a]\", \"b}\"]} },\n"
+					  "    \"geometry\": { \"type\": \"Point\", \"coordinates\": [ 10, -20 ] } },\n"
+					  "  { \"type\": \"Feature\", \"properties\": { \"label\": \"Road\" },\n"
+					  "    \"geometry\": { \"type\": \"LineString\", \"coordinates\": [ [0, 0], [1, 1] ] } }\n"
+					  "],\n"
+					  "\"type\": \"FeatureCollection\", \"sabrina:categories\": [ { \"name\": \"3\", \"radius\": 9 } ] }";
+
+	QBuffer buffer(&json);
+	QVERIFY(buffer.open(QIODevice::ReadOnly));
+
+	Sabrina::Cartography carto("carto");
+	carto.setSize(QSizeF(100, 100));
+
+	Sabrina::CartographyGeoJson geoJson;
+	geoJson.setNameProperty("label");
+	geoJson.setCategoryProperty("kind");
+
+	QCOMPARE(geoJson.importCartography(&carto, &buffer), 2);
+
+	Sabrina::CartographyItem* mill = itemNamed(carto, "Mill");
+	QVERIFY(mill != nullptr);
+	QCOMPARE(mill->getPosition(), QPointF(10, 20));
+
+	Sabrina::CartographyCategory* kind = categoryNamed(carto, "3");
+	QVERIFY(kind != nullptr);
+	QCOMPARE(mill->getCategoryIndex(), kind->getStyleIndex());
+	QCOMPARE(mill->getRadius(), 9.); //the style read after the features is applied to the category they created.
+
+	QCOMPARE(carto.getVectorItems().size(), 1);
+	Sabrina::CartographyVectorItem* road = carto.getVectorItems().first();
+	QCOMPARE(road->objectName(), QString("Road"));
+	QCOMPARE(road->getKind(), Sabrina::CartographyVectorItem::POLYLINE);
+	QCOMPARE(road->getPoints(), QVector<QPointF>({QPointF(0, 0), QPointF(1, -1)}));
+	QVERIFY(road->getStrokeIndex() >= 0); //without category, the road keeps the default one.
+
+	QByteArray truncated = "{ \"type\": \"FeatureCollection\", \"features\": [ { \"type\": \"Feature\"";
+	QBuffer truncatedBuffer(&truncated);
+	QVERIFY(truncatedBuffer.open(QIODevice::ReadOnly));
+
+	QCOMPARE(geoJson.importCartography(&carto, &truncatedBuffer), -1);
+	QVERIFY(!geoJson.errorString().isEmpty());
+}
+
+void CartographyModelTest::testGeoJsonVectorItems() {
+
+	Sabrina::Cartography source("source");
+	source.setSize(QSizeF(500, 500));
+
+	Sabrina::CartographyCategory* rivers = source.addCategory("rivers");
+	Sabrina::CartographyCategory* forests = source.addCategory("forests");
+
+	Sabrina::CartographyVectorItem* river = source.addVectorItem("river", Sabrina::CartographyVectorItem::POLYLINE,
+																 {QPointF(0, 10), QPointF(50.25, 60), QPointF(100, 40)});
+	river->setStrokeCategory(rivers);
+
+	Sabrina::CartographyVectorItem* forest = source.addVectorItem("forest", Sabrina::CartographyVectorItem::POLYGON,
+																  {QPointF(200, 200), QPointF(300, 200), QPointF(250, 300)});
+	forest->setFillCategory(forests);
+	forest->setStrokeCategory(static_cast<Sabrina::CartographyCategory*>(nullptr));
+
+	QBuffer buffer;
+	QVERIFY(buffer.open(QIODevice::ReadWrite));
+
+	Sabrina::CartographyGeoJson geoJson;
+	QVERIFY(geoJson.exportCartography(&source, &buffer));
+
+	QVERIFY(buffer.data().contains("\"LineString\""));
+	QVERIFY(buffer.data().contains("\"Polygon\""));
+
+	buffer.seek(0);
+
+	Sabrina::Cartography imported("imported");
+
+	QVector<int> batches;
+	connect(&imported, &Sabrina::Cartography::cartographyVectorItemsInserted, [&batches] (QVector<Sabrina::CartographyVectorItem*> const& items) {
+		batches.push_back(items.size());
+	});
+
+	QCOMPARE(geoJson.importCartography(&imported, &buffer), 2);
+	QCOMPARE(batches, QVector<int>({2}));
+
+	Sabrina::CartographyVectorItem* importedRiver = imported.getVectorItems().at(0);
+	Sabrina::CartographyVectorItem* importedForest = imported.getVectorItems().at(1);
+
+	QCOMPARE(importedRiver->objectName(), QString("river"));
+	QCOMPARE(importedRiver->getKind(), Sabrina::CartographyVectorItem::POLYLINE);
+	QCOMPARE(importedRiver->getPoints(), river->getPoints());
+	QCOMPARE(importedRiver->getStrokeIndex(), categoryNamed(imported, "rivers")->getStyleIndex());
+
+	QCOMPARE(importedForest->getKind(), Sabrina::CartographyVectorItem::POLYGON);
+	QCOMPARE(importedForest->getPoints(), forest->getPoints()); //the closing point of the ring is removed.
+	QCOMPARE(importedForest->getFillIndex(), categoryNamed(imported, "forests")->getStyleIndex());
+	QCOMPARE(importedForest->getStrokeIndex(), -1);
+
+	//a multi polygon from another tool, each polygon become a region, the holes are ignored.
+	QByteArray json = "{ \"type\": \"FeatureCollection\", \"features\": [\n"
+					  "  { \"type\": \"Feature\", \"properties\": { \"name\": \"lakes\", \"category\": \"water\" },\n"
+					  "    \"geometry\": { \"type\": \"MultiPolygon\", \"coordinates\": [\n"
+					  "      [ [ [0, 0], [10, 0], [10, -10], [0, 0] ], [ [2, -1], [3, -1], [3, -2], [2, -1] ] ],\n"
+					  "      [ [ [20, 0], [30, 0], [30, -10] ] ] ] } }\n"
+					  "] }";
+
+	QBuffer foreignBuffer(&json);
+	QVERIFY(foreignBuffer.open(QIODevice::ReadOnly));
+
+	Sabrina::Cartography lakes("lakes");
+	QCOMPARE(geoJson.importCartography(&lakes, &foreignBuffer), 2);
+
+	Sabrina::CartographyCategory* water = categoryNamed(lakes, "water");
+	QVERIFY(water != nullptr);
+
+	QCOMPARE(lakes.getVectorItems().size(), 2);
+	QCOMPARE(lakes.getVectorItems().at(0)->getPoints(), QVector<QPointF>({QPointF(0, 0), QPointF(10, 0), QPointF(10, 10)}));
+	QCOMPARE(lakes.getVectorItems().at(1)->getPoints(), QVector<QPointF>({QPointF(20, 0), QPointF(30, 0), QPointF(30, 10)}));
+	QCOMPARE(lakes.getVectorItems().at(1)->getFillIndex(), water->getStyleIndex());
+	QCOMPARE(lakes.getVectorItems().at(1)->getStrokeIndex(), water->getStyleIndex());
+}
+
+void CartographyModelTest::testVectorItemsQueries() {
+
+	Sabrina::Cartography carto("carto");
+	carto.setSize(QSizeF(1000, 1000));
+
+	QVector<int> batches;
+
+	connect(&carto, &Sabrina::Cartography::cartographyVectorItemsInserted, [&batches] (QVector<Sabrina::CartographyVectorItem*> const& items) {
+		batches.push_back(items.size());
+	});
+
+	Sabrina::CartographyVectorItem* country = carto.addVectorItem("country", Sabrina::CartographyVectorItem::POLYGON,
+																	{QPointF(100, 100), QPointF(500, 100), QPointF(500, 400), QPointF(300, 250), QPointF(100, 400)});
+	Sabrina::CartographyVectorItem* road = carto.addVectorItem("road", Sabrina::CartographyVectorItem::POLYLINE,
+																 {QPointF(0, 300), QPointF(900, 300)});
+
+	carto.beginInsertionBatch();
+
+	for (int i = 0; i < 100; i++) {
+		carto.addVectorItem(QString("field_%1").arg(i), Sabrina::CartographyVectorItem::POLYGON,
+							{QPointF(600 + (i%10)*30, 600 + (i/10)*30), QPointF(620 + (i%10)*30, 600 + (i/10)*30), QPointF(620 + (i%10)*30, 620 + (i/10)*30)});
+	}
+
+	carto.endInsertionBatch();
+
+	QCOMPARE(batches, QVector<int>({1, 1, 100}));
+	QCOMPARE(carto.getVectorItems().size(), 102);
+
+	QCOMPARE(country->getBoundingRect(), QRectF(100, 100, 400, 300));
+	QVERIFY(country->getFillIndex() >= 0);
+	QCOMPARE(road->getFillIndex(), -1); //polylines are not filled.
+
+	//viewport culling, in drawing order.
+	QCOMPARE(carto.vectorItemsInRect(QRectF(0, 0, 550, 550)), QVector<Sabrina::CartographyVectorItem*>({country, road}));
+	QCOMPARE(carto.vectorItemsInRect(QRectF(580, 580, 400, 400)).size(), 100);
+	QVERIFY(carto.vectorItemsInRect(QRectF(0, 0, 50, 50)).isEmpty());
+
+	//point in region, the notch of the country is outside of it.
+	QCOMPARE(carto.vectorItemsAt(QPointF(200, 200)), QVector<Sabrina::CartographyVectorItem*>({country}));
+	QVERIFY(carto.vectorItemsAt(QPointF(300, 350)).isEmpty());
+	QCOMPARE(carto.vectorItemsAt(QPointF(700, 302), 3), QVector<Sabrina::CartographyVectorItem*>({road}));
+	QCOMPARE(carto.vectorItemsAt(QPointF(200, 301), 2), QVector<Sabrina::CartographyVectorItem*>({road, country})); //the topmost first.
+
+	//the index follows the changes of the outline.
+	road->setPoints({QPointF(0, 950), QPointF(900, 950)});
+
+	QVERIFY(carto.vectorItemsAt(QPointF(700, 302), 3).isEmpty());
+	QCOMPARE(carto.vectorItemsInRect(QRectF(0, 900, 100, 100)), QVector<Sabrina::CartographyVectorItem*>({road}));
+
+	carto.removeVectorItem(country);
+
+	QCOMPARE(carto.getVectorItems().size(), 101);
+	QVERIFY(carto.vectorItemsAt(QPointF(200, 200)).isEmpty());
+}
+
+void CartographyModelTest::testVectorItemCoordinates() {
+
+	Sabrina::Cartography carto("carto");
+	carto.setSize(QSizeF(100, 100));
+
+	Sabrina::CartographyCategory* rivers = carto.addCategory("rivers");
+
+	Sabrina::CartographyVectorItem* river = carto.addVectorItem("river", Sabrina::CartographyVectorItem::POLYLINE,
+																  {QPointF(0.5, 10), QPointF(20.25, 30), QPointF(-4, 1e5)});
+	river->setStrokeCategory(rivers);
+
+	QCOMPARE(river->getCoordinatesString(), QString("0.5 10 20.25 30 -4 100000"));
+	QCOMPARE(river->getStrokeCategoryRef(), rivers->getRef());
+	QCOMPARE(river->getStrokeIndex(), rivers->getStyleIndex());
+
+	//as when the item is loaded from a file.
+	Sabrina::CartographyVectorItem::CartographyVectorItemFactory factory;
+	Sabrina::CartographyVectorItem* copy = qobject_cast<Sabrina::CartographyVectorItem*>(factory.createItem("copy", &carto));
+
+	QVERIFY(copy != nullptr);
+
+	copy->setCoordinatesString(" 0.5, 10 20.25,30\n-4 100000 7");
+	QCOMPARE(copy->getCoordinates(), river->getCoordinates()); //the incomplete point is dropped.
+
+	copy->setCoordinatesString("1 2 x 3");
+	QCOMPARE(copy->getCoordinates(), river->getCoordinates()); //an invalid string is ignored.
+
+	copy->setStrokeCategory(QString("missing_category"));
+	QCOMPARE(copy->getStrokeIndex(), -1);
+	QCOMPARE(copy->getStrokeCategoryRef(), QString("missing_category"));
+
+	delete copy;
+}
+
+void CartographyModelTest::cleanupTestCase() {
+
+}
+
+QTEST_MAIN(CartographyModelTest)
+#include "testcartographymodel.moc"
@@ -0,0 +1,162 @@
+#include <QTest>
+
+#include "gui/editors/cartographypointslayout.h"
+
+class CartographyPointsLayoutTest : public QObject
+{
+	Q_OBJECT
+public:
+private slots :
+	void initTestCase();
+
+	void testZoomBands();
+	void testClusters();
+	void testLabelsCollision();
+	void testLabelsLevelOfDetail();
+	void testExcludedItem();
+
+	void cleanupTestCase();
+
+private:
+
+	Sabrina::CartographyItem* addPoint(QString const& name, QPointF const& pos);
+	Sabrina::CartographyPointsLayout layout(qreal scale, Sabrina::CartographyItem* excluded = nullptr);
+
+	static int marksWithLabel(Sabrina::CartographyPointsLayout const& layout);
+
+	Sabrina::Cartography* _carto;
+	Sabrina::CartographyPointsLayout::LabelMeasure _measure;
+};
+
+Sabrina::CartographyItem* CartographyPointsLayoutTest::addPoint(QString const& name, QPointF const& pos) {
+
+	_carto->addCartoPoint(name);
+
+	Sabrina::CartographyItem* item = _carto->getItems().last();
+	item->setObjectName(name);
+	item->setPosition(pos);
+
+	return item;
+}
+
+Sabrina::CartographyPointsLayout CartographyPointsLayoutTest::layout(qreal scale, Sabrina::CartographyItem* excluded) {
+
+	Sabrina::CartographyPointsLayout layout(Sabrina::CartographyPointsLayout::zoomBand(scale));
+	layout.build(_carto->getItems(), _carto->categoryStyles(), _measure, excluded);
+
+	return layout;
+}
+
+int CartographyPointsLayoutTest::marksWithLabel(Sabrina::CartographyPointsLayout const& layout) {
+
+	int count = 0;
+
+	for (Sabrina::CartographyPointsLayout::Mark const& mark : layout.marks()) {
+		if (mark.showLabel) {
+			count++;
+		}
+	}
+
+	return count;
+}
+
+void CartographyPointsLayoutTest::initTestCase() {
+
+	_carto = new Sabrina::Cartography("carto");
+	_carto->setSize(QSizeF(1000, 1000));
+
+	//a fixed size for the legends, 10 units per character and 40 units high.
+	_measure = [] (QString const& text, int styleIndex) {
+		Q_UNUSED(styleIndex);
+		return QSizeF(10*text.size(), 40);
+	};
+
+	addPoint("aaaa", QPointF(100, 100));
+	addPoint("bbbb", QPointF(110, 100));
+	addPoint("cccc", QPointF(400, 400));
+	addPoint("dddd", QPointF(410, 410));
+	addPoint("eeee", QPointF(420, 420));
+}
+
+void CartographyPointsLayoutTest::testZoomBands() {
+
+	QCOMPARE(Sabrina::CartographyPointsLayout::zoomBand(1), 0);
+	QCOMPARE(Sabrina::CartographyPointsLayout::zoomBand(0.25), -2*Sabrina::CartographyPointsLayout::BandsPerOctave);
+	QCOMPARE(Sabrina::CartographyPointsLayout::bandScale(Sabrina::CartographyPointsLayout::zoomBand(0.25)), 0.25);
+
+	int band = Sabrina::CartographyPointsLayout::zoomBand(1.1);
+	QVERIFY(Sabrina::CartographyPointsLayout::bandScale(band) <= 1.1);
+	QVERIFY(Sabrina::CartographyPointsLayout::bandScale(band + 1) > 1.1);
+}
+
+void CartographyPointsLayoutTest::testClusters() {
+
+	Sabrina::CartographyPointsLayout zoomedIn = layout(1);
+	QCOMPARE(zoomedIn.marks().size(), 5);
+
+	//at 0.25, the clusters cells are 160 units wide.
+	Sabrina::CartographyPointsLayout zoomedOut = layout(0.25);
+	QCOMPARE(zoomedOut.marks().size(), 2);
+
+	int cluster = -1;
+
+	for (int i = 0; i < zoomedOut.marks().size(); i++) {
+		if (zoomedOut.marks()[i].membersCount == 3) {
+			cluster = i;
+		}
+	}
+
+	QVERIFY(cluster >= 0);
+
+	Sabrina::CartographyPointsLayout::Mark const& mark = zoomedOut.marks()[cluster];
+	QCOMPARE(mark.position, QPointF(410, 410));
+	QCOMPARE(mark.text, QString("3"));
+	QVERIFY(mark.radius > 5);
+
+	QCOMPARE(zoomedOut.members(cluster).size(), 3);
+	QCOMPARE(zoomedOut.itemAt(QPointF(416, 416))->objectName(), QString("eeee"));
+	QVERIFY(zoomedOut.itemAt(QPointF(300, 300)) == nullptr);
+
+	QCOMPARE(zoomedOut.marksIn(QRectF(350, 350, 100, 100)), QVector<int>({cluster}));
+}
+
+void CartographyPointsLayoutTest::testLabelsCollision() {
+
+	Sabrina::CartographyPointsLayout zoomedIn = layout(1);
+
+	QCOMPARE(zoomedIn.marks()[0].showLabel, true);
+	QCOMPARE(zoomedIn.marks()[1].showLabel, false); //overlaps the legend of the first point.
+
+	QCOMPARE(marksWithLabel(zoomedIn), 2);
+
+	//the legends of the clusters are placed first.
+	Sabrina::CartographyPointsLayout zoomedOut = layout(0.25);
+	QCOMPARE(marksWithLabel(zoomedOut), 2);
+}
+
+void CartographyPointsLayoutTest::testLabelsLevelOfDetail() {
+
+	//at 0.125, the legends are 5 pixels high, too small to be read.
+	Sabrina::CartographyPointsLayout layout = this->layout(0.125);
+
+	QVERIFY(layout.marks().size() > 0);
+	QCOMPARE(marksWithLabel(layout), 0);
+}
+
+void CartographyPointsLayoutTest::testExcludedItem() {
+
+	Sabrina::CartographyItem* first = _carto->getItems().first();
+
+	Sabrina::CartographyPointsLayout layout = this->layout(1, first);
+
+	QCOMPARE(layout.marks().size(), 4);
+	QCOMPARE(layout.marks()[0].item->objectName(), QString("bbbb"));
+	QCOMPARE(layout.marks()[0].showLabel, true); //the legend of the excluded item does not hide it anymore.
+}
+
+void CartographyPointsLayoutTest::cleanupTestCase() {
+	delete _carto;
+}
+
+QTEST_MAIN(CartographyPointsLayoutTest)
+#include "testcartographypointslayout.moc"
@@ -0,0 +1,435 @@
+#include <QTest>
+#include <QTemporaryDir>
+#include <QBuffer>
+#include <QDataStream>
+#include <QFile>
+#include <QFileInfo>
+#include <QImage>
+#include <QMap>
+#include <QPainter>
+
+#include <zlib.h>
+
+#include <algorithm>
+
+#include "gui/editors/cartographytilepyramid.h"
+
+class CartographyTilePyramidTest : public QObject
+{
+	Q_OBJECT
+public:
+private slots :
+	void initTestCase();
+
+	void testLevels();
+	void testTiles();
+	void testLevelForScale();
+	void testCacheReuse();
+	void testPreviewAndCancel();
+	void testLayeredImage();
+	void testLayerIds();
+	void testKritaLayers();
+
+	void cleanupTestCase();
+
+private:
+
+	//! \brief write an OpenRaster document with stored entries, the layers are given by entry name.
+	static bool writeOpenRaster(QString const& file, QByteArray const& stack, QMap<QString, QImage> const& layers);
+	//! \brief write a zip archive with stored entries.
+	static bool writeArchive(QString const& file, QMap<QString, QByteArray> const& entries);
+	//! \brief a krita paint layer of 64x64 tiles filled with a single color, the tiles are given by position and compressed with LZF or not.
+	static QByteArray kritaLayer(QColor const& color, QVector<QPoint> const& tiles, bool compressed);
+
+	QTemporaryDir _dir;
+	QString _imageFile;
+	Sabrina::CartographyTilePyramid _pyramid;
+};
+
+void CartographyTilePyramidTest::initTestCase() {
+
+	QVERIFY(_dir.isValid());
+
+	//a 600x300 map, red on the left half and blue on the right half.
+	QImage image(600, 300, QImage::Format_RGB32);
+	image.fill(Qt::red);
+
+	QPainter painter(&image);
+	painter.fillRect(300, 0, 300, 300, Qt::blue);
+	painter.end();
+
+	_imageFile = _dir.filePath("map.png");
+	QVERIFY(image.save(_imageFile));
+
+	QVERIFY(_pyramid.open(_imageFile));
+	QCOMPARE(Sabrina::CartographyTilePyramid::cacheDirectory(_imageFile), _dir.filePath(".map.png.tiles"));
+}
+
+void CartographyTilePyramidTest::testLevels() {
+
+	QVERIFY(_pyramid.isValid());
+	QCOMPARE(_pyramid.imageSize(), QSize(600, 300));
+
+	QCOMPARE(_pyramid.levelsCount(), 3);
+	QCOMPARE(_pyramid.levelSize(1), QSize(300, 150));
+	QCOMPARE(_pyramid.levelSize(2), QSize(150, 75));
+
+	QCOMPARE(_pyramid.columns(0), 3);
+	QCOMPARE(_pyramid.rows(0), 2);
+	QCOMPARE(_pyramid.columns(2), 1);
+	QCOMPARE(_pyramid.rows(2), 1);
+
+	QCOMPARE(_pyramid.tileArea(0, 2, 1), QRect(512, 256, 88, 44));
+	QCOMPARE(_pyramid.tileArea(1, 1, 0), QRect(512, 0, 88, 300));
+	QCOMPARE(_pyramid.tileArea(2, 0, 0), QRect(0, 0, 600, 300));
+}
+
+void CartographyTilePyramidTest::testTiles() {
+
+	QImage corner = _pyramid.tile(0, 2, 1);
+	QCOMPARE(corner.size(), QSize(88, 44));
+	QCOMPARE(QColor(corner.pixel(40, 20)), QColor(Qt::blue));
+
+	QImage top = _pyramid.tile(2, 0, 0);
+	QCOMPARE(top.size(), QSize(150, 75));
+	QCOMPARE(QColor(top.pixel(10, 40)), QColor(Qt::red));
+	QCOMPARE(QColor(top.pixel(140, 40)), QColor(Qt::blue));
+
+	QVERIFY(_pyramid.tile(0, 3, 0).isNull());
+	QVERIFY(_pyramid.tile(3, 0, 0).isNull());
+}
+
+void CartographyTilePyramidTest::testLevelForScale() {
+
+	QCOMPARE(_pyramid.levelForScale(4), 0);
+	QCOMPARE(_pyramid.levelForScale(1), 0);
+	QCOMPARE(_pyramid.levelForScale(0.5), 1);
+	QCOMPARE(_pyramid.levelForScale(0.3), 1);
+	QCOMPARE(_pyramid.levelForScale(0.1), 2);
+}
+
+void CartographyTilePyramidTest::testCacheReuse() {
+
+	QString firstTile = _dir.filePath(".map.png.tiles/0/0_0.png");
+
+	QVERIFY(QFile::remove(firstTile));
+
+	Sabrina::CartographyTilePyramid reopened;
+	QVERIFY(reopened.open(_imageFile));
+	QVERIFY(!QFileInfo(firstTile).exists()); //the index is still valid, nothing was generated.
+
+	QFile image(_imageFile);
+	QVERIFY(image.open(QIODevice::ReadWrite));
+	QVERIFY(image.setFileTime(QFileInfo(_imageFile).lastModified().addSecs(10), QFileDevice::FileModificationTime));
+	image.close();
+
+	QVERIFY(reopened.open(_imageFile));
+	QVERIFY(QFileInfo(firstTile).exists()); //the image changed, the tiles are generated again.
+}
+
+void CartographyTilePyramidTest::testPreviewAndCancel() {
+
+	QString imageFile = _dir.filePath("other.png");
+
+	QImage image(1000, 500, QImage::Format_RGB32);
+	image.fill(Qt::green);
+	QVERIFY(image.save(imageFile));
+
+	Sabrina::CartographyTilePyramid pyramid;
+
+	QVERIFY(!pyramid.open(imageFile, [] () { return true; }));
+	QVERIFY(!pyramid.isValid());
+	QVERIFY(!QFileInfo(_dir.filePath(".other.png.tiles/index.ini")).exists());
+
+	QImage preview;
+
+	QVERIFY(pyramid.open(imageFile, nullptr, [&preview] (QImage const& img) { preview = img; }));
+	QCOMPARE(preview.size(), QSize(256, 128));
+	QCOMPARE(QColor(preview.pixel(128, 64)), QColor(Qt::green));
+
+	QCOMPARE(Sabrina::CartographyTilePyramid::imageFileSize(imageFile), QSize(1000, 500));
+}
+
+void CartographyTilePyramidTest::testLayeredImage() {
+
+	QString imageFile = _dir.filePath("map.ora");
+
+	QImage background(600, 300, QImage::Format_ARGB32);
+	background.fill(Qt::red);
+
+	QImage river(300, 300, QImage::Format_ARGB32);
+	river.fill(Qt::blue);
+
+	QImage notes(100, 100, QImage::Format_ARGB32);
+	notes.fill(Qt::green);
+
+	QByteArray stack = "<image w=\"600\" h=\"300\"><stack>"
+					   "<layer name=\"notes\" src=\"data/notes.png\" visibility=\"hidden\"/>"
+					   "<stack name=\"water\"><layer name=\"river\" src=\"data/river.png\" x=\"300\" y=\"0\"/></stack>"
+					   "<layer name=\"background\" src=\"data/background.png\"/>"
+					   "</stack></image>";
+
+	QVERIFY(writeOpenRaster(imageFile, stack, {{"data/notes.png", notes},
+												{"data/river.png", river},
+												{"data/background.png", background}}));
+
+	QCOMPARE(Sabrina::CartographyTilePyramid::imageFileSize(imageFile), QSize(600, 300));
+
+	Sabrina::CartographyTilePyramid pyramid;
+	QVERIFY(pyramid.open(imageFile));
+
+	QVERIFY(pyramid.isLayered());
+	QCOMPARE(pyramid.imageSize(), QSize(600, 300));
+	QCOMPARE(pyramid.layersCount(), 3);
+	QCOMPARE(pyramid.layerName(0), QString("background"));
+	QCOMPARE(pyramid.layerName(1), QString("river"));
+	QCOMPARE(pyramid.layerName(2), QString("notes"));
+	QCOMPARE(pyramid.layerId(1), QString("water/river"));
+	QCOMPARE(pyramid.layerId(2), QString("notes"));
+	QVERIFY(!pyramid.isLayerVisibleInFile(2));
+	QVERIFY(!pyramid.isLayerVisible(2));
+
+	//the transparent tiles of the layers are not saved.
+	QVERIFY(!QFileInfo(_dir.filePath(".map.ora.tiles/layers/1/0/0_0.png")).exists());
+	QVERIFY(QFileInfo(_dir.filePath(".map.ora.tiles/layers/1/0/1_0.png")).exists());
+
+	QImage top = pyramid.tile(2, 0, 0);
+	QCOMPARE(top.size(), QSize(150, 75));
+	QCOMPARE(QColor(top.pixel(10, 40)), QColor(Qt::red));
+	QCOMPARE(QColor(top.pixel(140, 40)), QColor(Qt::blue));
+
+	QCOMPARE(QColor(pyramid.tile(0, 0, 0).pixel(50, 50)), QColor(Qt::red));
+
+	pyramid.setLayerVisible(1, false);
+	pyramid.setLayerVisible(2, true);
+
+	QCOMPARE(QColor(pyramid.tile(0, 2, 1).pixel(40, 20)), QColor(Qt::red));
+	QCOMPARE(QColor(pyramid.tile(0, 0, 0).pixel(50, 50)), QColor(Qt::green));
+
+	Sabrina::CartographyTilePyramid reopened;
+	QVERIFY(reopened.open(imageFile));
+	QCOMPARE(reopened.layersCount(), 3);
+	QVERIFY(!reopened.isLayerVisible(2)); //the visibility toggled in the pyramid is not stored in the cache.
+	QCOMPARE(QColor(reopened.tile(0, 2, 1).pixel(40, 20)), QColor(Qt::blue));
+}
+
+void CartographyTilePyramidTest::testLayerIds() {
+
+	QString imageFile = _dir.filePath("ink.ora");
+
+	QImage ink(10, 10, QImage::Format_ARGB32);
+	ink.fill(Qt::black);
+
+	//three layers with the same name, two of them in the same group.
+	QByteArray stack = "<image w=\"10\" h=\"10\"><stack>"
+					   "<stack name=\"sketch\"><layer name=\"ink\" src=\"data/ink3.png\"/></stack>"
+					   "<layer name=\"ink\" src=\"data/ink2.png\"/>"
+					   "<layer name=\"ink\" src=\"data/ink1.png\"/>"
+					   "</stack></image>";
+
+	QVERIFY(writeOpenRaster(imageFile, stack, {{"data/ink1.png", ink},
+												{"data/ink2.png", ink},
+												{"data/ink3.png", ink}}));
+
+	Sabrina::CartographyTilePyramid pyramid;
+	QVERIFY(pyramid.open(imageFile));
+
+	QCOMPARE(pyramid.layersCount(), 3);
+	QCOMPARE(pyramid.layerName(0), QString("ink"));
+	QCOMPARE(pyramid.layerId(0), QString("ink#2"));
+	QCOMPARE(pyramid.layerId(1), QString("ink"));
+	QCOMPARE(pyramid.layerId(2), QString("sketch/ink"));
+
+	Sabrina::CartographyTilePyramid reopened;
+	QVERIFY(reopened.open(imageFile));
+	QCOMPARE(reopened.layerId(0), QString("ink#2")); //read from the cache.
+}
+
+void CartographyTilePyramidTest::testKritaLayers() {
+
+	QString imageFile = _dir.filePath("map.kra");
+
+	QByteArray maindoc = "<DOC><IMAGE name=\"map\" width=\"100\" height=\"80\"><layers>"
+						 "<layer nodetype=\"paintlayer\" name=\"ink\" filename=\"layer3\" colorspacename=\"RGBA\" visible=\"0\" opacity=\"255\" x=\"0\" y=\"0\"/>"
+						 "<layer nodetype=\"grouplayer\" name=\"water\" filename=\"layer4\" visible=\"1\" opacity=\"255\"><layers>"
+						 "<layer nodetype=\"paintlayer\" name=\"river\" filename=\"layer2\" colorspacename=\"RGBA\" visible=\"1\" opacity=\"255\" x=\"10\" y=\"0\"/>"
+						 "</layers></layer>"
+						 "<layer nodetype=\"paintlayer\" name=\"paper\" filename=\"layer1\" colorspacename=\"RGBA\" visible=\"1\" opacity=\"255\" x=\"0\" y=\"0\"/>"
+						 "</layers></IMAGE></DOC>";
+
+	QVERIFY(writeArchive(imageFile, {{"maindoc.xml", maindoc},
+									 {"map/layers/layer1", kritaLayer(Qt::red, {QPoint(0, 0)}, true)},
+									 {"map/layers/layer2", kritaLayer(Qt::blue, {QPoint(64, 0), QPoint(64, 64)}, true)},
+									 {"map/layers/layer3", kritaLayer(Qt::green, {QPoint(0, 0)}, false)}}));
+
+	QCOMPARE(Sabrina::CartographyTilePyramid::imageFileSize(imageFile), QSize(100, 80));
+
+	Sabrina::CartographyTilePyramid pyramid;
+	QVERIFY(pyramid.open(imageFile));
+
+	QCOMPARE(pyramid.layersCount(), 3);
+	QCOMPARE(pyramid.layerName(0), QString("paper"));
+	QCOMPARE(pyramid.layerId(1), QString("water/river"));
+	QCOMPARE(pyramid.layerId(2), QString("ink"));
+	QVERIFY(!pyramid.isLayerVisibleInFile(2));
+
+	//the river starts at 64 in its tiles, and is moved by 10 in the document.
+	QImage tile = pyramid.tile(0, 0, 0);
+	QCOMPARE(tile.size(), QSize(100, 80));
+	QCOMPARE(QColor(tile.pixel(10, 10)), QColor(Qt::red));
+	QCOMPARE(qAlpha(tile.pixel(70, 10)), 0);
+	QCOMPARE(QColor(tile.pixel(80, 70)), QColor(Qt::blue));
+
+	pyramid.setLayerVisible(2, true);
+	QCOMPARE(QColor(pyramid.tile(0, 0, 0).pixel(10, 10)), QColor(Qt::green));
+
+	//a visible layer which cannot be read, the merged image is read instead.
+	QString mergedFile = _dir.filePath("merged.kra");
+
+	QImage merged(100, 80, QImage::Format_ARGB32);
+	merged.fill(Qt::yellow);
+
+	QByteArray png;
+	QBuffer buffer(&png);
+	buffer.open(QIODevice::WriteOnly);
+	QVERIFY(merged.save(&buffer, "PNG"));
+
+	QByteArray vectorDoc = "<DOC><IMAGE name=\"merged\" width=\"100\" height=\"80\"><layers>"
+						   "<layer nodetype=\"shapelayer\" name=\"text\" filename=\"layer2\" visible=\"1\" opacity=\"255\"/>"
+						   "<layer nodetype=\"paintlayer\" name=\"paper\" filename=\"layer1\" colorspacename=\"RGBA\" visible=\"1\" opacity=\"255\" x=\"0\" y=\"0\"/>"
+						   "</layers></IMAGE></DOC>";
+
+	QVERIFY(writeArchive(mergedFile, {{"maindoc.xml", vectorDoc},
+									  {"mergedimage.png", png},
+									  {"merged/layers/layer1", kritaLayer(Qt::red, {QPoint(0, 0)}, true)}}));
+
+	Sabrina::CartographyTilePyramid fallback;
+	QVERIFY(fallback.open(mergedFile));
+
+	QCOMPARE(fallback.layersCount(), 1);
+	QCOMPARE(QColor(fallback.tile(0, 0, 0).pixel(10, 10)), QColor(Qt::yellow));
+}
+
+QByteArray CartographyTilePyramidTest::kritaLayer(QColor const& color, QVector<QPoint> const& tiles, bool compressed) {
+
+	const int nPixels = 64*64;
+	QByteArray bgra = QByteArray(1, char(color.blue())) + char(color.green()) + char(color.red()) + char(color.alpha());
+
+	QByteArray tileData(1, compressed ? 1 : 0);
+
+	if (compressed) {
+
+		//each channel is a run of the same byte: a literal byte, then back references to the previous byte.
+		for (int channel = 0; channel < 4; channel++) {
+
+			tileData += char(0);
+			tileData += bgra[channel];
+
+			int remaining = nPixels-1;
+
+			while (remaining > 0) {
+
+				int len = std::min(remaining, 264);
+
+				if (len < 3) {
+					tileData += char(len-1);
+					tileData += QByteArray(len, bgra[channel]);
+				} else if (len-2 < 7) {
+					tileData += char((len-2) << 5);
+					tileData += char(0);
+				} else {
+					tileData += char(7 << 5);
+					tileData += char(len-2-7);
+					tileData += char(0);
+				}
+
+				remaining -= len;
+			}
+		}
+
+	} else {
+		for (int i = 0; i < nPixels; i++) {
+			tileData += bgra;
+		}
+	}
+
+	QByteArray layer = QString("VERSION 2\nTILEWIDTH 64\nTILEHEIGHT 64\nPIXELSIZE 4\nDATA %1\n").arg(tiles.size()).toUtf8();
+
+	for (QPoint const& tile : tiles) {
+		layer += QString("%1,%2,LZF,%3\n").arg(tile.x()).arg(tile.y()).arg(tileData.size()).toUtf8();
+		layer += tileData;
+	}
+
+	return layer;
+}
+
+bool CartographyTilePyramidTest::writeOpenRaster(QString const& file, QByteArray const& stack, QMap<QString, QImage> const& layers) {
+
+	QMap<QString, QByteArray> entries;
+	entries.insert("stack.xml", stack);
+
+	for (auto it = layers.constBegin(); it != layers.constEnd(); ++it) {
+
+		QByteArray png;
+		QBuffer buffer(&png);
+		buffer.open(QIODevice::WriteOnly);
+
+		if (!it.value().save(&buffer, "PNG")) {
+			return false;
+		}
+
+		entries.insert(it.key(), png);
+	}
+
+	return writeArchive(file, entries);
+}
+
+bool CartographyTilePyramidTest::writeArchive(QString const& file, QMap<QString, QByteArray> const& entries) {
+
+	QFile zip(file);
+
+	if (!zip.open(QIODevice::WriteOnly)) {
+		return false;
+	}
+
+	QDataStream stream(&zip);
+	stream.setByteOrder(QDataStream::LittleEndian);
+
+	QByteArray directory;
+	QDataStream directoryStream(&directory, QIODevice::WriteOnly);
+	directoryStream.setByteOrder(QDataStream::LittleEndian);
+
+	for (auto it = entries.constBegin(); it != entries.constEnd(); ++it) {
+
+		QByteArray name = it.key().toUtf8();
+		QByteArray const& data = it.value();
+
+		quint32 crc = crc32(crc32(0L, Z_NULL, 0), reinterpret_cast<Bytef const*>(data.constData()), data.size());
+		quint32 offset = static_cast<quint32>(zip.pos());
+
+		stream << quint32(0x04034b50) << quint16(20) << quint16(0) << quint16(0) << quint16(0) << quint16(0)
+			   << crc << quint32(data.size()) << quint32(data.size()) << quint16(name.size()) << quint16(0);
+		stream.writeRawData(name.constData(), name.size());
+		stream.writeRawData(data.constData(), data.size());
+
+		directoryStream << quint32(0x02014b50) << quint16(20) << quint16(20) << quint16(0) << quint16(0) << quint16(0) << quint16(0)
+						<< crc << quint32(data.size()) << quint32(data.size()) << quint16(name.size())
+						<< quint16(0) << quint16(0) << quint16(0) << quint16(0) << quint32(0) << offset;
+		directoryStream.writeRawData(name.constData(), name.size());
+	}
+
+	quint32 directoryOffset = static_cast<quint32>(zip.pos());
+	stream.writeRawData(directory.constData(), directory.size());
+
+	stream << quint32(0x06054b50) << quint16(0) << quint16(0) << quint16(entries.size()) << quint16(entries.size())
+		   << quint32(directory.size()) << directoryOffset << quint16(0);
+
+	return stream.status() == QDataStream::Ok;
+}
+
+void CartographyTilePyramidTest::cleanupTestCase() {
+
+}
+
+QTEST_MAIN(CartographyTilePyramidTest)
+#include "testcartographytilepyramid.moc"
@@ -0,0 +1,99 @@
+#include <QTest>
+#include <QBuffer>
+#include <QXmlStreamReader>
+
+#include "text/textnode.h"
+#include "text/documentexporters.h"
+
+#include "testdocuments.h"
+
+#include <memory>
+
+class DocumentExportersTest : public QObject
+{
+	Q_OBJECT
+public:
+private slots :
+	void initTestCase();
+
+	void testExportFormats_data();
+	void testExportFormats();
+
+	void testFlatOdtIsWellFormed();
+
+	void cleanupTestCase();
+};
+
+void DocumentExportersTest::initTestCase() {
+
+}
+
+void DocumentExportersTest::testExportFormats_data() {
+	QTest::addColumn<QString>("format");
+	QTest::addColumn<QStringList>("expectedParts");
+
+	QTest::newRow("Html") << QString("html") << QStringList({"<p>Title &lt;&amp;&gt;</p>", "<p>First page</p>", "<p>First panel</p>", "</body>"});
+	QTest::newRow("Plain text") << QString("txt") << QStringList({"Title <&>\n", "\nFirst page\n", "\n  First panel\n"});
+	QTest::newRow("Flat odt") << QString("fodt") << QStringList({"Title &lt;&amp;&gt;", "First page", "First panel", "office:document"});
+}
+
+void DocumentExportersTest::testExportFormats() {
+
+	QFETCH(QString, format);
+	QFETCH(QStringList, expectedParts);
+
+	std::unique_ptr<Sabrina::TextDocumentExporter> exporter(Sabrina::TextDocumentExporter::createExporter(format));
+	QVERIFY(exporter != nullptr);
+	QCOMPARE(exporter->formatId(), format);
+
+	Sabrina::TextNode* root = TestDocuments::buildExportDocument();
+
+	QBuffer buffer;
+	buffer.open(QIODevice::WriteOnly);
+
+	QVERIFY(exporter->exportDocument(root, &buffer));
+
+	QString out = QString::fromUtf8(buffer.data());
+
+	for (QString const& part : expectedParts) {
+		QVERIFY2(out.contains(part), qPrintable(part));
+	}
+
+	delete root;
+}
+
+void DocumentExportersTest::testFlatOdtIsWellFormed() {
+
+	std::unique_ptr<Sabrina::TextDocumentExporter> exporter(Sabrina::TextDocumentExporter::createExporter("fodt"));
+
+	Sabrina::TextNode* root = TestDocuments::buildExportDocument();
+
+	QBuffer buffer;
+	buffer.open(QIODevice::WriteOnly);
+
+	QVERIFY(exporter->exportDocument(root, &buffer));
+
+	QXmlStreamReader reader(buffer.data());
+	int nParagraphs = 0;
+
+	while (!reader.atEnd()) {
+		reader.readNext();
+
+		if (reader.isStartElement() and reader.name() == QLatin1String("p")) {
+			nParagraphs++;
+		}
+	}
+
+	QVERIFY(!reader.hasError());
+	QCOMPARE(nParagraphs, 3);
+
+	delete root;
+}
+
+void DocumentExportersTest::cleanupTestCase() {
+
+}
+
+
+QTEST_MAIN(DocumentExportersTest)
+#include "testdocumentexporters.moc"
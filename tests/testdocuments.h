@@ -0,0 +1,79 @@
+#ifndef SABRINA_TESTDOCUMENTS_H
+#define SABRINA_TESTDOCUMENTS_H
+
+#include "text/textnode.h"
+
+//! \brief the documents shared by the text tests, the caller takes the ownership of the returned root.
+namespace TestDocuments {
+
+//! \brief a title "The cat", a caption and a two lines dialog, with cats in all cases, inside words and followed by a number.
+inline Sabrina::TextNode* buildSearchDocument() {
+
+	Sabrina::TextNode* root = new Sabrina::TextNode();
+	root->lineAt(0)->setText("The cat");
+
+	Sabrina::TextNode* caption = root->insertNodeBelow(1,-1);
+	caption->lineAt(0)->setText("A cat sits on the catwalk");
+
+	Sabrina::TextNode* dialog = root->insertNodeBelow(2,-1);
+	dialog->setNbTextLines(2);
+	dialog->lineAt(0)->setText("CAT");
+	dialog->lineAt(1)->setText("Another cat, cat 42");
+
+	return root;
+}
+
+//! \brief a document with 3 pages (style 2) of 2 panels (style 3), each panel containing a dialog (style 5).
+inline Sabrina::TextNode* buildOutlineDocument() {
+
+	Sabrina::TextNode* root = new Sabrina::TextNode();
+
+	for (int p = 0; p < 3; p++) {
+		Sabrina::TextNode* page = root->insertNodeBelow(2,-1);
+		page->lineAt(0)->setText(QString("Page %1").arg(p+1));
+
+		for (int c = 0; c < 2; c++) {
+			Sabrina::TextNode* panel = page->insertNodeBelow(3,-1);
+			panel->lineAt(0)->setText(QString("Panel %1.%2").arg(p+1).arg(c+1));
+
+			Sabrina::TextNode* dialog = panel->insertNodeBelow(5,-1);
+			dialog->lineAt(0)->setText("Hello");
+		}
+	}
+
+	return root;
+}
+
+//! \brief a title with characters to escape, one page and one panel.
+inline Sabrina::TextNode* buildExportDocument() {
+
+	Sabrina::TextNode* root = new Sabrina::TextNode();
+	root->lineAt(0)->setText("Title <&>");
+
+	Sabrina::TextNode* page = root->insertNodeBelow(0,-1);
+	page->lineAt(0)->setText("First page");
+
+	Sabrina::TextNode* panel = page->insertNodeBelow(0,-1);
+	panel->lineAt(0)->setText("First panel");
+
+	return root;
+}
+
+static const int PageBreakStyle = 9;
+
+//! \brief a document with 10 nodes below the root, the sixth one having the PageBreakStyle style.
+inline Sabrina::TextNode* buildPaginationDocument() {
+
+	Sabrina::TextNode* root = new Sabrina::TextNode();
+
+	for (int i = 0; i < 10; i++) {
+		Sabrina::TextNode* node = root->insertNodeBelow((i == 5) ? PageBreakStyle : 1, -1);
+		node->lineAt(0)->setText(QString("Node %1").arg(i+1));
+	}
+
+	return root;
+}
+
+} // namespace TestDocuments
+
+#endif // SABRINA_TESTDOCUMENTS_H
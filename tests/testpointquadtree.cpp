@@ -0,0 +1,136 @@
+#include <QTest>
+
+#include "utils/pointquadtree.h"
+
+#include <algorithm>
+
+class PointQuadTreeTest : public QObject
+{
+	Q_OBJECT
+public:
+private slots :
+	void initTestCase();
+
+	void testRectQuery();
+	void testNearest();
+	void testGrowth();
+	void testMoveAndRemove();
+
+	void cleanupTestCase();
+
+private:
+
+	//! \brief a 20x20 grid of points spaced by 10, the value of a point is its index in the grid.
+	void fillGrid(Sabrina::PointQuadTree<int> & tree);
+};
+
+void PointQuadTreeTest::fillGrid(Sabrina::PointQuadTree<int> & tree) {
+
+	for (int i = 0; i < 20; i++) {
+		for (int j = 0; j < 20; j++) {
+			tree.insert(i*20 + j, QPointF(i*10 + 5, j*10 + 5));
+		}
+	}
+}
+
+void PointQuadTreeTest::initTestCase() {
+
+}
+
+void PointQuadTreeTest::testRectQuery() {
+
+	Sabrina::PointQuadTree<int> tree(QRectF(0, 0, 200, 200), 4);
+	fillGrid(tree);
+
+	QCOMPARE(tree.size(), 400);
+
+	QVector<int> found = tree.query(QRectF(0, 0, 30, 20));
+	std::sort(found.begin(), found.end());
+
+	QCOMPARE(found, QVector<int>({0, 1, 20, 21, 40, 41}));
+
+	QVERIFY(tree.query(QRectF(300, 300, 10, 10)).isEmpty());
+	QCOMPARE(tree.query(QRectF(0, 0, 200, 200)).size(), 400);
+}
+
+void PointQuadTreeTest::testNearest() {
+
+	Sabrina::PointQuadTree<int> tree(QRectF(0, 0, 200, 200), 4);
+	fillGrid(tree);
+
+	int value = -1;
+	QPointF pos;
+
+	QVERIFY(tree.nearest(QPointF(57, 122), -1, &value, &pos));
+	QCOMPARE(value, 5*20 + 12);
+	QCOMPARE(pos, QPointF(55, 125));
+
+	QVERIFY(tree.nearest(QPointF(-50, -50), -1, &value));
+	QCOMPARE(value, 0);
+
+	QVERIFY(!tree.nearest(QPointF(-50, -50), 10, &value));
+}
+
+void PointQuadTreeTest::testGrowth() {
+
+	Sabrina::PointQuadTree<int> tree(QRectF(0, 0, 10, 10), 2);
+
+	tree.insert(1, QPointF(5, 5));
+	tree.insert(2, QPointF(-100, 40));
+	tree.insert(3, QPointF(1000, -300));
+
+	QVERIFY(tree.bounds().contains(QPointF(-100, 40)));
+	QVERIFY(tree.bounds().contains(QPointF(1000, -300)));
+
+	QCOMPARE(tree.query(QRectF(-200, 0, 100, 100)), QVector<int>({2}));
+	QCOMPARE(tree.query(QRectF(900, -400, 200, 200)), QVector<int>({3}));
+}
+
+void PointQuadTreeTest::testMoveAndRemove() {
+
+	Sabrina::PointQuadTree<int> tree(QRectF(0, 0, 200, 200), 4);
+	fillGrid(tree);
+
+	tree.move(0, QPointF(195, 195));
+
+	QCOMPARE(tree.size(), 400);
+	QCOMPARE(tree.position(0), QPointF(195, 195));
+	QVERIFY(!tree.query(QRectF(0, 0, 10, 10)).contains(0));
+	QVERIFY(tree.query(QRectF(190, 190, 10, 10)).contains(0));
+
+	for (int i = 0; i < 400; i += 2) {
+		QVERIFY(tree.remove(i));
+	}
+
+	QVERIFY(!tree.remove(0));
+	QCOMPARE(tree.size(), 200);
+	QCOMPARE(tree.query(QRectF(0, 0, 200, 200)).size(), 200);
+
+	for (int i = 1; i < 400; i += 2) {
+		tree.remove(i);
+	}
+
+	QVERIFY(tree.isEmpty());
+	QVERIFY(!tree.nearest(QPointF(50, 50), -1));
+
+	//a point on the bottom right corner of the old root, after the tree grew on its right.
+	Sabrina::PointQuadTree<int> grown(QRectF(0, 0, 10, 10), 1);
+
+	grown.insert(1, QPointF(10, 10));
+	grown.insert(2, QPointF(5, 5));
+	grown.insert(3, QPointF(20, 20));
+
+	QVERIFY(grown.remove(1));
+	QVERIFY(!grown.query(QRectF(8, 8, 4, 4)).contains(1));
+	QCOMPARE(grown.size(), 2);
+
+	grown.move(2, QPointF(10, 10)); //moved, not duplicated.
+	QCOMPARE(grown.query(QRectF(0, 0, 30, 30)).size(), 2);
+}
+
+void PointQuadTreeTest::cleanupTestCase() {
+
+}
+
+QTEST_MAIN(PointQuadTreeTest)
+#include "testpointquadtree.moc"
@@ -0,0 +1,132 @@
+#include <QTest>
+
+#include "utils/rectquadtree.h"
+
+#include <algorithm>
+
+class RectQuadTreeTest : public QObject
+{
+	Q_OBJECT
+public:
+private slots :
+	void initTestCase();
+
+	void testRectQuery();
+	void testPointQuery();
+	void testGrowth();
+	void testMoveAndRemove();
+
+	void cleanupTestCase();
+
+private:
+
+	//! \brief a 20x20 grid of 5x5 boxes spaced by 10, the value of a box is its index in the grid.
+	void fillGrid(Sabrina::RectQuadTree<int> & tree);
+};
+
+void RectQuadTreeTest::fillGrid(Sabrina::RectQuadTree<int> & tree) {
+
+	for (int i = 0; i < 20; i++) {
+		for (int j = 0; j < 20; j++) {
+			tree.insert(i*20 + j, QRectF(i*10, j*10, 5, 5));
+		}
+	}
+}
+
+void RectQuadTreeTest::initTestCase() {
+
+}
+
+void RectQuadTreeTest::testRectQuery() {
+
+	Sabrina::RectQuadTree<int> tree(QRectF(0, 0, 200, 200), 4);
+	fillGrid(tree);
+
+	QCOMPARE(tree.size(), 400);
+
+	QVector<int> found = tree.query(QRectF(0, 0, 12, 8));
+	std::sort(found.begin(), found.end());
+
+	QCOMPARE(found, QVector<int>({0, 20}));
+
+	QVERIFY(tree.query(QRectF(300, 300, 10, 10)).isEmpty());
+	QCOMPARE(tree.query(QRectF(0, 0, 200, 200)).size(), 400);
+}
+
+void RectQuadTreeTest::testPointQuery() {
+
+	Sabrina::RectQuadTree<int> tree(QRectF(0, 0, 200, 200), 4);
+	fillGrid(tree);
+
+	tree.insert(1000, QRectF(QPointF(102, 0), QPointF(102, 200))); //a vertical line.
+	tree.insert(2000, QRectF(50, 50, 100, 100)); //a region straddling the center of the tree.
+
+	QVector<int> found = tree.query(QPointF(102, 102));
+	std::sort(found.begin(), found.end());
+
+	QCOMPARE(found, QVector<int>({210, 1000, 2000}));
+
+	found = tree.query(QPointF(7, 7));
+	QVERIFY(found.isEmpty());
+}
+
+void RectQuadTreeTest::testGrowth() {
+
+	Sabrina::RectQuadTree<int> tree(QRectF(0, 0, 10, 10), 2);
+
+	tree.insert(1, QRectF(5, 5, 1, 1));
+	tree.insert(2, QRectF(-100, 40, 20, 20));
+	tree.insert(3, QRectF(900, -300, 200, 10));
+
+	QVERIFY(tree.bounds().contains(QRectF(-100, 40, 20, 20)));
+	QVERIFY(tree.bounds().contains(QRectF(900, -300, 200, 10)));
+
+	QCOMPARE(tree.query(QRectF(-200, 0, 100, 100)), QVector<int>({2}));
+	QCOMPARE(tree.query(QPointF(1000, -295)), QVector<int>({3}));
+}
+
+void RectQuadTreeTest::testMoveAndRemove() {
+
+	Sabrina::RectQuadTree<int> tree(QRectF(0, 0, 200, 200), 4);
+	fillGrid(tree);
+
+	tree.move(0, QRectF(190, 190, 5, 5));
+
+	QCOMPARE(tree.size(), 400);
+	QCOMPARE(tree.rect(0), QRectF(190, 190, 5, 5));
+	QVERIFY(!tree.query(QRectF(0, 0, 8, 8)).contains(0));
+	QVERIFY(tree.query(QRectF(190, 190, 10, 10)).contains(0));
+
+	for (int i = 0; i < 400; i += 2) {
+		QVERIFY(tree.remove(i));
+	}
+
+	QVERIFY(!tree.remove(0));
+	QCOMPARE(tree.size(), 200);
+	QCOMPARE(tree.query(QRectF(0, 0, 200, 200)).size(), 200);
+
+	for (int i = 1; i < 400; i += 2) {
+		tree.remove(i);
+	}
+
+	QVERIFY(tree.isEmpty());
+	QVERIFY(tree.query(QRectF(0, 0, 200, 200)).isEmpty());
+
+	//a line on the edge of the old root, after the tree grew on its left.
+	Sabrina::RectQuadTree<int> grown(QRectF(0, 0, 10, 10), 1);
+
+	grown.insert(1, QRectF(1, 1, 1, 1));
+	grown.insert(2, QRectF(QPointF(0, 2), QPointF(0, 3)));
+	grown.insert(3, QRectF(-5, 1, 1, 1));
+
+	QVERIFY(grown.remove(2));
+	QVERIFY(!grown.query(QPointF(0, 2.5)).contains(2));
+	QCOMPARE(grown.size(), 2);
+}
+
+void RectQuadTreeTest::cleanupTestCase() {
+
+}
+
+QTEST_MAIN(RectQuadTreeTest)
+#include "testrectquadtree.moc"
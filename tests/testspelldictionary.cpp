@@ -0,0 +1,101 @@
+#include <QTest>
+#include <QTemporaryDir>
+#include <QFile>
+
+#include "text/spellchecker.h"
+
+class SpellDictionaryTest : public QObject
+{
+	Q_OBJECT
+public:
+private slots :
+	void initTestCase();
+
+	void testAffixes_data();
+	void testAffixes();
+
+	void testMisspelledWords();
+
+	void cleanupTestCase();
+
+private:
+
+	QTemporaryDir _dir;
+	Sabrina::SpellDictionary _dictionary;
+};
+
+void SpellDictionaryTest::initTestCase() {
+
+	QVERIFY(_dir.isValid());
+
+	QFile aff(_dir.filePath("test.aff"));
+	QVERIFY(aff.open(QIODevice::WriteOnly | QIODevice::Text));
+	aff.write("SET UTF-8\n"
+			  "\n"
+			  "PFX U Y 1\n"
+			  "PFX U 0 un .\n"
+			  "\n"
+			  "SFX S Y 2\n"
+			  "SFX S 0 s [^y]\n"
+			  "SFX S y ies y\n"
+			  "\n"
+			  "SFX D N 1\n"
+			  "SFX D 0 ed .\n");
+	aff.close();
+
+	QFile dic(_dir.filePath("test.dic"));
+	QVERIFY(dic.open(QIODevice::WriteOnly | QIODevice::Text));
+	dic.write("5\n"
+			  "cat/S\n"
+			  "story/S\n"
+			  "lock/UDS\n"
+			  "the\n"
+			  "l'\n");
+	dic.close();
+
+	QVERIFY(_dictionary.load(dic.fileName(), aff.fileName()));
+	QCOMPARE(_dictionary.stemsCount(), 5);
+}
+
+void SpellDictionaryTest::testAffixes_data() {
+
+	QTest::addColumn<QString>("word");
+	QTest::addColumn<bool>("known");
+
+	QTest::newRow("Stem") << QString("cat") << true;
+	QTest::newRow("Capitalized stem") << QString("Cat") << true;
+	QTest::newRow("Suffix") << QString("cats") << true;
+	QTest::newRow("Suffix with strip") << QString("stories") << true;
+	QTest::newRow("Suffix condition") << QString("storys") << false;
+	QTest::newRow("Missing flag") << QString("cated") << false;
+	QTest::newRow("Prefix") << QString("unlock") << true;
+	QTest::newRow("Cross product") << QString("unlocks") << true;
+	QTest::newRow("No cross product") << QString("unlocked") << false;
+	QTest::newRow("Unknown") << QString("dog") << false;
+}
+void SpellDictionaryTest::testAffixes() {
+
+	QFETCH(QString, word);
+	QFETCH(bool, known);
+
+	QCOMPARE(_dictionary.contains(word), known);
+}
+
+void SpellDictionaryTest::testMisspelledWords() {
+
+	QString text("The cats, l'cat and the dogs: a storys!");
+
+	QVector<QPair<int, int>> errors = Sabrina::SpellCheckWorker::misspelledWords(text, _dictionary);
+
+	QCOMPARE(errors.size(), 3); //single letter words are ignored.
+	QCOMPARE(text.mid(errors[0].first, errors[0].second), QString("and"));
+	QCOMPARE(text.mid(errors[1].first, errors[1].second), QString("dogs"));
+	QCOMPARE(text.mid(errors[2].first, errors[2].second), QString("storys"));
+}
+
+void SpellDictionaryTest::cleanupTestCase() {
+
+}
+
+QTEST_MAIN(SpellDictionaryTest)
+#include "testspelldictionary.moc"
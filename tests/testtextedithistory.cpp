@@ -0,0 +1,135 @@
+#include <QTest>
+
+#include "text/textnode.h"
+#include "gui/widgets/texteditcommands.h"
+
+class TextEditHistoryTest : public QObject
+{
+	Q_OBJECT
+public:
+private slots :
+	void initTestCase();
+
+	void testMergeAndRedo();
+	void testCountLimit();
+	void testMemoryBudget();
+
+	void cleanupTestCase();
+
+private:
+
+	//! \brief change the style of a node and record the change, as the editor does.
+	void pushStyle(Sabrina::TextEditHistory & history, Sabrina::TextNode* root, Sabrina::TextNode* node, int style);
+};
+
+void TextEditHistoryTest::pushStyle(Sabrina::TextEditHistory & history, Sabrina::TextNode* root, Sabrina::TextNode* node, int style) {
+	history.push(new Sabrina::NodeStyleCommand(root, node, node->styleId(), style));
+	node->setStyleId(style);
+}
+
+void TextEditHistoryTest::initTestCase() {
+
+}
+
+void TextEditHistoryTest::testMergeAndRedo() {
+
+	Sabrina::TextNode* root = new Sabrina::TextNode();
+	Sabrina::TextNode* node = root->insertNodeBelow(1,-1);
+	Sabrina::TextLine* line = node->lineAt(0);
+
+	Sabrina::TextEditHistory history(100, 1024*1024);
+
+	line->setText("a");
+	history.push(new Sabrina::LineTextCommand(root, line, "", "a"));
+	line->setText("ab");
+	history.push(new Sabrina::LineTextCommand(root, line, "a", "ab"));
+
+	QCOMPARE(history.count(), 1); //the keystrokes are merged.
+
+	qint64 size = history.byteSize();
+	QVERIFY(size > 0);
+
+	history.undo();
+	QCOMPARE(line->getText(), QString(""));
+	QVERIFY(!history.canUndo());
+
+	history.redo();
+	QCOMPARE(line->getText(), QString("ab"));
+	QVERIFY(!history.canRedo());
+
+	history.undo();
+	pushStyle(history, root, node, 2);
+
+	QCOMPARE(history.count(), 1); //the undone command cannot be redone anymore.
+	QVERIFY(!history.canRedo());
+	QVERIFY(history.byteSize() != size);
+
+	history.clear();
+	QCOMPARE(history.byteSize(), 0);
+
+	delete root;
+}
+
+void TextEditHistoryTest::testCountLimit() {
+
+	Sabrina::TextNode* root = new Sabrina::TextNode();
+	Sabrina::TextNode* node = root->insertNodeBelow(1,-1);
+
+	Sabrina::TextEditHistory history(3, 1024*1024);
+
+	for (int style = 2; style <= 6; style++) {
+		pushStyle(history, root, node, style);
+	}
+
+	QCOMPARE(history.count(), 3);
+	QCOMPARE(history.index(), 3);
+
+	while (history.canUndo()) {
+		history.undo();
+	}
+
+	QCOMPARE(node->styleId(), 3); //the two oldest changes have been dropped.
+
+	delete root;
+}
+
+void TextEditHistoryTest::testMemoryBudget() {
+
+	Sabrina::TextNode* root = new Sabrina::TextNode();
+	Sabrina::TextNode* node = root->insertNodeBelow(1,-1);
+
+	qint64 commandSize = Sabrina::NodeStyleCommand(root, node, 1, 2).byteSize();
+
+	Sabrina::TextEditHistory history(100, 2*commandSize + commandSize/2);
+
+	for (int style = 2; style <= 5; style++) {
+		pushStyle(history, root, node, style);
+	}
+
+	QCOMPARE(history.count(), 2);
+	QCOMPARE(history.byteSize(), 2*commandSize);
+
+	history.undo();
+	history.undo();
+	QCOMPARE(node->styleId(), 3);
+
+	//a command larger than the budget is still kept, as the last command.
+	Sabrina::TextEditHistory small(100, 1);
+
+	pushStyle(small, root, node, 7);
+	pushStyle(small, root, node, 8);
+
+	QCOMPARE(small.count(), 1);
+
+	small.undo();
+	QCOMPARE(node->styleId(), 7);
+
+	delete root;
+}
+
+void TextEditHistoryTest::cleanupTestCase() {
+
+}
+
+QTEST_MAIN(TextEditHistoryTest)
+#include "testtextedithistory.moc"
@@ -0,0 +1,176 @@
+#include <QTest>
+#include <QSignalSpy>
+
+#include "text/textnode.h"
+#include "text/textlayoutindex.h"
+
+#include <algorithm>
+
+class TextLayoutIndexTest : public QObject
+{
+	Q_OBJECT
+public:
+private slots :
+	void initTestCase();
+
+	void testTreeRebuild();
+	void testStructureEdits();
+
+	void cleanupTestCase();
+
+private:
+
+	//! \brief compare the order, the positions, the tops and the first lines of the index with the document.
+	void checkIndex(Sabrina::TextLayoutIndex & index, Sabrina::TextNode* root);
+	static void collect(Sabrina::TextNode* node, QVector<Sabrina::TextNode*> & out);
+};
+
+//exposes the tree functions of the index.
+class TestableLayoutIndex : public Sabrina::TextLayoutIndex
+{
+public:
+	using Sabrina::TextLayoutIndex::treeBuild;
+	using Sabrina::TextLayoutIndex::treeRebuildFrom;
+};
+
+void TextLayoutIndexTest::collect(Sabrina::TextNode* node, QVector<Sabrina::TextNode*> & out) {
+
+	out.push_back(node);
+
+	for (Sabrina::TextNode* child : node->childNodes()) {
+		collect(child, out);
+	}
+}
+
+void TextLayoutIndexTest::checkIndex(Sabrina::TextLayoutIndex & index, Sabrina::TextNode* root) {
+
+	QVector<Sabrina::TextNode*> nodes;
+	collect(root, nodes);
+
+	QCOMPARE(index.nodeCount(), nodes.size());
+
+	int top = 0;
+	int line = 0;
+
+	for (int i = 0; i < nodes.size(); i++) {
+		QCOMPARE(index.nodeAt(i), nodes[i]);
+		QCOMPARE(index.nodePosition(nodes[i]), i);
+		QCOMPARE(index.nodeTop(nodes[i]), top);
+		QCOMPARE(index.nodeFirstLine(nodes[i]), line);
+
+		top += index.nodeHeightHint(nodes[i]);
+		line += nodes[i]->nbTextLines();
+	}
+
+	QCOMPARE(index.totalHeight(), top);
+	QCOMPARE(index.lineCount(), line);
+}
+
+void TextLayoutIndexTest::initTestCase() {
+
+}
+
+void TextLayoutIndexTest::testTreeRebuild() {
+
+	QVector<int> values;
+
+	for (int i = 0; i < 37; i++) {
+		values.push_back(i*7 % 11);
+	}
+
+	for (int position = 0; position <= 40; position++) {
+
+		QVector<int> changed = values.mid(0, std::min(position, values.size()));
+
+		for (int i = changed.size(); i < 40; i++) {
+			changed.push_back(i*3 % 5 + 1);
+		}
+
+		QVector<int> tree;
+		TestableLayoutIndex::treeBuild(tree, values);
+		TestableLayoutIndex::treeRebuildFrom(tree, changed, std::min(position, values.size()));
+
+		QVector<int> expected;
+		TestableLayoutIndex::treeBuild(expected, changed);
+
+		QCOMPARE(tree, expected);
+	}
+}
+
+void TextLayoutIndexTest::testStructureEdits() {
+
+	Sabrina::TextNode* root = new Sabrina::TextNode();
+
+	for (int p = 0; p < 4; p++) {
+		Sabrina::TextNode* page = root->insertNodeBelow(2,-1);
+
+		for (int c = 0; c < 3; c++) {
+			Sabrina::TextNode* panel = page->insertNodeBelow(3,-1);
+			panel->setNbTextLines(c+1);
+		}
+	}
+
+	Sabrina::TextLayoutIndex index;
+	index.setDocument(root);
+
+	QVector<Sabrina::TextNode*> nodes;
+	collect(root, nodes);
+
+	for (int i = 0; i < nodes.size(); i++) {
+		index.setNodeHeight(nodes[i], 10 + i);
+	}
+
+	checkIndex(index, root);
+
+	QSignalSpy spy(&index, &Sabrina::TextLayoutIndex::layoutInvalidated);
+
+	//insertion in the middle of a page.
+	Sabrina::TextNode* page = root->childNodes()[1];
+	Sabrina::TextNode* added = page->insertNodeBelow(3, 1);
+	added->setNbTextLines(2);
+
+	QCOMPARE(spy.count(), 1);
+	QCOMPARE(spy.last().first().toInt(), index.nodePosition(added)); //the nodes before the new one are not affected.
+	QVERIFY(index.isNodeHeightExact(page)); //the known heights are kept.
+	checkIndex(index, root);
+
+	//removal of a whole page.
+	Sabrina::TextNode* removed = root->childNodes()[2];
+	int removedPos = index.nodePosition(removed);
+	removed->clearFromDoc();
+
+	QCOMPARE(spy.last().first().toInt(), removedPos);
+	QCOMPARE(index.nodePosition(removed), -1);
+	checkIndex(index, root);
+
+	//moves down and up, the moved nodes keep their height.
+	Sabrina::TextNode* moved = root->childNodes()[0]->childNodes()[0];
+	int movedHeight = index.nodeHeightHint(moved);
+
+	moved->moveNode(root->childNodes()[2], 2);
+	QCOMPARE(index.nodeHeightHint(moved), movedHeight);
+	checkIndex(index, root);
+
+	Sabrina::TextNode* movedPage = root->childNodes()[2];
+	movedPage->moveNode(root, 0);
+	QVERIFY(index.isNodeHeightExact(movedPage));
+	checkIndex(index, root);
+
+	//bulk insertion of subtrees.
+	QVector<Sabrina::TextNode::NodeSnapshot> snapshots = {root->childNodes()[0]->snapshot(), root->childNodes()[1]->snapshot()};
+	root->childNodes()[1]->insertSnapshotsBelow(snapshots, 1);
+	checkIndex(index, root);
+
+	//removal of the last node of the document.
+	root->childNodes().last()->lastNode()->clearFromDoc();
+	checkIndex(index, root);
+
+	delete root;
+}
+
+void TextLayoutIndexTest::cleanupTestCase() {
+
+}
+
+QTEST_MAIN(TextLayoutIndexTest)
+#include "testtextlayoutindex.moc"
@@ -1,5 +1,6 @@
 #include <QTest>
 #include <QMetaType>
+#include <QSignalSpy>
 
 #include "text/textnode.h"
 
@@ -23,6 +24,11 @@ private slots :
 	void testOffsetBetweenPosCalculator_data();
 	void testOffsetBetweenPosCalculator();
 
+	void testLineEditedSignal();
+
+	void testNodePathAndSnapshot();
+	void testBulkSnapshotsInsertion();
+
 	void cleanupTestCase();
 };
 
@@ -183,6 +189,122 @@ void TextNodeTest::testOffsetBetweenPosCalculator() {
 
 }
 
+void TextNodeTest::testLineEditedSignal() {
+
+	Sabrina::TextNode* root = new Sabrina::TextNode();
+	Sabrina::TextNode* child = root->insertNodeBelow(0,-1);
+	Sabrina::TextLine* line = child->lineAt(0);
+
+	QSignalSpy lineSpy(line, &Sabrina::TextLine::lineEdited);
+	QSignalSpy rootSpy(root, &Sabrina::TextNode::nodeEdited);
+
+	quint64 revision = line->revision();
+
+	line->setText("ABCD");
+
+	QCOMPARE(lineSpy.count(), 1);
+	QCOMPARE(rootSpy.count(), 1);
+	QCOMPARE(rootSpy.at(0).at(0).value<Sabrina::TextNode*>(), child);
+	QVERIFY(line->revision() != revision);
+
+	revision = line->revision();
+	line->setText("ABCD"); //same text, nothing changes.
+
+	QCOMPARE(lineSpy.count(), 1);
+	QCOMPARE(line->revision(), revision);
+
+	delete root;
+}
+
+void TextNodeTest::testNodePathAndSnapshot() {
+
+	Sabrina::TextNode* root = new Sabrina::TextNode();
+	Sabrina::TextNode* first = root->insertNodeBelow(1,-1);
+	Sabrina::TextNode* second = root->insertNodeBelow(1,-1);
+	Sabrina::TextNode* child = second->insertNodeBelow(2,-1);
+
+	child->setNbTextLines(2);
+	child->lineAt(0)->setText("AB");
+	child->lineAt(1)->setText("CD");
+
+	QCOMPARE(child->nodePath(), QVector<int>({1, 0}));
+	QCOMPARE(root->nodeAtPath(child->nodePath()), child);
+	QCOMPARE(root->nodeAtPath({}), root);
+	QVERIFY(root->nodeAtPath({2}) == nullptr);
+
+	Sabrina::TextNode::NodeSnapshot snap = second->snapshot();
+
+	second->clearFromDoc(false);
+	QCOMPARE(root->nbChildren(), 1);
+
+	Sabrina::TextNode* restored = root->insertSnapshotBelow(snap, 0);
+
+	QCOMPARE(restored->nodeIndex(), 0);
+	QCOMPARE(first->nodeIndex(), 1);
+	QCOMPARE(restored->styleId(), 1);
+	QCOMPARE(restored->nbChildren(), 1);
+
+	Sabrina::TextNode* restoredChild = restored->childNodes().first();
+
+	QCOMPARE(restoredChild->styleId(), 2);
+	QCOMPARE(restoredChild->nbTextLines(), 2);
+	QCOMPARE(restoredChild->lineAt(1)->getText(), QString("CD"));
+
+	delete second;
+	delete root;
+}
+
+void TextNodeTest::testBulkSnapshotsInsertion() {
+
+	Sabrina::TextNode* root = new Sabrina::TextNode();
+	Sabrina::TextNode* first = root->insertNodeBelow(1,-1);
+	Sabrina::TextNode* last = root->insertNodeBelow(1,-1);
+
+	QVector<Sabrina::TextNode::NodeSnapshot> snapshots;
+
+	for (int i = 0; i < 3; i++) {
+		Sabrina::TextNode::NodeSnapshot snap;
+		snap.styleId = 1;
+		snap.lines << QString("Node %1").arg(i);
+
+		Sabrina::TextNode::NodeSnapshot child;
+		child.styleId = 2;
+		child.lines << "A" << "B";
+		snap.children << child;
+
+		snapshots << snap;
+	}
+
+	QSignalSpy addedSpy(root, &Sabrina::TextNode::nodeAdded);
+	QSignalSpy bulkSpy(root, &Sabrina::TextNode::nodesAdded);
+	QSignalSpy editedSpy(root, &Sabrina::TextNode::nodeEdited);
+
+	QList<Sabrina::TextNode*> inserted = root->insertSnapshotsBelow(snapshots, 1);
+
+	QCOMPARE(inserted.size(), 3);
+	QCOMPARE(addedSpy.count(), 0);
+	QCOMPARE(editedSpy.count(), 0);
+	QCOMPARE(bulkSpy.count(), 1);
+	QCOMPARE(bulkSpy.first().at(1).toInt(), 1);
+	QCOMPARE(bulkSpy.first().at(2).toInt(), 3);
+
+	QCOMPARE(root->nbChildren(), 5);
+	QCOMPARE(first->nodeIndex(), 0);
+	QCOMPARE(last->nodeIndex(), 4);
+	QCOMPARE(inserted[2]->lineAt(0)->getText(), QString("Node 2"));
+	QCOMPARE(inserted[2]->childNodes().first()->lineAt(1)->getText(), QString("B"));
+	QCOMPARE(root->maxLine(), 1 + 2 + 3*3);
+
+	//the inserted nodes are connected like any other node.
+	inserted[1]->childNodes().first()->lineAt(0)->setText("C");
+	QCOMPARE(editedSpy.count(), 1);
+
+	//only detached nodes can be adopted.
+	QVERIFY(!root->adoptNodes({first}, 0));
+
+	delete root;
+}
+
 void TextNodeTest::cleanupTestCase() {
 
 }
@@ -0,0 +1,179 @@
+#include <QTest>
+#include <QSignalSpy>
+#include <QAbstractItemModelTester>
+
+#include "text/textnode.h"
+#include "text/textoutlinemodel.h"
+
+#include "testdocuments.h"
+
+class TextOutlineModelTest : public QObject
+{
+	Q_OBJECT
+public:
+private slots :
+	void initTestCase();
+
+	void testLazyFetch();
+	void testIncrementalUpdates();
+	void testIndexFromNode();
+
+	void cleanupTestCase();
+
+private:
+
+	void fetchAll(Sabrina::TextOutlineModel & model, QModelIndex const& parent = QModelIndex());
+};
+
+void TextOutlineModelTest::fetchAll(Sabrina::TextOutlineModel & model, QModelIndex const& parent) {
+
+	if (model.canFetchMore(parent)) {
+		model.fetchMore(parent);
+	}
+
+	for (int i = 0; i < model.rowCount(parent); i++) {
+		fetchAll(model, model.index(i, 0, parent));
+	}
+}
+
+void TextOutlineModelTest::initTestCase() {
+
+}
+
+void TextOutlineModelTest::testLazyFetch() {
+
+	Sabrina::TextNode* root = TestDocuments::buildOutlineDocument();
+
+	Sabrina::TextOutlineModel model;
+	QAbstractItemModelTester tester(&model, QAbstractItemModelTester::FailureReportingMode::QtTest);
+
+	model.setDocument(root);
+
+	QVERIFY(model.hasChildren());
+	QVERIFY(model.canFetchMore(QModelIndex()));
+
+	model.fetchMore(QModelIndex());
+	QCOMPARE(model.rowCount(), 3);
+
+	QModelIndex page = model.index(1, 0);
+	QCOMPARE(page.data().toString(), QString("Page 2"));
+	QCOMPARE(page.data(Sabrina::TextOutlineModel::StyleIdRole).toInt(), 2);
+
+	QVERIFY(model.hasChildren(page));
+	QCOMPARE(model.rowCount(page), 0); //not fetched yet.
+
+	model.fetchMore(page);
+	QCOMPARE(model.rowCount(page), 2);
+
+	QModelIndex panel = model.index(1, 0, page);
+	QCOMPARE(panel.data().toString(), QString("Panel 2.2"));
+	QCOMPARE(model.parent(panel), page);
+
+	model.setMaxDepth(2);
+	fetchAll(model);
+
+	panel = model.index(0, 0, model.index(0, 0));
+	QCOMPARE(panel.data().toString(), QString("Panel 1.1"));
+	QVERIFY(!model.hasChildren(panel)); //dialogs are below the maximal depth.
+
+	delete root;
+}
+
+void TextOutlineModelTest::testIncrementalUpdates() {
+
+	Sabrina::TextNode* root = TestDocuments::buildOutlineDocument();
+
+	Sabrina::TextOutlineModel model;
+	QAbstractItemModelTester tester(&model, QAbstractItemModelTester::FailureReportingMode::QtTest);
+
+	model.setDocument(root);
+	fetchAll(model);
+
+	QSignalSpy resetSpy(&model, &QAbstractItemModel::modelReset);
+	QSignalSpy insertSpy(&model, &QAbstractItemModel::rowsInserted);
+	QSignalSpy removeSpy(&model, &QAbstractItemModel::rowsRemoved);
+	QSignalSpy moveSpy(&model, &QAbstractItemModel::rowsMoved);
+	QSignalSpy changeSpy(&model, &QAbstractItemModel::dataChanged);
+
+	Sabrina::TextNode* page1 = root->childNodes()[0];
+	Sabrina::TextNode* page2 = root->childNodes()[1];
+
+	//insertion.
+	Sabrina::TextNode* panel = page1->insertNodeBelow(3, 1);
+	panel->lineAt(0)->setText("New panel");
+
+	QCOMPARE(insertSpy.count(), 1);
+	QCOMPARE(insertSpy[0][0].value<QModelIndex>(), model.index(0, 0));
+	QCOMPARE(insertSpy[0][1].toInt(), 1);
+	QCOMPARE(model.rowCount(model.index(0, 0)), 3);
+	QCOMPARE(model.index(1, 0, model.index(0, 0)).data().toString(), QString("New panel"));
+	QCOMPARE(model.index(2, 0, model.index(0, 0)).data().toString(), QString("Panel 1.2"));
+	QCOMPARE(changeSpy.count(), 1);
+
+	//bulk insertion.
+	root->insertSnapshotsBelow({page1->snapshot(), page1->snapshot()}, 3);
+
+	QCOMPARE(insertSpy.count(), 2);
+	QCOMPARE(insertSpy[1][1].toInt(), 3);
+	QCOMPARE(insertSpy[1][2].toInt(), 4);
+	QCOMPARE(model.rowCount(), 5);
+
+	//move between parents.
+	panel->moveNode(page2, 0);
+
+	QCOMPARE(moveSpy.count(), 1);
+	QCOMPARE(model.rowCount(model.index(0, 0)), 2);
+	QCOMPARE(model.rowCount(model.index(1, 0)), 3);
+	QCOMPARE(model.index(0, 0, model.index(1, 0)).data().toString(), QString("New panel"));
+	QCOMPARE(model.parent(model.index(0, 0, model.index(1, 0))), model.index(1, 0));
+
+	//move in the same parent.
+	page1->moveNode(root, 2);
+
+	QCOMPARE(moveSpy.count(), 2);
+	QCOMPARE(model.index(0, 0).data().toString(), QString("Page 2"));
+	QCOMPARE(model.index(2, 0).data().toString(), QString("Page 1"));
+
+	//removal.
+	page2->clearFromDoc(false);
+
+	QCOMPARE(removeSpy.count(), 1);
+	QCOMPARE(removeSpy[0][1].toInt(), 0);
+	QCOMPARE(model.rowCount(), 4);
+	QCOMPARE(model.index(0, 0).data().toString(), QString("Page 3"));
+
+	QCOMPARE(resetSpy.count(), 0);
+
+	delete page2;
+	delete root;
+}
+
+void TextOutlineModelTest::testIndexFromNode() {
+
+	Sabrina::TextNode* root = TestDocuments::buildOutlineDocument();
+
+	Sabrina::TextOutlineModel model;
+	model.setDocument(root);
+
+	Sabrina::TextNode* dialog = root->childNodes()[2]->childNodes()[1]->childNodes()[0];
+
+	QModelIndex index = model.indexFromNode(dialog);
+
+	QVERIFY(index.isValid());
+	QCOMPARE(model.nodeFromIndex(index), dialog);
+	QCOMPARE(model.nodeFromIndex(index.parent().parent()), root->childNodes()[2]);
+	QCOMPARE(index.parent().row(), 1);
+
+	model.setMaxDepth(2);
+	QVERIFY(!model.indexFromNode(dialog).isValid());
+	QVERIFY(model.indexFromNode(dialog->parentNode()).isValid());
+
+	delete root;
+}
+
+void TextOutlineModelTest::cleanupTestCase() {
+
+}
+
+QTEST_MAIN(TextOutlineModelTest)
+#include "testtextoutlinemodel.moc"
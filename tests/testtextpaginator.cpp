@@ -0,0 +1,229 @@
+#include <QTest>
+#include <QSignalSpy>
+#include <QPageLayout>
+
+#include "text/textnode.h"
+#include "text/textpaginator.h"
+#include "text/textlayoutindex.h"
+
+#include "testdocuments.h"
+
+class TextPaginatorTest : public QObject
+{
+	Q_OBJECT
+public:
+private slots :
+	void initTestCase();
+
+	void testPageStarts();
+	void testForcedBreaks();
+	void testRelayout();
+	void testLazyPagination();
+	void testStructureEdits();
+
+	void cleanupTestCase();
+
+private:
+
+	//! \brief set a page area of 60x100 pixels and give each node below the root the same height, if nodeHeight is not negative.
+	void setupPaginator(Sabrina::TextPaginator & paginator, Sabrina::TextNode* root, int nodeHeight);
+	//! \brief compare the pages of the paginator with the pages of a new paginator on the same document, with the same node heights.
+	void checkPages(Sabrina::TextPaginator & paginator, Sabrina::TextNode* root);
+};
+
+void TextPaginatorTest::setupPaginator(Sabrina::TextPaginator & paginator, Sabrina::TextNode* root, int nodeHeight) {
+
+	//no style manager is set, the nodes whose height is not set have a null height.
+	paginator.setPageLayout(QPageLayout(QPageSize(QSizeF(100, 140), QPageSize::Point),
+										QPageLayout::Portrait,
+										QMarginsF(20, 20, 20, 20),
+										QPageLayout::Point), 72);
+	paginator.setDocument(root);
+
+	Sabrina::TextLayoutIndex* index = paginator.layoutIndex();
+	index->setNodeHeight(root, 0);
+
+	if (nodeHeight < 0) {
+		return;
+	}
+
+	for (int i = 0; i < root->nbChildren(); i++) {
+		index->setNodeHeight(root->childNodes().at(i), nodeHeight);
+	}
+}
+
+void TextPaginatorTest::checkPages(Sabrina::TextPaginator & paginator, Sabrina::TextNode* root) {
+
+	Sabrina::TextPaginator fresh;
+	setupPaginator(fresh, root, -1);
+	fresh.setPageBreakStyles(paginator.pageBreakStyles());
+
+	for (Sabrina::TextNode* node : root->childNodes()) {
+		fresh.layoutIndex()->setNodeHeight(node, paginator.layoutIndex()->nodeHeightHint(node));
+	}
+
+	QCOMPARE(paginator.pageCount(), fresh.pageCount());
+
+	for (int p = 0; p < fresh.pageCount(); p++) {
+		QCOMPARE(paginator.nodesOfPage(p), fresh.nodesOfPage(p));
+	}
+}
+
+void TextPaginatorTest::initTestCase() {
+
+}
+
+void TextPaginatorTest::testPageStarts() {
+
+	Sabrina::TextNode* root = TestDocuments::buildPaginationDocument();
+
+	Sabrina::TextPaginator paginator;
+	setupPaginator(paginator, root, 30);
+
+	QCOMPARE(paginator.pageArea().size(), QSize(60, 100));
+
+	//three nodes of 30 fit on a page of 100, the root is on the first page.
+	QCOMPARE(paginator.pageCount(), 4);
+	QVERIFY(paginator.isComplete());
+
+	QCOMPARE(paginator.firstNodeOfPage(0), root);
+	QCOMPARE(paginator.firstNodeOfPage(1), root->childNodes().at(3));
+	QCOMPARE(paginator.nodesOfPage(0), QVector<Sabrina::TextNode*>({root, root->childNodes().at(0), root->childNodes().at(1), root->childNodes().at(2)}));
+	QCOMPARE(paginator.nodesOfPage(2), QVector<Sabrina::TextNode*>({root->childNodes().at(6), root->childNodes().at(7), root->childNodes().at(8)}));
+	QCOMPARE(paginator.nodesOfPage(3), QVector<Sabrina::TextNode*>({root->childNodes().at(9)}));
+
+	QCOMPARE(paginator.firstNodeOfPage(4), static_cast<Sabrina::TextNode*>(nullptr));
+	QVERIFY(paginator.nodesOfPage(4).isEmpty());
+
+	delete root;
+}
+
+void TextPaginatorTest::testForcedBreaks() {
+
+	Sabrina::TextNode* root = TestDocuments::buildPaginationDocument();
+
+	Sabrina::TextPaginator paginator;
+	setupPaginator(paginator, root, 30);
+
+	QCOMPARE(paginator.pageCount(), 4);
+	QCOMPARE(paginator.firstNodeOfPage(2), root->childNodes().at(6));
+
+	paginator.setPageBreakStyles({TestDocuments::PageBreakStyle});
+
+	QVERIFY(!paginator.isComplete());
+
+	//the sixth node start a page even if the second page is not full.
+	QCOMPARE(paginator.pageCount(), 4);
+	QCOMPARE(paginator.nodesOfPage(1), QVector<Sabrina::TextNode*>({root->childNodes().at(3), root->childNodes().at(4)}));
+	QCOMPARE(paginator.firstNodeOfPage(2), root->childNodes().at(5));
+	QCOMPARE(paginator.firstNodeOfPage(3), root->childNodes().at(8));
+	QCOMPARE(paginator.pageOfNode(root->childNodes().at(6)), 2);
+	QCOMPARE(paginator.pageOfNode(root->childNodes().at(9)), 3);
+
+	delete root;
+}
+
+void TextPaginatorTest::testRelayout() {
+
+	Sabrina::TextNode* root = TestDocuments::buildPaginationDocument();
+
+	Sabrina::TextPaginator paginator;
+	setupPaginator(paginator, root, 30);
+	paginator.setPageBreakStyles({TestDocuments::PageBreakStyle});
+
+	QCOMPARE(paginator.pageCount(), 4);
+
+	QSignalSpy spy(&paginator, &Sabrina::TextPaginator::pagesChanged);
+
+	//the fifth node does not fit on the second page anymore.
+	paginator.layoutIndex()->setNodeHeight(root->childNodes().at(4), 80);
+
+	QCOMPARE(spy.count(), 1);
+	QCOMPARE(spy.first().first().toInt(), 1);
+	QCOMPARE(paginator.knownPageCount(), 2); //the pages before the node are kept.
+
+	QCOMPARE(paginator.pageCount(), 5);
+	QCOMPARE(paginator.nodesOfPage(1), QVector<Sabrina::TextNode*>({root->childNodes().at(3)}));
+	QCOMPARE(paginator.nodesOfPage(2), QVector<Sabrina::TextNode*>({root->childNodes().at(4)}));
+	QCOMPARE(paginator.firstNodeOfPage(3), root->childNodes().at(5));
+
+	delete root;
+}
+
+void TextPaginatorTest::testLazyPagination() {
+
+	Sabrina::TextNode* root = TestDocuments::buildPaginationDocument();
+
+	Sabrina::TextPaginator paginator;
+	setupPaginator(paginator, root, -1);
+
+	//only the heights of the first nodes are set.
+	Sabrina::TextLayoutIndex* index = paginator.layoutIndex();
+	index->setNodeHeight(root->childNodes().at(0), 60);
+	index->setNodeHeight(root->childNodes().at(1), 60);
+
+	QVERIFY(!index->isNodeHeightExact(root->childNodes().at(2)));
+
+	QCOMPARE(paginator.firstNodeOfPage(1), root->childNodes().at(1));
+	QCOMPARE(paginator.pageOfNode(root->childNodes().at(0)), 0);
+	QCOMPARE(paginator.estimatedPageCount(), 2);
+	QVERIFY(!paginator.isComplete());
+
+	//only the nodes of the first page and the start of the second one have been laid out.
+	for (int i = 2; i < root->nbChildren(); i++) {
+		QVERIFY(!index->isNodeHeightExact(root->childNodes().at(i)));
+	}
+
+	//the nodes after the second one are empty, they all fit on the second page.
+	QVERIFY(paginator.computePages(1));
+	QCOMPARE(paginator.pageCount(), 2);
+	QVERIFY(index->isNodeHeightExact(root->childNodes().at(9)));
+
+	delete root;
+}
+
+void TextPaginatorTest::testStructureEdits() {
+
+	Sabrina::TextNode* root = TestDocuments::buildPaginationDocument();
+
+	Sabrina::TextPaginator paginator;
+	setupPaginator(paginator, root, 30);
+	paginator.setPageBreakStyles({TestDocuments::PageBreakStyle});
+
+	QCOMPARE(paginator.pageCount(), 4);
+
+	QSignalSpy spy(&paginator, &Sabrina::TextPaginator::pagesChanged);
+
+	//insertion on the third page, the first pages are kept.
+	Sabrina::TextNode* added = root->insertNodeBelow(1, 7);
+	paginator.layoutIndex()->setNodeHeight(added, 30);
+
+	QVERIFY(spy.count() > 0);
+
+	for (const QList<QVariant> & args : spy) {
+		QVERIFY(args.first().toInt() >= 2);
+	}
+
+	checkPages(paginator, root);
+
+	//a new forced break after the known ones.
+	spy.clear();
+	root->childNodes().at(9)->setStyleId(TestDocuments::PageBreakStyle);
+
+	QCOMPARE(spy.count(), 1);
+	QVERIFY(spy.first().first().toInt() >= 2);
+	checkPages(paginator, root);
+
+	//the forced break of the sixth node is removed.
+	root->childNodes().at(5)->clearFromDoc();
+	checkPages(paginator, root);
+
+	delete root;
+}
+
+void TextPaginatorTest::cleanupTestCase() {
+
+}
+
+QTEST_MAIN(TextPaginatorTest)
+#include "testtextpaginator.moc"
@@ -0,0 +1,205 @@
+#include <QTest>
+#include <QSignalSpy>
+
+#include "text/textnode.h"
+#include "text/textsearchengine.h"
+
+#include "testdocuments.h"
+
+class TextSearchEngineTest : public QObject
+{
+	Q_OBJECT
+public:
+private slots :
+	void initTestCase();
+
+	void testQueryModes_data();
+	void testQueryModes();
+
+	void testStyleFilter();
+	void testIncrementalUpdate();
+	void testReplacements();
+
+	void cleanupTestCase();
+};
+
+void TextSearchEngineTest::initTestCase() {
+
+}
+
+void TextSearchEngineTest::testQueryModes_data() {
+
+	QTest::addColumn<int>("mode");
+	QTest::addColumn<QString>("pattern");
+	QTest::addColumn<bool>("caseSensitive");
+	QTest::addColumn<int>("expectedCount");
+
+	QTest::newRow("Plain") << static_cast<int>(Sabrina::TextSearchEngine::Mode::Plain) << QString("cat") << false << 6;
+	QTest::newRow("Plain case sensitive") << static_cast<int>(Sabrina::TextSearchEngine::Mode::Plain) << QString("cat") << true << 5;
+	QTest::newRow("Whole word") << static_cast<int>(Sabrina::TextSearchEngine::Mode::WholeWord) << QString("cat") << false << 5;
+	QTest::newRow("Regex") << static_cast<int>(Sabrina::TextSearchEngine::Mode::RegularExpression) << QString("cat \\d+") << false << 1;
+	QTest::newRow("Invalid regex") << static_cast<int>(Sabrina::TextSearchEngine::Mode::RegularExpression) << QString("cat(") << false << 0;
+}
+
+void TextSearchEngineTest::testQueryModes() {
+
+	QFETCH(int, mode);
+	QFETCH(QString, pattern);
+	QFETCH(bool, caseSensitive);
+	QFETCH(int, expectedCount);
+
+	Sabrina::TextNode* root = TestDocuments::buildSearchDocument();
+
+	Sabrina::TextSearchEngine engine;
+	engine.setDocument(root);
+
+	Sabrina::TextSearchEngine::Query query;
+	query.pattern = pattern;
+	query.mode = static_cast<Sabrina::TextSearchEngine::Mode>(mode);
+	query.caseSensitivity = (caseSensitive) ? Qt::CaseSensitive : Qt::CaseInsensitive;
+
+	engine.setQuery(query);
+
+	QCOMPARE(engine.matchCount(), expectedCount);
+
+	//the matches are in document order.
+	QVector<Sabrina::TextSearchEngine::Match> const& matches = engine.matches();
+
+	for (int i = 1; i < matches.size(); i++) {
+		QVERIFY(matches[i-1].lineNumber < matches[i].lineNumber or
+				(matches[i-1].lineNumber == matches[i].lineNumber and matches[i-1].pos < matches[i].pos));
+	}
+
+	delete root;
+}
+
+void TextSearchEngineTest::testStyleFilter() {
+
+	Sabrina::TextNode* root = TestDocuments::buildSearchDocument();
+
+	Sabrina::TextSearchEngine engine;
+	engine.setDocument(root);
+
+	Sabrina::TextSearchEngine::Query query;
+	query.pattern = "cat";
+	query.styles = {2};
+
+	engine.setQuery(query);
+
+	QCOMPARE(engine.matchCount(), 3);
+	QCOMPARE(engine.matches().first().lineNumber, 2);
+
+	QCOMPARE(engine.matchIndexAfter(3, 0), 1);
+	QCOMPARE(engine.matchIndexAfter(3, 14), -1);
+	QCOMPARE(engine.matchIndexBefore(3, 0), 0);
+
+	delete root;
+}
+
+void TextSearchEngineTest::testIncrementalUpdate() {
+
+	Sabrina::TextNode* root = TestDocuments::buildSearchDocument();
+
+	Sabrina::TextSearchEngine engine;
+	engine.setDocument(root);
+
+	Sabrina::TextSearchEngine::Query query;
+	query.pattern = "cat";
+	query.mode = Sabrina::TextSearchEngine::Mode::WholeWord;
+
+	engine.setQuery(query);
+	QCOMPARE(engine.matchCount(), 5);
+
+	QSignalSpy spy(&engine, &Sabrina::TextSearchEngine::matchesChanged);
+
+	Sabrina::TextLine* line = root->childNodes()[0]->lineAt(0);
+	line->setText("A cat sits on the cat walk");
+
+	QCOMPARE(spy.count(), 1);
+	QCOMPARE(engine.matchCount(), 6);
+	QCOMPARE(engine.matches()[2].line, line);
+	QCOMPARE(engine.matches()[2].pos, 18);
+
+	//an edit which does not change the matches is not notified.
+	line->setText("A cat sits on the cat walk!");
+	QCOMPARE(spy.count(), 1);
+
+	Sabrina::TextNode* added = root->insertNodeBelow(1,-1);
+	added->lineAt(0)->setText("cat");
+
+	QCOMPARE(engine.matchCount(), 7);
+	QCOMPARE(engine.matches().last().lineNumber, 4);
+
+	root->childNodes()[0]->clearFromDoc(false);
+	QCOMPARE(engine.matchCount(), 5);
+
+	delete root;
+}
+
+void TextSearchEngineTest::testReplacements() {
+
+	Sabrina::TextNode* root = TestDocuments::buildSearchDocument();
+
+	Sabrina::TextSearchEngine engine;
+	engine.setDocument(root);
+
+	Sabrina::TextSearchEngine::Query query;
+	query.pattern = "(cat) (\\d+)";
+	query.mode = Sabrina::TextSearchEngine::Mode::RegularExpression;
+
+	engine.setQuery(query);
+
+	QVector<Sabrina::TextSearchEngine::LineReplacement> replacements = engine.replacements("\\2 \\1s");
+
+	QCOMPARE(replacements.size(), 1);
+	QCOMPARE(replacements.first().text, QString("Another cat, 42 cats"));
+
+	query.pattern = "cat";
+	query.mode = Sabrina::TextSearchEngine::Mode::WholeWord;
+	engine.setQuery(query);
+
+	replacements = engine.replacements("dog");
+
+	QCOMPARE(replacements.size(), 4);
+	QCOMPARE(replacements[1].text, QString("A dog sits on the catwalk"));
+	QCOMPARE(replacements[3].text, QString("Another dog, dog 42"));
+
+	//a style change dropping lines, as done by the editor, does not leave the removed lines in the replacements.
+	Sabrina::TextNode* dialog = root->childNodes()[1];
+	dialog->setStyleId(3);
+	dialog->setNbTextLines(1);
+
+	replacements = engine.replacements("dog");
+
+	QCOMPARE(replacements.size(), 3);
+	QCOMPARE(replacements.last().line, dialog->lineAt(0));
+	QCOMPARE(replacements.last().text, QString("dog"));
+
+	delete root;
+
+	//the groups and the lookaheads are evaluated in the original text, not in the partially replaced one.
+	root = new Sabrina::TextNode();
+	root->lineAt(0)->setText("aaa");
+
+	engine.setDocument(root);
+
+	query.pattern = "(a)(?=a)";
+	query.mode = Sabrina::TextSearchEngine::Mode::RegularExpression;
+	engine.setQuery(query);
+
+	QCOMPARE(engine.matchCount(), 2);
+
+	replacements = engine.replacements("[\\1]");
+
+	QCOMPARE(replacements.size(), 1);
+	QCOMPARE(replacements.first().text, QString("[a][a]a"));
+
+	delete root;
+}
+
+void TextSearchEngineTest::cleanupTestCase() {
+
+}
+
+QTEST_MAIN(TextSearchEngineTest)
+#include "testtextsearchengine.moc"
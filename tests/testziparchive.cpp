@@ -0,0 +1,197 @@
+#include <QTest>
+#include <QTemporaryDir>
+#include <QDataStream>
+#include <QFile>
+
+#include <zlib.h>
+
+#include "utils/ziparchive.h"
+
+class ZipArchiveTest : public QObject
+{
+	Q_OBJECT
+public:
+private slots :
+	void initTestCase();
+
+	void testEntries();
+	void testStoredEntry();
+	void testDeflatedEntry();
+	void testCorruptedEntry();
+	void testOversizedEntry();
+	void testInvalidFile();
+
+	void cleanupTestCase();
+
+private:
+
+	struct Entry {
+		QString name;
+		QByteArray data;
+		bool deflated;
+	};
+
+	static bool writeZip(QString const& file, QVector<Entry> const& entries, bool corruptCrc = false);
+
+	QTemporaryDir _dir;
+	QString _zipFile;
+	QByteArray _text;
+};
+
+bool ZipArchiveTest::writeZip(QString const& file, QVector<Entry> const& entries, bool corruptCrc) {
+
+	QFile zip(file);
+
+	if (!zip.open(QIODevice::WriteOnly)) {
+		return false;
+	}
+
+	QDataStream stream(&zip);
+	stream.setByteOrder(QDataStream::LittleEndian);
+
+	QByteArray directory;
+	QDataStream directoryStream(&directory, QIODevice::WriteOnly);
+	directoryStream.setByteOrder(QDataStream::LittleEndian);
+
+	for (Entry const& entry : entries) {
+
+		QByteArray name = entry.name.toUtf8();
+		QByteArray data = entry.data;
+
+		quint32 crc = crc32(crc32(0L, Z_NULL, 0), reinterpret_cast<Bytef const*>(data.constData()), data.size());
+
+		if (corruptCrc) {
+			crc ^= 1;
+		}
+
+		if (entry.deflated) {
+			//a zlib stream is the raw deflate data with a 2 bytes header and a 4 bytes checksum.
+			QByteArray compressed(compressBound(data.size()), Qt::Uninitialized);
+			uLongf compressedSize = compressed.size();
+			compress2(reinterpret_cast<Bytef*>(compressed.data()), &compressedSize, reinterpret_cast<Bytef const*>(data.constData()), data.size(), 9);
+			data = compressed.mid(2, static_cast<int>(compressedSize) - 6);
+		}
+
+		quint16 method = entry.deflated ? 8 : 0;
+		quint32 offset = static_cast<quint32>(zip.pos());
+
+		stream << quint32(0x04034b50) << quint16(20) << quint16(0) << method << quint16(0) << quint16(0)
+			   << crc << quint32(data.size()) << quint32(entry.data.size()) << quint16(name.size()) << quint16(0);
+		stream.writeRawData(name.constData(), name.size());
+		stream.writeRawData(data.constData(), data.size());
+
+		directoryStream << quint32(0x02014b50) << quint16(20) << quint16(20) << quint16(0) << method << quint16(0) << quint16(0)
+						<< crc << quint32(data.size()) << quint32(entry.data.size()) << quint16(name.size())
+						<< quint16(0) << quint16(0) << quint16(0) << quint16(0) << quint32(0) << offset;
+		directoryStream.writeRawData(name.constData(), name.size());
+	}
+
+	quint32 directoryOffset = static_cast<quint32>(zip.pos());
+	stream.writeRawData(directory.constData(), directory.size());
+
+	stream << quint32(0x06054b50) << quint16(0) << quint16(0) << quint16(entries.size()) << quint16(entries.size())
+		   << quint32(directory.size()) << directoryOffset << quint16(0);
+
+	return stream.status() == QDataStream::Ok;
+}
+
+void ZipArchiveTest::initTestCase() {
+
+	QVERIFY(_dir.isValid());
+
+	for (int i = 0; i < 200; i++) {
+		_text += "Sabrina reads the layers of the maps. ";
+	}
+
+	_zipFile = _dir.filePath("archive.zip");
+
+	QVERIFY(writeZip(_zipFile, {{"mimetype", "image/openraster", false},
+								{"data/text.txt", _text, true}}));
+}
+
+void ZipArchiveTest::testEntries() {
+
+	Sabrina::ZipArchive archive(_zipFile);
+
+	QVERIFY(archive.isValid());
+	QCOMPARE(archive.entries(), QStringList({"mimetype", "data/text.txt"}));
+	QVERIFY(archive.contains("data/text.txt"));
+	QVERIFY(!archive.contains("data"));
+	QCOMPARE(archive.entrySize("data/text.txt"), qint64(_text.size()));
+	QCOMPARE(archive.entrySize("missing"), qint64(-1));
+}
+
+void ZipArchiveTest::testStoredEntry() {
+
+	Sabrina::ZipArchive archive(_zipFile);
+	QCOMPARE(archive.read("mimetype"), QByteArray("image/openraster"));
+}
+
+void ZipArchiveTest::testDeflatedEntry() {
+
+	Sabrina::ZipArchive archive(_zipFile);
+	QCOMPARE(archive.read("data/text.txt"), _text);
+	QVERIFY(archive.read("missing").isEmpty());
+}
+
+void ZipArchiveTest::testCorruptedEntry() {
+
+	QString file = _dir.filePath("corrupted.zip");
+	QVERIFY(writeZip(file, {{"data.txt", _text, true}}, true));
+
+	Sabrina::ZipArchive archive(file);
+
+	QVERIFY(archive.isValid());
+	QVERIFY(archive.read("data.txt").isEmpty()); //the checksum does not match.
+}
+
+void ZipArchiveTest::testOversizedEntry() {
+
+	QString file = _dir.filePath("oversized.zip");
+	QVERIFY(writeZip(file, {{"data.txt", _text, true}}));
+
+	QFile zip(file);
+	QVERIFY(zip.open(QIODevice::ReadWrite));
+	QByteArray content = zip.readAll();
+
+	//set the uncompressed size of the central directory to the zip64 marker.
+	int header = content.indexOf(QByteArray::fromHex("504b0102"));
+	QVERIFY(header >= 0);
+	QVERIFY(zip.seek(header + 24));
+	zip.write(QByteArray::fromHex("ffffffff"));
+	zip.close();
+
+	Sabrina::ZipArchive archive(file);
+	QString error;
+
+	QVERIFY(archive.isValid());
+	QVERIFY(archive.read("data.txt", &error).isEmpty());
+	QVERIFY(!error.isEmpty());
+
+	Sabrina::ZipArchive valid(_zipFile);
+	QCOMPARE(valid.read("data/text.txt", &error), _text);
+	QVERIFY(error.isEmpty());
+}
+
+void ZipArchiveTest::testInvalidFile() {
+
+	QString file = _dir.filePath("notazip.txt");
+
+	QFile text(file);
+	QVERIFY(text.open(QIODevice::WriteOnly));
+	text.write(_text);
+	text.close();
+
+	Sabrina::ZipArchive archive;
+
+	QVERIFY(!archive.open(file));
+	QVERIFY(!archive.isValid());
+	QVERIFY(!archive.open(_dir.filePath("missing.zip")));
+}
+
+void ZipArchiveTest::cleanupTestCase() {
+
+}
+
+QTEST_MAIN(ZipArchiveTest)
+#include "testziparchive.moc"